@@ -0,0 +1,131 @@
+// This is a tool that replays a recorded QScintilla session without a display
+// and reports the latency of each step.  If API files are given then the keys
+// typed in the session also build auto-completion lists from them, so that the
+// latency of each keystroke includes the time taken to build the list.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include <stdio.h>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QStringList>
+
+#include <Qsci/qsciapis.h>
+#include <Qsci/qscilexercpp.h>
+#include <Qsci/qsciscintilla.h>
+#include <Qsci/qscisessionreplayer.h>
+
+
+int main(int argc, char **argv)
+{
+    // Don't require a display unless a platform has been explicitly chosen.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+            "Replay a recorded QScintilla session and report the latencies.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("real-time",
+            "Replay each step at the time it was recorded."));
+    parser.addOption(QCommandLineOption("steps",
+            "List the latency of every step."));
+    parser.addOption(QCommandLineOption("apis",
+            "Auto-complete from the API <file> as the session is typed.  "
+            "This may be given more than once.",
+            "file"));
+    parser.addOption(QCommandLineOption("completion-limit",
+            "Limit auto-completion lists to <entries> entries.", "entries",
+            "0"));
+    parser.addPositionalArgument("session", "The recorded session.");
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+
+    if (args.size() != 1)
+        parser.showHelp(2);
+
+    QsciScintilla editor;
+    editor.show();
+
+    if (parser.isSet("apis"))
+    {
+        // The lexer is only used for its APIs and word characters.
+        QsciLexerCPP *lexer = new QsciLexerCPP(&editor);
+        QsciAPIs *apis = new QsciAPIs(lexer);
+        QStringList files = parser.values("apis");
+
+        for (int i = 0; i < files.size(); ++i)
+            if (!apis->load(files.at(i)))
+            {
+                fprintf(stderr, "%s: unable to load the APIs\n",
+                        qPrintable(files.at(i)));
+                return 1;
+            }
+
+        // Wait for the APIs to be prepared so that it isn't measured.
+        QEventLoop loop;
+        QObject::connect(apis, SIGNAL(apiPreparationFinished()), &loop,
+                SLOT(quit()));
+        apis->prepare();
+        loop.exec();
+
+        editor.setLexer(lexer);
+        editor.setAutoCompletionSource(QsciScintilla::AcsAll);
+        editor.setAutoCompletionThreshold(1);
+        editor.setAutoCompletionLimit(
+                parser.value("completion-limit").toInt());
+    }
+
+    // The replayer is owned by the editor.
+    QsciSessionReplayer *replayer = new QsciSessionReplayer(&editor);
+
+    if (!replayer->load(args.at(0)))
+    {
+        fprintf(stderr, "%s: unable to load the session\n",
+                qPrintable(args.at(0)));
+        return 1;
+    }
+
+    if (!replayer->replay(parser.isSet("real-time")))
+    {
+        fprintf(stderr, "%s: the session is corrupt\n",
+                qPrintable(args.at(0)));
+        return 1;
+    }
+
+    if (parser.isSet("steps"))
+    {
+        for (int i = 0; i < replayer->stepCount(); ++i)
+            printf("%10lld %10lld %s\n",
+                    static_cast<long long>(replayer->stepTime(i)),
+                    static_cast<long long>(replayer->stepLatency(i)),
+                    qPrintable(replayer->stepDescription(i)));
+
+        printf("\n");
+    }
+
+    printf("%s", qPrintable(replayer->report()));
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+CONFIG      += qscintilla2 console
+CONFIG      -= app_bundle
+
+QT          += widgets
+
+SOURCES      = main.cpp
@@ -63,6 +63,20 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_CANREDO 2016
 #define SCI_MARKERLINEFROMHANDLE 2017
 #define SCI_MARKERDELETEHANDLE 2018
+#define SC_ANCHORGRAVITY_BEFORE 0
+#define SC_ANCHORGRAVITY_AFTER 1
+#define SCI_POSITIONANCHORADD 2725
+#define SCI_POSITIONANCHORDELETE 2726
+#define SCI_POSITIONANCHORDELETEAT 2727
+#define SCI_POSITIONANCHORDELETEALL 2728
+#define SCI_POSITIONANCHORPOSITION 2729
+#define SCI_POSITIONANCHORCOUNT 2730
+#define SCI_POSITIONANCHORINDEXFROMPOSITION 2731
+#define SCI_POSITIONANCHORHANDLEAT 2732
+#define SCI_POSITIONANCHORPOSITIONAT 2733
+#define SCI_POSITIONANCHORGRAVITYAT 2734
+#define SCI_POSITIONANCHORPOSITIONS 2752
+#define SCI_POSITIONANCHORDELETEHANDLES 2753
 #define SCI_GETUNDOCOLLECTION 2019
 #define SCWS_INVISIBLE 0
 #define SCWS_VISIBLEALWAYS 1
@@ -96,6 +110,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_CLEARTABSTOPS 2675
 #define SCI_ADDTABSTOP 2676
 #define SCI_GETNEXTTABSTOP 2677
+#define SCI_SETELASTICTABSTOPS 2719
+#define SCI_GETELASTICTABSTOPS 2720
 #define SC_CP_UTF8 65001
 #define SCI_SETCODEPAGE 2037
 #define SC_IME_WINDOWED 0
@@ -366,6 +382,12 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETCOLUMN 2129
 #define SCI_COUNTCHARACTERS 2633
 #define SCI_COUNTCODEUNITS 2715
+#define SCI_ALLOCATETEXTSTATISTICS 2735
+#define SCI_RELEASETEXTSTATISTICS 2736
+#define SCI_COUNTWORDS 2737
+#define SCI_COUNTNONBLANKLINES 2738
+#define SCI_POSITIONSFROMCODEUNITS 2742
+#define SCI_CODEUNITSFROMPOSITIONS 2743
 #define SCI_SETHSCROLLBAR 2130
 #define SCI_GETHSCROLLBAR 2131
 #define SC_IV_NONE 0
@@ -456,6 +478,9 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SEARCHINTARGET 2197
 #define SCI_SETSEARCHFLAGS 2198
 #define SCI_GETSEARCHFLAGS 2199
+#define SCI_SEARCHSTYLEINTARGET 2739
+#define SCI_ALLOCATESTYLEINDEX 2740
+#define SCI_RELEASESTYLEINDEX 2741
 #define SCI_CALLTIPSHOW 2200
 #define SCI_CALLTIPCANCEL 2201
 #define SCI_CALLTIPACTIVE 2202
@@ -558,6 +583,10 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SC_CACHE_DOCUMENT 3
 #define SCI_SETLAYOUTCACHE 2272
 #define SCI_GETLAYOUTCACHE 2273
+#define SCI_SETLAYOUTPREFETCH 2721
+#define SCI_GETLAYOUTPREFETCH 2722
+#define SCI_GETLAYOUTPREFETCHHITS 2723
+#define SCI_GETLAYOUTPREFETCHMISSES 2724
 #define SCI_SETSCROLLWIDTH 2274
 #define SCI_GETSCROLLWIDTH 2275
 #define SCI_SETSCROLLWIDTHTRACKING 2516
@@ -667,6 +696,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETVIEWEOL 2356
 #define SCI_GETDOCPOINTER 2357
 #define SCI_SETDOCPOINTER 2358
+#define SCI_SETVIEWSTATECACHESIZE 2750
+#define SCI_GETVIEWSTATECACHESIZE 2751
 #define SCI_SETMODEVENTMASK 2359
 #define EDGE_NONE 0
 #define EDGE_LINE 1
@@ -889,6 +920,12 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_ALLOCATEEXTENDEDSTYLES 2553
 #define UNDO_MAY_COALESCE 1
 #define SCI_ADDUNDOACTION 2560
+#define SCI_ALLOCATEEDITJOURNAL 2744
+#define SCI_RELEASEEDITJOURNAL 2745
+#define SCI_GETEDITVERSION 2746
+#define SCI_EXPORTEDITS 2747
+#define SCI_IMPORTEDITS 2748
+#define SCI_DISCARDEDITS 2749
 #define SCI_CHARPOSITIONFROMPOINT 2561
 #define SCI_CHARPOSITIONFROMPOINTCLOSE 2562
 #define SCI_SETMOUSESELECTIONRECTANGULARSWITCH 2668
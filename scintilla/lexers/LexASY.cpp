@@ -27,8 +27,8 @@ static void ColouriseAsyDoc(Sci_PositionU startPos, Sci_Position length, int ini
 	WordList &keywords = *keywordlists[0];
 	WordList &keywords2 = *keywordlists[1];
 
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
 
 	int visibleChars = 0;
 
@@ -12,16 +12,23 @@
 #include <stdarg.h>
 #include <assert.h>
 
+#include <string>
+#include <vector>
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
 
+#include "PropSetSimple.h"
 #include "WordList.h"
 #include "LexAccessor.h"
 #include "Accessor.h"
 #include "StyleContext.h"
 #include "CharacterSet.h"
 #include "LexerModule.h"
+#include "SparseState.h"
+#include "LexerBase.h"
 
 using namespace Scintilla;
 
@@ -120,121 +127,202 @@ static int GlobScan(StyleContext &sc) {
 	return 0;
 }
 
-static void ColouriseBashDoc(Sci_PositionU startPos, Sci_Position length, int initStyle,
-							 WordList *keywordlists[], Accessor &styler) {
+namespace {
+
+class HereDocCls {	// Class to manage HERE document elements
+public:
+	int State;		// 0: '<<' encountered
+	// 1: collect the delimiter
+	// 2: here doc text (lines after the delimiter)
+	int Quote;		// the char after '<<'
+	bool Quoted;		// true if Quote in ('\'','"','`')
+	bool Indent;		// indented delimiter (for <<-)
+	int DelimiterLength;	// strlen(Delimiter)
+	char Delimiter[HERE_DELIM_MAX];	// the Delimiter
+	HereDocCls() {
+		State = 0;
+		Quote = 0;
+		Quoted = false;
+		Indent = 0;
+		DelimiterLength = 0;
+		Delimiter[0] = '\0';
+	}
+	void Append(int ch) {
+		Delimiter[DelimiterLength++] = static_cast<char>(ch);
+		Delimiter[DelimiterLength] = '\0';
+	}
+	~HereDocCls() {
+	}
+};
+
+class QuoteCls {	// Class to manage quote pairs (simplified vs LexPerl)
+	public:
+	int Count;
+	int Up, Down;
+	QuoteCls() {
+		Count = 0;
+		Up    = '\0';
+		Down  = '\0';
+	}
+	void Open(int u) {
+		Count++;
+		Up    = u;
+		Down  = opposite(Up);
+	}
+	void Start(int u) {
+		Count = 0;
+		Open(u);
+	}
+	bool operator==(const QuoteCls &other) const {
+		return (Count == other.Count) && (Up == other.Up) && (Down == other.Down);
+	}
+};
+
+class QuoteStackCls {	// Class to manage quote pairs that nest
+	public:
+	int Count;
+	int Up, Down;
+	int Style;
+	int Depth;			// levels pushed
+	int CountStack[BASH_DELIM_STACK_MAX];
+	int UpStack   [BASH_DELIM_STACK_MAX];
+	int StyleStack[BASH_DELIM_STACK_MAX];
+	QuoteStackCls() {
+		Count = 0;
+		Up    = '\0';
+		Down  = '\0';
+		Style = 0;
+		Depth = 0;
+	}
+	void Start(int u, int s) {
+		Count = 1;
+		Up    = u;
+		Down  = opposite(Up);
+		Style = s;
+	}
+	void Push(int u, int s) {
+		if (Depth >= BASH_DELIM_STACK_MAX)
+			return;
+		CountStack[Depth] = Count;
+		UpStack   [Depth] = Up;
+		StyleStack[Depth] = Style;
+		Depth++;
+		Count = 1;
+		Up    = u;
+		Down  = opposite(Up);
+		Style = s;
+	}
+	void Pop(void) {
+		if (Depth <= 0)
+			return;
+		Depth--;
+		Count = CountStack[Depth];
+		Up    = UpStack   [Depth];
+		Style = StyleStack[Depth];
+		Down  = opposite(Up);
+	}
+	bool operator==(const QuoteStackCls &other) const {
+		if ((Count != other.Count) || (Up != other.Up) || (Style != other.Style) || (Depth != other.Depth))
+			return false;
+		for (int i = 0; i < Depth; i++) {
+			if ((CountStack[i] != other.CountStack[i]) || (UpStack[i] != other.UpStack[i]) ||
+				(StyleStack[i] != other.StyleStack[i]))
+				return false;
+		}
+		return true;
+	}
+	~QuoteStackCls() {
+	}
+};
+
+// Everything Lex carries from one line to the next, recorded at the start of
+// each line so that lexing can resume there without backtracking.
+struct LineRestartState {
+	bool valid;
+	int style;
+	int cmdState;
+	int testExprType;
+	int numBase;
+	int hereState;
+	int hereQuote;
+	bool hereQuoted;
+	bool hereIndent;
+	int hereDelimiter;	// index into LexerBash::restartStrings
+	QuoteCls quote;
+	QuoteStackCls quoteStack;
+	LineRestartState() : valid(false), style(SCE_SH_DEFAULT), cmdState(BASH_CMD_START), testExprType(0),
+		numBase(0), hereState(0), hereQuote(0), hereQuoted(false), hereIndent(false), hereDelimiter(0) {
+	}
+	bool operator==(const LineRestartState &other) const {
+		return (valid == other.valid) &&
+			(style == other.style) &&
+			(cmdState == other.cmdState) &&
+			(testExprType == other.testExprType) &&
+			(numBase == other.numBase) &&
+			(hereState == other.hereState) &&
+			(hereQuote == other.hereQuote) &&
+			(hereQuoted == other.hereQuoted) &&
+			(hereIndent == other.hereIndent) &&
+			(hereDelimiter == other.hereDelimiter) &&
+			(quote == other.quote) &&
+			(quoteStack == other.quoteStack);
+	}
+	bool operator!=(const LineRestartState &other) const {
+		return !(*this == other);
+	}
+};
+
+}
 
-	WordList &keywords = *keywordlists[0];
+class LexerBash : public LexerBase {
+	// State at the start of each line, keyed by line number. Only lines before
+	// linesRecorded have been lexed since the text before them last changed.
+	// A record that is not valid means the state there is unknown.
+	SparseState<LineRestartState> restartStates;
+	Sci_Position linesRecorded;
+	std::vector<std::string> restartStrings;
+	int RestartString(const char *s) {
+		std::vector<std::string>::const_iterator it = std::find(restartStrings.begin(), restartStrings.end(), s);
+		if (it == restartStrings.end()) {
+			restartStrings.push_back(s);
+			return static_cast<int>(restartStrings.size() - 1);
+		}
+		return static_cast<int>(it - restartStrings.begin());
+	}
+public:
+	LexerBash() : linesRecorded(0), restartStrings(1) {
+	}
+	static ILexer *LexerFactoryBash() {
+		return new LexerBash();
+	}
+	const char * SCI_METHOD DescribeWordListSets() override;
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
+	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
+};
+
+void SCI_METHOD LexerBash::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
+	Accessor styler(pAccess, &props);
+
+	WordList &keywords = *keyWordLists[0];
 	WordList cmdDelimiter, bashStruct, bashStruct_in;
 	cmdDelimiter.Set("| || |& & && ; ;; ( ) { }");
 	bashStruct.Set("if elif fi while until else then do done esac eval");
 	bashStruct_in.Set("for case select");
 
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_");
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_");
 	// note that [+-] are often parts of identifiers in shell scripts
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._+-");
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._+-");
 	CharacterSet setMetaCharacter(CharacterSet::setNone, "|&;()<> \t\r\n");
 	setMetaCharacter.Add(0);
-	CharacterSet setBashOperator(CharacterSet::setNone, "^&%()-+=|{}[]:;>,*/<?!.~@");
-	CharacterSet setSingleCharOp(CharacterSet::setNone, "rwxoRWXOezsfdlpSbctugkTBMACahGLNn");
-	CharacterSet setParam(CharacterSet::setAlphaNum, "$_");
-	CharacterSet setHereDoc(CharacterSet::setAlpha, "_\\-+!%*,./:?@[]^`{}~");
-	CharacterSet setHereDoc2(CharacterSet::setAlphaNum, "_-+!%*,./:=?@[]^`{}~");
-	CharacterSet setLeftShift(CharacterSet::setDigits, "$");
-
-	class HereDocCls {	// Class to manage HERE document elements
-	public:
-		int State;		// 0: '<<' encountered
-		// 1: collect the delimiter
-		// 2: here doc text (lines after the delimiter)
-		int Quote;		// the char after '<<'
-		bool Quoted;		// true if Quote in ('\'','"','`')
-		bool Indent;		// indented delimiter (for <<-)
-		int DelimiterLength;	// strlen(Delimiter)
-		char Delimiter[HERE_DELIM_MAX];	// the Delimiter
-		HereDocCls() {
-			State = 0;
-			Quote = 0;
-			Quoted = false;
-			Indent = 0;
-			DelimiterLength = 0;
-			Delimiter[0] = '\0';
-		}
-		void Append(int ch) {
-			Delimiter[DelimiterLength++] = static_cast<char>(ch);
-			Delimiter[DelimiterLength] = '\0';
-		}
-		~HereDocCls() {
-		}
-	};
-	HereDocCls HereDoc;
+	static const CharacterSet setBashOperator(CharacterSet::setNone, "^&%()-+=|{}[]:;>,*/<?!.~@");
+	static const CharacterSet setSingleCharOp(CharacterSet::setNone, "rwxoRWXOezsfdlpSbctugkTBMACahGLNn");
+	static const CharacterSet setParam(CharacterSet::setAlphaNum, "$_");
+	static const CharacterSet setHereDoc(CharacterSet::setAlpha, "_\\-+!%*,./:?@[]^`{}~");
+	static const CharacterSet setHereDoc2(CharacterSet::setAlphaNum, "_-+!%*,./:=?@[]^`{}~");
+	static const CharacterSet setLeftShift(CharacterSet::setDigits, "$");
 
-	class QuoteCls {	// Class to manage quote pairs (simplified vs LexPerl)
-		public:
-		int Count;
-		int Up, Down;
-		QuoteCls() {
-			Count = 0;
-			Up    = '\0';
-			Down  = '\0';
-		}
-		void Open(int u) {
-			Count++;
-			Up    = u;
-			Down  = opposite(Up);
-		}
-		void Start(int u) {
-			Count = 0;
-			Open(u);
-		}
-	};
+	HereDocCls HereDoc;
 	QuoteCls Quote;
-
-	class QuoteStackCls {	// Class to manage quote pairs that nest
-		public:
-		int Count;
-		int Up, Down;
-		int Style;
-		int Depth;			// levels pushed
-		int CountStack[BASH_DELIM_STACK_MAX];
-		int UpStack   [BASH_DELIM_STACK_MAX];
-		int StyleStack[BASH_DELIM_STACK_MAX];
-		QuoteStackCls() {
-			Count = 0;
-			Up    = '\0';
-			Down  = '\0';
-			Style = 0;
-			Depth = 0;
-		}
-		void Start(int u, int s) {
-			Count = 1;
-			Up    = u;
-			Down  = opposite(Up);
-			Style = s;
-		}
-		void Push(int u, int s) {
-			if (Depth >= BASH_DELIM_STACK_MAX)
-				return;
-			CountStack[Depth] = Count;
-			UpStack   [Depth] = Up;
-			StyleStack[Depth] = Style;
-			Depth++;
-			Count = 1;
-			Up    = u;
-			Down  = opposite(Up);
-			Style = s;
-		}
-		void Pop(void) {
-			if (Depth <= 0)
-				return;
-			Depth--;
-			Count = CountStack[Depth];
-			Up    = UpStack   [Depth];
-			Style = StyleStack[Depth];
-			Down  = opposite(Up);
-		}
-		~QuoteStackCls() {
-		}
-	};
 	QuoteStackCls QuoteStack;
 
 	int numBase = 0;
@@ -243,22 +331,83 @@ static void ColouriseBashDoc(Sci_PositionU startPos, Sci_Position length, int in
 	int cmdState = BASH_CMD_START;
 	int testExprType = 0;
 
-	// Always backtracks to the start of a line that is not a continuation
+	// When the state at the start of this line was recorded, continue from it.
+	// Otherwise backtrack to the start of a line that is not a continuation
 	// of the previous line (i.e. start of a bash command segment)
 	Sci_Position ln = styler.GetLine(startPos);
-	if (ln > 0 && startPos == static_cast<Sci_PositionU>(styler.LineStart(ln)))
-		ln--;
-	for (;;) {
-		startPos = styler.LineStart(ln);
-		if (ln == 0 || styler.GetLineState(ln) == BASH_CMD_START)
-			break;
-		ln--;
+	LineRestartState restart;
+	if ((ln > 0) && (ln < linesRecorded) && (startPos == static_cast<Sci_PositionU>(styler.LineStart(ln))))
+		restart = restartStates.ValueAt(ln);
+	if (restart.valid) {
+		initStyle = restart.style;
+		cmdState = restart.cmdState;
+		testExprType = restart.testExprType;
+		numBase = restart.numBase;
+		HereDoc.State = restart.hereState;
+		HereDoc.Quote = restart.hereQuote;
+		HereDoc.Quoted = restart.hereQuoted;
+		HereDoc.Indent = restart.hereIndent;
+		const std::string &delimiter = restartStrings[restart.hereDelimiter];
+		HereDoc.DelimiterLength = static_cast<int>(delimiter.length());
+		memcpy(HereDoc.Delimiter, delimiter.c_str(), delimiter.length() + 1);
+		Quote = restart.quote;
+		QuoteStack = restart.quoteStack;
+	} else {
+		if (ln > 0 && startPos == static_cast<Sci_PositionU>(styler.LineStart(ln)))
+			ln--;
+		for (;;) {
+			startPos = styler.LineStart(ln);
+			if (ln == 0 || styler.GetLineState(ln) == BASH_CMD_START)
+				break;
+			ln--;
+		}
+		initStyle = SCE_SH_DEFAULT;
+		ln = styler.GetLine(startPos);
+	}
+
+	// Records after this line are about to be replaced. Lines between the
+	// last record and this line have not been seen so mark them unknown.
+	if (linesRecorded <= ln) {
+		restartStates.Set(linesRecorded, LineRestartState());
+	}
+	linesRecorded = ln + 1;
+	if (ln == 0) {
+		restartStrings.assign(1, std::string());
 	}
-	initStyle = SCE_SH_DEFAULT;
 
 	StyleContext sc(startPos, endPos - startPos, initStyle, styler);
 
+	// Record the state whenever the start of a line is reached. A line start
+	// skipped over by a multi-character construct is recorded as unknown.
+	const Sci_Position lineLast = styler.GetLine(styler.Length());
+	Sci_Position lineRecord = ln + 1;
+	Sci_PositionU lineRecordStart = styler.LineStart(lineRecord);
+	auto recordLineStarts = [&]() {
+		while ((lineRecordStart <= sc.currentPos) && (lineRecord <= lineLast)) {
+			LineRestartState record;
+			record.valid = lineRecordStart == sc.currentPos;
+			if (record.valid) {
+				record.style = sc.state;
+				record.cmdState = cmdState;
+				record.testExprType = testExprType;
+				record.numBase = numBase;
+				record.hereState = HereDoc.State;
+				record.hereQuote = HereDoc.Quote;
+				record.hereQuoted = HereDoc.Quoted;
+				record.hereIndent = HereDoc.Indent;
+				record.hereDelimiter = RestartString(HereDoc.Delimiter);
+				record.quote = Quote;
+				record.quoteStack = QuoteStack;
+			}
+			restartStates.Set(lineRecord, record);
+			lineRecord++;
+			linesRecorded = lineRecord;
+			lineRecordStart = styler.LineStart(lineRecord);
+		}
+	};
+
 	for (; sc.More(); sc.Forward()) {
+		recordLineStarts();
 
 		// handle line continuation, updates per-line stored state
 		if (sc.atLineStart) {
@@ -792,6 +941,7 @@ static void ColouriseBashDoc(Sci_PositionU startPos, Sci_Position length, int in
 			}
 		}// sc.state
 	}
+	recordLineStarts();
 	sc.Complete();
 	if (sc.state == SCE_SH_HERE_Q) {
 		styler.ChangeLexerState(sc.currentPos, styler.Length());
@@ -899,9 +1049,29 @@ static void FoldBashDoc(Sci_PositionU startPos, Sci_Position length, int, WordLi
 	styler.SetLevel(lineCurrent, levelPrev | flagsNext);
 }
 
+const char * SCI_METHOD LexerBash::DescribeWordListSets() {
+	return "Keywords";
+}
+
+void SCI_METHOD LexerBash::Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
+	if (props.GetInt("fold")) {
+		Accessor styler(pAccess, &props);
+		// Move back one line in case deletion wrecked current line fold state
+		const Sci_Position lineCurrent = styler.GetLine(startPos);
+		if (lineCurrent > 0) {
+			const Sci_Position newStartPos = styler.LineStart(lineCurrent - 1);
+			length += startPos - newStartPos;
+			startPos = newStartPos;
+			initStyle = (startPos > 0) ? styler.StyleAt(startPos - 1) : 0;
+		}
+		FoldBashDoc(startPos, length, initStyle, keyWordLists, styler);
+		styler.Flush();
+	}
+}
+
 static const char * const bashWordListDesc[] = {
 	"Keywords",
 	0
 };
 
-LexerModule lmBash(SCLEX_BASH, ColouriseBashDoc, "bash", FoldBashDoc, bashWordListDesc);
+LexerModule lmBash(SCLEX_BASH, LexerBash::LexerFactoryBash, "bash", bashWordListDesc);
@@ -108,11 +108,11 @@ static void ColouriseCoffeeScriptDoc(Sci_PositionU startPos, Sci_Position length
 	WordList &keywords2 = *keywordlists[1];
 	WordList &keywords4 = *keywordlists[3];
 
-	CharacterSet setOKBeforeRE(CharacterSet::setNone, "([{=,:;!%^&*|?~+-");
-	CharacterSet setCouldBePostOp(CharacterSet::setNone, "+-");
+	static const CharacterSet setOKBeforeRE(CharacterSet::setNone, "([{=,:;!%^&*|?~+-");
+	static const CharacterSet setCouldBePostOp(CharacterSet::setNone, "+-");
 
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_$@", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._$", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_$@", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._$", 0x80, true);
 
 	int chPrevNonWhite = ' ';
 	int visibleChars = 0;
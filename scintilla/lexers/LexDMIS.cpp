@@ -190,9 +190,9 @@ void SCI_METHOD LexerDMIS::Lex(Sci_PositionU startPos, Sci_Position lengthDoc, i
 
 	LexAccessor styler(pAccess);
 	StyleContext scCTX(startPos, lengthDoc, initStyle, styler);
-	CharacterSet setDMISNumber(CharacterSet::setDigits, ".-+eE");
-	CharacterSet setDMISWordStart(CharacterSet::setAlpha, "-234", 0x80, true);
-	CharacterSet setDMISWord(CharacterSet::setAlpha);
+	static const CharacterSet setDMISNumber(CharacterSet::setDigits, ".-+eE");
+	static const CharacterSet setDMISWordStart(CharacterSet::setAlpha, "-234", 0x80, true);
+	static const CharacterSet setDMISWord(CharacterSet::setAlpha);
 
 
 	bool isIFLine = false;
@@ -292,7 +292,7 @@ void SCI_METHOD LexerDMIS::Fold(Sci_PositionU startPos, Sci_Position lengthDoc,
 	int levelCurrent = levelPrev;
 	int strPos = 0;
 	bool foldWordPossible = false;
-	CharacterSet setDMISFoldWord(CharacterSet::setAlpha);
+	static const CharacterSet setDMISFoldWord(CharacterSet::setAlpha);
 	char *tmpStr;
 
 
@@ -74,11 +74,11 @@ static void ColouriseEclDoc(Sci_PositionU startPos, Sci_Position length, int ini
 
 	bool stylingWithinPreprocessor = false;
 
-	CharacterSet setOKBeforeRE(CharacterSet::setNone, "(=,");
-	CharacterSet setDoxygen(CharacterSet::setLower, "$@\\&<>#{}[]");
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
-	CharacterSet setQualified(CharacterSet::setNone, "uUxX");
+	static const CharacterSet setOKBeforeRE(CharacterSet::setNone, "(=,");
+	static const CharacterSet setDoxygen(CharacterSet::setLower, "$@\\&<>#{}[]");
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
+	static const CharacterSet setQualified(CharacterSet::setNone, "uUxX");
 
 	int chPrevNonWhite = ' ';
 	int visibleChars = 0;
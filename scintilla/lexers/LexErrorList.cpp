@@ -12,16 +12,22 @@
 #include <assert.h>
 #include <ctype.h>
 
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
 
 #include "WordList.h"
 #include "LexAccessor.h"
-#include "Accessor.h"
 #include "StyleContext.h"
 #include "CharacterSet.h"
 #include "LexerModule.h"
+#include "OptionSet.h"
+#include "DefaultLexer.h"
 
 using namespace Scintilla;
 
@@ -41,12 +47,67 @@ static bool IsAlphabetic(int ch) {
 	return IsASCII(ch) && isalpha(ch);
 }
 
-static inline bool AtEOL(Accessor &styler, Sci_PositionU i) {
-	return (styler[i] == '\n') ||
-	       ((styler[i] == '\r') && (styler.SafeGetCharAt(i + 1) != '\n'));
+#define CSI "\033["
+
+namespace {
+
+// The substrings that RecogniseErrorListLine looks for anywhere in a line.
+enum Marker {
+	mkFileQuote, mkCommaLine, mkIn, mkOnLine, mkAtParen, mkParenColon,
+	mkAtLine, mkFile, mkAt, mkLine, mkColonLine, mkCommaFile, mkColumn,
+	mkParen, mkDotJava, mkWarningLNK, mkWarningC, mkCSI,
+	mkBuiltIn
+};
+
+const char *const builtInMarkers[mkBuiltIn] = {
+	"File \"", ", line ", " in ", " on line ", " at (", ") : ",
+	"at line ", "file ", " at ", " line ", ":line ", ", file ", " column ",
+	"(", ".java:", "warning LNK", ": warning C", CSI,
+};
+
+/**
+ * Locate markers in a line, searching for each at most once and only when
+ * the classification reaches a test that needs it.
+ */
+class LineMarkers {
+	const char *line;
+	const char *found[mkBuiltIn];
+	bool searched[mkBuiltIn];
+public:
+	explicit LineMarkers(const char *line_) : line(line_), found(), searched() {
+	}
+	const char *Find(Marker marker) {
+		if (!searched[marker]) {
+			found[marker] = strstr(line, builtInMarkers[marker]);
+			searched[marker] = true;
+		}
+		return found[marker];
+	}
+	bool Has(Marker marker) {
+		return Find(marker) != 0;
+	}
+};
+
+}
+
+// In stInitial only ':', '(' and tab can change state and a space rules out
+// ctags, so pass over all other text with strcspn and memchr which examine
+// many bytes at a time. Returns the position of the next ':', '(' or tab.
+static Sci_PositionU SkipInitialText(const char *lineBuffer, Sci_PositionU i, Sci_PositionU lengthLine, bool &canBeCtags) {
+	while (i < lengthLine) {
+		const size_t span = strcspn(lineBuffer + i, ":(\t");
+		if (canBeCtags && memchr(lineBuffer + i, ' ', span))
+			canBeCtags = false;
+		i += span;
+		if ((i >= lengthLine) || lineBuffer[i])
+			break;
+		// Step over a NUL inside the line
+		i++;
+	}
+	return i;
 }
 
-static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLine, Sci_Position &startValue) {
+static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLine, LineMarkers &markers, Sci_Position &startValue) {
 	if (lineBuffer[0] == '>') {
 		// Command or return status
 		return SCE_ERR_CMD;
@@ -73,15 +134,15 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 	} else if (strstart(lineBuffer, "fortcom:")) {
 		// Intel Fortran Compiler v8.0 error/warning message
 		return SCE_ERR_IFORT;
-	} else if (strstr(lineBuffer, "File \"") && strstr(lineBuffer, ", line ")) {
+	} else if (markers.Has(mkFileQuote) && markers.Has(mkCommaLine)) {
 		return SCE_ERR_PYTHON;
-	} else if (strstr(lineBuffer, " in ") && strstr(lineBuffer, " on line ")) {
+	} else if (markers.Has(mkIn) && markers.Has(mkOnLine)) {
 		return SCE_ERR_PHP;
 	} else if ((strstart(lineBuffer, "Error ") ||
 	            strstart(lineBuffer, "Warning ")) &&
-	           strstr(lineBuffer, " at (") &&
-	           strstr(lineBuffer, ") : ") &&
-	           (strstr(lineBuffer, " at (") < strstr(lineBuffer, ") : "))) {
+	           markers.Has(mkAtParen) &&
+	           markers.Has(mkParenColon) &&
+	           (markers.Find(mkAtParen) < markers.Find(mkParenColon))) {
 		// Intel Fortran Compiler error/warning message
 		return SCE_ERR_IFC;
 	} else if (strstart(lineBuffer, "Error ")) {
@@ -90,43 +151,38 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 	} else if (strstart(lineBuffer, "Warning ")) {
 		// Borland warning message
 		return SCE_ERR_BORLAND;
-	} else if (strstr(lineBuffer, "at line ") &&
-	        (strstr(lineBuffer, "at line ") < (lineBuffer + lengthLine)) &&
-	           strstr(lineBuffer, "file ") &&
-	           (strstr(lineBuffer, "file ") < (lineBuffer + lengthLine))) {
+	} else if (markers.Has(mkAtLine) && markers.Has(mkFile)) {
 		// Lua 4 error message
 		return SCE_ERR_LUA;
-	} else if (strstr(lineBuffer, " at ") &&
-	        (strstr(lineBuffer, " at ") < (lineBuffer + lengthLine)) &&
-	           strstr(lineBuffer, " line ") &&
-	           (strstr(lineBuffer, " line ") < (lineBuffer + lengthLine)) &&
-	        (strstr(lineBuffer, " at ") + 4 < (strstr(lineBuffer, " line ")))) {
+	} else if (markers.Has(mkAt) &&
+	           markers.Has(mkLine) &&
+	           (markers.Find(mkAt) + 4 < markers.Find(mkLine))) {
 		// perl error message:
 		// <message> at <file> line <line>
 		return SCE_ERR_PERL;
 	} else if ((lengthLine >= 6) &&
 	           (memcmp(lineBuffer, "   at ", 6) == 0) &&
-	           strstr(lineBuffer, ":line ")) {
+	           markers.Has(mkColonLine)) {
 		// A .NET traceback
 		return SCE_ERR_NET;
 	} else if (strstart(lineBuffer, "Line ") &&
-	           strstr(lineBuffer, ", file ")) {
+	           markers.Has(mkCommaFile)) {
 		// Essential Lahey Fortran error message
 		return SCE_ERR_ELF;
 	} else if (strstart(lineBuffer, "line ") &&
-	           strstr(lineBuffer, " column ")) {
+	           markers.Has(mkColumn)) {
 		// HTML tidy style: line 42 column 1
 		return SCE_ERR_TIDY;
 	} else if (strstart(lineBuffer, "\tat ") &&
-	           strstr(lineBuffer, "(") &&
-	           strstr(lineBuffer, ".java:")) {
+	           markers.Has(mkParen) &&
+	           markers.Has(mkDotJava)) {
 		// Java stack back trace
 		return SCE_ERR_JAVA_STACK;
 	} else if (strstart(lineBuffer, "In file included from ") ||
 	           strstart(lineBuffer, "                 from ")) {
 		// GCC showing include path to following error
 		return SCE_ERR_GCC_INCLUDED_FROM;
-	} else if (strstr(lineBuffer, "warning LNK")) {
+	} else if (markers.Has(mkWarningLNK)) {
 		// Microsoft linker warning:
 		// {<object> : } warning LNK9999
 		return SCE_ERR_MS;
@@ -150,6 +206,14 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 			stUnrecognized
 		} state = stInitial;
 		for (Sci_PositionU i = 0; i < lengthLine; i++) {
+			if (state == stInitial) {
+				i = SkipInitialText(lineBuffer, i, lengthLine, canBeCtags);
+				if (i >= lengthLine)
+					break;
+			} else if (state == stUnrecognized) {
+				// Nothing later in the line can change the result
+				break;
+			}
 			const char ch = lineBuffer[i];
 			char chNext = ' ';
 			if ((i + 1) < lengthLine)
@@ -171,8 +235,6 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 				} else if ((ch == '\t') && canBeCtags) {
 					// May be CTags
 					state = stCtagsStart;
-				} else if (ch == ' ') {
-					canBeCtags = false;
 				}
 			} else if (state == stGccStart) {	// <filename>:
 				state = Is0To9(ch) ? stGccDigit : stUnrecognized;
@@ -256,7 +318,7 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 			return SCE_ERR_MS;
 		} else if ((state == stCtagsStringDollar) || (state == stCtags)) {
 			return SCE_ERR_CTAG;
-		} else if (initialColonPart && strstr(lineBuffer, ": warning C")) {
+		} else if (initialColonPart && markers.Has(mkWarningC)) {
 			// Microsoft warning without line number
 			// <filename>: warning C9999
 			return SCE_ERR_MS;
@@ -266,8 +328,6 @@ static int RecogniseErrorListLine(const char *lineBuffer, Sci_PositionU lengthLi
 	}
 }
 
-#define CSI "\033["
-
 namespace {
 
 bool SequenceEnd(int ch) {
@@ -303,16 +363,137 @@ int StyleFromSequence(const char *seq) {
 
 }
 
-static void ColouriseErrorListLine(
-    char *lineBuffer,
+namespace {
+
+struct OptionsErrorList {
+	bool valueSeparate;
+	bool escapeSequences;
+	OptionsErrorList() {
+		valueSeparate = false;
+		escapeSequences = false;
+	}
+};
+
+const char *const errorListWordListDesc[] = {
+	"User error markers as style:text",
+	0
+};
+
+struct OptionSetErrorList : public OptionSet<OptionsErrorList> {
+	OptionSetErrorList() {
+		DefineProperty("lexer.errorlist.value.separate", &OptionsErrorList::valueSeparate,
+			"For lines in the output pane that are matches from Find in Files or GCC-style "
+			"diagnostics, style the path and line number separately from the rest of the "
+			"line with style 21 used for the rest of the line. "
+			"This allows matched text to be more easily distinguished from its location.");
+
+		DefineProperty("lexer.errorlist.escape.sequences", &OptionsErrorList::escapeSequences,
+			"Set to 1 to interpret escape sequences.");
+
+		DefineWordListSets(errorListWordListDesc);
+	}
+};
+
+}
+
+class LexerErrorList : public DefaultLexer {
+	OptionsErrorList options;
+	OptionSetErrorList optSetErrorList;
+	std::string userMarkerList;
+	// User markers and their styles, in the order they were listed
+	std::vector<std::string> userMarkers;
+	std::vector<int> userStyles;
+
+	void ColouriseLine(const char *lineBuffer, Sci_PositionU lengthLine, Sci_PositionU endPos, LexAccessor &styler);
+public:
+	LexerErrorList() {
+	}
+	virtual ~LexerErrorList() {}
+	int SCI_METHOD Version() const override {
+		return lvOriginal;
+	}
+	void SCI_METHOD Release() override {
+		delete this;
+	}
+	const char *SCI_METHOD PropertyNames() override {
+		return optSetErrorList.PropertyNames();
+	}
+	int SCI_METHOD PropertyType(const char *name) override {
+		return optSetErrorList.PropertyType(name);
+	}
+	const char *SCI_METHOD DescribeProperty(const char *name) override {
+		return optSetErrorList.DescribeProperty(name);
+	}
+	Sci_Position SCI_METHOD PropertySet(const char *key, const char *val) override {
+		if (optSetErrorList.PropertySet(&options, key, val)) {
+			return 0;
+		}
+		return -1;
+	}
+	const char *SCI_METHOD DescribeWordListSets() override {
+		return optSetErrorList.DescribeWordListSets();
+	}
+	Sci_Position SCI_METHOD WordListSet(int n, const char *wl) override;
+	void *SCI_METHOD PrivateCall(int, void *) override {
+		return 0;
+	}
+	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
+
+	static ILexer *LexerFactoryErrorList() {
+		return new LexerErrorList();
+	}
+};
+
+// The user markers are parsed when set rather than on each call to Lex.
+Sci_Position SCI_METHOD LexerErrorList::WordListSet(int n, const char *wl) {
+	if ((n != 0) || (userMarkerList == wl)) {
+		return -1;
+	}
+	userMarkerList = wl;
+	userMarkers.clear();
+	userStyles.clear();
+	const char *word = userMarkerList.c_str();
+	while (*word) {
+		if (isspacechar(*word)) {
+			word++;
+			continue;
+		}
+		const char *wordEnd = word;
+		while (*wordEnd && !isspacechar(*wordEnd))
+			wordEnd++;
+		// Each word is a style number, a ':' and then the text to look for
+		const char *text = word;
+		int style = 0;
+		while ((text < wordEnd) && Is0To9(*text) && (style < 256)) {
+			style = style * 10 + (*text - '0');
+			text++;
+		}
+		if ((text > word) && (style < 256) && (text < wordEnd) && (*text == ':') && (text + 1 < wordEnd)) {
+			userMarkers.push_back(std::string(text + 1, wordEnd));
+			userStyles.push_back(style);
+		}
+		word = wordEnd;
+	}
+	return 0;
+}
+
+void LexerErrorList::ColouriseLine(
+    const char *lineBuffer,
     Sci_PositionU lengthLine,
     Sci_PositionU endPos,
-    Accessor &styler,
-	bool valueSeparate,
-	bool escapeSequences) {
+    LexAccessor &styler) {
+	LineMarkers markers(lineBuffer);
 	Sci_Position startValue = -1;
-	int style = RecogniseErrorListLine(lineBuffer, lengthLine, startValue);
-	if (escapeSequences && strstr(lineBuffer, CSI)) {
+	int style = RecogniseErrorListLine(lineBuffer, lengthLine, markers, startValue);
+	if (style == SCE_ERR_DEFAULT) {
+		for (size_t u = 0; u < userMarkers.size(); u++) {
+			if (strstr(lineBuffer, userMarkers[u].c_str())) {
+				style = userStyles[u];
+				break;
+			}
+		}
+	}
+	if (options.escapeSequences && markers.Has(mkCSI)) {
 		const Sci_Position startPos = endPos - lengthLine;
 		const char *linePortion = lineBuffer;
 		Sci_Position startPortion = startPos;
@@ -345,7 +526,7 @@ static void ColouriseErrorListLine(
 		}
 		styler.ColourTo(endPos, portionStyle);
 	} else {
-		if (valueSeparate && (startValue >= 0)) {
+		if (options.valueSeparate && (startValue >= 0)) {
 			styler.ColourTo(endPos - (lengthLine - startValue), style);
 			styler.ColourTo(endPos, SCE_ERR_VALUE);
 		} else {
@@ -354,40 +535,28 @@ static void ColouriseErrorListLine(
 	}
 }
 
-static void ColouriseErrorListDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *[], Accessor &styler) {
+void SCI_METHOD LexerErrorList::Lex(Sci_PositionU startPos, Sci_Position length, int, IDocument *pAccess) {
+	LexAccessor styler(pAccess);
 	char lineBuffer[10000];
 	styler.StartAt(startPos);
 	styler.StartSegment(startPos);
-	Sci_PositionU linePos = 0;
-
-	// property lexer.errorlist.value.separate
-	//	For lines in the output pane that are matches from Find in Files or GCC-style
-	//	diagnostics, style the path and line number separately from the rest of the
-	//	line with style 21 used for the rest of the line.
-	//	This allows matched text to be more easily distinguished from its location.
-	const bool valueSeparate = styler.GetPropertyInt("lexer.errorlist.value.separate", 0) != 0;
-
-	// property lexer.errorlist.escape.sequences
-	//	Set to 1 to interpret escape sequences.
-	const bool escapeSequences = styler.GetPropertyInt("lexer.errorlist.escape.sequences") != 0;
-
-	for (Sci_PositionU i = startPos; i < startPos + length; i++) {
-		lineBuffer[linePos++] = styler[i];
-		if (AtEOL(styler, i) || (linePos >= sizeof(lineBuffer) - 1)) {
-			// End of line (or of line buffer) met, colourise it
-			lineBuffer[linePos] = '\0';
-			ColouriseErrorListLine(lineBuffer, linePos, i, styler, valueSeparate, escapeSequences);
-			linePos = 0;
-		}
-	}
-	if (linePos > 0) {	// Last line does not have ending characters
-		lineBuffer[linePos] = '\0';
-		ColouriseErrorListLine(lineBuffer, linePos, startPos + length - 1, styler, valueSeparate, escapeSequences);
+
+	// Copy each line (or each buffer sized piece of a long line) in one call
+	// instead of examining the document a character at a time.
+	const Sci_PositionU endPos = startPos + length;
+	Sci_Position line = styler.GetLine(startPos);
+	Sci_PositionU linePieceStart = startPos;
+	while (linePieceStart < endPos) {
+		const Sci_PositionU lineEnd = std::min<Sci_PositionU>(styler.LineStart(line + 1), endPos);
+		const Sci_PositionU lengthPiece = std::min<Sci_PositionU>(lineEnd - linePieceStart, sizeof(lineBuffer) - 1);
+		pAccess->GetCharRange(lineBuffer, linePieceStart, lengthPiece);
+		lineBuffer[lengthPiece] = '\0';
+		linePieceStart += lengthPiece;
+		ColouriseLine(lineBuffer, lengthPiece, linePieceStart - 1, styler);
+		if (linePieceStart >= lineEnd)
+			line++;
 	}
+	styler.Flush();
 }
 
-static const char *const emptyWordListDesc[] = {
-	0
-};
-
-LexerModule lmErrorList(SCLEX_ERRORLIST, ColouriseErrorListDoc, "errorlist", 0, emptyWordListDesc);
+LexerModule lmErrorList(SCLEX_ERRORLIST, LexerErrorList::LexerFactoryErrorList, "errorlist", errorListWordListDesc);
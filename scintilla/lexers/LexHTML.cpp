@@ -12,8 +12,10 @@
 #include <assert.h>
 #include <ctype.h>
 #include <string>
+#include <vector>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -26,6 +28,7 @@
 #include "CharacterSet.h"
 #include "LexerModule.h"
 #include "OptionSet.h"
+#include "SparseState.h"
 #include "DefaultLexer.h"
 
 using namespace Scintilla;
@@ -185,6 +188,16 @@ inline bool IsNumber(Sci_PositionU start, Accessor &styler) {
 	       (styler[start] == '-') || (styler[start] == '#');
 }
 
+// States where only markup characters end the current lexeme so a run of
+// other characters can be skipped in one step.
+inline bool isTextRunState(int state) {
+	return (state == SCE_H_DEFAULT) ||
+	       (state == SCE_H_DOUBLESTRING) ||
+	       (state == SCE_H_SINGLESTRING) ||
+	       (state == SCE_H_COMMENT) ||
+	       (state == SCE_H_CDATA);
+}
+
 inline bool isStringState(int state) {
 	bool bResult;
 
@@ -550,6 +563,46 @@ Sci_Position FindPhpStringDelimiter(std::string &phpStringDelimiter, Sci_Positio
 	return j - 1;
 }
 
+// Everything Lex carries from one line to the next, recorded at the start of
+// each line so that lexing can resume there without rereading earlier text.
+struct LineRestartState {
+	bool valid = false;
+	int state = SCE_H_DEFAULT;
+	script_mode inScriptType = eHtml;
+	bool tagOpened = false;
+	bool tagClosing = false;
+	bool tagDontFold = false;
+	script_type aspScript = eScriptNone;
+	script_type clientScript = eScriptNone;
+	script_type scriptLanguage = eScriptNone;
+	script_type beforeLanguage = eScriptNone;
+	int beforePreProc = 0;
+	// Indexes into LexerHTML::restartStrings so that records stay trivial to copy and erase
+	int phpStringDelimiter = 0;
+	int makoBlockType = 0;
+	int djangoBlockType = 0;
+
+	bool operator==(const LineRestartState &other) const {
+		return (valid == other.valid) &&
+			(state == other.state) &&
+			(inScriptType == other.inScriptType) &&
+			(tagOpened == other.tagOpened) &&
+			(tagClosing == other.tagClosing) &&
+			(tagDontFold == other.tagDontFold) &&
+			(aspScript == other.aspScript) &&
+			(clientScript == other.clientScript) &&
+			(scriptLanguage == other.scriptLanguage) &&
+			(beforeLanguage == other.beforeLanguage) &&
+			(beforePreProc == other.beforePreProc) &&
+			(phpStringDelimiter == other.phpStringDelimiter) &&
+			(makoBlockType == other.makoBlockType) &&
+			(djangoBlockType == other.djangoBlockType);
+	}
+	bool operator!=(const LineRestartState &other) const {
+		return !(*this == other);
+	}
+};
+
 // Options used for LexerHTML
 struct OptionsHTML {
 	int aspDefaultLanguage = eScriptJS;
@@ -834,6 +887,20 @@ class LexerHTML : public DefaultLexer {
 	OptionsHTML options;
 	OptionSetHTML osHTML;
 	std::set<std::string> nonFoldingTags;
+	// State at the start of each line, keyed by line number. Only lines before
+	// linesRecorded have been lexed since the text before them last changed.
+	// A record that is not valid means the state there is unknown.
+	SparseState<LineRestartState> restartStates;
+	Sci_Position linesRecorded = 0;
+	std::vector<std::string> restartStrings;
+	int RestartString(const std::string &s) {
+		std::vector<std::string>::const_iterator it = std::find(restartStrings.begin(), restartStrings.end(), s);
+		if (it == restartStrings.end()) {
+			restartStrings.push_back(s);
+			return static_cast<int>(restartStrings.size() - 1);
+		}
+		return static_cast<int>(it - restartStrings.begin());
+	}
 public:
 	explicit LexerHTML(bool isXml_, bool isPHPScript_) :
 		DefaultLexer(isXml_ ? lexicalClassesHTML : lexicalClassesXML,
@@ -841,7 +908,8 @@ public:
 		isXml(isXml_),
 		isPHPScript(isPHPScript_),
 		osHTML(isPHPScript_),
-		nonFoldingTags(std::begin(tagsThatDoNotFold), std::end(tagsThatDoNotFold)) {
+		nonFoldingTags(std::begin(tagsThatDoNotFold), std::end(tagsThatDoNotFold)),
+		restartStrings(1) {
 	}
 	~LexerHTML() override {
 	}
@@ -930,39 +998,60 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	std::string makoBlockType;
 	int makoComment = 0;
 	std::string djangoBlockType;
-	// If inside a tag, it may be a script tag, so reread from the start of line starting tag to ensure any language tags are seen
-	if (InTagState(state)) {
-		while ((startPos > 0) && (InTagState(styler.StyleAt(startPos - 1)))) {
-			const Sci_Position backLineStart = styler.LineStart(styler.GetLine(startPos-1));
-			length += startPos - backLineStart;
-			startPos = backLineStart;
+	// When the state at the start of this line was recorded, continue from it
+	// directly. Otherwise look back for the context needed.
+	LineRestartState restart;
+	{
+		const Sci_Position lineStart = styler.GetLine(startPos);
+		if ((lineStart > 0) && (lineStart < linesRecorded) &&
+			(static_cast<Sci_Position>(startPos) == styler.LineStart(lineStart))) {
+			restart = restartStates.ValueAt(lineStart);
 		}
-		state = SCE_H_DEFAULT;
 	}
-	// String can be heredoc, must find a delimiter first. Reread from beginning of line containing the string, to get the correct lineState
-	if (isPHPStringState(state)) {
-		while (startPos > 0 && (isPHPStringState(state) || !isLineEnd(styler[startPos - 1]))) {
-			startPos--;
-			length++;
-			state = styler.StyleAt(startPos);
-		}
-		if (startPos == 0)
+	if (!restart.valid) {
+		// If inside a tag, it may be a script tag, so reread from the start of line starting tag to ensure any language tags are seen
+		if (InTagState(state)) {
+			while ((startPos > 0) && (InTagState(styler.StyleAt(startPos - 1)))) {
+				const Sci_Position backLineStart = styler.LineStart(styler.GetLine(startPos-1));
+				length += startPos - backLineStart;
+				startPos = backLineStart;
+			}
 			state = SCE_H_DEFAULT;
-	}
-	styler.StartAt(startPos);
+		}
+		// String can be heredoc, must find a delimiter first. Reread from beginning of line containing the string, to get the correct lineState
+		if (isPHPStringState(state)) {
+			while (startPos > 0 && (isPHPStringState(state) || !isLineEnd(styler[startPos - 1]))) {
+				startPos--;
+				length++;
+				state = styler.StyleAt(startPos);
+			}
+			if (startPos == 0)
+				state = SCE_H_DEFAULT;
+		}
+		styler.StartAt(startPos);
 
-	/* Nothing handles getting out of these, so we need not start in any of them.
-	 * As we're at line start and they can't span lines, we'll re-detect them anyway */
-	switch (state) {
-		case SCE_H_QUESTION:
-		case SCE_H_XMLSTART:
-		case SCE_H_XMLEND:
-		case SCE_H_ASP:
-			state = SCE_H_DEFAULT;
-			break;
+		/* Nothing handles getting out of these, so we need not start in any of them.
+		 * As we're at line start and they can't span lines, we'll re-detect them anyway */
+		switch (state) {
+			case SCE_H_QUESTION:
+			case SCE_H_XMLSTART:
+			case SCE_H_XMLEND:
+			case SCE_H_ASP:
+				state = SCE_H_DEFAULT;
+				break;
+		}
 	}
 
 	Sci_Position lineCurrent = styler.GetLine(startPos);
+	// Records after this line are about to be replaced. Lines between the
+	// last record and this line have not been seen so mark them unknown.
+	if (linesRecorded <= lineCurrent) {
+		restartStates.Set(linesRecorded, LineRestartState());
+	}
+	linesRecorded = lineCurrent + 1;
+	if (lineCurrent == 0) {
+		restartStrings.assign(1, std::string());
+	}
 	int lineState;
 	if (lineCurrent > 0) {
 		lineState = styler.GetLineState(lineCurrent-1);
@@ -986,6 +1075,21 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		scriptLanguage = eScriptComment;
 	}
 	script_type beforeLanguage = ScriptOfState(beforePreProc);
+	if (restart.valid) {
+		state = restart.state;
+		inScriptType = restart.inScriptType;
+		tagOpened = restart.tagOpened;
+		tagClosing = restart.tagClosing;
+		tagDontFold = restart.tagDontFold;
+		aspScript = restart.aspScript;
+		clientScript = restart.clientScript;
+		scriptLanguage = restart.scriptLanguage;
+		beforeLanguage = restart.beforeLanguage;
+		beforePreProc = restart.beforePreProc;
+		phpStringDelimiter = restartStrings[restart.phpStringDelimiter];
+		makoBlockType = restartStrings[restart.makoBlockType];
+		djangoBlockType = restartStrings[restart.djangoBlockType];
+	}
 	const bool foldHTML = options.foldHTML;
 	const bool fold = foldHTML && options.fold;
 	const bool foldHTMLPreprocessor = foldHTML && options.foldHTMLPreprocessor;
@@ -996,11 +1100,15 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 	const bool allowScripts = options.allowScripts;
 	const bool isMako = options.isMako;
 	const bool isDjango = options.isDjango;
-	const CharacterSet setHTMLWord(CharacterSet::setAlphaNum, ".-_:!#", 0x80, true);
-	const CharacterSet setTagContinue(CharacterSet::setAlphaNum, ".-_:!#[", 0x80, true);
-	const CharacterSet setAttributeContinue(CharacterSet::setAlphaNum, ".-_:!#/", 0x80, true);
+	static const CharacterSet setHTMLWord(CharacterSet::setAlphaNum, ".-_:!#", 0x80, true);
+	static const CharacterSet setTagContinue(CharacterSet::setAlphaNum, ".-_:!#[", 0x80, true);
+	static const CharacterSet setAttributeContinue(CharacterSet::setAlphaNum, ".-_:!#/", 0x80, true);
 	// TODO: also handle + and - (except if they're part of ++ or --) and return keywords
-	const CharacterSet setOKBeforeJSRE(CharacterSet::setNone, "([{=,:;!%^&*|?~");
+	static const CharacterSet setOKBeforeJSRE(CharacterSet::setNone, "([{=,:;!%^&*|?~");
+	// Characters with no effect in text run states. Bytes >= 0x80 are inert unless
+	// they may be DBCS lead bytes.
+	const bool textRuns = !isMako && !isDjango && (styler.Encoding() != encDBCS);
+	static const CharacterSet setTextRun(CharacterSet::setAlphaNum, " \t.,;:()_+*^~|", 0x80, true);
 
 	int levelPrev = styler.LevelAt(lineCurrent) & SC_FOLDLEVELNUMBERMASK;
 	int levelCurrent = levelPrev;
@@ -1009,6 +1117,11 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 
 	int chPrev = ' ';
 	int ch = ' ';
+	if (restart.valid) {
+		// As if the previous line had just been lexed, so line ends are seen
+		chPrev = static_cast<unsigned char>(styler.SafeGetCharAt(startPos - 2));
+		ch = static_cast<unsigned char>(styler.SafeGetCharAt(startPos - 1));
+	}
 	int chPrevNonWhite = ' ';
 	// look back to set chPrevNonWhite properly for better regex colouring
 	if (scriptLanguage == eScriptJS && startPos > 0) {
@@ -1025,9 +1138,63 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		}
 	}
 
+	// Record the state whenever the start of a line is reached. Text skipped
+	// over by a multi-character construct may cross a line start so that the
+	// state there is unknown.
+	const Sci_Position lineLast = styler.GetLine(styler.Length());
+	Sci_Position lineRecord = lineCurrent + 1;
+	Sci_Position lineRecordStart = styler.LineStart(lineRecord);
+	auto recordLineStarts = [&](Sci_Position position) {
+		while ((lineRecordStart <= position) && (lineRecord <= lineLast)) {
+			LineRestartState record;
+			record.valid = lineRecordStart == position;
+			if (record.valid) {
+				record.state = state;
+				record.inScriptType = inScriptType;
+				record.tagOpened = tagOpened;
+				record.tagClosing = tagClosing;
+				record.tagDontFold = tagDontFold;
+				record.aspScript = aspScript;
+				record.clientScript = clientScript;
+				record.scriptLanguage = scriptLanguage;
+				record.beforeLanguage = beforeLanguage;
+				record.beforePreProc = beforePreProc;
+				record.phpStringDelimiter = RestartString(phpStringDelimiter);
+				record.makoBlockType = RestartString(makoBlockType);
+				record.djangoBlockType = RestartString(djangoBlockType);
+			}
+			restartStates.Set(lineRecord, record);
+			lineRecord++;
+			linesRecorded = lineRecord;
+			lineRecordStart = styler.LineStart(lineRecord);
+		}
+	};
+
 	styler.StartSegment(startPos);
 	const Sci_Position lengthDoc = startPos + length;
-	for (Sci_Position i = startPos; i < lengthDoc; i++) {
+	Sci_Position i = startPos;
+	for (; i < lengthDoc; i++) {
+		recordLineStarts(i);
+		if (textRuns && (inScriptType == eHtml) &&
+			((scriptLanguage == eScriptNone) || (scriptLanguage == eScriptXML)) &&
+			isTextRunState(state) && setTextRun.Contains(static_cast<unsigned char>(styler[i]))) {
+			// Same updates as the start of the loop below but none of the checks
+			// as these characters can not end the text, string, comment or CDATA.
+			Sci_Position j = i;
+			do {
+				chPrev = ch;
+				if (!IsASpace(ch))
+					chPrevNonWhite = ch;
+				ch = static_cast<unsigned char>(styler[j]);
+				if ((!IsASpace(ch) || !foldCompact) && fold)
+					visibleChars++;
+				if (!IsASpace(ch))
+					lineStartVisibleChars++;
+				j++;
+			} while ((j < lengthDoc) && setTextRun.Contains(static_cast<unsigned char>(styler[j])));
+			i = j - 1;
+			continue;
+		}
 		const int chPrev2 = chPrev;
 		chPrev = ch;
 		if (!IsASpace(ch) && state != SCE_HJ_COMMENT &&
@@ -2456,6 +2623,8 @@ void SCI_METHOD LexerHTML::Lex(Sci_PositionU startPos, Sci_Position length, int
 		break;
 	}
 
+	recordLineStarts(i);
+
 	// Fill in the real level of the next line, keeping the current flags as they will be filled in later
 	if (fold) {
 		const int flagsNext = styler.LevelAt(lineCurrent) & ~SC_FOLDLEVELNUMBERMASK;
@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -137,6 +138,7 @@ class LexerJSON : public DefaultLexer {
 	CharacterSet setURL;
 	CharacterSet setKeywordJSONLD;
 	CharacterSet setKeywordJSON;
+	CharacterSet setStringRun;
 	CompactIRI compactIRI;
 
 	static bool IsNextNonWhitespace(LexAccessor &styler, Sci_Position start, char ch) {
@@ -182,6 +184,33 @@ class LexerJSON : public DefaultLexer {
 		return false;
 	}
 
+	/**
+	 * Looks for the end of a run of string characters that need no checks
+	 * beyond updating the compact IRI state, starting after the current
+	 * character. Only ASCII characters are accepted so the run can be
+	 * skipped with StyleContext::ForwardASCIIWithinLine.
+	 */
+	Sci_Position StringRunEnd(LexAccessor &styler, Sci_Position pos, Sci_Position end) {
+		for (; pos < end; pos++) {
+			const unsigned char ch = styler[pos];
+			if (!setStringRun.Contains(ch)) {
+				break;
+			}
+			if (((ch == 'h') || (ch == 's') || (ch == 'g') || (ch == 'f') || (ch == 'm')) &&
+				(styler.Match(pos, "https://") ||
+				 styler.Match(pos, "http://") ||
+				 styler.Match(pos, "ssh://") ||
+				 styler.Match(pos, "git://") ||
+				 styler.Match(pos, "svn://") ||
+				 styler.Match(pos, "ftp://") ||
+				 styler.Match(pos, "mailto:"))) {
+				break;
+			}
+			compactIRI.checkChar(ch);
+		}
+		return pos;
+	}
+
 	static bool IsNextWordInList(WordList &keywordList, CharacterSet wordSet,
 								 StyleContext &context, LexAccessor &styler) {
 		char word[51];
@@ -204,7 +233,8 @@ class LexerJSON : public DefaultLexer {
 		setOperators(CharacterSet::setNone, "[{}]:,"),
 		setURL(CharacterSet::setAlphaNum, "-._~:/?#[]@!$&'()*+,),="),
 		setKeywordJSONLD(CharacterSet::setAlpha, ":@"),
-		setKeywordJSON(CharacterSet::setAlpha, "$_") {
+		setKeywordJSON(CharacterSet::setAlpha, "$_"),
+		setStringRun(CharacterSet::setAlphaNum, " !#$%&'()*+,-./:;<=>?[]^_`{|}~") {
 	}
 	virtual ~LexerJSON() {}
 	int SCI_METHOD Version() const override {
@@ -274,6 +304,7 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 							   IDocument *pAccess) {
 	LexAccessor styler(pAccess);
 	StyleContext context(startPos, length, initStyle, styler);
+	const Sci_Position endPos = startPos + length;
 	int stringStyleBefore = SCE_JSON_STRING;
 	while (context.More()) {
 		switch (context.state) {
@@ -355,6 +386,14 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 					}
 				} else {
 					compactIRI.checkChar(context.ch);
+					if (IsASCII(context.ch)) {
+						// Skip ordinary text in bulk, stopping on the last character
+						// of the run so the next one gets the checks above.
+						const Sci_Position currPos = static_cast<Sci_Position>(context.currentPos);
+						const Sci_Position runEnd = StringRunEnd(styler, currPos + 1,
+							std::min(endPos, context.lineStartNext));
+						context.ForwardASCIIWithinLine(runEnd - 1 - currPos);
+					}
 				}
 				break;
 			case SCE_JSON_LDKEYWORD:
@@ -439,6 +478,14 @@ void SCI_METHOD LexerJSON::Lex(Sci_PositionU startPos,
 				context.SetState(SCE_JSON_NUMBER);
 			} else if (context.state == SCE_JSON_DEFAULT && !IsASpace(context.ch)) {
 				context.SetState(SCE_JSON_ERROR);
+			} else if (context.state == SCE_JSON_DEFAULT && IsASpaceOrTab(context.ch)) {
+				// Indentation and other blanks can not change the state
+				Sci_Position pos = static_cast<Sci_Position>(context.currentPos) + 1;
+				const Sci_Position end = std::min(endPos, context.lineStartNext);
+				while ((pos < end) && IsASpaceOrTab(styler[pos])) {
+					pos++;
+				}
+				context.ForwardASCIIWithinLine(pos - 1 - static_cast<Sci_Position>(context.currentPos));
 			}
 		}
 		context.Forward();
@@ -461,14 +508,18 @@ void SCI_METHOD LexerJSON::Fold(Sci_PositionU startPos,
 		currLevel = styler.LevelAt(currLine - 1) >> 16;
 	int nextLevel = currLevel;
 	int visibleChars = 0;
+	char next = styler.SafeGetCharAt(startPos);
 	for (Sci_PositionU i = startPos; i < endPos; i++) {
-		char curr = styler.SafeGetCharAt(i);
-		char next = styler.SafeGetCharAt(i+1);
+		const char curr = next;
+		next = styler.SafeGetCharAt(i+1);
 		bool atEOL = (curr == '\r' && next != '\n') || (curr == '\n');
-		if (styler.StyleAt(i) == SCE_JSON_OPERATOR) {
-			if (curr == '{' || curr == '[') {
+		// Only brackets change the level so only look up their style
+		if (curr == '{' || curr == '[') {
+			if (styler.StyleAt(i) == SCE_JSON_OPERATOR) {
 				nextLevel++;
-			} else if (curr == '}' || curr == ']') {
+			}
+		} else if (curr == '}' || curr == ']') {
+			if (styler.StyleAt(i) == SCE_JSON_OPERATOR) {
 				nextLevel--;
 			}
 		}
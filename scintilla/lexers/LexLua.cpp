@@ -59,14 +59,14 @@ static void ColouriseLuaDoc(
 	const WordList &keywords8 = *keywordlists[7];
 
 	// Accepts accented characters
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
 	// Not exactly following number definition (several dots are seen as OK, etc.)
 	// but probably enough in most cases. [pP] is for hex floats.
-	CharacterSet setNumber(CharacterSet::setDigits, ".-+abcdefpABCDEFP");
-	CharacterSet setExponent(CharacterSet::setNone, "eEpP");
-	CharacterSet setLuaOperator(CharacterSet::setNone, "*/-+()={}~[];<>,.^%:#&|");
-	CharacterSet setEscapeSkip(CharacterSet::setNone, "\"'\\");
+	static const CharacterSet setNumber(CharacterSet::setDigits, ".-+abcdefpABCDEFP");
+	static const CharacterSet setExponent(CharacterSet::setNone, "eEpP");
+	static const CharacterSet setLuaOperator(CharacterSet::setNone, "*/-+()={}~[];<>,.^%:#&|");
+	static const CharacterSet setEscapeSkip(CharacterSet::setNone, "\"'\\");
 
 	Sci_Position currentLine = styler.GetLine(startPos);
 	// Initialize long string [[ ... ]] or block comment --[[ ... ]] nesting level,
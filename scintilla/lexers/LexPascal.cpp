@@ -144,7 +144,7 @@ static void GetRangeLowered(Sci_PositionU start,
 }
 
 static void GetForwardRangeLowered(Sci_PositionU start,
-		CharacterSet &charSet,
+		const CharacterSet &charSet,
 		Accessor &styler,
 		char *s,
 		Sci_PositionU len) {
@@ -216,11 +216,11 @@ static void ColourisePascalDoc(Sci_PositionU startPos, Sci_Position length, int
 		Accessor &styler) {
 	bool bSmartHighlighting = styler.GetPropertyInt("lexer.pascal.smart.highlighting", 1) != 0;
 
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
-	CharacterSet setNumber(CharacterSet::setDigits, ".-+eE");
-	CharacterSet setHexNumber(CharacterSet::setDigits, "abcdefABCDEF");
-	CharacterSet setOperator(CharacterSet::setNone, "#$&'()*+,-./:;<=>@[]^{}");
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
+	static const CharacterSet setNumber(CharacterSet::setDigits, ".-+eE");
+	static const CharacterSet setHexNumber(CharacterSet::setDigits, "abcdefABCDEF");
+	static const CharacterSet setOperator(CharacterSet::setNone, "#$&'()*+,-./:;<=>@[]^{}");
 
 	Sci_Position curLine = styler.GetLine(startPos);
 	int curLineState = curLine > 0 ? styler.GetLineState(curLine - 1) : 0;
@@ -372,7 +372,7 @@ static void SetFoldInPreprocessorLevelFlag(int &lineFoldStateCurrent, unsigned i
 
 static void ClassifyPascalPreprocessorFoldPoint(int &levelCurrent, int &lineFoldStateCurrent,
 		Sci_PositionU startPos, Accessor &styler) {
-	CharacterSet setWord(CharacterSet::setAlpha);
+	static const CharacterSet setWord(CharacterSet::setAlpha);
 
 	char s[11];	// Size of the longest possible keyword + one additional character + null
 	GetForwardRangeLowered(startPos, setWord, styler, s, sizeof(s));
@@ -405,7 +405,7 @@ static void ClassifyPascalPreprocessorFoldPoint(int &levelCurrent, int &lineFold
 
 static Sci_PositionU SkipWhiteSpace(Sci_PositionU currentPos, Sci_PositionU endPos,
 		Accessor &styler, bool includeChars = false) {
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_");
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_");
 	Sci_PositionU j = currentPos + 1;
 	char ch = styler.SafeGetCharAt(j);
 	while ((j < endPos) && (IsASpaceOrTab(ch) || ch == '\r' || ch == '\n' ||
@@ -435,8 +435,8 @@ static void ClassifyPascalWordFoldPoint(int &levelCurrent, int &lineFoldStateCur
 		bool ignoreKeyword = false;
 		Sci_PositionU j = SkipWhiteSpace(currentPos, endPos, styler);
 		if (j < endPos) {
-			CharacterSet setWordStart(CharacterSet::setAlpha, "_");
-			CharacterSet setWord(CharacterSet::setAlphaNum, "_");
+			static const CharacterSet setWordStart(CharacterSet::setAlpha, "_");
+			static const CharacterSet setWord(CharacterSet::setAlphaNum, "_");
 
 			if (styler.SafeGetCharAt(j) == ';') {
 				// Handle forward class declarations ("type TMyClass = class;")
@@ -530,7 +530,7 @@ static void FoldPascalDoc(Sci_PositionU startPos, Sci_Position length, int initS
 	int style = initStyle;
 
 	Sci_Position lastStart = 0;
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
 
 	for (Sci_PositionU i = startPos; i < endPos; i++) {
 		char ch = chNext;
@@ -15,7 +15,9 @@
 #include <ctype.h>
 
 #include <string>
+#include <vector>
 #include <map>
+#include <algorithm>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -27,6 +29,7 @@
 #include "CharacterSet.h"
 #include "LexerModule.h"
 #include "OptionSet.h"
+#include "SparseState.h"
 #include "DefaultLexer.h"
 
 using namespace Scintilla;
@@ -399,6 +402,52 @@ struct OptionSetPerl : public OptionSet<OptionsPerl> {
 	}
 };
 
+namespace {
+
+// Everything Lex carries from one line to the next, recorded at the start of
+// each line so that lexing can resume there without backtracking.
+struct LineRestartState {
+	bool valid;
+	int style;
+	int hereState;
+	int hereQuote;
+	bool hereQuoted;
+	int hereDelimiter;	// index into LexerPerl::restartStrings
+	int quoteRep;
+	int quoteCount;
+	int quoteUp;
+	int quoteDown;
+	int numState;
+	int dotCount;
+	int backFlag;
+	Sci_PositionU backPos;
+	LineRestartState() : valid(false), style(SCE_PL_DEFAULT), hereState(0), hereQuote(0), hereQuoted(false),
+		hereDelimiter(0), quoteRep(1), quoteCount(0), quoteUp(0), quoteDown(0), numState(PERLNUM_DECIMAL),
+		dotCount(0), backFlag(BACK_NONE), backPos(0) {
+	}
+	bool operator==(const LineRestartState &other) const {
+		return (valid == other.valid) &&
+			(style == other.style) &&
+			(hereState == other.hereState) &&
+			(hereQuote == other.hereQuote) &&
+			(hereQuoted == other.hereQuoted) &&
+			(hereDelimiter == other.hereDelimiter) &&
+			(quoteRep == other.quoteRep) &&
+			(quoteCount == other.quoteCount) &&
+			(quoteUp == other.quoteUp) &&
+			(quoteDown == other.quoteDown) &&
+			(numState == other.numState) &&
+			(dotCount == other.dotCount) &&
+			(backFlag == other.backFlag) &&
+			(backPos == other.backPos);
+	}
+	bool operator!=(const LineRestartState &other) const {
+		return !(*this == other);
+	}
+};
+
+}
+
 class LexerPerl : public DefaultLexer {
 	CharacterSet setWordStart;
 	CharacterSet setWord;
@@ -407,12 +456,28 @@ class LexerPerl : public DefaultLexer {
 	WordList keywords;
 	OptionsPerl options;
 	OptionSetPerl osPerl;
+	// State at the start of each line, keyed by line number. Only lines before
+	// linesRecorded have been lexed since the text before them last changed.
+	// A record that is not valid means the state there is unknown.
+	SparseState<LineRestartState> restartStates;
+	Sci_Position linesRecorded;
+	std::vector<std::string> restartStrings;
+	int RestartString(const char *s) {
+		std::vector<std::string>::const_iterator it = std::find(restartStrings.begin(), restartStrings.end(), s);
+		if (it == restartStrings.end()) {
+			restartStrings.push_back(s);
+			return static_cast<int>(restartStrings.size() - 1);
+		}
+		return static_cast<int>(it - restartStrings.begin());
+	}
 public:
 	LexerPerl() :
 		setWordStart(CharacterSet::setAlpha, "_", 0x80, true),
 		setWord(CharacterSet::setAlphaNum, "_", 0x80, true),
 		setSpecialVar(CharacterSet::setNone, "\"$;<>&`'+,./\\%:=~!?@[]"),
-		setControlVar(CharacterSet::setNone, "ACDEFHILMNOPRSTVWX") {
+		setControlVar(CharacterSet::setNone, "ACDEFHILMNOPRSTVWX"),
+		linesRecorded(0),
+		restartStrings(1) {
 	}
 	virtual ~LexerPerl() {
 	}
@@ -587,25 +652,25 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 	reWords.Set("elsif if split while");
 
 	// charset classes
-	CharacterSet setSingleCharOp(CharacterSet::setNone, "rwxoRWXOezsfdlpSbctugkTBMAC");
+	static const CharacterSet setSingleCharOp(CharacterSet::setNone, "rwxoRWXOezsfdlpSbctugkTBMAC");
 	// lexing of "%*</" operators is non-trivial; these are missing in the set below
-	CharacterSet setPerlOperator(CharacterSet::setNone, "^&\\()-+=|{}[]:;>,?!.~");
-	CharacterSet setQDelim(CharacterSet::setNone, "qrwx");
-	CharacterSet setModifiers(CharacterSet::setAlpha);
-	CharacterSet setPreferRE(CharacterSet::setNone, "*/<%");
+	static const CharacterSet setPerlOperator(CharacterSet::setNone, "^&\\()-+=|{}[]:;>,?!.~");
+	static const CharacterSet setQDelim(CharacterSet::setNone, "qrwx");
+	static const CharacterSet setModifiers(CharacterSet::setAlpha);
+	static const CharacterSet setPreferRE(CharacterSet::setNone, "*/<%");
 	// setArray and setHash also accepts chars for special vars like $_,
 	// which are then truncated when the next char does not match setVar
-	CharacterSet setVar(CharacterSet::setAlphaNum, "#$_'", 0x80, true);
-	CharacterSet setArray(CharacterSet::setAlpha, "#$_+-", 0x80, true);
-	CharacterSet setHash(CharacterSet::setAlpha, "#$_!^+-", 0x80, true);
-	CharacterSet &setPOD = setModifiers;
-	CharacterSet setNonHereDoc(CharacterSet::setDigits, "=$@");
-	CharacterSet setHereDocDelim(CharacterSet::setAlphaNum, "_");
-	CharacterSet setSubPrototype(CharacterSet::setNone, "\\[$@%&*+];_ \t");
-	CharacterSet setRepetition(CharacterSet::setDigits, ")\"'");
+	static const CharacterSet setVar(CharacterSet::setAlphaNum, "#$_'", 0x80, true);
+	static const CharacterSet setArray(CharacterSet::setAlpha, "#$_+-", 0x80, true);
+	static const CharacterSet setHash(CharacterSet::setAlpha, "#$_!^+-", 0x80, true);
+	const CharacterSet &setPOD = setModifiers;
+	static const CharacterSet setNonHereDoc(CharacterSet::setDigits, "=$@");
+	static const CharacterSet setHereDocDelim(CharacterSet::setAlphaNum, "_");
+	static const CharacterSet setSubPrototype(CharacterSet::setNone, "\\[$@%&*+];_ \t");
+	static const CharacterSet setRepetition(CharacterSet::setDigits, ")\"'");
 	// for format identifiers
-	CharacterSet setFormatStart(CharacterSet::setAlpha, "_=");
-	CharacterSet &setFormat = setHereDocDelim;
+	static const CharacterSet setFormatStart(CharacterSet::setAlpha, "_=");
+	const CharacterSet &setFormat = setHereDocDelim;
 
 	// Lexer for perl often has to backtrack to start of current style to determine
 	// which characters are being used as quotes, how deeply nested is the
@@ -665,79 +730,94 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 
 	Sci_PositionU endPos = startPos + length;
 
-	// Backtrack to beginning of style if required...
-	// If in a long distance lexical state, backtrack to find quote characters.
-	// Includes strings (may be multi-line), numbers (additional state), format
-	// bodies, as well as POD sections.
-	if (initStyle == SCE_PL_HERE_Q
-	    || initStyle == SCE_PL_HERE_QQ
-	    || initStyle == SCE_PL_HERE_QX
-	    || initStyle == SCE_PL_FORMAT
-	    || initStyle == SCE_PL_HERE_QQ_VAR
-	    || initStyle == SCE_PL_HERE_QX_VAR
-	   ) {
-		// backtrack through multiple styles to reach the delimiter start
-		int delim = (initStyle == SCE_PL_FORMAT) ? SCE_PL_FORMAT_IDENT:SCE_PL_HERE_DELIM;
-		while ((startPos > 1) && (styler.StyleAt(startPos) != delim)) {
-			startPos--;
-		}
-		startPos = styler.LineStart(styler.GetLine(startPos));
-		initStyle = styler.StyleAt(startPos - 1);
+	// When the state at the start of this line was recorded, continue from it.
+	// POD is classified by paragraph so its cheap backtracking is still needed.
+	LineRestartState restart;
+	{
+		const Sci_Position lineStart = styler.GetLine(startPos);
+		if ((lineStart > 0) && (lineStart < linesRecorded) &&
+			(startPos == static_cast<Sci_PositionU>(styler.LineStart(lineStart))))
+			restart = restartStates.ValueAt(lineStart);
+		if (restart.style == SCE_PL_POD || restart.style == SCE_PL_POD_VERB)
+			restart.valid = false;
 	}
-	if (initStyle == SCE_PL_STRING
-	    || initStyle == SCE_PL_STRING_QQ
-	    || initStyle == SCE_PL_BACKTICKS
-	    || initStyle == SCE_PL_STRING_QX
-	    || initStyle == SCE_PL_REGEX
-	    || initStyle == SCE_PL_STRING_QR
-	    || initStyle == SCE_PL_REGSUBST
-	    || initStyle == SCE_PL_STRING_VAR
-	    || initStyle == SCE_PL_STRING_QQ_VAR
-	    || initStyle == SCE_PL_BACKTICKS_VAR
-	    || initStyle == SCE_PL_STRING_QX_VAR
-	    || initStyle == SCE_PL_REGEX_VAR
-	    || initStyle == SCE_PL_STRING_QR_VAR
-	    || initStyle == SCE_PL_REGSUBST_VAR
-	   ) {
-		// for interpolation, must backtrack through a mix of two different styles
-		int otherStyle = (initStyle >= SCE_PL_STRING_VAR) ?
-			initStyle - INTERPOLATE_SHIFT : initStyle + INTERPOLATE_SHIFT;
-		while (startPos > 1) {
-			int st = styler.StyleAt(startPos - 1);
-			if ((st != initStyle) && (st != otherStyle))
-				break;
-			startPos--;
-		}
-		initStyle = SCE_PL_DEFAULT;
-	} else if (initStyle == SCE_PL_STRING_Q
-	        || initStyle == SCE_PL_STRING_QW
-	        || initStyle == SCE_PL_XLAT
-	        || initStyle == SCE_PL_CHARACTER
-	        || initStyle == SCE_PL_NUMBER
-	        || initStyle == SCE_PL_IDENTIFIER
-	        || initStyle == SCE_PL_ERROR
-	        || initStyle == SCE_PL_SUB_PROTOTYPE
-	   ) {
-		while ((startPos > 1) && (styler.StyleAt(startPos - 1) == initStyle)) {
-			startPos--;
-		}
-		initStyle = SCE_PL_DEFAULT;
-	} else if (initStyle == SCE_PL_POD
-	        || initStyle == SCE_PL_POD_VERB
-	          ) {
-		// POD backtracking finds preceding blank lines and goes back past them
-		Sci_Position ln = styler.GetLine(startPos);
-		if (ln > 0) {
-			initStyle = styler.StyleAt(styler.LineStart(--ln));
-			if (initStyle == SCE_PL_POD || initStyle == SCE_PL_POD_VERB) {
-				while (ln > 0 && styler.GetLineState(ln) == SCE_PL_DEFAULT)
-					ln--;
+	if (restart.valid) {
+		initStyle = restart.style;
+	} else {
+		// Backtrack to beginning of style if required...
+		// If in a long distance lexical state, backtrack to find quote characters.
+		// Includes strings (may be multi-line), numbers (additional state), format
+		// bodies, as well as POD sections.
+		if (initStyle == SCE_PL_HERE_Q
+		    || initStyle == SCE_PL_HERE_QQ
+		    || initStyle == SCE_PL_HERE_QX
+		    || initStyle == SCE_PL_FORMAT
+		    || initStyle == SCE_PL_HERE_QQ_VAR
+		    || initStyle == SCE_PL_HERE_QX_VAR
+		   ) {
+			// backtrack through multiple styles to reach the delimiter start
+			int delim = (initStyle == SCE_PL_FORMAT) ? SCE_PL_FORMAT_IDENT:SCE_PL_HERE_DELIM;
+			while ((startPos > 1) && (styler.StyleAt(startPos) != delim)) {
+				startPos--;
 			}
-			startPos = styler.LineStart(++ln);
+			startPos = styler.LineStart(styler.GetLine(startPos));
 			initStyle = styler.StyleAt(startPos - 1);
-		} else {
-			startPos = 0;
+		}
+		if (initStyle == SCE_PL_STRING
+		    || initStyle == SCE_PL_STRING_QQ
+		    || initStyle == SCE_PL_BACKTICKS
+		    || initStyle == SCE_PL_STRING_QX
+		    || initStyle == SCE_PL_REGEX
+		    || initStyle == SCE_PL_STRING_QR
+		    || initStyle == SCE_PL_REGSUBST
+		    || initStyle == SCE_PL_STRING_VAR
+		    || initStyle == SCE_PL_STRING_QQ_VAR
+		    || initStyle == SCE_PL_BACKTICKS_VAR
+		    || initStyle == SCE_PL_STRING_QX_VAR
+		    || initStyle == SCE_PL_REGEX_VAR
+		    || initStyle == SCE_PL_STRING_QR_VAR
+		    || initStyle == SCE_PL_REGSUBST_VAR
+		   ) {
+			// for interpolation, must backtrack through a mix of two different styles
+			int otherStyle = (initStyle >= SCE_PL_STRING_VAR) ?
+				initStyle - INTERPOLATE_SHIFT : initStyle + INTERPOLATE_SHIFT;
+			while (startPos > 1) {
+				int st = styler.StyleAt(startPos - 1);
+				if ((st != initStyle) && (st != otherStyle))
+					break;
+				startPos--;
+			}
+			initStyle = SCE_PL_DEFAULT;
+		} else if (initStyle == SCE_PL_STRING_Q
+		        || initStyle == SCE_PL_STRING_QW
+		        || initStyle == SCE_PL_XLAT
+		        || initStyle == SCE_PL_CHARACTER
+		        || initStyle == SCE_PL_NUMBER
+		        || initStyle == SCE_PL_IDENTIFIER
+		        || initStyle == SCE_PL_ERROR
+		        || initStyle == SCE_PL_SUB_PROTOTYPE
+		   ) {
+			while ((startPos > 1) && (styler.StyleAt(startPos - 1) == initStyle)) {
+				startPos--;
+			}
 			initStyle = SCE_PL_DEFAULT;
+		} else if (initStyle == SCE_PL_POD
+		        || initStyle == SCE_PL_POD_VERB
+		          ) {
+			// POD backtracking finds preceding blank lines and goes back past them
+			Sci_Position ln = styler.GetLine(startPos);
+			if (ln > 0) {
+				initStyle = styler.StyleAt(styler.LineStart(--ln));
+				if (initStyle == SCE_PL_POD || initStyle == SCE_PL_POD_VERB) {
+					while (ln > 0 && styler.GetLineState(ln) == SCE_PL_DEFAULT)
+						ln--;
+				}
+				startPos = styler.LineStart(++ln);
+				initStyle = styler.StyleAt(startPos - 1);
+			} else {
+				startPos = 0;
+				initStyle = SCE_PL_DEFAULT;
+			}
 		}
 	}
 
@@ -755,10 +835,69 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 			backFlag = BACK_KEYWORD;
 		backPos++;
 	}
+	if (restart.valid) {
+		HereDoc.State = restart.hereState;
+		HereDoc.Quote = restart.hereQuote;
+		HereDoc.Quoted = restart.hereQuoted;
+		const std::string &delimiter = restartStrings[restart.hereDelimiter];
+		HereDoc.DelimiterLength = static_cast<int>(delimiter.length());
+		memcpy(HereDoc.Delimiter, delimiter.c_str(), delimiter.length() + 1);
+		Quote.Rep = restart.quoteRep;
+		Quote.Count = restart.quoteCount;
+		Quote.Up = restart.quoteUp;
+		Quote.Down = restart.quoteDown;
+		numState = restart.numState;
+		dotCount = restart.dotCount;
+		backFlag = restart.backFlag;
+		backPos = restart.backPos;
+	}
+
+	// Records after this line are about to be replaced. Lines between the
+	// last record and this line have not been seen so mark them unknown.
+	const Sci_Position lineCurrent = styler.GetLine(startPos);
+	if (linesRecorded <= lineCurrent) {
+		restartStates.Set(linesRecorded, LineRestartState());
+	}
+	linesRecorded = lineCurrent + 1;
+	if (lineCurrent == 0) {
+		restartStrings.assign(1, std::string());
+	}
 
 	StyleContext sc(startPos, endPos - startPos, initStyle, styler);
 
+	// Record the state whenever the start of a line is reached. A line start
+	// skipped over by a multi-character construct is recorded as unknown.
+	const Sci_Position lineLast = styler.GetLine(styler.Length());
+	Sci_Position lineRecord = lineCurrent + 1;
+	Sci_PositionU lineRecordStart = styler.LineStart(lineRecord);
+	auto recordLineStarts = [&]() {
+		while ((lineRecordStart <= sc.currentPos) && (lineRecord <= lineLast)) {
+			LineRestartState record;
+			record.valid = lineRecordStart == sc.currentPos;
+			if (record.valid) {
+				record.style = sc.state;
+				record.hereState = HereDoc.State;
+				record.hereQuote = HereDoc.Quote;
+				record.hereQuoted = HereDoc.Quoted;
+				record.hereDelimiter = RestartString(HereDoc.Delimiter);
+				record.quoteRep = Quote.Rep;
+				record.quoteCount = Quote.Count;
+				record.quoteUp = Quote.Up;
+				record.quoteDown = Quote.Down;
+				record.numState = numState;
+				record.dotCount = dotCount;
+				record.backFlag = backFlag;
+				record.backPos = backPos;
+			}
+			restartStates.Set(lineRecord, record);
+			lineRecord++;
+			linesRecorded = lineRecord;
+			lineRecordStart = styler.LineStart(lineRecord);
+		}
+	};
+
 	for (; sc.More(); sc.Forward()) {
+		recordLineStarts();
 
 		// Determine if the current state should terminate.
 		switch (sc.state) {
@@ -1626,6 +1765,7 @@ void SCI_METHOD LexerPerl::Lex(Sci_PositionU startPos, Sci_Position length, int
 			}
 		}
 	}
+	recordLineStarts();
 	sc.Complete();
 	if (sc.state == SCE_PL_HERE_Q
 	        || sc.state == SCE_PL_HERE_QQ
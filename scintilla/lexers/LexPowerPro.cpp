@@ -135,8 +135,8 @@ static void ColourisePowerProDoc(Sci_PositionU startPos, Sci_Position length, in
 	WordList &keywords4 = *keywordlists[3];
 
 	//define the character sets
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_@", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_@", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
 
 	StyleContext sc(startPos, length, initStyle, styler);
 	char s_save[100]; //for last line highlighting
@@ -361,8 +361,8 @@ static void ColourisePowerProDoc(Sci_PositionU startPos, Sci_Position length, in
 static void FoldPowerProDoc(Sci_PositionU startPos, Sci_Position length, int, WordList *[], Accessor &styler)
 {
 	//define the character sets
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_@", 0x80, true);
-	CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_@", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "._", 0x80, true);
 
 	//used to tell if we're recursively folding the whole document, or just a small piece (ie: if statement or 1 function)
 	bool isFoldingAll = true;
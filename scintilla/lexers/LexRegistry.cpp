@@ -212,7 +212,7 @@ void SCI_METHOD LexerRegistry::Lex(Sci_PositionU startPos,
 								   IDocument *pAccess) {
 	int beforeGUID = SCE_REG_DEFAULT;
 	int beforeEscape = SCE_REG_DEFAULT;
-	CharacterSet setOperators = CharacterSet(CharacterSet::setNone, "-,.=:\\@()");
+	static const CharacterSet setOperators(CharacterSet::setNone, "-,.=:\\@()");
 	LexAccessor styler(pAccess);
 	StyleContext context(startPos, length, initStyle, styler);
 	bool highlight = true;
@@ -12,16 +12,23 @@
 #include <assert.h>
 #include <ctype.h>
 
+#include <string>
+#include <vector>
+#include <algorithm>
+
 #include "ILexer.h"
 #include "Scintilla.h"
 #include "SciLexer.h"
 
+#include "PropSetSimple.h"
 #include "WordList.h"
 #include "LexAccessor.h"
 #include "Accessor.h"
 #include "StyleContext.h"
 #include "CharacterSet.h"
 #include "LexerModule.h"
+#include "SparseState.h"
+#include "LexerBase.h"
 
 using namespace Scintilla;
 
@@ -278,6 +285,9 @@ public:
         }
         return *this;
     }
+    bool operator==(const QuoteCls &q) const {
+        return (Count == q.Count) && (Up == q.Up) && (Down == q.Down);
+    }
 
 };
 
@@ -692,14 +702,119 @@ static void synchronizeDocStart(Sci_PositionU &startPos,
     initStyle = SCE_RB_DEFAULT;
 }
 
-static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int initStyle,
-                           WordList *keywordlists[], Accessor &styler) {
+// In most cases a value of 2 should be ample for the code in the
+// Ruby library, and the code the user is likely to enter.
+// For example,
+// fu_output_message "mkdir #{options[:mode] ? ('-m %03o ' % options[:mode]) : ''}#{list.join ' '}"
+//     if options[:verbose]
+// from fileutils.rb nests to a level of 2
+// If the user actually hits a 6th occurrence of '#{' in a double-quoted
+// string (including regex'es, %Q, %<sym>, %w, and other strings
+// that interpolate), it will stay as a string.  The problem with this
+// is that quotes might flip, a 7th '#{' will look like a comment,
+// and code-folding might be wrong.
+
+// If anyone runs into this problem, I recommend raising this
+// value slightly higher to replacing the fixed array with a linked
+// list.  Keep in mind this code will be called every time the lexer
+// is invoked.
+
+#define INNER_STRINGS_MAX_COUNT 5
+
+namespace {
+
+// Everything Lex carries from one line to the next, recorded at the start of
+// each line so that lexing can resume there without backtracking.
+struct LineRestartState {
+    bool valid;
+    int state;
+    bool preferRE;
+    int hereState;
+    char hereQuote;
+    bool hereQuoted;
+    bool hereCanBeIndented;
+    int hereDelimiter;  // index into LexerRuby::restartStrings
+    QuoteCls quote;
+    int numDots;
+    bool isRealNumber;
+    int prevWord;       // index into LexerRuby::restartStrings
+    int innerStringCount;
+    int braceCounts;
+    int innerStringTypes[INNER_STRINGS_MAX_COUNT];
+    int innerExpnBraceCounts[INNER_STRINGS_MAX_COUNT];
+    QuoteCls innerQuotes[INNER_STRINGS_MAX_COUNT];
+    LineRestartState() : valid(false), state(SCE_RB_DEFAULT), preferRE(true), hereState(0), hereQuote(0),
+        hereQuoted(false), hereCanBeIndented(false), hereDelimiter(0), numDots(0), isRealNumber(true),
+        prevWord(0), innerStringCount(0), braceCounts(0) {
+    }
+    bool operator==(const LineRestartState &other) const {
+        if ((valid != other.valid) ||
+                (state != other.state) ||
+                (preferRE != other.preferRE) ||
+                (hereState != other.hereState) ||
+                (hereQuote != other.hereQuote) ||
+                (hereQuoted != other.hereQuoted) ||
+                (hereCanBeIndented != other.hereCanBeIndented) ||
+                (hereDelimiter != other.hereDelimiter) ||
+                !(quote == other.quote) ||
+                (numDots != other.numDots) ||
+                (isRealNumber != other.isRealNumber) ||
+                (prevWord != other.prevWord) ||
+                (innerStringCount != other.innerStringCount) ||
+                (braceCounts != other.braceCounts)) {
+            return false;
+        }
+        for (int i = 0; i < innerStringCount; i++) {
+            if ((innerStringTypes[i] != other.innerStringTypes[i]) ||
+                    (innerExpnBraceCounts[i] != other.innerExpnBraceCounts[i]) ||
+                    !(innerQuotes[i] == other.innerQuotes[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const LineRestartState &other) const {
+        return !(*this == other);
+    }
+};
+
+}
+
+class LexerRuby : public LexerBase {
+    // State at the start of each line, keyed by line number. Only lines before
+    // linesRecorded have been lexed since the text before them last changed.
+    // A record that is not valid means the state there is unknown.
+    SparseState<LineRestartState> restartStates;
+    Sci_Position linesRecorded;
+    std::vector<std::string> restartStrings;
+    int RestartString(const char *s) {
+        std::vector<std::string>::const_iterator it = std::find(restartStrings.begin(), restartStrings.end(), s);
+        if (it == restartStrings.end()) {
+            restartStrings.push_back(s);
+            return static_cast<int>(restartStrings.size() - 1);
+        }
+        return static_cast<int>(it - restartStrings.begin());
+    }
+public:
+    LexerRuby() : linesRecorded(0), restartStrings(1) {
+    }
+    static ILexer *LexerFactoryRuby() {
+        return new LexerRuby();
+    }
+    const char * SCI_METHOD DescribeWordListSets() override;
+    void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
+    void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) override;
+};
+
+void SCI_METHOD LexerRuby::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
+    Accessor styler(pAccess, &props);
 
     // Lexer for Ruby often has to backtrack to start of current style to determine
     // which characters are being used as quotes, how deeply nested is the
-    // start position and what the termination string is for here documents
+    // start position and what the termination string is for here documents.
+    // That is avoided when the state at the start of the line was recorded.
 
-    WordList &keywords = *keywordlists[0];
+    WordList &keywords = *keyWordLists[0];
 
     class HereDocCls {
     public:
@@ -728,8 +843,19 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
     int numDots = 0;  // For numbers --
     // Don't start lexing in the middle of a num
 
-    synchronizeDocStart(startPos, length, initStyle, styler, // ref args
-                        false);
+    LineRestartState restart;
+    {
+        const Sci_Position lineStart = styler.GetLine(startPos);
+        if ((lineStart > 0) && (lineStart < linesRecorded) &&
+                (startPos == static_cast<Sci_PositionU>(styler.LineStart(lineStart))))
+            restart = restartStates.ValueAt(lineStart);
+    }
+    if (restart.valid) {
+        initStyle = restart.state;
+    } else {
+        synchronizeDocStart(startPos, length, initStyle, styler, // ref args
+                            false);
+    }
 
     bool preferRE = true;
     int state = initStyle;
@@ -755,24 +881,6 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
                             };
     static const char *q_chars = "qQrwWx";
 
-    // In most cases a value of 2 should be ample for the code in the
-    // Ruby library, and the code the user is likely to enter.
-    // For example,
-    // fu_output_message "mkdir #{options[:mode] ? ('-m %03o ' % options[:mode]) : ''}#{list.join ' '}"
-    //     if options[:verbose]
-    // from fileutils.rb nests to a level of 2
-    // If the user actually hits a 6th occurrence of '#{' in a double-quoted
-    // string (including regex'es, %Q, %<sym>, %w, and other strings
-    // that interpolate), it will stay as a string.  The problem with this
-    // is that quotes might flip, a 7th '#{' will look like a comment,
-    // and code-folding might be wrong.
-
-    // If anyone runs into this problem, I recommend raising this
-    // value slightly higher to replacing the fixed array with a linked
-    // list.  Keep in mind this code will be called every time the lexer
-    // is invoked.
-
-#define INNER_STRINGS_MAX_COUNT 5
     // These vars track our instances of "...#{,,,%Q<..#{,,,}...>,,,}..."
     int inner_string_types[INNER_STRINGS_MAX_COUNT];
     // Track # braces when we push a new #{ thing
@@ -786,7 +894,77 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
         inner_string_types[i] = 0;
         inner_expn_brace_counts[i] = 0;
     }
+    if (restart.valid) {
+        preferRE = restart.preferRE;
+        HereDoc.State = restart.hereState;
+        HereDoc.Quote = restart.hereQuote;
+        HereDoc.Quoted = restart.hereQuoted;
+        HereDoc.CanBeIndented = restart.hereCanBeIndented;
+        const std::string &delimiter = restartStrings[restart.hereDelimiter];
+        HereDoc.DelimiterLength = static_cast<int>(delimiter.length());
+        memcpy(HereDoc.Delimiter, delimiter.c_str(), delimiter.length() + 1);
+        Quote = restart.quote;
+        numDots = restart.numDots;
+        is_real_number = restart.isRealNumber;
+        strcpy(prevWord, restartStrings[restart.prevWord].c_str());
+        inner_string_count = restart.innerStringCount;
+        brace_counts = restart.braceCounts;
+        for (i = 0; i < inner_string_count; i++) {
+            inner_string_types[i] = restart.innerStringTypes[i];
+            inner_expn_brace_counts[i] = restart.innerExpnBraceCounts[i];
+            inner_quotes[i] = restart.innerQuotes[i];
+        }
+    }
+
+    // Records after this line are about to be replaced. Lines between the
+    // last record and this line have not been seen so mark them unknown.
+    const Sci_Position lineCurrent = styler.GetLine(startPos);
+    if (linesRecorded <= lineCurrent) {
+        restartStates.Set(linesRecorded, LineRestartState());
+    }
+    linesRecorded = lineCurrent + 1;
+    if (lineCurrent == 0) {
+        restartStrings.assign(1, std::string());
+    }
+
+    // Record the state whenever the start of a line is reached. A line start
+    // skipped over by a multi-character construct is recorded as unknown.
+    const Sci_Position lineLast = styler.GetLine(styler.Length());
+    Sci_Position lineRecord = lineCurrent + 1;
+    Sci_Position lineRecordStart = styler.LineStart(lineRecord);
+    auto recordLineStarts = [&]() {
+        while ((lineRecordStart <= i) && (lineRecord <= lineLast)) {
+            LineRestartState record;
+            record.valid = lineRecordStart == i;
+            if (record.valid) {
+                record.state = state;
+                record.preferRE = preferRE;
+                record.hereState = HereDoc.State;
+                record.hereQuote = HereDoc.Quote;
+                record.hereQuoted = HereDoc.Quoted;
+                record.hereCanBeIndented = HereDoc.CanBeIndented;
+                record.hereDelimiter = RestartString(HereDoc.Delimiter);
+                record.quote = Quote;
+                record.numDots = numDots;
+                record.isRealNumber = is_real_number;
+                record.prevWord = RestartString(prevWord);
+                record.innerStringCount = inner_string_count;
+                record.braceCounts = brace_counts;
+                for (int k = 0; k < inner_string_count; k++) {
+                    record.innerStringTypes[k] = inner_string_types[k];
+                    record.innerExpnBraceCounts[k] = inner_expn_brace_counts[k];
+                    record.innerQuotes[k] = inner_quotes[k];
+                }
+            }
+            restartStates.Set(lineRecord, record);
+            lineRecord++;
+            linesRecorded = lineRecord;
+            lineRecordStart = styler.LineStart(lineRecord);
+        }
+    };
+
     for (i = startPos; i < lengthDoc; i++) {
+        recordLineStarts();
         char ch = chNext;
         chNext = styler.SafeGetCharAt(i + 1);
         char chNext2 = styler.SafeGetCharAt(i + 2);
@@ -1319,7 +1497,7 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
                                                 i - HereDoc.DelimiterLength + 1,
                                                 lengthDoc,
                                                 HereDoc.Delimiter)) {
-                styler.ColourTo(i - 1 - HereDoc.DelimiterLength, state);
+                styler.ColourTo(i - HereDoc.DelimiterLength, state);
                 styler.ColourTo(i, SCE_RB_HERE_DELIM);
                 state = SCE_RB_DEFAULT;
                 preferRE = false;
@@ -1475,6 +1653,9 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
         }
         chPrev = ch;
     }
+    if (i >= lengthDoc) {
+        recordLineStarts();
+    }
     if (state == SCE_RB_WORD) {
         // We've ended on a word, possibly at EOF, and need to
         // classify it.
@@ -1482,6 +1663,7 @@ static void ColouriseRbDoc(Sci_PositionU startPos, Sci_Position length, int init
     } else {
         styler.ColourTo(lengthDoc - 1, state);
     }
+    styler.Flush();
 }
 
 // Helper functions for folding, disambiguation keywords
@@ -1760,13 +1942,14 @@ static bool IsCommentLine(Sci_Position line, Accessor &styler) {
  *  Later offer to fold POD, here-docs, strings, and blocks of comments
  */
 
-static void FoldRbDoc(Sci_PositionU startPos, Sci_Position length, int initStyle,
+static void FoldRbDoc(Sci_PositionU startPos, Sci_Position length,
                       WordList *[], Accessor &styler) {
     const bool foldCompact = styler.GetPropertyInt("fold.compact", 1) != 0;
     bool foldComment = styler.GetPropertyInt("fold.comment") != 0;
 
-    synchronizeDocStart(startPos, length, initStyle, styler, // ref args
-                        false);
+    // Fold levels depend only on the previous line's level and the styles
+    // set by the lexer, so there is no need to back up over multi-line
+    // constructs here.
     Sci_PositionU endPos = startPos + length;
     int visibleChars = 0;
     Sci_Position lineCurrent = styler.GetLine(startPos);
@@ -1871,9 +2054,28 @@ static void FoldRbDoc(Sci_PositionU startPos, Sci_Position length, int initStyle
     styler.SetLevel(lineCurrent, levelCurrent|SC_FOLDLEVELBASE);
 }
 
+const char * SCI_METHOD LexerRuby::DescribeWordListSets() {
+    return "Keywords";
+}
+
+void SCI_METHOD LexerRuby::Fold(Sci_PositionU startPos, Sci_Position length, int /* initStyle */, IDocument *pAccess) {
+    if (props.GetInt("fold")) {
+        Accessor styler(pAccess, &props);
+        // Move back one line in case deletion wrecked current line fold state
+        const Sci_Position lineCurrent = styler.GetLine(startPos);
+        if (lineCurrent > 0) {
+            const Sci_Position newStartPos = styler.LineStart(lineCurrent - 1);
+            length += startPos - newStartPos;
+            startPos = newStartPos;
+        }
+        FoldRbDoc(startPos, length, keyWordLists, styler);
+        styler.Flush();
+    }
+}
+
 static const char *const rubyWordListDesc[] = {
     "Keywords",
     0
 };
 
-LexerModule lmRuby(SCLEX_RUBY, ColouriseRbDoc, "ruby", FoldRbDoc, rubyWordListDesc);
+LexerModule lmRuby(SCLEX_RUBY, LexerRuby::LexerFactoryRuby, "ruby", rubyWordListDesc);
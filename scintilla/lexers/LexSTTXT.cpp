@@ -63,12 +63,12 @@ static void ColouriseSTTXTDoc (Sci_PositionU startPos, Sci_Position length, int
 {
 	StyleContext sc(startPos, length, initStyle, styler);
 
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
-	CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
-	CharacterSet setNumber(CharacterSet::setDigits, "_.eE");
-	CharacterSet setHexNumber(CharacterSet::setDigits, "_abcdefABCDEF");
-	CharacterSet setOperator(CharacterSet::setNone,",.+-*/:;<=>[]()%&");
-	CharacterSet setDataTime(CharacterSet::setDigits,"_.-:dmshDMSH");
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
+	static const CharacterSet setWordStart(CharacterSet::setAlpha, "_", 0x80, true);
+	static const CharacterSet setNumber(CharacterSet::setDigits, "_.eE");
+	static const CharacterSet setHexNumber(CharacterSet::setDigits, "_abcdefABCDEF");
+	static const CharacterSet setOperator(CharacterSet::setNone,",.+-*/:;<=>[]()%&");
+	static const CharacterSet setDataTime(CharacterSet::setDigits,"_.-:dmshDMSH");
 
  	for ( ; sc.More() ; sc.Forward())
  	{
@@ -334,7 +334,7 @@ static void FoldSTTXTDoc(Sci_PositionU startPos, Sci_Position length, int initSt
 	int style = initStyle;
 	Sci_Position lastStart = 0;
 
-	CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
+	static const CharacterSet setWord(CharacterSet::setAlphaNum, "_", 0x80, true);
 
 	for (Sci_PositionU i = startPos; i < endPos; i++)
 	{
@@ -250,8 +250,8 @@ static void forwardEscapeLiteral(StyleContext &sc, int EscapeState) {
 
 void SCI_METHOD LexerVisualProlog::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
     LexAccessor styler(pAccess);
-    CharacterSet setDoxygen(CharacterSet::setAlpha, "");
-    CharacterSet setNumber(CharacterSet::setNone, "0123456789abcdefABCDEFxoXO");
+    static const CharacterSet setDoxygen(CharacterSet::setAlpha, "");
+    static const CharacterSet setNumber(CharacterSet::setNone, "0123456789abcdefABCDEFxoXO");
 
     StyleContext sc(startPos, length, initStyle, styler, 0x7f);
 
@@ -10,10 +10,44 @@
 
 namespace Scintilla {
 
+// Helpers for building the bit table of a CharacterSet at compile time.
+// C++11 constexpr functions are limited to a single return statement so
+// loops are written as recursion.
+namespace CharacterSetBits {
+
+// Bits of 32 bit word 'word' for the characters first to last inclusive.
+constexpr unsigned int RangeInWord(int word, int first, int last) {
+	return (last < first) ? 0U :
+		(((last - first) >= 31) ? 0xFFFFFFFFU : ((1U << (last - first + 1)) - 1U)) << (first - word * 32);
+}
+
+constexpr unsigned int Range(int word, int first, int last) {
+	return RangeInWord(word,
+		(first > word * 32) ? first : word * 32,
+		(last < word * 32 + 31) ? last : word * 32 + 31);
+}
+
+constexpr unsigned int String(int word, const char *s) {
+	return *s ? (((static_cast<unsigned char>(*s) >> 5) == word ?
+			(1U << (static_cast<unsigned char>(*s) & 0x1F)) : 0U) | String(word, s + 1)) : 0U;
+}
+
+constexpr unsigned int Word(int word, int base, const char *initialSet, int size, bool valueAfter) {
+	return String(word, initialSet) |
+		((base & 1) ? Range(word, 'a', 'z') : 0U) |
+		((base & 2) ? Range(word, 'A', 'Z') : 0U) |
+		((base & 4) ? Range(word, '0', '9') : 0U) |
+		(valueAfter ? Range(word, size, 0xFF) : 0U);
+}
+
+}
+
 class CharacterSet {
 	int size;
 	bool valueAfter;
-	bool *bset;
+	// One bit for each byte value. Values from size up to 0xFF hold valueAfter so
+	// that Contains needs no size check for bytes.
+	unsigned int bset[8];
 public:
 	enum setBase {
 		setNone=0,
@@ -23,76 +57,37 @@ public:
 		setAlpha=setLower|setUpper,
 		setAlphaNum=setAlpha|setDigits
 	};
-	CharacterSet(setBase base=setNone, const char *initialSet="", int size_=0x80, bool valueAfter_=false) {
-		size = size_;
-		valueAfter = valueAfter_;
-		bset = new bool[size];
-		for (int i=0; i < size; i++) {
-			bset[i] = false;
-		}
-		AddString(initialSet);
-		if (base & setLower)
-			AddString("abcdefghijklmnopqrstuvwxyz");
-		if (base & setUpper)
-			AddString("ABCDEFGHIJKLMNOPQRSTUVWXYZ");
-		if (base & setDigits)
-			AddString("0123456789");
-	}
-	CharacterSet(const CharacterSet &other) {
-		size = other.size;
-		valueAfter = other.valueAfter;
-		bset = new bool[size];
-		for (int i=0; i < size; i++) {
-			bset[i] = other.bset[i];
-		}
-	}
-	CharacterSet &operator=(CharacterSet &&other) {
-		if (this != &other) {
-			delete []bset;
-			size = other.size;
-			valueAfter = other.valueAfter;
-			bset = other.bset;
-			other.size = 0;
-			other.bset = nullptr;
-		}
-		return *this;
-	}
-	~CharacterSet() {
-		delete []bset;
-		bset = nullptr;
-		size = 0;
-	}
-	CharacterSet &operator=(const CharacterSet &other) {
-		if (this != &other) {
-			bool *bsetNew = new bool[other.size];
-			for (int i=0; i < other.size; i++) {
-				bsetNew[i] = other.bset[i];
-			}
-			delete []bset;
-			size = other.size;
-			valueAfter = other.valueAfter;
-			bset = bsetNew;
-		}
-		return *this;
+	// constexpr so that sets with constant arguments declared as static const
+	// are built at compile time instead of each time a lexer runs.
+	constexpr CharacterSet(setBase base=setNone, const char *initialSet="", int size_=0x80, bool valueAfter_=false) :
+		size(size_),
+		valueAfter(valueAfter_),
+		bset{
+			CharacterSetBits::Word(0, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(1, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(2, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(3, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(4, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(5, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(6, base, initialSet, size_, valueAfter_),
+			CharacterSetBits::Word(7, base, initialSet, size_, valueAfter_)
+		} {
 	}
 	void Add(int val) {
 		assert(val >= 0);
 		assert(val < size);
-		bset[val] = true;
+		bset[val >> 5] |= 1U << (val & 0x1F);
 	}
 	void AddString(const char *setToAdd) {
 		for (const char *cp=setToAdd; *cp; cp++) {
-			int val = static_cast<unsigned char>(*cp);
-			assert(val >= 0);
-			assert(val < size);
-			bset[val] = true;
+			Add(static_cast<unsigned char>(*cp));
 		}
 	}
-	bool Contains(int val) const {
-        // val being -ve is valid (or there is a sign extension bug elsewhere.
-		//assert(val >= 0);
-		if (val < 0) return false;
-		return (val < size) ? bset[val] : valueAfter;
+	constexpr bool Contains(int val) const {
+		// val being -ve is valid (or there is a sign extension bug elsewhere.
+		return (val < 0) ? false :
+			(val > 0xFF) ? valueAfter :
+			((bset[val >> 5] >> (val & 0x1F)) & 1U) != 0;
 	}
 };
 
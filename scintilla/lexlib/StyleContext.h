@@ -128,6 +128,20 @@ public:
 			Forward();
 		}
 	}
+	// Move over nb bytes in one step, only reading the characters at the destination.
+	// The bytes skipped must all be ASCII and must not include a line end.
+	void ForwardASCIIWithinLine(Sci_Position nb) {
+		if (nb > 0) {
+			atLineStart = false;
+			currentPos += nb;
+			chPrev = static_cast<unsigned char>(styler.SafeGetCharAt(currentPos - 1, 0));
+			width = 0;
+			GetNextChar();
+			ch = chNext;
+			width = widthNext;
+			GetNextChar();
+		}
+	}
 	void ForwardBytes(Sci_Position nb) {
 		const Sci_PositionU forwardPos = currentPos + nb;
 		while (forwardPos > currentPos) {
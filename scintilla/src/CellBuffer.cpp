@@ -11,6 +11,7 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdarg>
+#include <cstdint>
 
 #include <stdexcept>
 #include <string>
@@ -269,6 +270,255 @@ public:
 	}
 };
 
+namespace Scintilla {
+
+/**
+ * Hashes the text of a cell buffer so that digests of all of it or of ranges are available
+ * without reading the whole text again after each change.
+ * The text is divided into blocks of a few thousand bytes and the polynomial hash of each block
+ * is combined with its neighbours in a segment tree. As the polynomial hash of a sequence can be
+ * combined from the hashes of its parts, a digest depends only on the text and not on where
+ * block boundaries fall, so documents with different histories can be compared.
+ * A change rehashes the blocks it touches and updates the tree in O(log blocks); splitting
+ * or merging blocks rebuilds the tree when it is next needed.
+ */
+class ContentHash {
+public:
+	struct Value {
+		std::uint64_t hash;
+		std::uint64_t power;
+		Value(std::uint64_t hash_=0, std::uint64_t power_=1) noexcept : hash(hash_), power(power_) {
+		}
+		bool operator==(const Value &other) const noexcept {
+			return hash == other.hash && power == other.power;
+		}
+	};
+private:
+	static constexpr std::uint64_t modulus = (static_cast<std::uint64_t>(1) << 61) - 1;
+	// Small enough for each half of a hash multiplied by it to fit in 64 bits
+	static constexpr std::uint64_t base = 0x1C6A3E95;
+	static constexpr Sci::Position blockSize = 4096;
+
+	Partitioning<Sci::Position> blocks;
+	SplitVector<Value> blockValues;
+	std::vector<Value> tree;
+	size_t leaves;
+	bool treeValid;
+
+	static std::uint64_t MulMod(std::uint64_t a, std::uint64_t b) noexcept {
+		// Multiply 61 bit values by halves to avoid needing a 128 bit type
+		const std::uint64_t aLow = a & 0xffffffffU;
+		const std::uint64_t aHigh = a >> 32;
+		const std::uint64_t bLow = b & 0xffffffffU;
+		const std::uint64_t bHigh = b >> 32;
+		const std::uint64_t low = aLow * bLow;
+		const std::uint64_t middle = aLow * bHigh + aHigh * bLow;
+		const std::uint64_t high = aHigh * bHigh;
+		std::uint64_t product = (low & modulus) + (low >> 61) + (high << 3) +
+			(middle >> 29) + ((middle << 35) >> 3) + 1;
+		product = (product & modulus) + (product >> 61);
+		product = (product & modulus) + (product >> 61);
+		return product - 1;
+	}
+	// Hashing each byte is the bulk of the work so multiplying by base is done specially.
+	static std::uint64_t MulBaseAdd(std::uint64_t hash, unsigned int value) noexcept {
+		const std::uint64_t high = (hash >> 32) * base;
+		// high << 32 is reduced by 2^61 being congruent to 1
+		std::uint64_t result = (high >> 29) + ((high & 0x1fffffffU) << 32) +
+			(hash & 0xffffffffU) * base + value;
+		result = (result & modulus) + (result >> 61);
+		return (result >= modulus) ? result - modulus : result;
+	}
+	static std::uint64_t AddMod(std::uint64_t a, std::uint64_t b) noexcept {
+		const std::uint64_t sum = a + b;
+		return (sum >= modulus) ? sum - modulus : sum;
+	}
+	static std::uint64_t Power(Sci::Position length) noexcept {
+		std::uint64_t result = 1;
+		std::uint64_t square = base;
+		while (length > 0) {
+			if (length & 1)
+				result = MulMod(result, square);
+			square = MulMod(square, square);
+			length >>= 1;
+		}
+		return result;
+	}
+	static Value Hash(const SplitVector<char> &substance, Sci::Position start, Sci::Position end) {
+		const Sci::Position length = end - start;
+		std::uint64_t hash = 0;
+		char buffer[blockSize];
+		while (start < end) {
+			const Sci::Position lengthChunk = std::min(end - start, blockSize);
+			substance.GetRange(buffer, start, lengthChunk);
+			// Hash quarters of the chunk together so they do not wait on each other then
+			// join them. 1 is added to each byte so that runs of NUL still change the hash.
+			const Sci::Position quarter = lengthChunk / 4;
+			const unsigned char *bytes = reinterpret_cast<const unsigned char *>(buffer);
+			std::uint64_t hashes[4] = {0, 0, 0, 0};
+			for (Sci::Position i = 0; i < quarter; i++) {
+				hashes[0] = MulBaseAdd(hashes[0], bytes[i] + 1);
+				hashes[1] = MulBaseAdd(hashes[1], bytes[quarter + i] + 1);
+				hashes[2] = MulBaseAdd(hashes[2], bytes[2 * quarter + i] + 1);
+				hashes[3] = MulBaseAdd(hashes[3], bytes[3 * quarter + i] + 1);
+			}
+			for (Sci::Position i = 4 * quarter; i < lengthChunk; i++) {
+				hashes[3] = MulBaseAdd(hashes[3], bytes[i] + 1);
+			}
+			const std::uint64_t powerQuarter = Power(quarter);
+			for (int part = 0; part < 3; part++) {
+				hash = AddMod(MulMod(hash, powerQuarter), hashes[part]);
+			}
+			hash = AddMod(MulMod(hash, Power(lengthChunk - 3 * quarter)), hashes[3]);
+			start += lengthChunk;
+		}
+		return Value(hash, Power(length));
+	}
+
+	Sci::Position BlockStart(Sci::Position block) const noexcept {
+		return blocks.PositionFromPartition(block);
+	}
+	void RehashBlock(const SplitVector<char> &substance, Sci::Position block) {
+		blockValues.SetValueAt(block, HashBlock(substance, block));
+		if (treeValid) {
+			size_t node = leaves + block;
+			tree[node] = blockValues.ValueAt(block);
+			while (node > 1) {
+				node /= 2;
+				tree[node] = Combine(tree[2 * node], tree[2 * node + 1]);
+			}
+		}
+	}
+	Value HashBlock(const SplitVector<char> &substance, Sci::Position block) const {
+		return Hash(substance, BlockStart(block), BlockStart(block + 1));
+	}
+	void InsertBlock(Sci::Position block, Sci::Position position) {
+		blocks.InsertPartition(block, position);
+		blockValues.Insert(block, Value());
+		treeValid = false;
+	}
+	void RemoveBlock(Sci::Position block) {
+		blocks.RemovePartition(block);
+		blockValues.Delete(block);
+		treeValid = false;
+	}
+	// Keep blocks from growing so large that rehashing is slow or so small that they are numerous.
+	void Rebalance(const SplitVector<char> &substance, Sci::Position block) {
+		if ((BlockStart(block + 1) - BlockStart(block) < blockSize / 4) && (blocks.Partitions() > 1)) {
+			if (block + 1 < blocks.Partitions()) {
+				RemoveBlock(block + 1);
+			} else {
+				RemoveBlock(block);
+				block--;
+			}
+		}
+		const Sci::Position start = BlockStart(block);
+		const Sci::Position length = BlockStart(block + 1) - start;
+		const Sci::Position pieces = (length > 2 * blockSize) ? length / blockSize : 1;
+		for (Sci::Position piece = 1; piece < pieces; piece++) {
+			InsertBlock(block + piece, start + piece * blockSize);
+		}
+		for (Sci::Position piece = 0; piece < pieces; piece++) {
+			RehashBlock(substance, block + piece);
+		}
+	}
+	void BuildTree() {
+		leaves = 1;
+		while (leaves < static_cast<size_t>(blocks.Partitions()))
+			leaves *= 2;
+		tree.assign(2 * leaves, Value());
+		for (Sci::Position block = 0; block < blocks.Partitions(); block++) {
+			tree[leaves + block] = blockValues.ValueAt(block);
+		}
+		for (size_t node = leaves - 1; node > 0; node--) {
+			tree[node] = Combine(tree[2 * node], tree[2 * node + 1]);
+		}
+		treeValid = true;
+	}
+	// Combined value of blocks blockFirst up to but not including blockEnd.
+	Value BlocksValue(Sci::Position blockFirst, Sci::Position blockEnd) {
+		if (!treeValid)
+			BuildTree();
+		Value left;
+		Value right;
+		size_t lower = leaves + blockFirst;
+		size_t upper = leaves + blockEnd;
+		while (lower < upper) {
+			if (lower & 1)
+				left = Combine(left, tree[lower++]);
+			if (upper & 1)
+				right = Combine(tree[--upper], right);
+			lower /= 2;
+			upper /= 2;
+		}
+		return Combine(left, right);
+	}
+
+public:
+	explicit ContentHash(const SplitVector<char> &substance) : blocks(256), leaves(1), treeValid(false) {
+		const Sci::Position length = substance.Length();
+		blocks.InsertText(0, length);
+		blockValues.InsertValue(0, 1, Value());
+		for (Sci::Position block = 1; block * blockSize < length; block++) {
+			blocks.InsertPartition(block, block * blockSize);
+			blockValues.Insert(block, Value());
+		}
+		for (Sci::Position block = 0; block < blocks.Partitions(); block++) {
+			blockValues.SetValueAt(block, HashBlock(substance, block));
+		}
+	}
+
+	static Value Combine(Value a, Value b) noexcept {
+		return Value(AddMod(MulMod(a.hash, b.power), b.hash), MulMod(a.power, b.power));
+	}
+
+	void InsertText(const SplitVector<char> &substance, Sci::Position position, Sci::Position insertLength) {
+		const Sci::Position block = blocks.PartitionFromPosition(position);
+		blocks.InsertText(block, insertLength);
+		Rebalance(substance, block);
+	}
+
+	// Called after text is removed from substance while block positions still include it.
+	void DeleteText(const SplitVector<char> &substance, Sci::Position position, Sci::Position deleteLength) {
+		const Sci::Position block = blocks.PartitionFromPosition(position);
+		const Sci::Position blockEnd = blocks.PartitionFromPosition(position + deleteLength - 1);
+		// Blocks wholly deleted and the remains of the last block join the first block
+		for (Sci::Position blockRemove = blockEnd; blockRemove > block; blockRemove--) {
+			RemoveBlock(blockRemove);
+		}
+		blocks.InsertText(block, -deleteLength);
+		Rebalance(substance, block);
+	}
+
+	Value RangeValue(const SplitVector<char> &substance, Sci::Position start, Sci::Position end) {
+		const Sci::Position blockFirst = blocks.PartitionFromPosition(start);
+		const Sci::Position blockLast = blocks.PartitionFromPosition(end);
+		Value value;
+		Sci::Position blockWhole = blockFirst;
+		if (start > BlockStart(blockFirst)) {
+			// Partial first block
+			value = Hash(substance, start, std::min(end, BlockStart(blockFirst + 1)));
+			blockWhole++;
+		}
+		const Sci::Position blockLastStart = BlockStart(blockLast);
+		const bool lastWhole = (end == BlockStart(blockLast + 1)) && (end > blockLastStart);
+		const Sci::Position blockWholeEnd = lastWhole ? blockLast + 1 : blockLast;
+		if (blockWhole < blockWholeEnd) {
+			value = Combine(value, BlocksValue(blockWhole, blockWholeEnd));
+		}
+		if (!lastWhole && (blockLast >= blockWhole) && (end > blockLastStart)) {
+			// Partial last block
+			value = Combine(value, Hash(substance, blockLastStart, end));
+		}
+		return value;
+	}
+};
+
+// Definition needed as std::min binds a reference to it.
+constexpr Sci::Position ContentHash::blockSize;
+
+}
+
 Action::Action() {
 	at = startAction;
 	position = 0;
@@ -529,6 +779,14 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
+bool UndoHistory::GroupHasContainerAction(int steps, bool redo) const {
+	for (int step = 0; step < steps; step++) {
+		if (actions[redo ? currentAction + step : currentAction - step].at == containerAction)
+			return true;
+	}
+	return false;
+}
+
 CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 	hasStyles(hasStyles_), largeDocument(largeDocument_) {
 	readOnly = false;
@@ -949,6 +1207,9 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 	if (hasStyles) {
 		style.InsertValue(position, insertLength, 0);
 	}
+	if (contentHash) {
+		contentHash->InsertText(substance, position, insertLength);
+	}
 
 	const bool atLineStart = plv->LineStart(lineInsert-1) == position;
 	// Point all the lines after the insertion point further along in the buffer
@@ -1119,6 +1380,9 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 		}
 	}
 	substance.DeleteRange(position, deleteLength);
+	if (contentHash) {
+		contentHash->DeleteText(substance, position, deleteLength);
+	}
 	if (lineRecalculateStart >= 0) {
 		RecalculateIndexLineStarts(lineRecalculateStart, lineRecalculateStart);
 	}
@@ -1180,6 +1444,11 @@ void CellBuffer::PerformUndoStep() {
 	uh.CompletedUndoStep();
 }
 
+// Move past the next undo or redo step without changing the text as the caller applies it.
+void CellBuffer::SkipUndoStep() {
+	uh.CompletedUndoStep();
+}
+
 bool CellBuffer::CanRedo() const {
 	return uh.CanRedo();
 }
@@ -1202,3 +1471,46 @@ void CellBuffer::PerformRedoStep() {
 	uh.CompletedRedoStep();
 }
 
+void CellBuffer::SkipRedoStep() {
+	uh.CompletedRedoStep();
+}
+
+bool CellBuffer::GroupHasContainerAction(int steps, bool redo) const {
+	return uh.GroupHasContainerAction(steps, redo);
+}
+
+void CellBuffer::DeleteCharsUnrecorded(Sci::Position position, Sci::Position deleteLength) {
+	BasicDeleteChars(position, deleteLength);
+}
+
+void CellBuffer::InsertStringUnrecorded(Sci::Position position, const char *s, Sci::Position insertLength) {
+	BasicInsertString(position, s, insertLength);
+}
+
+uint64_t CellBuffer::HashRange(Sci::Position start, Sci::Position end) {
+	if (!contentHash) {
+		contentHash.reset(new ContentHash(substance));
+	}
+	start = Sci::clamp(start, static_cast<Sci::Position>(0), Length());
+	end = Sci::clamp(end, start, Length());
+	return contentHash->RangeValue(substance, start, end).hash;
+}
+
+// Find the first position where the text differs from other by bisecting on the hashes
+// of prefixes. Returns -1 when the texts are the same.
+Sci::Position CellBuffer::FirstDifference(CellBuffer &other) {
+	const Sci::Position lengthCommon = std::min(Length(), other.Length());
+	if (HashRange(0, lengthCommon) == other.HashRange(0, lengthCommon))
+		return (Length() == other.Length()) ? -1 : lengthCommon;
+	// Prefixes of length lower are equal and of length upper differ
+	Sci::Position lower = 0;
+	Sci::Position upper = lengthCommon;
+	while (upper - lower > 1) {
+		const Sci::Position middle = lower + (upper - lower) / 2;
+		if (HashRange(0, middle) == other.HashRange(0, middle))
+			lower = middle;
+		else
+			upper = middle;
+	}
+	return lower;
+}
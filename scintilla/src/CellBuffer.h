@@ -24,6 +24,8 @@ public:
  */
 class ILineVector;
 
+class ContentHash;
+
 enum actionType { insertAction, removeAction, startAction, containerAction };
 
 /**
@@ -99,6 +101,10 @@ public:
 	int StartRedo();
 	const Action &GetRedoStep() const;
 	void CompletedRedoStep();
+
+	/// Whether any of the next steps actions of an undo or redo is a container action, as
+	/// containers expect a notification for each of them.
+	bool GroupHasContainerAction(int steps, bool redo) const;
 };
 
 /**
@@ -121,6 +127,8 @@ private:
 
 	std::unique_ptr<ILineVector> plv;
 
+	std::unique_ptr<ContentHash> contentHash;
+
 	bool UTF8LineEndOverlaps(Sci::Position position) const;
 	bool UTF8IsCharacterBoundary(Sci::Position position) const;
 	void ResetLineEnds();
@@ -204,10 +212,23 @@ public:
 	int StartUndo();
 	const Action &GetUndoStep() const;
 	void PerformUndoStep();
+	void SkipUndoStep();
 	bool CanRedo() const;
 	int StartRedo();
 	const Action &GetRedoStep() const;
 	void PerformRedoStep();
+	void SkipRedoStep();
+	bool GroupHasContainerAction(int steps, bool redo) const;
+
+	/// Change the text without recording undo or checking read-only state so that steps
+	/// skipped over in the undo history can be applied a few at a time.
+	void DeleteCharsUnrecorded(Sci::Position position, Sci::Position deleteLength);
+	void InsertStringUnrecorded(Sci::Position position, const char *s, Sci::Position insertLength);
+
+	/// Hashes of the text are calculated when first requested then kept up to date
+	/// as the text changes so later requests are quick.
+	uint64_t HashRange(Sci::Position start, Sci::Position end);
+	Sci::Position FirstDifference(CellBuffer &other);
 };
 
 }
@@ -39,6 +39,7 @@ class ContractionState final : public IContractionState {
 	LINE linesInDocument;
 
 	void EnsureData();
+	void RebuildDisplayLines();
 
 	bool OneToOne() const noexcept {
 		// True when each document line is exactly one display line so need for
@@ -83,6 +84,7 @@ public:
 
 	int GetHeight(Sci::Line lineDoc) const override;
 	bool SetHeight(Sci::Line lineDoc, int height) override;
+	void ResetHeights() override;
 
 	void ShowAll() override;
 
@@ -106,8 +108,39 @@ void ContractionState<LINE>::EnsureData() {
 		heights = std::unique_ptr<RunStyles<LINE, int>>(new RunStyles<LINE, int>());
 		foldDisplayTexts = std::unique_ptr<SparseVector<UniqueString>>(new SparseVector<UniqueString>());
 		displayLines = std::unique_ptr<Partitioning<LINE>>(new Partitioning<LINE>(4));
-		InsertLines(0, linesInDocument);
+		// Every line starts visible, expanded and one display line high
+		const LINE lines = static_cast<LINE>(linesInDocument);
+		visible->InsertSpace(0, lines);
+		visible->FillRange(0, 1, lines);
+		expanded->InsertSpace(0, lines);
+		expanded->FillRange(0, 1, lines);
+		heights->InsertSpace(0, lines);
+		heights->FillRange(0, 1, lines);
+		foldDisplayTexts->InsertSpace(0, lines);
+		RebuildDisplayLines();
+		Check();
+	}
+}
+
+// Find the display line of every document line from the visibility and heights in one
+// pass instead of updating the partitioning once for each line.
+template <typename LINE>
+void ContractionState<LINE>::RebuildDisplayLines() {
+	const LINE lines = static_cast<LINE>(visible->Length());
+	std::vector<LINE> starts(lines);
+	LINE lineDisplay = 0;
+	for (LINE line = 0; line < lines;) {
+		// Runs of visibility and height are long so handle each together
+		const LINE endRun = std::min(visible->EndRun(line), heights->EndRun(line));
+		const LINE height = visible->ValueAt(line) ? static_cast<LINE>(heights->ValueAt(line)) : 0;
+		for (; line < endRun; line++) {
+			lineDisplay += height;
+			starts[line] = lineDisplay;
+		}
 	}
+	displayLines->DeleteAll();
+	displayLines->InsertPartitions(1, starts.data(), starts.size());
+	displayLines->InsertText(lines, lineDisplay);
 }
 
 template <typename LINE>
@@ -374,6 +407,19 @@ bool ContractionState<LINE>::SetHeight(Sci::Line lineDoc, int height) {
 	}
 }
 
+// Make every line one display line high as when wrapping is turned off.
+template <typename LINE>
+void ContractionState<LINE>::ResetHeights() {
+	if (!OneToOne()) {
+		const LINE lines = static_cast<LINE>(heights->Length());
+		heights->DeleteAll();
+		heights->InsertSpace(0, lines);
+		heights->FillRange(0, 1, lines);
+		RebuildDisplayLines();
+		Check();
+	}
+}
+
 template <typename LINE>
 void ContractionState<LINE>::ShowAll() {
 	const LINE lines = static_cast<LINE>(LinesInDoc());
@@ -41,6 +41,7 @@ public:
 
 	virtual int GetHeight(Sci::Line lineDoc) const=0;
 	virtual bool SetHeight(Sci::Line lineDoc, int height)=0;
+	virtual void ResetHeights()=0;
 
 	virtual void ShowAll()=0;
 };
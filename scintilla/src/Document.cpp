@@ -9,15 +9,18 @@
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <cstdint>
 #include <cstdio>
 #include <cmath>
 
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include <deque>
 #include <forward_list>
 #include <algorithm>
 #include <memory>
+#include <bitset>
 #include <chrono>
 
 #ifndef NO_CXX11_REGEX
@@ -36,10 +39,15 @@
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
+#include "SparseVector.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
 #include "CharClassify.h"
 #include "Decoration.h"
+#include "PositionAnchors.h"
+#include "DocumentStatistics.h"
+#include "StyleIndex.h"
+#include "EditJournal.h"
 #include "CaseFolder.h"
 #include "Document.h"
 #include "RESearch.h"
@@ -69,11 +77,37 @@ void LexInterface::Colourise(Sci::Position start, Sci::Position end) {
 
 		if (len > 0) {
 			instance->Lex(start, len, styleStart, pdoc);
+			// Folding is performed on demand by Document::EnsureFoldedTo
+			pdoc->FoldModifiedAt(start);
+		}
+
+		performingStyle = false;
+	}
+}
+
+bool LexInterface::Fold(Sci::Position start, Sci::Position end) {
+	if (pdoc && instance && !performingStyle) {
+		// Shares the reentrance guard with Colourise as the folder may set
+		// levels which cause the fold parent or last child to be requested.
+		performingStyle = true;
+
+		const Sci::Position len = end - start;
+
+		PLATFORM_ASSERT(len >= 0);
+		PLATFORM_ASSERT(end <= pdoc->Length());
+
+		int styleStart = 0;
+		if (start > 0)
+			styleStart = pdoc->StyleAt(start - 1);
+
+		if (len > 0) {
 			instance->Fold(start, len, styleStart, pdoc);
 		}
 
 		performingStyle = false;
+		return true;
 	}
+	return false;
 }
 
 int LexInterface::LineEndTypesSupported() {
@@ -121,6 +155,7 @@ Document::Document(int options) :
 	dbcsCodePage = SC_CP_UTF8;
 	lineEndBitSet = SC_LINE_END_TYPE_DEFAULT;
 	endStyled = 0;
+	endFolded = 0;
 	styleClock = 0;
 	enteredModification = 0;
 	enteredStyling = 0;
@@ -142,6 +177,11 @@ Document::Document(int options) :
 	perLineData[ldAnnotation].reset(new LineAnnotation());
 
 	decorations = DecorationListCreate(IsLarge());
+	anchors.reset(new PositionAnchors());
+	statisticsReferences = 0;
+	styleIndexReferences = 0;
+	editVersion = 0;
+	journalReferences = 0;
 
 	cb.SetPerLine(this);
 	cb.SetUTF8Substance(SC_CP_UTF8 == dbcsCodePage);
@@ -221,6 +261,8 @@ bool Document::SetDBCSCodePage(int dbcsCodePage_) {
 		SetCaseFolder(nullptr);
 		cb.SetLineEndTypes(lineEndBitSet & LineEndTypesSupported());
 		cb.SetUTF8Substance(SC_CP_UTF8 == dbcsCodePage);
+		if (statistics)
+			statistics->Rebuild(this);
 		ModifiedAt(0);	// Need to restyle whole document
 		return true;
 	} else {
@@ -372,6 +414,54 @@ Sci::Line Document::LineFromHandle(int markerHandle) const {
 	return Markers()->LineFromHandle(markerHandle);
 }
 
+int Document::AddPositionAnchor(Sci::Position position, int gravity) {
+	return anchors->Add(position, gravity);
+}
+
+void Document::DeletePositionAnchor(int anchorHandle) {
+	anchors->Delete(anchorHandle);
+}
+
+void Document::DeletePositionAnchorAt(Sci::Position index) {
+	anchors->DeleteAt(index);
+}
+
+void Document::DeleteAllPositionAnchors() {
+	anchors->DeleteAll();
+}
+
+void Document::DeletePositionAnchors(const Sci::Position *anchorHandles, Sci::Position count) {
+	anchors->DeleteHandles(anchorHandles, count);
+}
+
+Sci::Position Document::PositionAnchorPosition(int anchorHandle) const {
+	return anchors->PositionAt(anchors->IndexFromHandle(anchorHandle));
+}
+
+void Document::PositionAnchorPositions(Sci::Position *values, Sci::Position count) const {
+	anchors->PositionsFromHandles(values, count);
+}
+
+Sci::Position Document::PositionAnchorCount() const {
+	return anchors->Count();
+}
+
+Sci::Position Document::PositionAnchorIndexFromPosition(Sci::Position position) const {
+	return anchors->IndexFromPosition(position);
+}
+
+int Document::PositionAnchorHandleAt(Sci::Position index) const {
+	return anchors->HandleAt(index);
+}
+
+Sci::Position Document::PositionAnchorPositionAt(Sci::Position index) const {
+	return anchors->PositionAt(index);
+}
+
+int Document::PositionAnchorGravityAt(Sci::Position index) const {
+	return anchors->GravityAt(index);
+}
+
 Sci_Position SCI_METHOD Document::LineStart(Sci_Position line) const {
 	return cb.LineStart(static_cast<Sci::Line>(line));
 }
@@ -484,13 +574,14 @@ static bool IsSubordinate(int levelStart, int levelTry) {
 }
 
 Sci::Line Document::GetLastChild(Sci::Line lineParent, int level, Sci::Line lastLine) {
+	EnsureFoldedTo(LineStart(lineParent + 2));
 	if (level == -1)
 		level = LevelNumber(GetLevel(lineParent));
 	const Sci::Line maxLine = LinesTotal();
 	const Sci::Line lookLastLine = (lastLine != -1) ? std::min(LinesTotal() - 1, lastLine) : -1;
 	Sci::Line lineMaxSubord = lineParent;
 	while (lineMaxSubord < maxLine - 1) {
-		EnsureStyledTo(LineStart(lineMaxSubord + 2));
+		EnsureFoldedTo(LineStart(lineMaxSubord + 2));
 		if (!IsSubordinate(level, GetLevel(lineMaxSubord + 1)))
 			break;
 		if ((lookLastLine != -1) && (lineMaxSubord >= lookLastLine) && !(GetLevel(lineMaxSubord) & SC_FOLDLEVELWHITEFLAG))
@@ -508,7 +599,8 @@ Sci::Line Document::GetLastChild(Sci::Line lineParent, int level, Sci::Line last
 	return lineMaxSubord;
 }
 
-Sci::Line Document::GetFoldParent(Sci::Line line) const {
+Sci::Line Document::GetFoldParent(Sci::Line line) {
+	EnsureFoldedTo(LineStart(line + 1));
 	const int level = LevelNumber(GetLevel(line));
 	Sci::Line lineLook = line - 1;
 	while ((lineLook > 0) && (
@@ -526,8 +618,9 @@ Sci::Line Document::GetFoldParent(Sci::Line line) const {
 }
 
 void Document::GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, Sci::Line line, Sci::Line lastLine) {
-	const int level = GetLevel(line);
 	const Sci::Line lookLastLine = std::max(line, lastLine) + 1;
+	EnsureFoldedTo(LineStart(lookLastLine + 1));
+	const int level = GetLevel(line);
 
 	Sci::Line lookLine = line;
 	int lookLineLevel = level;
@@ -1153,6 +1246,12 @@ EncodingFamily Document::CodePageFamily() const noexcept {
 void Document::ModifiedAt(Sci::Position pos) noexcept {
 	if (endStyled > pos)
 		endStyled = pos;
+	FoldModifiedAt(pos);
+}
+
+void Document::FoldModifiedAt(Sci::Position pos) noexcept {
+	if (endFolded > pos)
+		endFolded = pos;
 }
 
 void Document::CheckReadOnly() {
@@ -1276,6 +1375,10 @@ void * SCI_METHOD Document::ConvertToDocument() {
 	return this;
 }
 
+// Undo and redo groups with at least this many steps, such as those left by a replace all,
+// are applied as a batch.
+static constexpr int batchedUndoRedoSteps = 100;
+
 Sci::Position Document::Undo() {
 	Sci::Position newPos = -1;
 	CheckReadOnly();
@@ -1286,6 +1389,8 @@ Sci::Position Document::Undo() {
 			bool multiLine = false;
 			const int steps = cb.StartUndo();
 			//Platform::DebugPrintf("Steps=%d\n", steps);
+			BatchedChange batch;
+			const bool batched = StartBatch(steps, false, batch);
 			Sci::Position coalescedRemovePos = -1;
 			Sci::Position coalescedRemoveLen = 0;
 			Sci::Position prevRemoveActionPos = -1;
@@ -1293,7 +1398,9 @@ Sci::Position Document::Undo() {
 			for (int step = 0; step < steps; step++) {
 				const Sci::Line prevLinesTotal = LinesTotal();
 				const Action &action = cb.GetUndoStep();
-				if (action.at == removeAction) {
+				if (batched) {
+					// Watchers are told about the changes by ApplyBatch
+				} else if (action.at == removeAction) {
 					NotifyModified(DocModification(
 									SC_MOD_BEFOREINSERT | SC_PERFORMED_UNDO, action));
 				} else if (action.at == containerAction) {
@@ -1310,7 +1417,10 @@ Sci::Position Document::Undo() {
 					NotifyModified(DocModification(
 									SC_MOD_BEFOREDELETE | SC_PERFORMED_UNDO, action));
 				}
-				cb.PerformUndoStep();
+				if (batched)
+					cb.SkipUndoStep();
+				else
+					cb.PerformUndoStep();
 				if (action.at != containerAction) {
 					ModifiedAt(action.position);
 					newPos = action.position;
@@ -1348,9 +1458,14 @@ Sci::Position Document::Undo() {
 					if (multiLine)
 						modFlags |= SC_MULTILINEUNDOREDO;
 				}
-				NotifyModified(DocModification(modFlags, action.position, action.lenData,
-											   linesAdded, action.data.get()));
+				if (batched)
+					BatchStep(batch, modFlags, action.position, action.lenData, action.data.get());
+				else
+					NotifyModified(DocModification(modFlags, action.position, action.lenData,
+												   linesAdded, action.data.get()));
 			}
+			if (batched)
+				ApplyBatch(batch, true);
 
 			const bool endSavePoint = cb.IsSavePoint();
 			if (startSavePoint != endSavePoint)
@@ -1370,10 +1485,14 @@ Sci::Position Document::Redo() {
 			const bool startSavePoint = cb.IsSavePoint();
 			bool multiLine = false;
 			const int steps = cb.StartRedo();
+			BatchedChange batch;
+			const bool batched = StartBatch(steps, true, batch);
 			for (int step = 0; step < steps; step++) {
 				const Sci::Line prevLinesTotal = LinesTotal();
 				const Action &action = cb.GetRedoStep();
-				if (action.at == insertAction) {
+				if (batched) {
+					// Watchers are told about the changes by ApplyBatch
+				} else if (action.at == insertAction) {
 					NotifyModified(DocModification(
 									SC_MOD_BEFOREINSERT | SC_PERFORMED_REDO, action));
 				} else if (action.at == containerAction) {
@@ -1384,7 +1503,10 @@ Sci::Position Document::Redo() {
 					NotifyModified(DocModification(
 									SC_MOD_BEFOREDELETE | SC_PERFORMED_REDO, action));
 				}
-				cb.PerformRedoStep();
+				if (batched)
+					cb.SkipRedoStep();
+				else
+					cb.PerformRedoStep();
 				if (action.at != containerAction) {
 					ModifiedAt(action.position);
 					newPos = action.position;
@@ -1407,10 +1529,15 @@ Sci::Position Document::Redo() {
 					if (multiLine)
 						modFlags |= SC_MULTILINEUNDOREDO;
 				}
-				NotifyModified(
-					DocModification(modFlags, action.position, action.lenData,
-									linesAdded, action.data.get()));
+				if (batched)
+					BatchStep(batch, modFlags, action.position, action.lenData, action.data.get());
+				else
+					NotifyModified(
+						DocModification(modFlags, action.position, action.lenData,
+										linesAdded, action.data.get()));
 			}
+			if (batched)
+				ApplyBatch(batch, true);
 
 			const bool endSavePoint = cb.IsSavePoint();
 			if (startSavePoint != endSavePoint)
@@ -1421,6 +1548,176 @@ Sci::Position Document::Redo() {
 	return newPos;
 }
 
+bool Document::StartBatch(int steps, bool redo, BatchedChange &batch) {
+	if ((steps < batchedUndoRedoSteps) || cb.GroupHasContainerAction(steps, redo))
+		return false;
+	batch.performed = redo ? SC_PERFORMED_REDO : SC_PERFORMED_UNDO;
+	return true;
+}
+
+// Batches are also used for applying edits which are reported as performed by the user
+// without the undo and redo step flags.
+static int BatchFlags(int performed) noexcept {
+	return (performed == SC_PERFORMED_USER) ? performed : (performed | SC_MULTISTEPUNDOREDO);
+}
+
+void Document::BatchStep(BatchedChange &batch, int modFlags, Sci::Position position, Sci::Position length, const char *text) {
+	// The position is in the text as if the pending change was applied. The buffer does not
+	// have the inserted text of the change but has its removed text in its place.
+	const Sci::Position endInserted = batch.position + batch.textInserted.length();
+	if (modFlags & SC_MOD_INSERTTEXT) {
+		if (!batch.pending || (position < batch.position) || (position > endInserted)) {
+			ApplyBatch(batch, false);
+			batch.pending = true;
+			batch.position = position;
+		}
+		batch.textInserted.insert(position - batch.position, text, length);
+		decorations->InsertSpace(position, length);
+		anchors->InsertSpace(position, length);
+		if (styleIndex)
+			styleIndex->InsertSpace(position, length);
+		RecordEdit(insertAction, position, length, text);
+	} else if (modFlags & SC_MOD_DELETETEXT) {
+		const Sci::Position end = position + length;
+		if (!batch.pending || (end < batch.position) || (position > endInserted)) {
+			ApplyBatch(batch, false);
+			batch.pending = true;
+			batch.position = position;
+			batch.textRemoved.append(cb.RangePointer(position, length), length);
+		} else {
+			// Removing text around the change takes it from the buffer.
+			const Sci::Position startInside = std::max(position, batch.position);
+			const Sci::Position endInside = std::min(end, endInserted);
+			if (end > endInserted) {
+				const Sci::Position endRemoved = batch.position + batch.textRemoved.length();
+				batch.textRemoved.append(cb.RangePointer(endRemoved, end - endInserted), end - endInserted);
+			}
+			batch.textInserted.erase(startInside - batch.position, endInside - startInside);
+			if (position < batch.position) {
+				batch.textRemoved.insert(0, cb.RangePointer(position, batch.position - position),
+					batch.position - position);
+				batch.position = position;
+			}
+		}
+		decorations->DeleteRange(position, length);
+		anchors->DeleteRange(position, length);
+		if (styleIndex)
+			styleIndex->DeleteRange(position, length);
+		RecordEdit(removeAction, position, length, text);
+	}
+}
+
+// Apply the pending change of a batch to the buffer with a notification pair for its removal
+// and for its insertion. Edits performed by the user are recorded for undo while undo and redo
+// steps have already been moved past in the undo history. After the last change, the last
+// notification of an undo or redo carries the last step flags.
+void Document::ApplyBatch(BatchedChange &batch, bool last) {
+	const bool recording = batch.performed == SC_PERFORMED_USER;
+	const int modFlags = BatchFlags(batch.performed);
+	const Sci::Position position = batch.position;
+	const Sci::Position lengthRemoved = batch.textRemoved.length();
+	const Sci::Position lengthInserted = batch.textInserted.length();
+	bool startSequence = false;
+	if (lengthRemoved > 0) {
+		NotifyWatchers(DocModification(SC_MOD_BEFOREDELETE | modFlags,
+			position, lengthRemoved, 0, batch.textRemoved.c_str()));
+		const Sci::Line prevLinesTotal = LinesTotal();
+		if (recording)
+			cb.DeleteChars(position, lengthRemoved, startSequence);
+		else
+			cb.DeleteCharsUnrecorded(position, lengthRemoved);
+		ModifiedAt(((position < Length()) || (position == 0)) ? position : position - 1);
+		if (statistics)
+			statistics->Modify(this, position, lengthRemoved, 0);
+		const Sci::Line linesAdded = LinesTotal() - prevLinesTotal;
+		if (linesAdded != 0)
+			batch.multiLine = true;
+		NotifyWatchers(DocModification(SC_MOD_DELETETEXT | modFlags |
+			((last && (lengthInserted == 0)) ? LastBatchStep(batch) : 0),
+			position, lengthRemoved, linesAdded, batch.textRemoved.c_str()));
+	}
+	if (lengthInserted > 0) {
+		NotifyWatchers(DocModification(SC_MOD_BEFOREINSERT | modFlags,
+			position, lengthInserted, 0, batch.textInserted.c_str()));
+		const Sci::Line prevLinesTotal = LinesTotal();
+		if (recording)
+			cb.InsertString(position, batch.textInserted.c_str(), lengthInserted, startSequence);
+		else
+			cb.InsertStringUnrecorded(position, batch.textInserted.c_str(), lengthInserted);
+		ModifiedAt(position);
+		if (statistics)
+			statistics->Modify(this, position, 0, lengthInserted);
+		const Sci::Line linesAdded = LinesTotal() - prevLinesTotal;
+		if (linesAdded != 0)
+			batch.multiLine = true;
+		NotifyWatchers(DocModification(SC_MOD_INSERTTEXT | modFlags | (last ? LastBatchStep(batch) : 0),
+			position, lengthInserted, linesAdded, batch.textInserted.c_str()));
+	}
+	if (last && (lengthRemoved == 0) && (lengthInserted == 0) && !recording) {
+		// The steps cancelled out but watchers still expect the last step.
+		NotifyWatchers(DocModification(modFlags | LastBatchStep(batch)));
+	}
+	batch.pending = false;
+	batch.textRemoved.clear();
+	batch.textInserted.clear();
+}
+
+int Document::LastBatchStep(const BatchedChange &batch) const noexcept {
+	if (batch.performed == SC_PERFORMED_USER)
+		return 0;
+	return SC_LASTSTEPINUNDOREDO | (batch.multiLine ? SC_MULTILINEUNDOREDO : 0);
+}
+
+void Document::RecordEdit(actionType at, Sci::Position position, Sci::Position length, const char *text) {
+	editVersion++;
+	if (journal)
+		journal->Append(at, position, text, length);
+}
+
+// Apply a delta made by ExportEdits from a copy of this document as a single undo
+// action that is reported to watchers as a replacement of each part it changes.
+// False if the delta is not valid or does not start from the current length.
+bool Document::ImportEdits(const char *delta, Sci::Position deltaLength) {
+	EditDelta decoded;
+	if (!EditJournal::Decode(delta, deltaLength, decoded) || (decoded.lengthBefore != Length()))
+		return false;
+	return ApplyEdits(decoded);
+}
+
+// Apply edits, each positioned in the document as left by those before it, as a single
+// undo action that is reported to watchers as a replacement of each part they change.
+// The versions and lengths of the delta are not used.  False if the document can not
+// be modified or an edit is outside it.
+bool Document::ApplyEdits(const EditDelta &delta) {
+	CheckReadOnly();
+	if (cb.IsReadOnly() || (enteredModification != 0))
+		return false;
+	Sci::Position length = Length();
+	for (const EditDelta::Edit &edit : delta.edits) {
+		if ((edit.position < 0) || (edit.length < 0) ||
+			(edit.position + (edit.insert ? 0 : edit.length) > length))
+			return false;
+		length += edit.insert ? edit.length : -edit.length;
+	}
+	if (delta.edits.empty())
+		return true;
+	enteredModification++;
+
+	const bool startSavePoint = cb.IsSavePoint();
+	if (startSavePoint && cb.IsCollectingUndo())
+		NotifySavePoint(!startSavePoint);
+	BatchedChange batch;
+	cb.BeginUndoAction();
+	for (const EditDelta::Edit &edit : delta.edits) {
+		BatchStep(batch, edit.insert ? SC_MOD_INSERTTEXT : SC_MOD_DELETETEXT,
+			edit.position, edit.length, edit.insert ? edit.text : nullptr);
+	}
+	ApplyBatch(batch, true);
+	cb.EndUndoAction();
+	enteredModification--;
+	return true;
+}
+
 void Document::DelChar(Sci::Position pos) {
 	DeleteChars(pos, LenChar(pos));
 }
@@ -1530,6 +1827,8 @@ Sci::Position Document::GetColumn(Sci::Position pos) {
 Sci::Position Document::CountCharacters(Sci::Position startPos, Sci::Position endPos) const {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (statistics)
+		return statistics->Count(this, startPos, endPos).characters;
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -1542,6 +1841,8 @@ Sci::Position Document::CountCharacters(Sci::Position startPos, Sci::Position en
 Sci::Position Document::CountUTF16(Sci::Position startPos, Sci::Position endPos) const {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (statistics)
+		return statistics->Count(this, startPos, endPos).utf16;
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -1554,6 +1855,140 @@ Sci::Position Document::CountUTF16(Sci::Position startPos, Sci::Position endPos)
 	return count;
 }
 
+Sci::Position Document::CountWords(Sci::Position startPos, Sci::Position endPos) const {
+	startPos = MovePositionOutsideChar(startPos, 1, false);
+	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (statistics)
+		return statistics->Count(this, startPos, endPos).words;
+	return DocumentStatistics::CountByScanning(this, startPos, endPos).words;
+}
+
+Sci::Position Document::CountNonBlankLines(Sci::Position startPos, Sci::Position endPos) const {
+	startPos = MovePositionOutsideChar(startPos, 1, false);
+	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (statistics)
+		return statistics->Count(this, startPos, endPos).nonBlankLines;
+	return DocumentStatistics::CountByScanning(this, startPos, endPos).nonBlankLines;
+}
+
+// Move position forward over whole characters, counting UTF-16 code units in offset,
+// until it reaches positionLimit or moving further would take offset past offsetLimit.
+// UTF-8 text is examined in a buffer with runs of ASCII skipped 8 bytes at a time.
+static void AdvanceUTF16(const Document *pdoc, Sci::Position &position, Sci::Position &offset,
+	Sci::Position positionLimit, Sci::Position offsetLimit) {
+	positionLimit = std::min(positionLimit, static_cast<Sci::Position>(pdoc->Length()));
+	if (SC_CP_UTF8 != pdoc->dbcsCodePage) {
+		while ((position < positionLimit) && (offset < offsetLimit)) {
+			const Sci::Position next = pdoc->NextPosition(position, 1);
+			const Sci::Position units = ((next - position) > 3) ? 2 : 1;
+			if (offset + units > offsetLimit)
+				return;
+			position = next;
+			offset += units;
+		}
+		return;
+	}
+	constexpr Sci::Position bufferSize = 1024;
+	unsigned char buffer[bufferSize];
+	while ((position < positionLimit) && (offset < offsetLimit)) {
+		// Retrieve enough bytes to complete any character started before scanEnd
+		const Sci::Position scanEnd = std::min(bufferSize - UTF8MaxBytes, positionLimit - position);
+		const Sci::Position retrieve = std::min(scanEnd + UTF8MaxBytes, pdoc->Length() - position);
+		pdoc->GetCharRange(reinterpret_cast<char *>(buffer), position, retrieve);
+		Sci::Position i = 0;
+		while ((i < scanEnd) && (offset < offsetLimit)) {
+			if ((i + 8 <= scanEnd) && (offset + 8 <= offsetLimit)) {
+				uint64_t bytes;
+				memcpy(&bytes, buffer + i, sizeof(bytes));
+				if ((bytes & 0x8080808080808080ULL) == 0) {
+					i += 8;
+					offset += 8;
+					continue;
+				}
+			}
+			Sci::Position width = 1;
+			Sci::Position units = 1;
+			if (!UTF8IsAscii(buffer[i])) {
+				const int utf8status = UTF8Classify(buffer + i, retrieve - i);
+				if (!(utf8status & UTF8MaskInvalid)) {
+					width = utf8status & UTF8MaskWidth;
+					units = (width > 3) ? 2 : 1;
+				}
+			}
+			if ((offset + units > offsetLimit) || (i + width > positionLimit - position)) {
+				position += i;
+				return;
+			}
+			i += width;
+			offset += units;
+		}
+		position += i;
+	}
+}
+
+// Convert UTF-16 offsets from the start of the document, in place, to positions.
+// The values are converted in increasing order in a single pass, starting each from
+// the previous result or, when the UTF-16 line character index is available and the
+// value is on a later line, from the start of its line.
+// An offset inside a character is converted to the start of the character.
+void Document::PositionsFromUTF16(Sci::Position *values, Sci::Position count) const {
+	std::vector<Sci::Position> order(count);
+	for (Sci::Position i = 0; i < count; i++)
+		order[i] = i;
+	if (!std::is_sorted(values, values + count)) {
+		std::stable_sort(order.begin(), order.end(), [values](Sci::Position a, Sci::Position b) noexcept {
+			return values[a] < values[b];
+		});
+	}
+	const bool indexed = (LineCharacterIndex() & SC_LINECHARACTERINDEX_UTF16) != 0;
+	Sci::Position position = 0;
+	Sci::Position offset = 0;
+	for (const Sci::Position i : order) {
+		const Sci::Position target = values[i];
+		if (indexed && (target > offset)) {
+			const Sci::Line line = LineFromPositionIndex(target, SC_LINECHARACTERINDEX_UTF16);
+			const Sci::Position lineOffset = IndexLineStart(line, SC_LINECHARACTERINDEX_UTF16);
+			if (lineOffset > offset) {
+				position = LineStart(line);
+				offset = lineOffset;
+			}
+		}
+		AdvanceUTF16(this, position, offset, Length(), target);
+		values[i] = position;
+	}
+}
+
+// Convert positions, in place, to UTF-16 offsets from the start of the document in the
+// same way as PositionsFromUTF16.
+// A position inside a character is converted as the start of the character.
+void Document::UTF16FromPositions(Sci::Position *values, Sci::Position count) const {
+	std::vector<Sci::Position> order(count);
+	for (Sci::Position i = 0; i < count; i++)
+		order[i] = i;
+	if (!std::is_sorted(values, values + count)) {
+		std::stable_sort(order.begin(), order.end(), [values](Sci::Position a, Sci::Position b) noexcept {
+			return values[a] < values[b];
+		});
+	}
+	const bool indexed = (LineCharacterIndex() & SC_LINECHARACTERINDEX_UTF16) != 0;
+	Sci::Position position = 0;
+	Sci::Position offset = 0;
+	for (const Sci::Position i : order) {
+		const Sci::Position limited = std::max<Sci::Position>(std::min<Sci::Position>(values[i], Length()), 0);
+		const Sci::Position target = MovePositionOutsideChar(limited, -1, false);
+		if (indexed && (target > position)) {
+			const Sci::Line line = SciLineFromPosition(target);
+			const Sci::Position lineStart = LineStart(line);
+			if (lineStart > position) {
+				position = lineStart;
+				offset = IndexLineStart(line, SC_LINECHARACTERINDEX_UTF16);
+			}
+		}
+		AdvanceUTF16(this, position, offset, target, PTRDIFF_MAX);
+		values[i] = offset;
+	}
+}
+
 Sci::Position Document::FindColumn(Sci::Line line, Sci::Position column) {
 	Sci::Position position = LineStart(line);
 	if ((line >= 0) && (line < LinesTotal())) {
@@ -2153,22 +2588,101 @@ void Document::ReleaseLineCharacterIndex(int lineCharacterIndex) {
 	return cb.ReleaseLineCharacterIndex(lineCharacterIndex);
 }
 
+void Document::AllocateStatistics() {
+	if (!statistics) {
+		statistics.reset(new DocumentStatistics());
+		statistics->Rebuild(this);
+	}
+	statisticsReferences++;
+}
+
+void Document::ReleaseStatistics() {
+	if (statisticsReferences > 0) {
+		statisticsReferences--;
+		if (statisticsReferences == 0)
+			statistics.reset();
+	}
+}
+
 Sci::Line Document::LinesTotal() const noexcept {
 	return cb.Lines();
 }
 
 void Document::SetDefaultCharClasses(bool includeWordClass) {
     charClass.SetDefaultCharClasses(includeWordClass);
+    if (statistics)
+        statistics->Rebuild(this);
 }
 
 void Document::SetCharClasses(const unsigned char *chars, CharClassify::cc newCharClass) {
     charClass.SetCharClasses(chars, newCharClass);
+    if (statistics)
+        statistics->Rebuild(this);
 }
 
 int Document::GetCharsOfClass(CharClassify::cc characterClass, unsigned char *buffer) const {
     return charClass.GetCharsOfClass(characterClass, buffer);
 }
 
+void Document::AllocateStyleIndex() {
+	if (!styleIndex) {
+		styleIndex.reset(new StyleIndex());
+		styleIndex->Rebuild(Length());
+	}
+	styleIndexReferences++;
+}
+
+void Document::ReleaseStyleIndex() {
+	if (styleIndexReferences > 0) {
+		styleIndexReferences--;
+		if (styleIndexReferences == 0)
+			styleIndex.reset();
+	}
+}
+
+// Start recording edits so that the edits from the current version onwards can be
+// exported, or increase the journal's use count.
+void Document::AllocateEditJournal() {
+	if (!journal)
+		journal.reset(new EditJournal(editVersion));
+	journalReferences++;
+}
+
+void Document::ReleaseEditJournal() {
+	if (journalReferences > 0) {
+		journalReferences--;
+		if (journalReferences == 0)
+			journal.reset();
+	}
+}
+
+// Forget the edits made before version as they will not be exported again.
+void Document::DiscardEdits(Sci::Position version) {
+	if (journal)
+		journal->Discard(version);
+}
+
+// Encode the edits between two versions as a delta.  False if they are not held.
+bool Document::ExportEdits(Sci::Position fromVersion, Sci::Position toVersion, std::string &delta) const {
+	if (!journal)
+		return false;
+	return journal->Export(fromVersion, toVersion, Length(), delta);
+}
+
+// Find the first run of any of a set of styles that overlaps a range.  The run's start
+// is returned and its end is set in runEnd, both limited to the range.
+Sci::Position Document::FindStyleRun(Sci::Position start, Sci::Position end, const char *styles, Sci::Position stylesLength,
+	Sci::Position *runEnd) {
+	StyleIndex::StyleSet styleSet;
+	for (Sci::Position i = 0; i < stylesLength; i++)
+		styleSet.set(static_cast<unsigned char>(styles[i]));
+	start = std::max<Sci::Position>(start, 0);
+	end = std::min<Sci::Position>(end, Length());
+	if (styleIndex)
+		return styleIndex->Find(this, start, end, styleSet, runEnd);
+	return StyleIndex::FindByScanning(this, start, end, styleSet, runEnd);
+}
+
 void SCI_METHOD Document::StartStyling(Sci_Position position, char) {
 	endStyled = position;
 }
@@ -2235,6 +2749,25 @@ void Document::EnsureStyledTo(Sci::Position pos) {
 	}
 }
 
+// Fold levels are only calculated when something asks for them, such as a visible fold
+// margin or a fold command, so styling does not pay for folding that is never shown.
+// Each call folds at least foldSliceLines lines past its start so that callers walking
+// down the document a line at a time do not invoke the folder for every line.
+void Document::EnsureFoldedTo(Sci::Position pos) {
+	if ((enteredStyling != 0) || (pos <= endFolded) || !pli || pli->UseContainerLexing())
+		return;
+	constexpr Sci::Line foldSliceLines = 200;
+	const Sci::Line lineEndFolded = SciLineFromPosition(endFolded);
+	const Sci::Position foldStart = LineStart(lineEndFolded);
+	const Sci::Position foldSlice = LineStart(std::min(lineEndFolded + foldSliceLines, LinesTotal()));
+	const Sci::Position foldWanted = std::max(pos, foldSlice);
+	EnsureStyledTo(pos);
+	const Sci::Position foldEnd = std::min(foldWanted, GetEndStyled());
+	if ((foldEnd > foldStart) && pli->Fold(foldStart, foldEnd)) {
+		endFolded = foldEnd;
+	}
+}
+
 void Document::StyleToAdjustingLineDuration(Sci::Position pos) {
 	const Sci::Line lineFirst = SciLineFromPosition(GetEndStyled());
 	ElapsedPeriod epStyling;
@@ -2350,10 +2883,14 @@ int Document::AnnotationLines(Sci::Line line) const {
 	return Annotations()->Lines(line);
 }
 
+Sci::Line Document::AnnotationNext(Sci::Line lineStart) const {
+	return Annotations()->Next(lineStart);
+}
+
 void Document::AnnotationClearAll() {
-	const Sci::Line maxEditorLine = LinesTotal();
-	for (Sci::Line l=0; l<maxEditorLine; l++)
-		AnnotationSetText(l, nullptr);
+	// Only lines with annotations change
+	for (Sci::Line line = AnnotationNext(0); line >= 0; line = AnnotationNext(line + 1))
+		AnnotationSetText(line, nullptr);
 	// Free remaining data
 	Annotations()->ClearAll();
 }
@@ -2411,9 +2948,28 @@ void Document::NotifySavePoint(bool atSavePoint) {
 void Document::NotifyModified(DocModification mh) {
 	if (mh.modificationType & SC_MOD_INSERTTEXT) {
 		decorations->InsertSpace(mh.position, mh.length);
+		anchors->InsertSpace(mh.position, mh.length);
+		if (statistics)
+			statistics->Modify(this, mh.position, 0, mh.length);
+		if (styleIndex)
+			styleIndex->InsertSpace(mh.position, mh.length);
+		RecordEdit(insertAction, mh.position, mh.length, mh.text);
 	} else if (mh.modificationType & SC_MOD_DELETETEXT) {
 		decorations->DeleteRange(mh.position, mh.length);
+		anchors->DeleteRange(mh.position, mh.length);
+		if (statistics)
+			statistics->Modify(this, mh.position, mh.length, 0);
+		if (styleIndex)
+			styleIndex->DeleteRange(mh.position, mh.length);
+		RecordEdit(removeAction, mh.position, mh.length, mh.text);
+	}
+	if ((mh.modificationType & SC_MOD_CHANGESTYLE) && styleIndex) {
+		styleIndex->Restyled(mh.position, mh.length);
 	}
+	NotifyWatchers(mh);
+}
+
+void Document::NotifyWatchers(const DocModification &mh) {
 	for (const WatcherWithUserData &watcher : watchers) {
 		watcher.watcher->NotifyModified(this, mh, watcher.userData);
 	}
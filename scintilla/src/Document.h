@@ -17,6 +17,11 @@ class LineMarkers;
 class LineLevels;
 class LineState;
 class LineAnnotation;
+class PositionAnchors;
+class DocumentStatistics;
+class StyleIndex;
+class EditJournal;
+struct EditDelta;
 
 enum EncodingFamily { efEightBit, efUnicode, efDBCS };
 
@@ -179,6 +184,7 @@ public:
 	virtual ~LexInterface() {
 	}
 	void Colourise(Sci::Position start, Sci::Position end);
+	bool Fold(Sci::Position start, Sci::Position end);
 	virtual int LineEndTypesSupported();
 	bool UseContainerLexing() const {
 		return instance == nullptr;
@@ -232,6 +238,7 @@ private:
 	CharClassify charClass;
 	std::unique_ptr<CaseFolder> pcf;
 	Sci::Position endStyled;
+	Sci::Position endFolded;
 	int styleClock;
 	int enteredModification;
 	int enteredStyling;
@@ -254,6 +261,15 @@ private:
 	bool matchesValid;
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
+	std::unique_ptr<PositionAnchors> anchors;
+	std::unique_ptr<DocumentStatistics> statistics;
+	int statisticsReferences;
+	std::unique_ptr<StyleIndex> styleIndex;
+	int styleIndexReferences;
+	// Counts the insertions and removals made to the document.
+	Sci::Position editVersion;
+	std::unique_ptr<EditJournal> journal;
+	int journalReferences;
 
 public:
 
@@ -358,6 +374,14 @@ public:
 	void SetSavePoint();
 	bool IsSavePoint() const { return cb.IsSavePoint(); }
 
+	Sci::Position EditVersion() const noexcept { return editVersion; }
+	void AllocateEditJournal();
+	void ReleaseEditJournal();
+	void DiscardEdits(Sci::Position version);
+	bool ExportEdits(Sci::Position fromVersion, Sci::Position toVersion, std::string &delta) const;
+	bool ImportEdits(const char *delta, Sci::Position deltaLength);
+	bool ApplyEdits(const EditDelta &delta);
+
 	void TentativeStart() { cb.TentativeStart(); }
 	void TentativeCommit() { cb.TentativeCommit(); }
 	void TentativeUndo();
@@ -366,6 +390,8 @@ public:
 	const char * SCI_METHOD BufferPointer() override { return cb.BufferPointer(); }
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) { return cb.RangePointer(position, rangeLength); }
 	Sci::Position GapPosition() const { return cb.GapPosition(); }
+	uint64_t HashRange(Sci::Position start, Sci::Position end) { return cb.HashRange(start, end); }
+	Sci::Position FirstDifference(Document &other) { return cb.FirstDifference(other.cb); }
 
 	int SCI_METHOD GetLineIndentation(Sci_Position line) override;
 	Sci::Position SetLineIndentation(Sci::Line line, Sci::Position indent);
@@ -373,6 +399,10 @@ public:
 	Sci::Position GetColumn(Sci::Position pos);
 	Sci::Position CountCharacters(Sci::Position startPos, Sci::Position endPos) const;
 	Sci::Position CountUTF16(Sci::Position startPos, Sci::Position endPos) const;
+	Sci::Position CountWords(Sci::Position startPos, Sci::Position endPos) const;
+	Sci::Position CountNonBlankLines(Sci::Position startPos, Sci::Position endPos) const;
+	void PositionsFromUTF16(Sci::Position *values, Sci::Position count) const;
+	void UTF16FromPositions(Sci::Position *values, Sci::Position count) const;
 	Sci::Position FindColumn(Sci::Line line, Sci::Position column);
 	void Indent(bool forwards, Sci::Line lineBottom, Sci::Line lineTop);
 	static std::string TransformLineEnds(const char *s, size_t len, int eolModeWanted);
@@ -394,6 +424,10 @@ public:
 	void GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const {
 		cb.GetStyleRange(buffer, position, lengthRetrieve);
 	}
+	void AllocateStyleIndex();
+	void ReleaseStyleIndex();
+	Sci::Position FindStyleRun(Sci::Position start, Sci::Position end, const char *styles, Sci::Position stylesLength,
+		Sci::Position *runEnd);
 	int GetMark(Sci::Line line) const;
 	Sci::Line MarkerNext(Sci::Line lineStart, int mask) const;
 	int AddMark(Sci::Line line, int markerNum);
@@ -402,6 +436,18 @@ public:
 	void DeleteMarkFromHandle(int markerHandle);
 	void DeleteAllMarks(int markerNum);
 	Sci::Line LineFromHandle(int markerHandle) const;
+	int AddPositionAnchor(Sci::Position position, int gravity);
+	void DeletePositionAnchor(int anchorHandle);
+	void DeletePositionAnchorAt(Sci::Position index);
+	void DeleteAllPositionAnchors();
+	void DeletePositionAnchors(const Sci::Position *anchorHandles, Sci::Position count);
+	Sci::Position PositionAnchorPosition(int anchorHandle) const;
+	void PositionAnchorPositions(Sci::Position *values, Sci::Position count) const;
+	Sci::Position PositionAnchorCount() const;
+	Sci::Position PositionAnchorIndexFromPosition(Sci::Position position) const;
+	int PositionAnchorHandleAt(Sci::Position index) const;
+	Sci::Position PositionAnchorPositionAt(Sci::Position index) const;
+	int PositionAnchorGravityAt(Sci::Position index) const;
 	Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
 	bool IsLineStartPosition(Sci::Position position) const;
 	Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
@@ -416,7 +462,7 @@ public:
 	int SCI_METHOD GetLevel(Sci_Position line) const override;
 	void ClearLevels();
 	Sci::Line GetLastChild(Sci::Line lineParent, int level=-1, Sci::Line lastLine=-1);
-	Sci::Line GetFoldParent(Sci::Line line) const;
+	Sci::Line GetFoldParent(Sci::Line line);
 	void GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, Sci::Line line, Sci::Line lastLine);
 
 	Sci::Position ExtendWordSelect(Sci::Position pos, int delta, bool onlyWordCharacters=false) const;
@@ -439,6 +485,8 @@ public:
 	int LineCharacterIndex() const;
 	void AllocateLineCharacterIndex(int lineCharacterIndex);
 	void ReleaseLineCharacterIndex(int lineCharacterIndex);
+	void AllocateStatistics();
+	void ReleaseStatistics();
 	Sci::Line LinesTotal() const noexcept;
 
 	void SetDefaultCharClasses(bool includeWordClass);
@@ -449,6 +497,9 @@ public:
 	bool SCI_METHOD SetStyles(Sci_Position length, const char *styles) override;
 	Sci::Position GetEndStyled() const noexcept { return endStyled; }
 	void EnsureStyledTo(Sci::Position pos);
+	Sci::Position GetEndFolded() const noexcept { return endFolded; }
+	void FoldModifiedAt(Sci::Position pos) noexcept;
+	void EnsureFoldedTo(Sci::Position pos);
 	void StyleToAdjustingLineDuration(Sci::Position pos);
 	void LexerChanged();
 	int GetStyleClock() const noexcept { return styleClock; }
@@ -474,6 +525,7 @@ public:
 	void AnnotationSetStyle(Sci::Line line, int style);
 	void AnnotationSetStyles(Sci::Line line, const unsigned char *styles);
 	int AnnotationLines(Sci::Line line) const;
+	Sci::Line AnnotationNext(Sci::Line lineStart) const;
 	void AnnotationClearAll();
 
 	bool AddWatcher(DocWatcher *watcher, void *userData);
@@ -492,9 +544,28 @@ public:
 	Sci::Position BraceMatch(Sci::Position position, Sci::Position maxReStyle);
 
 private:
+	/// A large undo or redo group, or a set of edits, is applied as a batch. Steps that follow
+	/// on from each other, like the removal and insertion of a replacement, are gathered into
+	/// one change. The change is applied to the buffer and reported when a step elsewhere
+	/// arrives or the batch ends, so watchers only hear about the text that changed.
+	struct BatchedChange {
+		int performed = SC_PERFORMED_USER;
+		bool multiLine = false;
+		bool pending = false;
+		Sci::Position position = 0;
+		std::string textRemoved;
+		std::string textInserted;
+	};
+	bool StartBatch(int steps, bool redo, BatchedChange &batch);
+	void BatchStep(BatchedChange &batch, int modFlags, Sci::Position position, Sci::Position length, const char *text);
+	void ApplyBatch(BatchedChange &batch, bool last);
+	int LastBatchStep(const BatchedChange &batch) const noexcept;
+	void RecordEdit(actionType at, Sci::Position position, Sci::Position length, const char *text);
+
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
 	void NotifyModified(DocModification mh);
+	void NotifyWatchers(const DocModification &mh);
 };
 
 class UndoGroup {
@@ -0,0 +1,283 @@
+// Scintilla source code edit control
+/** @file DocumentStatistics.cxx
+ ** Counts of characters, words and non-blank lines kept up to date with edits.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "DocumentStatistics.h"
+#include "UniConversion.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// Blocks are split to be no longer than this when they are counted.
+constexpr Sci::Position blockSize = 4096;
+
+TextStatistics Difference(const TextStatistics &a, const TextStatistics &b) noexcept {
+	TextStatistics result;
+	result.characters = a.characters - b.characters;
+	result.utf16 = a.utf16 - b.utf16;
+	result.words = a.words - b.words;
+	result.nonBlankLines = a.nonBlankLines - b.nonBlankLines;
+	return result;
+}
+
+void Accumulate(TextStatistics &total, const TextStatistics &counts) noexcept {
+	total.characters += counts.characters;
+	total.utf16 += counts.utf16;
+	total.words += counts.words;
+	total.nonBlankLines += counts.nonBlankLines;
+}
+
+}
+
+DocumentStatistics::DocumentStatistics() :
+	starts(256), characters(256), utf16(256), words(256), nonBlankLines(256), multiByte(false) {
+	contentBefore.SetGrowSize(256);
+	contentBefore.Insert(0, 0);
+	std::fill(classes, std::end(classes), CharClassify::ccSpace);
+}
+
+DocumentStatistics::~DocumentStatistics() {
+}
+
+// Count the characters from position until the first character boundary at or after
+// limit, adding to counts.  Returns the boundary.
+// Single byte characters are classified with a table as most text is ASCII.
+Sci::Position DocumentStatistics::Scan(const Document *pdoc, const CharClassify::cc *classes, bool multiByte,
+	Sci::Position position, Sci::Position limit, ScanState &state, TextStatistics &counts) {
+	limit = std::min(limit, static_cast<Sci::Position>(pdoc->Length()));
+	char buffer[blockSize];
+	while (position < limit) {
+		const Sci::Position bufferStart = position;
+		const Sci::Position bufferEnd = std::min(position + blockSize, limit);
+		pdoc->GetCharRange(buffer, bufferStart, bufferEnd - bufferStart);
+		while (position < bufferEnd) {
+			const unsigned char ch = buffer[position - bufferStart];
+			CharClassify::cc cc;
+			if (!multiByte || UTF8IsAscii(ch)) {
+				cc = classes[ch];
+				counts.utf16++;
+				position++;
+			} else {
+				const Document::CharacterExtracted ce = pdoc->CharacterAfter(position);
+				cc = pdoc->WordCharacterClass(ce.character);
+				counts.utf16 += (ce.widthBytes > 3) ? 2 : 1;
+				position += ce.widthBytes;
+			}
+			counts.characters++;
+			if (cc == CharClassify::ccNewLine) {
+				state.lineHasContent = false;
+			} else if (cc != CharClassify::ccSpace) {
+				if ((cc == CharClassify::ccWord) && (state.previous != CharClassify::ccWord))
+					counts.words++;
+				if (!state.lineHasContent) {
+					counts.nonBlankLines++;
+					state.lineHasContent = true;
+				}
+			}
+			state.previous = cc;
+		}
+	}
+	return position;
+}
+
+DocumentStatistics::ScanState DocumentStatistics::StateAtBlock(const Document *pdoc, Sci::Position block) const {
+	ScanState state;
+	const Sci::Position start = starts.PositionFromPartition(block);
+	if (start > 0)
+		state.previous = pdoc->WordCharacterClass(pdoc->CharacterBefore(start).character);
+	state.lineHasContent = contentBefore.ValueAt(block) != 0;
+	return state;
+}
+
+TextStatistics DocumentStatistics::TotalsBefore(Sci::Position block) const noexcept {
+	TextStatistics totals;
+	totals.characters = characters.PositionFromPartition(block);
+	totals.utf16 = utf16.PositionFromPartition(block);
+	totals.words = words.PositionFromPartition(block);
+	totals.nonBlankLines = nonBlankLines.PositionFromPartition(block);
+	return totals;
+}
+
+void DocumentStatistics::AdjustBlock(Sci::Position block, const TextStatistics &before, const TextStatistics &after) {
+	characters.InsertText(block, after.characters - before.characters);
+	utf16.InsertText(block, after.utf16 - before.utf16);
+	words.InsertText(block, after.words - before.words);
+	nonBlankLines.InsertText(block, after.nonBlankLines - before.nonBlankLines);
+}
+
+// The previous block takes over the text and counts of the block.
+void DocumentStatistics::RemoveBlock(Sci::Position block) {
+	starts.RemovePartition(block);
+	characters.RemovePartition(block);
+	utf16.RemovePartition(block);
+	words.RemovePartition(block);
+	nonBlankLines.RemovePartition(block);
+	contentBefore.Delete(block);
+}
+
+// Merge the blocks from first to last, change their length by delta and count them
+// again, splitting the text into new blocks.  The blocks after them are counted again
+// while their start state differs from before.
+void DocumentStatistics::Recount(const Document *pdoc, Sci::Position first, Sci::Position last, Sci::Position delta) {
+	const TextStatistics totalsFirst = TotalsBefore(first);
+	const TextStatistics before = Difference(TotalsBefore(last + 1), totalsFirst);
+	for (Sci::Position block = last; block > first; block--)
+		RemoveBlock(block);
+	starts.InsertText(first, delta);
+	const Sci::Position start = starts.PositionFromPartition(first);
+	const Sci::Position end = starts.PositionFromPartition(first + 1);
+
+	ScanState state = StateAtBlock(pdoc, first);
+	std::vector<Sci::Position> pieceStarts;
+	std::vector<char> pieceContent;
+	std::vector<TextStatistics> pieceCounts;
+	Sci::Position position = start;
+	do {
+		pieceStarts.push_back(position);
+		pieceContent.push_back(state.lineHasContent);
+		TextStatistics counts;
+		position = Scan(pdoc, classes, multiByte, position, std::min(position + blockSize, end), state, counts);
+		pieceCounts.push_back(counts);
+	} while (position < end);
+
+	TextStatistics after;
+	for (const TextStatistics &counts : pieceCounts)
+		Accumulate(after, counts);
+	AdjustBlock(first, before, after);
+	contentBefore.SetValueAt(first, pieceContent[0]);
+	TextStatistics totals = totalsFirst;
+	const Sci::Position pieces = pieceStarts.size();
+	for (Sci::Position piece = 1; piece < pieces; piece++) {
+		Accumulate(totals, pieceCounts[piece - 1]);
+		const Sci::Position block = first + piece;
+		starts.InsertPartition(block, pieceStarts[piece]);
+		characters.InsertPartition(block, totals.characters);
+		utf16.InsertPartition(block, totals.utf16);
+		words.InsertPartition(block, totals.words);
+		nonBlankLines.InsertPartition(block, totals.nonBlankLines);
+		contentBefore.Insert(block, pieceContent[piece]);
+	}
+	Sci::Position next = first + pieces;
+	if ((start == end) && (first > 0)) {
+		RemoveBlock(first);
+		next = first;
+	}
+
+	// A change to whether the line has content before a block changes whether the
+	// block counts that line, which may continue into the following block.
+	while ((next < starts.Partitions()) && ((contentBefore.ValueAt(next) != 0) != state.lineHasContent)) {
+		const TextStatistics previous = Difference(TotalsBefore(next + 1), TotalsBefore(next));
+		contentBefore.SetValueAt(next, state.lineHasContent);
+		TextStatistics counts;
+		Scan(pdoc, classes, multiByte, starts.PositionFromPartition(next), starts.PositionFromPartition(next + 1), state, counts);
+		AdjustBlock(next, previous, counts);
+		next++;
+	}
+}
+
+// The totals before position along with the counting state there.
+TextStatistics DocumentStatistics::CountBefore(const Document *pdoc, Sci::Position position, ScanState &state) const {
+	const Sci::Position block = starts.PartitionFromPosition(position);
+	TextStatistics counts = TotalsBefore(block);
+	state = StateAtBlock(pdoc, block);
+	Scan(pdoc, classes, multiByte, starts.PositionFromPartition(block), position, state, counts);
+	return counts;
+}
+
+void DocumentStatistics::Rebuild(const Document *pdoc) {
+	for (int ch = 0; ch < 256; ch++)
+		classes[ch] = pdoc->WordCharacterClass(ch);
+	multiByte = pdoc->dbcsCodePage != 0;
+	starts.DeleteAll();
+	characters.DeleteAll();
+	utf16.DeleteAll();
+	words.DeleteAll();
+	nonBlankLines.DeleteAll();
+	contentBefore.DeleteAll();
+	contentBefore.Insert(0, 0);
+	Recount(pdoc, 0, 0, pdoc->Length());
+}
+
+// Called after the text has changed with the positions from before the change.
+void DocumentStatistics::Modify(const Document *pdoc, Sci::Position position, Sci::Position deleteLength, Sci::Position insertLength) {
+	// As well as the blocks containing the change, the block before is counted again in
+	// case the change completes a character started there and the block after as its
+	// first character may now follow a different character.
+	const Sci::Position first = std::max<Sci::Position>(starts.PartitionFromPosition(position) - 1, 0);
+	const Sci::Position last = std::min(starts.PartitionFromPosition(position + deleteLength) + 1,
+		starts.Partitions() - 1);
+	Recount(pdoc, first, last, insertLength - deleteLength);
+}
+
+// Count the text from start to end which should be character boundaries.
+// Words and non-blank lines that start before the range are counted if they continue
+// into it, which is the same as counting the text of the range on its own.
+TextStatistics DocumentStatistics::Count(const Document *pdoc, Sci::Position start, Sci::Position end) const {
+	if (end <= start)
+		return TextStatistics();
+	ScanState stateStart;
+	ScanState stateEnd;
+	const TextStatistics before = CountBefore(pdoc, start, stateStart);
+	TextStatistics counts = Difference(CountBefore(pdoc, end, stateEnd), before);
+	if ((stateStart.previous == CharClassify::ccWord) &&
+		(pdoc->WordCharacterClass(pdoc->CharacterAfter(start).character) == CharClassify::ccWord))
+		counts.words++;
+	if (stateStart.lineHasContent) {
+		Sci::Position position = start;
+		while (position < end) {
+			const Document::CharacterExtracted ce = pdoc->CharacterAfter(position);
+			const CharClassify::cc cc = pdoc->WordCharacterClass(ce.character);
+			if (cc == CharClassify::ccNewLine)
+				break;
+			if (cc != CharClassify::ccSpace) {
+				counts.nonBlankLines++;
+				break;
+			}
+			position += ce.widthBytes;
+		}
+	}
+	return counts;
+}
+
+// Count the text from start to end without any blocks, for when statistics are not
+// being maintained.
+TextStatistics DocumentStatistics::CountByScanning(const Document *pdoc, Sci::Position start, Sci::Position end) {
+	CharClassify::cc classesDocument[256];
+	for (int ch = 0; ch < 256; ch++)
+		classesDocument[ch] = pdoc->WordCharacterClass(ch);
+	ScanState state;
+	TextStatistics counts;
+	Scan(pdoc, classesDocument, pdoc->dbcsCodePage != 0, start, end, state, counts);
+	return counts;
+}
@@ -0,0 +1,73 @@
+// Scintilla source code edit control
+/** @file DocumentStatistics.h
+ ** Counts of characters, words and non-blank lines kept up to date with edits.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef DOCUMENTSTATISTICS_H
+#define DOCUMENTSTATISTICS_H
+
+namespace Scintilla {
+
+class Document;
+
+/// Counts of the text in a range.
+/// A word is counted at a word character that does not follow a word character and
+/// a non-blank line at its first character that is neither a space nor a line end.
+struct TextStatistics {
+	Sci::Position characters = 0;
+	Sci::Position utf16 = 0;
+	Sci::Position words = 0;
+	Sci::Position nonBlankLines = 0;
+};
+
+/// The text of a document is divided into blocks of a few kilobytes that start at
+/// character boundaries.  The block starts and the running totals of each count at
+/// the start of each block are held as Partitionings so that the totals up to any
+/// position are found with a binary search and a scan of part of one block and an
+/// edit only recounts the blocks around it.
+class DocumentStatistics {
+	// Counting state carried across the end of a block.
+	struct ScanState {
+		CharClassify::cc previous = CharClassify::ccSpace;
+		bool lineHasContent = false;
+	};
+
+	Partitioning<Sci::Position> starts;
+	Partitioning<Sci::Position> characters;
+	Partitioning<Sci::Position> utf16;
+	Partitioning<Sci::Position> words;
+	Partitioning<Sci::Position> nonBlankLines;
+	// Whether the line containing the start of each block has content before it.
+	SplitVector<char> contentBefore;
+	CharClassify::cc classes[256];
+	bool multiByte;
+
+	static Sci::Position Scan(const Document *pdoc, const CharClassify::cc *classes, bool multiByte,
+		Sci::Position position, Sci::Position limit, ScanState &state, TextStatistics &counts);
+	ScanState StateAtBlock(const Document *pdoc, Sci::Position block) const;
+	TextStatistics TotalsBefore(Sci::Position block) const noexcept;
+	void AdjustBlock(Sci::Position block, const TextStatistics &before, const TextStatistics &after);
+	void RemoveBlock(Sci::Position block);
+	void Recount(const Document *pdoc, Sci::Position first, Sci::Position last, Sci::Position delta);
+	TextStatistics CountBefore(const Document *pdoc, Sci::Position position, ScanState &state) const;
+public:
+	DocumentStatistics();
+	// Deleted so DocumentStatistics objects can not be copied.
+	DocumentStatistics(const DocumentStatistics &) = delete;
+	DocumentStatistics(DocumentStatistics &&) = delete;
+	void operator=(const DocumentStatistics &) = delete;
+	void operator=(DocumentStatistics &&) = delete;
+	~DocumentStatistics();
+
+	void Rebuild(const Document *pdoc);
+	void Modify(const Document *pdoc, Sci::Position position, Sci::Position deleteLength, Sci::Position insertLength);
+	TextStatistics Count(const Document *pdoc, Sci::Position start, Sci::Position end) const;
+
+	static TextStatistics CountByScanning(const Document *pdoc, Sci::Position start, Sci::Position end);
+};
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+// Scintilla source code edit control
+/** @file EditJournal.cxx
+ ** Records edits so that they can be sent to another copy of a document as a delta.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "CellBuffer.h"
+#include "EditJournal.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// A delta starts with these bytes followed by the format version.
+const char deltaMagic[] = "SCED";
+constexpr size_t deltaMagicLength = 4;
+constexpr uint64_t deltaFormat = 1;
+
+// An edit while the edits are being coalesced.
+struct PendingEdit {
+	bool insert;
+	Sci::Position position;
+	Sci::Position length;
+	std::string text;
+};
+
+// Try to combine an edit with the one made before it.
+bool Coalesce(PendingEdit &previous, actionType at, Sci::Position position, const char *text, Sci::Position length) {
+	if (previous.insert) {
+		const Sci::Position offset = position - previous.position;
+		if ((offset < 0) || (offset > previous.length))
+			return false;
+		if (at == insertAction) {
+			// Typing within text just inserted
+			previous.text.insert(offset, text, length);
+			previous.length += length;
+			return true;
+		}
+		if (offset + length <= previous.length) {
+			// Deleting text just inserted
+			previous.text.erase(offset, length);
+			previous.length -= length;
+			return true;
+		}
+		return false;
+	}
+	if (at != removeAction)
+		return false;
+	if (position == previous.position) {
+		// Forward delete
+		previous.length += length;
+		return true;
+	}
+	if (position + length == previous.position) {
+		// Backspace
+		previous.position = position;
+		previous.length += length;
+		return true;
+	}
+	return false;
+}
+
+void AppendNumber(std::string &delta, uint64_t value) {
+	while (value >= 0x80) {
+		delta.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	delta.push_back(static_cast<char>(value));
+}
+
+bool ReadNumber(const unsigned char *&p, const unsigned char *end, uint64_t &value) noexcept {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (p == end)
+			return false;
+		const unsigned char byte = *p++;
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// Read a number that must fit in a Sci::Position.
+bool ReadPosition(const unsigned char *&p, const unsigned char *end, Sci::Position &position) noexcept {
+	uint64_t value;
+	if (!ReadNumber(p, end, value) || (value > static_cast<uint64_t>(PTRDIFF_MAX)))
+		return false;
+	position = static_cast<Sci::Position>(value);
+	return true;
+}
+
+}
+
+EditJournal::EditJournal(Sci::Position version) : firstVersion(version) {
+}
+
+EditJournal::~EditJournal() {
+}
+
+Sci::Position EditJournal::LastVersion() const noexcept {
+	return firstVersion + static_cast<Sci::Position>(edits.size());
+}
+
+void EditJournal::Append(actionType at, Sci::Position position, const char *text, Sci::Position length) {
+	edits.emplace_back();
+	if (at == insertAction) {
+		edits.back().Create(at, position, text, length);
+	} else {
+		edits.back().Create(at, position);
+		edits.back().lenData = length;
+	}
+}
+
+// Forget the edits made before version.
+void EditJournal::Discard(Sci::Position version) {
+	const Sci::Position discard = std::min(version, LastVersion()) - firstVersion;
+	for (Sci::Position i = 0; i < discard; i++) {
+		edits.pop_front();
+		firstVersion++;
+	}
+}
+
+// Encode the edits from fromVersion to toVersion of a document that is currently
+// length bytes long.  False if the journal does not hold those edits.
+bool EditJournal::Export(Sci::Position fromVersion, Sci::Position toVersion, Sci::Position length, std::string &delta) const {
+	if ((fromVersion < firstVersion) || (toVersion > LastVersion()) || (fromVersion > toVersion))
+		return false;
+	const size_t first = fromVersion - firstVersion;
+	const size_t last = toVersion - firstVersion;
+
+	// Work back from the current length to the length before the edits
+	Sci::Position lengthBefore = length;
+	for (size_t i = edits.size(); i > first; i--) {
+		const Action &action = edits[i - 1];
+		lengthBefore += (action.at == insertAction) ? -action.lenData : action.lenData;
+	}
+
+	std::vector<PendingEdit> pending;
+	Sci::Position lengthAfter = lengthBefore;
+	for (size_t i = first; i < last; i++) {
+		const Action &action = edits[i];
+		lengthAfter += (action.at == insertAction) ? action.lenData : -action.lenData;
+		if (!pending.empty() && Coalesce(pending.back(), action.at, action.position, action.data.get(), action.lenData)) {
+			if (pending.back().length == 0)
+				pending.pop_back();
+			continue;
+		}
+		PendingEdit edit;
+		edit.insert = action.at == insertAction;
+		edit.position = action.position;
+		edit.length = action.lenData;
+		if (edit.insert)
+			edit.text.assign(action.data.get(), action.lenData);
+		pending.push_back(std::move(edit));
+	}
+
+	delta.assign(deltaMagic, deltaMagicLength);
+	AppendNumber(delta, deltaFormat);
+	AppendNumber(delta, fromVersion);
+	AppendNumber(delta, toVersion);
+	AppendNumber(delta, lengthBefore);
+	AppendNumber(delta, lengthAfter);
+	AppendNumber(delta, pending.size());
+	// Each position is held as the zigzag encoded distance from the end of the previous
+	// edit with the lowest bit showing whether the edit is an insertion.
+	Sci::Position previousEnd = 0;
+	for (const PendingEdit &edit : pending) {
+		const Sci::Position distance = edit.position - previousEnd;
+		const uint64_t zigzag = (distance < 0) ? ((static_cast<uint64_t>(-distance) << 1) - 1) :
+			(static_cast<uint64_t>(distance) << 1);
+		AppendNumber(delta, (zigzag << 1) | (edit.insert ? 1 : 0));
+		AppendNumber(delta, edit.length);
+		if (edit.insert) {
+			delta.append(edit.text);
+			previousEnd = edit.position + edit.length;
+		} else {
+			previousEnd = edit.position;
+		}
+	}
+	return true;
+}
+
+// Decode a delta, checking that each edit is within the document as it will be when
+// the edit is made.
+bool EditJournal::Decode(const char *delta, Sci::Position deltaLength, EditDelta &decoded) {
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(delta);
+	const unsigned char *end = p + deltaLength;
+	if ((deltaLength < static_cast<Sci::Position>(deltaMagicLength)) || (memcmp(p, deltaMagic, deltaMagicLength) != 0))
+		return false;
+	p += deltaMagicLength;
+	uint64_t format;
+	Sci::Position count;
+	if (!ReadNumber(p, end, format) || (format != deltaFormat) ||
+		!ReadPosition(p, end, decoded.fromVersion) || !ReadPosition(p, end, decoded.toVersion) ||
+		!ReadPosition(p, end, decoded.lengthBefore) || !ReadPosition(p, end, decoded.lengthAfter) ||
+		!ReadPosition(p, end, count) || (count > end - p))
+		return false;
+	decoded.edits.clear();
+	decoded.edits.reserve(count);
+	Sci::Position length = decoded.lengthBefore;
+	Sci::Position previousEnd = 0;
+	for (Sci::Position i = 0; i < count; i++) {
+		uint64_t head;
+		EditDelta::Edit edit;
+		if (!ReadNumber(p, end, head) || !ReadPosition(p, end, edit.length) || (edit.length <= 0))
+			return false;
+		edit.insert = (head & 1) != 0;
+		const uint64_t zigzag = head >> 1;
+		const uint64_t magnitude = (zigzag >> 1) + (zigzag & 1);
+		if (magnitude > static_cast<uint64_t>(length))
+			return false;
+		const Sci::Position distance = static_cast<Sci::Position>(magnitude);
+		edit.position = previousEnd + ((zigzag & 1) ? -distance : distance);
+		if ((edit.position < 0) || (edit.position > length))
+			return false;
+		if (edit.insert) {
+			if (edit.length > end - p)
+				return false;
+			edit.text = reinterpret_cast<const char *>(p);
+			p += edit.length;
+			length += edit.length;
+			previousEnd = edit.position + edit.length;
+		} else {
+			if (edit.length > length - edit.position)
+				return false;
+			edit.text = nullptr;
+			length -= edit.length;
+			previousEnd = edit.position;
+		}
+		decoded.edits.push_back(edit);
+	}
+	return (p == end) && (length == decoded.lengthAfter);
+}
@@ -0,0 +1,60 @@
+// Scintilla source code edit control
+/** @file EditJournal.h
+ ** Records edits so that they can be sent to another copy of a document as a delta.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+namespace Scintilla {
+
+/// The edits held in a delta along with the versions and lengths of the document
+/// before and after them.  Inserted text points into the encoded delta.
+struct EditDelta {
+	struct Edit {
+		bool insert;
+		Sci::Position position;
+		Sci::Position length;
+		const char *text;
+	};
+	Sci::Position fromVersion = 0;
+	Sci::Position toVersion = 0;
+	Sci::Position lengthBefore = 0;
+	Sci::Position lengthAfter = 0;
+	std::vector<Edit> edits;
+};
+
+/// Each insertion and removal made to a document is numbered by the version of the
+/// document it changed and kept as an Action in the same form as undo history.
+/// The edits between two versions are encoded as a delta with consecutive typing and
+/// deletion coalesced, positions held relative to the previous edit and all numbers
+/// as variable length integers so that an edit of a few characters takes a few bytes.
+/// Removals keep only their length as the deleted text is not needed to replay them.
+class EditJournal {
+	// A deque so that old edits can be discarded from the front.
+	std::deque<Action> edits;
+	// The version changed by edits[0].
+	Sci::Position firstVersion;
+public:
+	explicit EditJournal(Sci::Position version);
+	// Deleted so EditJournal objects can not be copied.
+	EditJournal(const EditJournal &) = delete;
+	EditJournal(EditJournal &&) = delete;
+	void operator=(const EditJournal &) = delete;
+	void operator=(EditJournal &&) = delete;
+	~EditJournal();
+
+	Sci::Position FirstVersion() const noexcept { return firstVersion; }
+	Sci::Position LastVersion() const noexcept;
+	void Append(actionType at, Sci::Position position, const char *text, Sci::Position length);
+	void Discard(Sci::Position version);
+	bool Export(Sci::Position fromVersion, Sci::Position toVersion, Sci::Position length, std::string &delta) const;
+
+	static bool Decode(const char *delta, Sci::Position deltaLength, EditDelta &decoded);
+};
+
+}
+
+#endif
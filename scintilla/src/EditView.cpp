@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <limits>
 #include <chrono>
 
 #include "Platform.h"
@@ -37,6 +38,7 @@
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
+#include "SparseVector.h"
 #include "ContractionState.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
@@ -174,8 +176,21 @@ void DrawStyledText(Surface *surface, const ViewStyle &vs, int styleOffset, PRec
 
 const XYPOSITION epsilon = 0.0001f;	// A small nudge to avoid floating point precision issues
 
+HitTestEntry::HitTestEntry() noexcept :
+	pdoc(nullptr), generation(0), styleClock(0), wrapWidth(0),
+	visibleLine(-1), lineDoc(-1), lineStartSet(-1), options(0), xStart(0), xEnd(0) {
+}
+
+// Whether the entries are for the same options on the same display line laid out in the same way.
+bool HitTestEntry::SameLine(const HitTestEntry &other) const noexcept {
+	return (pdoc == other.pdoc) && (generation == other.generation) && (styleClock == other.styleClock) &&
+		(wrapWidth == other.wrapWidth) && (visibleLine == other.visibleLine) && (lineDoc == other.lineDoc) &&
+		(lineStartSet == other.lineStartSet) && (options == other.options);
+}
+
 EditView::EditView() {
 	tabWidthMinimumPixels = 2; // needed for calculating tab stops for fractional proportional fonts
+	elasticTabstops = false;
 	hideSelection = false;
 	drawOverstrikeCaret = true;
 	bufferedDraw = true;
@@ -186,6 +201,10 @@ EditView::EditView() {
 	imeCaretBlockOverride = false;
 	llc.SetLevel(LineLayoutCache::llcCaret);
 	posCache.SetSize(0x400);
+	hitTestNext = 0;
+	linesMeasured = 0;
+	prefetchHits = 0;
+	prefetchMisses = 0;
 	tabArrowHeight = 4;
 	customDrawTabArrow = nullptr;
 	customDrawWrapMarker = nullptr;
@@ -214,6 +233,8 @@ bool EditView::LinesOverlap() const {
 
 void EditView::ClearAllTabstops() {
 	ldTabstops.reset();
+	ldCellWidths.reset();
+	ClearWrapSignatures();
 }
 
 XYPOSITION EditView::NextTabstopPos(Sci::Line line, XYPOSITION x, XYPOSITION tabWidth) const {
@@ -224,6 +245,8 @@ XYPOSITION EditView::NextTabstopPos(Sci::Line line, XYPOSITION x, XYPOSITION tab
 }
 
 bool EditView::ClearTabstops(Sci::Line line) {
+	if (ldWrapSignatures)
+		ldWrapSignatures->Forget(line);
 	return ldTabstops && ldTabstops->ClearTabstops(line);
 }
 
@@ -231,6 +254,8 @@ bool EditView::AddTabstop(Sci::Line line, int x) {
 	if (!ldTabstops) {
 		ldTabstops.reset(new LineTabstops());
 	}
+	if (ldWrapSignatures)
+		ldWrapSignatures->Forget(line);
 	return ldTabstops && ldTabstops->AddTabstop(line, x);
 }
 
@@ -242,6 +267,340 @@ int EditView::GetNextTabstop(Sci::Line line, int x) const {
 	}
 }
 
+bool EditView::SetElasticTabstops(bool elastic) {
+	if (elasticTabstops == elastic)
+		return false;
+	elasticTabstops = elastic;
+	// Tabstops set explicitly and those set by a previous alignment are both dropped
+	ClearAllTabstops();
+	return true;
+}
+
+void EditView::InvalidateElasticTabstops(Sci::Line lineFirst, Sci::Line lineLast, bool linesChanged) {
+	if (ldCellWidths) {
+		if (linesChanged)
+			ldCellWidths->Invalidate(lineFirst, lineLast);
+		else
+			ldCellWidths->Remeasure(lineFirst, lineLast);
+	}
+}
+
+// Measurements depend on the styles so are all discarded when styles change.
+// Tabstops remain until they are replaced by aligning with the new measurements.
+void EditView::ClearCellWidths() {
+	ldCellWidths.reset();
+}
+
+// Measure the cells ended by tabs on a line unless already known. Returns false
+// when the line has no tabs so is not part of a block.
+bool EditView::MeasureCells(Surface *surface, const EditModel &model, const ViewStyle &vstyle, Sci::Line line) {
+	if (ldCellWidths->Measured(line))
+		return !ldCellWidths->Widths(line).empty();
+	const Sci::Position posLineStart = model.pdoc->LineStart(line);
+	const Sci::Position lineLength = model.pdoc->LineEnd(line) - posLineStart;
+	std::string chars(lineLength, '\0');
+	model.pdoc->GetCharRange(&chars[0], posLineStart, lineLength);
+	TabstopList widths;
+	size_t tab = chars.find('\t');
+	if (tab != std::string::npos) {
+		std::vector<unsigned char> styles(lineLength);
+		model.pdoc->GetStyleRange(styles.data(), posLineStart, lineLength);
+		std::vector<XYPOSITION> positions(lineLength);
+		size_t cellStart = 0;
+		while (tab != std::string::npos) {
+			// Measure each run of a single style in the cell as layout would
+			XYPOSITION width = 0.0f;
+			size_t run = cellStart;
+			while (run < tab) {
+				size_t runEnd = run + 1;
+				while ((runEnd < tab) && (styles[runEnd] == styles[run]))
+					runEnd++;
+				if (vstyle.styles[styles[run]].visible) {
+					const unsigned int runLength = static_cast<unsigned int>(runEnd - run);
+					posCache.MeasureWidths(surface, vstyle, styles[run], &chars[run],
+						runLength, positions.data(), model.pdoc);
+					width += positions[runLength - 1];
+				}
+				run = runEnd;
+			}
+			widths.push_back(static_cast<int>(std::ceil(width)));
+			cellStart = tab + 1;
+			tab = chars.find('\t', cellStart);
+		}
+	}
+	const bool hasCells = !widths.empty();
+	ldCellWidths->SetWidths(line, std::move(widths));
+	return hasCells;
+}
+
+// The widest cell of a column of a line is found from its tabstops.
+static int WidestCell(const TabstopList &stops, size_t column, int padding) noexcept {
+	return stops[column] - ((column > 0) ? stops[column - 1] : 0) - padding;
+}
+
+// An aligned line whose text changed in place keeps the tabstops of its block when it has
+// the same cells and no column grows wider than its run or shrinks from being the widest
+// without another cell of the run being as wide. Otherwise the line keeps the widths it was
+// aligned with until its group is aligned.
+bool EditView::CellsKeepAlignment(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+	Sci::Line line, int padding) {
+	TabstopList widthsBefore = ldCellWidths->Widths(line);
+	MeasureCells(surface, model, vstyle, line);
+	const TabstopList &widths = ldCellWidths->Widths(line);
+	const TabstopList *stops = ldTabstops->Tabstops(line);
+	bool keeps = stops && (stops->size() == widths.size()) && (widthsBefore.size() == widths.size());
+	for (size_t column = 0; keeps && (column < widths.size()); column++) {
+		const int widest = WidestCell(*stops, column, padding);
+		keeps = (widths[column] <= widest) &&
+			((widthsBefore[column] != widest) || (widths[column] == widest) ||
+			ldCellWidths->RunHasWidth(line, -1, column, widest) ||
+			ldCellWidths->RunHasWidth(line, 1, column, widest));
+	}
+	if (!keeps) {
+		ldCellWidths->SetWidths(line, std::move(widthsBefore));
+		ldCellWidths->Remeasure(line, line);
+	}
+	return keeps;
+}
+
+// Whether a line next to a group being aligned is aligned, checking it first if its text
+// changed in place.
+bool EditView::AlignedNeighbour(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+	Sci::Line line, int padding) {
+	if (!ldCellWidths->Aligned(line))
+		return false;
+	if (ldCellWidths->Measured(line) || CellsKeepAlignment(surface, model, vstyle, line, padding))
+		return true;
+	ldCellWidths->SetUnaligned(line);
+	return false;
+}
+
+// Add a line that is not aligned to the group being aligned, keeping the widths it had when
+// its block was aligned along with those of lines removed below it, then measure it.
+// Returns true when the line separates the group from the lines beyond it as it was there
+// before and has no cells before or after changing and no lines were removed below it.
+bool EditView::JoinGroup(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+	Sci::Line line, std::vector<TabstopList> &widthsBefore) {
+	const bool separates = !ldCellWidths->Added(line) && !ldCellWidths->HasRemoved(line) &&
+		ldCellWidths->Widths(line).empty();
+	if (!ldCellWidths->Added(line))
+		widthsBefore.push_back(ldCellWidths->Widths(line));
+	ldCellWidths->TakeRemoved(line, widthsBefore);
+	if (line == 0)
+		ldCellWidths->TakeRemoved(-1, widthsBefore);
+	return !MeasureCells(surface, model, vstyle, line) && separates;
+}
+
+// Whether the group lineFirst..lineLast fits between the aligned lines lineAbove and lineBelow,
+// or -1 where the group is not joined to another line, leaving the widest cell of each run of
+// the columns they reach as it was. widthsBefore holds the cells between lineAbove and lineBelow
+// before the lines changed.
+bool EditView::GroupFits(Sci::Line lineFirst, Sci::Line lineLast, Sci::Line lineAbove, Sci::Line lineBelow,
+	const std::vector<TabstopList> &widthsBefore, int padding) const {
+	const TabstopList noCells;
+	const TabstopList &widthsAbove = (lineAbove >= 0) ? ldCellWidths->Widths(lineAbove) : noCells;
+	const TabstopList &widthsBelow = (lineBelow >= 0) ? ldCellWidths->Widths(lineBelow) : noCells;
+	const TabstopList *stopsAbove = widthsAbove.empty() ? nullptr : ldTabstops->Tabstops(lineAbove);
+	const TabstopList *stopsBelow = widthsBelow.empty() ? nullptr : ldTabstops->Tabstops(lineBelow);
+	if ((!widthsAbove.empty() && (!stopsAbove || (stopsAbove->size() != widthsAbove.size()))) ||
+		(!widthsBelow.empty() && (!stopsBelow || (stopsBelow->size() != widthsBelow.size()))))
+		return false;
+	const size_t columns = std::max(widthsAbove.size(), widthsBelow.size());
+	for (size_t column = 0; column < columns; column++) {
+		const bool reachAbove = column < widthsAbove.size();
+		const bool reachBelow = column < widthsBelow.size();
+		const int widestAbove = reachAbove ? WidestCell(*stopsAbove, column, padding) : 0;
+		const int widestBelow = reachBelow ? WidestCell(*stopsBelow, column, padding) : 0;
+		// Cells continuing the runs above and below may not be wider than them
+		bool matchAbove = false;
+		Sci::Line line = lineFirst;
+		for (; (line <= lineLast) && (ldCellWidths->Widths(line).size() > column); line++) {
+			const int width = ldCellWidths->Widths(line)[column];
+			if (reachAbove && (width > widestAbove))
+				return false;
+			matchAbove = matchAbove || (reachAbove && (width == widestAbove));
+		}
+		const bool joinedAfter = line > lineLast;
+		bool matchBelow = false;
+		for (line = lineLast; (line >= lineFirst) && (ldCellWidths->Widths(line).size() > column); line--) {
+			const int width = ldCellWidths->Widths(line)[column];
+			if (reachBelow && (width > widestBelow))
+				return false;
+			matchBelow = matchBelow || (reachBelow && (width == widestBelow));
+		}
+		// The runs above and below must still be joined, or still be apart
+		const bool joined = reachAbove && reachBelow && joinedAfter;
+		if (reachAbove && reachBelow) {
+			const bool joinedBefore = std::all_of(widthsBefore.begin(), widthsBefore.end(),
+				[column](const TabstopList &widths) { return widths.size() > column; });
+			if ((joinedBefore != joinedAfter) || (joined && (widestAbove != widestBelow)))
+				return false;
+		}
+		// A cell that may have been the widest of the run above or below must be matched by
+		// another. As the order of the cells before is not known, either run may have held it.
+		for (const TabstopList &widths : widthsBefore) {
+			if (widths.size() > column) {
+				if (reachAbove && !matchAbove && (widths[column] == widestAbove)) {
+					matchAbove = (widthsAbove[column] == widestAbove) ||
+						ldCellWidths->RunHasWidth(lineAbove, -1, column, widestAbove) ||
+						(joined && ((widthsBelow[column] == widestBelow) ||
+						ldCellWidths->RunHasWidth(lineBelow, 1, column, widestBelow)));
+					if (!matchAbove)
+						return false;
+					matchBelow = matchBelow || joined;
+				}
+				if (reachBelow && !matchBelow && (widths[column] == widestBelow)) {
+					matchBelow = (widthsBelow[column] == widestBelow) ||
+						ldCellWidths->RunHasWidth(lineBelow, 1, column, widestBelow);
+					if (!matchBelow)
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// Set the tabstops of the group lineFirst..lineLast. The cells in a column are as wide as the
+// widest of them over each run of consecutive lines that reach that column, with runs that
+// continue from lineAbove or to lineBelow as wide as their tabstops show.
+void EditView::SetGroupTabstops(const EditModel &model, Sci::Line lineFirst, Sci::Line lineLast,
+	Sci::Line lineAbove, Sci::Line lineBelow, int padding, Range &changed) {
+	// The cells of the group are held in arrays with offsets giving where each line starts.
+	// Cells continuing a run of their column from the previous line share its index
+	// so the widest cell of every run is found in one pass.
+	const TabstopList noCells;
+	const TabstopList &widthsAbove = (lineAbove >= 0) ? ldCellWidths->Widths(lineAbove) : noCells;
+	const TabstopList &widthsBelow = (lineBelow >= 0) ? ldCellWidths->Widths(lineBelow) : noCells;
+	const size_t groupLines = lineLast - lineFirst + 1;
+	std::vector<const TabstopList *> widthsOfLine(groupLines);
+	std::vector<size_t> offsets(groupLines + 1, 0);
+	for (size_t i = 0; i < groupLines; i++) {
+		widthsOfLine[i] = &ldCellWidths->Widths(lineFirst + i);
+		offsets[i + 1] = offsets[i] + widthsOfLine[i]->size();
+	}
+	std::vector<size_t> runs(offsets[groupLines]);
+	std::vector<int> runWidths;
+	std::vector<size_t> runsAbove;
+	for (size_t column = 0; column < widthsAbove.size(); column++) {
+		runsAbove.push_back(runWidths.size());
+		runWidths.push_back(WidestCell(*ldTabstops->Tabstops(lineAbove), column, padding));
+	}
+	for (size_t i = 0; i < groupLines; i++) {
+		const TabstopList &widths = *widthsOfLine[i];
+		const size_t cellsBefore = (i > 0) ? widthsOfLine[i - 1]->size() : widthsAbove.size();
+		for (size_t column = 0; column < widths.size(); column++) {
+			size_t run = runWidths.size();
+			if (column < cellsBefore) {
+				run = (i > 0) ? runs[offsets[i - 1] + column] : runsAbove[column];
+				runWidths[run] = std::max(runWidths[run], widths[column]);
+			} else {
+				runWidths.push_back(widths[column]);
+			}
+			runs[offsets[i] + column] = run;
+		}
+	}
+	const size_t cellsLast = widthsOfLine[groupLines - 1]->size();
+	for (size_t column = 0; (column < cellsLast) && (column < widthsBelow.size()); column++) {
+		const size_t run = runs[offsets[groupLines - 1] + column];
+		runWidths[run] = std::max(runWidths[run], WidestCell(*ldTabstops->Tabstops(lineBelow), column, padding));
+	}
+
+	// Lines in a run share the stops of earlier columns so their stops match
+	std::vector<int> stops(offsets[groupLines]);
+	for (size_t i = 0; i < groupLines; i++) {
+		int x = 0;
+		for (size_t cell = offsets[i]; cell < offsets[i + 1]; cell++) {
+			x += runWidths[runs[cell]] + padding;
+			stops[cell] = x;
+		}
+		const Sci::Line lineGroup = lineFirst + i;
+		if ((offsets[i + 1] > offsets[i]) &&
+			ldTabstops->SetTabstops(lineGroup, stops.data() + offsets[i], offsets[i + 1] - offsets[i])) {
+			if (ldWrapSignatures)
+				ldWrapSignatures->Forget(lineGroup);
+			const Sci::Position posLineStart = model.pdoc->LineStart(lineGroup);
+			const Sci::Position posLineEnd = model.pdoc->LineStart(lineGroup + 1);
+			if (changed.Valid()) {
+				changed = Range(std::min(changed.start, posLineStart), std::max(changed.end, posLineEnd));
+			} else {
+				changed = Range(posLineStart, posLineEnd);
+			}
+		}
+	}
+}
+
+// Align the group of lines that are not aligned around line. The group is fitted between the
+// aligned lines either side when that leaves the widest cell of each of their columns alone,
+// otherwise the blocks either side join the group. Returns the last line of the group.
+Sci::Line EditView::AlignGroup(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+	Sci::Line line, int padding, Range &changed) {
+	const Sci::Line lines = model.pdoc->LinesTotal();
+	std::vector<TabstopList> widthsBefore;
+	Sci::Line lineFirst = line;
+	Sci::Line lineLast = line;
+	const bool separates = JoinGroup(surface, model, vstyle, line, widthsBefore);
+	bool boundedAbove = separates && !ldCellWidths->HasRemoved(line - 1);
+	bool boundedBelow = separates;
+	while (true) {
+		while (!boundedAbove && (lineFirst > 0) && !AlignedNeighbour(surface, model, vstyle, lineFirst - 1, padding)) {
+			lineFirst--;
+			boundedAbove = JoinGroup(surface, model, vstyle, lineFirst, widthsBefore) &&
+				!ldCellWidths->HasRemoved(lineFirst - 1);
+		}
+		while (!boundedBelow && (lineLast + 1 < lines) && !AlignedNeighbour(surface, model, vstyle, lineLast + 1, padding)) {
+			lineLast++;
+			boundedBelow = JoinGroup(surface, model, vstyle, lineLast, widthsBefore);
+		}
+		const Sci::Line lineAbove = (!boundedAbove && (lineFirst > 0)) ? lineFirst - 1 : -1;
+		const Sci::Line lineBelow = (!boundedBelow && (lineLast + 1 < lines)) ? lineLast + 1 : -1;
+		if (lineAbove >= 0)
+			ldCellWidths->TakeRemoved(lineAbove, widthsBefore);
+		if (GroupFits(lineFirst, lineLast, lineAbove, lineBelow, widthsBefore, padding)) {
+			SetGroupTabstops(model, lineFirst, lineLast, lineAbove, lineBelow, padding, changed);
+			ldCellWidths->SetAligned(lineFirst, lineLast);
+			return lineLast;
+		}
+		if (lineAbove >= 0)
+			ldCellWidths->Unalign(lineAbove);
+		if (lineBelow >= 0)
+			ldCellWidths->Unalign(lineBelow);
+	}
+}
+
+// Set the tabstops of the lines in lineFirst..lineLast that have not been aligned since they
+// changed. Only those lines are measured. A line whose text changed in place is checked against
+// its existing tabstops. Lines added, removed or changed in other ways are aligned in groups
+// that are fitted between the aligned lines around them, so the rest of a block is only
+// aligned again when the widest cell of one of its columns changes.
+// Returns the range of lines whose tabstops moved.
+Range EditView::AlignElasticTabstops(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+	Sci::Line lineFirst, Sci::Line lineLast) {
+	Range changed(Sci::invalidPosition);
+	if (!elasticTabstops)
+		return changed;
+	if (!ldCellWidths) {
+		ldCellWidths.reset(new LineCellWidths());
+	}
+	if (!ldTabstops) {
+		ldTabstops.reset(new LineTabstops());
+	}
+	const int padding = static_cast<int>(std::ceil(vstyle.spaceWidth)) + tabWidthMinimumPixels;
+	lineLast = std::min(lineLast, model.pdoc->LinesTotal() - 1);
+	for (Sci::Line line = std::max(lineFirst, static_cast<Sci::Line>(0)); line <= lineLast; line++) {
+		if (ldCellWidths->Aligned(line)) {
+			if (ldCellWidths->Measured(line) || CellsKeepAlignment(surface, model, vstyle, line, padding))
+				continue;
+			ldCellWidths->SetUnaligned(line);
+		}
+		line = AlignGroup(surface, model, vstyle, line, padding, changed);
+	}
+	if (changed.Valid()) {
+		llc.Invalidate(LineLayout::llInvalid);
+	}
+	return changed;
+}
+
 void EditView::LinesAddedOrRemoved(Sci::Line lineOfPos, Sci::Line linesAdded) {
 	if (ldTabstops) {
 		if (linesAdded > 0) {
@@ -254,6 +613,68 @@ void EditView::LinesAddedOrRemoved(Sci::Line lineOfPos, Sci::Line linesAdded) {
 			}
 		}
 	}
+	if (ldCellWidths) {
+		if (linesAdded > 0) {
+			for (Sci::Line line = lineOfPos; line < lineOfPos + linesAdded; line++) {
+				ldCellWidths->InsertLine(line);
+			}
+		} else {
+			for (Sci::Line line = (lineOfPos + -linesAdded) - 1; line >= lineOfPos; line--) {
+				ldCellWidths->RemoveLine(line);
+			}
+		}
+	}
+	if (ldWrapSignatures) {
+		if (linesAdded > 0) {
+			for (Sci::Line line = lineOfPos; line < lineOfPos + linesAdded; line++) {
+				ldWrapSignatures->InsertLine(line);
+			}
+		} else {
+			for (Sci::Line line = (lineOfPos + -linesAdded) - 1; line >= lineOfPos; line--) {
+				ldWrapSignatures->RemoveLine(line);
+			}
+		}
+	}
+}
+
+// The text of a line and the metrics of its styles determine how it wraps while the view
+// settings, counted by generation, and the width are unchanged.  Where the style changes is
+// included since that separates the segments measured and is a break for word wrapping.
+unsigned int EditView::WrapSignature(const EditModel &model, Sci::Line line, const ViewStyle &vstyle,
+	int generation, int width) const {
+	// FNV-1a
+	const unsigned int prime = 16777619U;
+	unsigned int hash = 2166136261U;
+	hash = (hash ^ static_cast<unsigned int>(generation)) * prime;
+	hash = (hash ^ static_cast<unsigned int>(width)) * prime;
+	const Sci::Position posLineEnd = model.pdoc->LineStart(line + 1);
+	int stylePrevious = -1;
+	for (Sci::Position position = model.pdoc->LineStart(line); position < posLineEnd; position++) {
+		const int style = model.pdoc->StyleIndexAt(position);
+		const unsigned int metrics = vstyle.MetricClass(style) * 2 + ((style != stylePrevious) ? 1 : 0);
+		hash = (hash ^ static_cast<unsigned char>(model.pdoc->CharAt(position))) * prime;
+		hash = (hash ^ metrics) * prime;
+		stylePrevious = style;
+	}
+	return hash;
+}
+
+// The number of lines a line wrapped into when it last had this signature or 0 when unknown.
+int EditView::WrappedLines(Sci::Line line, unsigned int signature) const {
+	if (ldWrapSignatures)
+		return ldWrapSignatures->Lines(line, signature);
+	return 0;
+}
+
+void EditView::SetWrappedLines(Sci::Line line, unsigned int signature, int lines) {
+	if (!ldWrapSignatures) {
+		ldWrapSignatures.reset(new LineWrapSignatures());
+	}
+	ldWrapSignatures->SetLines(line, signature, lines);
+}
+
+void EditView::ClearWrapSignatures() {
+	ldWrapSignatures.reset();
 }
 
 void EditView::DropGraphics(bool freeObjects) {
@@ -369,15 +790,26 @@ void EditView::LayoutLine(const EditModel &model, Sci::Line line, Surface *surfa
 		if (lineLength == ll->numCharsInLine) {
 			// See if chars, styles, indicators, are all the same
 			bool allSame = true;
+			// Styles may change to others with the same metrics as long as the style changes
+			// stay in the same places since they separate measured segments and wrap breaks.
+			bool stylesChanged = false;
 			// Check base line layout
 			int styleByte = 0;
 			int numCharsInLine = 0;
 			while (numCharsInLine < lineLength) {
 				const Sci::Position charInDoc = numCharsInLine + posLineStart;
 				const char chDoc = model.pdoc->CharAt(charInDoc);
+				const int styleBytePrevious = styleByte;
 				styleByte = model.pdoc->StyleIndexAt(charInDoc);
-				allSame = allSame &&
-					(ll->styles[numCharsInLine] == styleByte);
+				if (ll->styles[numCharsInLine] != styleByte) {
+					stylesChanged = true;
+					allSame = allSame &&
+						(vstyle.MetricClass(ll->styles[numCharsInLine]) == vstyle.MetricClass(styleByte));
+				}
+				if (stylesChanged && (numCharsInLine > 0)) {
+					allSame = allSame &&
+						((ll->styles[numCharsInLine - 1] == ll->styles[numCharsInLine]) == (styleBytePrevious == styleByte));
+				}
 				if (vstyle.styles[ll->styles[numCharsInLine]].caseForce == Style::caseMixed)
 					allSame = allSame &&
 					(ll->chars[numCharsInLine] == chDoc);
@@ -397,7 +829,14 @@ void EditView::LayoutLine(const EditModel &model, Sci::Line line, Surface *surfa
 				}
 				numCharsInLine++;
 			}
-			allSame = allSame && (ll->styles[numCharsInLine] == styleByte);	// For eolFilled
+			if (allSame && stylesChanged) {
+				// Keep the positions but draw with the new styles
+				const int lineLengthAll = static_cast<int>(posLineEnd - posLineStart);
+				model.pdoc->GetStyleRange(ll->styles.get(), posLineStart, lineLengthAll);
+				ll->styles[numCharsInLine] = (lineLengthAll > 0) ? ll->styles[lineLengthAll - 1] : 0;
+			} else {
+				allSame = allSame && (ll->styles[numCharsInLine] == styleByte);	// For eolFilled
+			}
 			if (allSame) {
 				ll->validity = LineLayout::llPositions;
 			} else {
@@ -408,6 +847,8 @@ void EditView::LayoutLine(const EditModel &model, Sci::Line line, Surface *surfa
 		}
 	}
 	if (ll->validity == LineLayout::llInvalid) {
+		linesMeasured++;
+		ll->prefetched = false;
 		ll->widthLine = LineLayout::wrapWidthInfinite;
 		ll->lines = 1;
 		if (vstyle.edgeState == EDGE_BACKGROUND) {
@@ -658,21 +1099,52 @@ SelectionPosition EditView::SPositionFromLocation(Surface *surface, const EditMo
 	if (lineDoc >= model.pdoc->LinesTotal())
 		return SelectionPosition(canReturnInvalid ? INVALID_POSITION :
 			model.pdoc->Length());
+	const Sci::Line lineStartSet = model.pcs->DisplayFromDoc(lineDoc);
+
+	// Points near a recent hit test may be resolved without laying out the line
+	HitTestEntry hit;
+	hit.pdoc = model.pdoc;
+	hit.generation = llc.Generation();
+	hit.styleClock = model.pdoc->GetStyleClock();
+	hit.wrapWidth = model.wrapWidth;
+	hit.visibleLine = visibleLine;
+	hit.lineDoc = lineDoc;
+	hit.lineStartSet = lineStartSet;
+	hit.options = (canReturnInvalid ? 1 : 0) | (charPosition ? 2 : 0) | (virtualSpace ? 4 : 0);
+	for (const HitTestEntry &entry : hitTests) {
+		if (entry.SameLine(hit) && (pt.x >= entry.xStart) && (pt.x < entry.xEnd))
+			return entry.position;
+	}
+
+	const XYPOSITION xUnbounded = std::numeric_limits<XYPOSITION>::max();
 	const Sci::Position posLineStart = model.pdoc->LineStart(lineDoc);
 	AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc, model));
 	if (surface && ll) {
 		LayoutLine(model, lineDoc, surface, vs, ll, model.wrapWidth);
-		const Sci::Line lineStartSet = model.pcs->DisplayFromDoc(lineDoc);
+		// Laying out may have invalidated the cache
+		hit.generation = llc.Generation();
 		const int subLine = static_cast<int>(visibleLine - lineStartSet);
 		if (subLine < ll->lines) {
 			const Range rangeSubLine = ll->SubLineRange(subLine, LineLayout::Scope::visibleOnly);
 			const XYPOSITION subLineStart = ll->positions[rangeSubLine.start];
+			// The range of x giving the position is found in line coordinates then moved back
+			const XYPOSITION xShift = subLineStart - ((subLine > 0) ? ll->wrapIndent : 0);
 			if (subLine > 0)	// Wrapped
 				pt.x -= ll->wrapIndent;
 			const Sci::Position positionInLine = ll->FindPositionFromX(static_cast<XYPOSITION>(pt.x + subLineStart),
 				rangeSubLine, charPosition);
+			const XYPOSITION *positions = ll->positions.get();
+			XYPOSITION xStart = -xUnbounded;
+			if (positionInLine > rangeSubLine.start) {
+				xStart = charPosition ? positions[positionInLine] :
+					(positions[positionInLine - 1] + positions[positionInLine]) / 2;
+				xStart -= xShift;
+			}
 			if (positionInLine < rangeSubLine.end) {
-				return SelectionPosition(model.pdoc->MovePositionOutsideChar(positionInLine + posLineStart, 1));
+				const XYPOSITION xEnd = (charPosition ? positions[positionInLine + 1] :
+					(positions[positionInLine] + positions[positionInLine + 1]) / 2) - xShift;
+				return AddHitTest(hit, xStart, xEnd,
+					SelectionPosition(model.pdoc->MovePositionOutsideChar(positionInLine + posLineStart, 1)));
 			}
 			if (virtualSpace) {
 				const XYPOSITION spaceWidth = vs.styles[ll->EndLineStyle()].spaceWidth;
@@ -680,19 +1152,33 @@ SelectionPosition EditView::SPositionFromLocation(Surface *surface, const EditMo
 					(pt.x + subLineStart - ll->positions[rangeSubLine.end] + spaceWidth / 2) / spaceWidth);
 				return SelectionPosition(rangeSubLine.end + posLineStart, spaceOffset);
 			} else if (canReturnInvalid) {
+				const XYPOSITION xLineEnd = positions[rangeSubLine.end] - xShift;
 				if (pt.x < (ll->positions[rangeSubLine.end] - subLineStart)) {
-					return SelectionPosition(model.pdoc->MovePositionOutsideChar(rangeSubLine.end + posLineStart, 1));
+					return AddHitTest(hit, xStart, xLineEnd,
+						SelectionPosition(model.pdoc->MovePositionOutsideChar(rangeSubLine.end + posLineStart, 1)));
 				}
+				return AddHitTest(hit, std::max(xStart, xLineEnd), xUnbounded, SelectionPosition(INVALID_POSITION));
 			} else {
-				return SelectionPosition(rangeSubLine.end + posLineStart);
+				return AddHitTest(hit, xStart, xUnbounded, SelectionPosition(rangeSubLine.end + posLineStart));
 			}
 		}
 		if (!canReturnInvalid)
-			return SelectionPosition(ll->numCharsInLine + posLineStart);
+			return AddHitTest(hit, -xUnbounded, xUnbounded, SelectionPosition(ll->numCharsInLine + posLineStart));
+		return AddHitTest(hit, -xUnbounded, xUnbounded, SelectionPosition(INVALID_POSITION));
 	}
 	return SelectionPosition(canReturnInvalid ? INVALID_POSITION : posLineStart);
 }
 
+// Remember the result of a hit test along with the range of x that gives the same result.
+SelectionPosition EditView::AddHitTest(HitTestEntry hit, XYPOSITION xStart, XYPOSITION xEnd, SelectionPosition position) {
+	hit.xStart = xStart;
+	hit.xEnd = xEnd;
+	hit.position = position;
+	hitTests[hitTestNext] = hit;
+	hitTestNext = (hitTestNext + 1) % hitTestEntries;
+	return position;
+}
+
 /**
 * Find the document position corresponding to an x coordinate on a particular document line.
 * Ensure is between whole characters when document is in multi-byte or UTF-8 mode.
@@ -888,7 +1374,9 @@ void EditView::DrawEOL(Surface *surface, const EditModel &model, const ViewStyle
 			const SelectionSegment virtualSpaceRange(SelectionPosition(model.pdoc->LineEnd(line)),
 				SelectionPosition(model.pdoc->LineEnd(line),
 					model.sel.VirtualSpaceFor(model.pdoc->LineEnd(line))));
-			for (size_t r = 0; r<model.sel.Count(); r++) {
+			std::vector<size_t> rangesLine;
+			model.sel.RangesTouching(model.pdoc->LineEnd(line), model.pdoc->LineEnd(line), rangesLine);
+			for (const size_t r : rangesLine) {
 				const int alpha = (r == model.sel.Main()) ? vsDraw.selAlpha : vsDraw.selAdditionalAlpha;
 				if (alpha == SC_ALPHA_NOALPHA) {
 					const SelectionSegment portion = model.sel.Range(r).Intersect(virtualSpaceRange);
@@ -1328,8 +1816,14 @@ void EditView::DrawCarets(Surface *surface, const EditModel &model, const ViewSt
 	if (hideSelection && !drawDrag)
 		return;
 	const Sci::Position posLineStart = model.pdoc->LineStart(lineDoc);
+	// Only selections touching the line can have their caret drawn on it
+	std::vector<size_t> rangesLine;
+	if (drawDrag)
+		rangesLine.push_back(0);
+	else
+		model.sel.RangesTouching(posLineStart, posLineStart + ll->numCharsInLine, rangesLine);
 	// For each selection draw
-	for (size_t r = 0; (r<model.sel.Count()) || drawDrag; r++) {
+	for (const size_t r : rangesLine) {
 		const bool mainCaret = r == model.sel.Main();
 		SelectionPosition posCaret = (drawDrag ? model.posDrag : model.sel.Range(r).caret);
 		if (vsDraw.caretStyle == CARETSTYLE_BLOCK && !drawDrag && posCaret > model.sel.Range(r).anchor) {
@@ -1571,7 +2065,9 @@ static void DrawTranslucentSelection(Surface *surface, const EditModel &model, c
 		const SelectionPosition posStart(posLineStart + lineRange.start);
 		const SelectionPosition posEnd(posLineStart + lineRange.end, virtualSpaces);
 		const SelectionSegment virtualSpaceRange(posStart, posEnd);
-		for (size_t r = 0; r < model.sel.Count(); r++) {
+		std::vector<size_t> rangesLine;
+		model.sel.RangesTouching(posStart.Position(), posEnd.Position(), rangesLine);
+		for (const size_t r : rangesLine) {
 			const int alpha = (r == model.sel.Main()) ? vsDraw.selAlpha : vsDraw.selAdditionalAlpha;
 			if (alpha != SC_ALPHA_NOALPHA) {
 				const SelectionSegment portion = model.sel.Range(r).Intersect(virtualSpaceRange);
@@ -2063,7 +2559,16 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, PRectan
 				if (lineDoc != lineDocPrevious) {
 					ll.Set(nullptr);
 					ll.Set(RetrieveLineLayout(lineDoc, model));
+					const int linesMeasuredBefore = linesMeasured;
 					LayoutLine(model, lineDoc, surface, vsDraw, ll, model.wrapWidth);
+					if (ll && (llc.GetPrefetchLines() > 0)) {
+						if (ll->prefetched) {
+							prefetchHits++;
+							ll->prefetched = false;
+						} else if (linesMeasured != linesMeasuredBefore) {
+							prefetchMisses++;
+						}
+					}
 					lineDocPrevious = lineDoc;
 				}
 #if defined(TIME_PAINTING)
@@ -2300,6 +2805,8 @@ Sci::Position EditView::FormatRange(bool draw, const Sci_RangeToFormat *pfr, Sur
 
 	// Ensure we are styled to where we are formatting.
 	model.pdoc->EnsureStyledTo(endPosPrint);
+	if (model.foldFlags)
+		model.pdoc->EnsureFoldedTo(endPosPrint);
 
 	const int xStart = vsPrint.fixedColumnWidth + pfr->rc.left;
 	int ypos = pfr->rc.top;
@@ -43,6 +43,28 @@ void DrawStyledText(Surface *surface, const ViewStyle &vs, int styleOffset, PRec
 typedef void (*DrawTabArrowFn)(Surface *surface, PRectangle rcTab, int ymid);
 
 class LineTabstops;
+class LineCellWidths;
+class LineWrapSignatures;
+
+/**
+* The result of hit testing a point which is also the result for any point on the same
+* display line with an x in [xStart, xEnd) while the layouts in the cache are unchanged.
+*/
+struct HitTestEntry {
+	const Document *pdoc;
+	int generation;
+	int styleClock;
+	int wrapWidth;
+	Sci::Line visibleLine;
+	Sci::Line lineDoc;
+	Sci::Line lineStartSet;
+	int options;
+	XYPOSITION xStart;
+	XYPOSITION xEnd;
+	SelectionPosition position;
+	HitTestEntry() noexcept;
+	bool SameLine(const HitTestEntry &other) const noexcept;
+};
 
 /**
 * EditView draws the main text area.
@@ -52,6 +74,13 @@ public:
 	PrintParameters printParameters;
 	std::unique_ptr<LineTabstops> ldTabstops;
 	int tabWidthMinimumPixels;
+	/** With elastic tabstops, the tabstops of lines containing tabs are set so that the cells
+	* ended by tabs line up in columns over each block of consecutive lines containing tabs. */
+	bool elasticTabstops;
+	std::unique_ptr<LineCellWidths> ldCellWidths;
+	/** Lines that are rewrapped with the same text and style metrics as when they were last
+	* wrapped keep their number of lines without being laid out. */
+	std::unique_ptr<LineWrapSignatures> ldWrapSignatures;
 
 	bool hideSelection;
 	bool drawOverstrikeCaret;
@@ -81,6 +110,18 @@ public:
 	LineLayoutCache llc;
 	PositionCache posCache;
 
+	/// Recent hit tests so that moving the mouse within a character does not lay out the line
+	enum { hitTestEntries = 8 };
+	HitTestEntry hitTests[hitTestEntries];
+	int hitTestNext;
+
+	/// Number of times LayoutLine has measured a line, so callers can tell if a layout was reused
+	int linesMeasured;
+	/** When lines are prefetched, drawn lines that were laid out ahead of scrolling are
+	* counted as hits and drawn lines that had to be measured while painting as misses. */
+	int prefetchHits;
+	int prefetchMisses;
+
 	int tabArrowHeight; // draw arrow heads this many pixels above/below line midpoint
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
 	 * DrawTabArrow function for drawing tab characters. Allow those platforms to
@@ -106,7 +147,30 @@ public:
 	bool ClearTabstops(Sci::Line line);
 	bool AddTabstop(Sci::Line line, int x);
 	int GetNextTabstop(Sci::Line line, int x) const;
+	bool SetElasticTabstops(bool elastic);
+	void InvalidateElasticTabstops(Sci::Line lineFirst, Sci::Line lineLast, bool linesChanged);
+	void ClearCellWidths();
+	bool MeasureCells(Surface *surface, const EditModel &model, const ViewStyle &vstyle, Sci::Line line);
+	bool CellsKeepAlignment(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+		Sci::Line line, int padding);
+	bool AlignedNeighbour(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+		Sci::Line line, int padding);
+	bool JoinGroup(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+		Sci::Line line, std::vector<std::vector<int>> &widthsBefore);
+	bool GroupFits(Sci::Line lineFirst, Sci::Line lineLast, Sci::Line lineAbove, Sci::Line lineBelow,
+		const std::vector<std::vector<int>> &widthsBefore, int padding) const;
+	void SetGroupTabstops(const EditModel &model, Sci::Line lineFirst, Sci::Line lineLast,
+		Sci::Line lineAbove, Sci::Line lineBelow, int padding, Range &changed);
+	Sci::Line AlignGroup(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+		Sci::Line line, int padding, Range &changed);
+	Range AlignElasticTabstops(Surface *surface, const EditModel &model, const ViewStyle &vstyle,
+		Sci::Line lineFirst, Sci::Line lineLast);
 	void LinesAddedOrRemoved(Sci::Line lineOfPos, Sci::Line linesAdded);
+	unsigned int WrapSignature(const EditModel &model, Sci::Line line, const ViewStyle &vstyle,
+		int generation, int width) const;
+	int WrappedLines(Sci::Line line, unsigned int signature) const;
+	void SetWrappedLines(Sci::Line line, unsigned int signature, int lines);
+	void ClearWrapSignatures();
 
 	void DropGraphics(bool freeObjects);
 	void AllocateGraphics(const ViewStyle &vsDraw);
@@ -121,6 +185,7 @@ public:
 	Range RangeDisplayLine(Surface *surface, const EditModel &model, Sci::Line lineVisible, const ViewStyle &vs);
 	SelectionPosition SPositionFromLocation(Surface *surface, const EditModel &model, PointDocument pt, bool canReturnInvalid,
 		bool charPosition, bool virtualSpace, const ViewStyle &vs);
+	SelectionPosition AddHitTest(HitTestEntry hit, XYPOSITION xStart, XYPOSITION xEnd, SelectionPosition position);
 	SelectionPosition SPositionFromLineX(Surface *surface, const EditModel &model, Sci::Line lineDoc, int x, const ViewStyle &vs);
 	Sci::Line DisplayFromPosition(Surface *surface, const EditModel &model, Sci::Position pos, const ViewStyle &vs);
 	Sci::Position StartEndDisplayLine(Surface *surface, const EditModel &model, Sci::Position pos, bool start, const ViewStyle &vs);
@@ -36,6 +36,7 @@
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
+#include "SparseVector.h"
 #include "ContractionState.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
@@ -55,6 +56,7 @@
 #include "MarginView.h"
 #include "EditView.h"
 #include "Editor.h"
+#include "ViewStateCache.h"
 #include "ElapsedPeriod.h"
 
 using namespace Scintilla;
@@ -96,6 +98,14 @@ Timer::Timer() :
 Idler::Idler() :
 		state(false), idlerID(0) {}
 
+// Time in seconds used to measure scrolling speed.
+static double SecondsNow() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Scrolling has paused when there has been no scroll for this long.
+static constexpr double secondsScrollPause = 1.0;
+
 static inline bool IsAllSpacesOrTabs(const char *s, unsigned int len) {
 	for (unsigned int i = 0; i < len; i++) {
 		// This is safe because IsSpaceOrTab() will return false for null terminators
@@ -192,6 +202,13 @@ Editor::Editor() : durationWrapOneLine(0.00001, 0.000001, 0.0001) {
 
 	convertPastes = true;
 
+	wrapGeneration = 0;
+	viewStates.reset(new ViewStateCache());
+
+	hoverLine = -1;
+	hoverLineIndicator = false;
+	hoverLineHotspot = false;
+
 	SetRepresentations();
 }
 
@@ -276,14 +293,27 @@ void Editor::InvalidateStyleData() {
 	AllocateGraphics();
 	view.llc.Invalidate(LineLayout::llInvalid);
 	view.posCache.Clear();
+	view.ClearCellWidths();
+	hoverLine = -1;
 }
 
 void Editor::InvalidateStyleRedraw() {
+	wrapGeneration++;
 	NeedWrapping();
 	InvalidateStyleData();
 	Redraw();
 }
 
+// Only the colours or decorations of styles changed so text is measured and wrapped as
+// before and the layouts of lines remain valid.
+void Editor::InvalidateStyleAppearance() {
+	stylesValid = false;
+	DropGraphics(false);
+	AllocateGraphics();
+	hoverLine = -1;
+	Redraw();
+}
+
 void Editor::RefreshStyleData() {
 	if (!stylesValid) {
 		stylesValid = true;
@@ -945,6 +975,7 @@ void Editor::SetLastXChosen() {
 void Editor::ScrollTo(Sci::Line line, bool moveThumb) {
 	const Sci::Line topLineNew = Sci::clamp(line, static_cast<Sci::Line>(0), MaxScrollPos());
 	if (topLineNew != topLine) {
+		const Sci::Line linesScrolled = topLineNew - topLine;
 		// Try to optimise small scrolls
 #ifndef UNDER_CE
 		const Sci::Line linesToMove = topLine - topLineNew;
@@ -955,6 +986,7 @@ void Editor::ScrollTo(Sci::Line line, bool moveThumb) {
 		// Optimize by styling the view as this will invalidate any needed area
 		// which could abort the initial paint if discovered later.
 		StyleAreaBounded(GetClientRectangle(), true);
+		PrefetchForScroll(linesScrolled);
 #ifndef UNDER_CE
 		// Perform redraw rather than scroll if many lines would be redrawn anyway.
 		if (performBlit) {
@@ -1448,8 +1480,21 @@ void Editor::InvalidateCaret() {
 	if (posDrag.IsValid()) {
 		InvalidateRange(posDrag.Position(), posDrag.Position() + 1);
 	} else {
-		for (size_t r=0; r<sel.Count(); r++) {
-			InvalidateRange(sel.Range(r).caret.Position(), sel.Range(r).caret.Position() + 1);
+		// Only lines on screen that contain carets are redrawn, once each
+		const Sci::Position posFirstVisible = pdoc->LineStart(pcs->DocFromDisplay(TopLineOfMain()));
+		const Sci::Position posLastVisible = pdoc->LineStart(pcs->DocFromDisplay(TopLineOfMain() + LinesOnScreen()) + 1);
+		// Read through a const reference so drawing can keep the selection index
+		const Selection &selCarets = sel;
+		Sci::Line lineInvalidated = -1;
+		for (size_t r=0; r<selCarets.Count(); r++) {
+			const Sci::Position posCaret = selCarets.Range(r).caret.Position();
+			if ((posCaret < posFirstVisible) || (posCaret > posLastVisible))
+				continue;
+			const Sci::Line lineCaret = pdoc->SciLineFromPosition(posCaret);
+			if (lineCaret != lineInvalidated) {
+				InvalidateRange(posCaret, posCaret + 1);
+				lineInvalidated = lineCaret;
+			}
 		}
 	}
 	UpdateSystemCaret();
@@ -1477,16 +1522,32 @@ void Editor::NeedWrapping(Sci::Line docLineStart, Sci::Line docLineEnd) {
 }
 
 bool Editor::WrapOneLine(Surface *surface, Sci::Line lineToWrap) {
-	AutoLineLayout ll(view.llc, view.RetrieveLineLayout(lineToWrap, *this));
-	int linesWrapped = 1;
-	if (ll) {
-		view.LayoutLine(*this, lineToWrap, surface, vs, ll, wrapWidth);
-		linesWrapped = ll->lines;
+	// A line restyled without changing how its text is measured wraps as it did before
+	const unsigned int signature = view.WrapSignature(*this, lineToWrap, vs, wrapGeneration, wrapWidth);
+	int linesWrapped = view.WrappedLines(lineToWrap, signature);
+	if (linesWrapped == 0) {
+		AutoLineLayout ll(view.llc, view.RetrieveLineLayout(lineToWrap, *this));
+		linesWrapped = 1;
+		if (ll) {
+			view.LayoutLine(*this, lineToWrap, surface, vs, ll, wrapWidth);
+			linesWrapped = ll->lines;
+			view.SetWrappedLines(lineToWrap, signature, linesWrapped);
+		}
 	}
 	return pcs->SetHeight(lineToWrap, linesWrapped +
 		(vs.annotationVisible ? pdoc->AnnotationLines(lineToWrap) : 0));
 }
 
+// Elastic tabstops are aligned before lines are laid out, like styling. Aligning can move
+// the tabstops of lines outside the range so those are rewrapped.
+Range Editor::AlignElasticTabstops(Surface *surface, Sci::Line lineFirst, Sci::Line lineLast) {
+	const Range changed = view.AlignElasticTabstops(surface, *this, vs, lineFirst, lineLast);
+	if (changed.Valid() && Wrapping()) {
+		NeedWrapping(pdoc->SciLineFromPosition(changed.start), pdoc->SciLineFromPosition(changed.end) + 1);
+	}
+	return changed;
+}
+
 // Perform  wrapping for a subset of the lines needing wrapping.
 // wsAll: wrap all lines which need wrapping in this single call
 // wsVisible: wrap currently visible lines
@@ -1498,9 +1559,12 @@ bool Editor::WrapLines(WrapScope ws) {
 	if (!Wrapping()) {
 		if (wrapWidth != LineLayout::wrapWidthInfinite) {
 			wrapWidth = LineLayout::wrapWidthInfinite;
-			for (Sci::Line lineDoc = 0; lineDoc < pdoc->LinesTotal(); lineDoc++) {
-				pcs->SetHeight(lineDoc, 1 +
-					(vs.annotationVisible ? pdoc->AnnotationLines(lineDoc) : 0));
+			view.ClearWrapSignatures();
+			pcs->ResetHeights();
+			if (vs.annotationVisible) {
+				for (Sci::Line lineDoc = pdoc->AnnotationNext(0); (lineDoc >= 0) && (lineDoc < pdoc->LinesTotal()); lineDoc = pdoc->AnnotationNext(lineDoc + 1)) {
+					pcs->SetHeight(lineDoc, 1 + pdoc->AnnotationLines(lineDoc));
+				}
 			}
 			wrapOccurred = true;
 		}
@@ -1559,6 +1623,7 @@ bool Editor::WrapLines(WrapScope ws) {
 			if (surface) {
 //Platform::DebugPrintf("Wraplines: scope=%0d need=%0d..%0d perform=%0d..%0d\n", ws, wrapPending.start, wrapPending.end, lineToWrap, lineToWrapEnd);
 
+				AlignElasticTabstops(surface, lineToWrap, lineToWrapEnd - 1);
 				const Sci::Line linesBeingWrapped = lineToWrapEnd - lineToWrap;
 				ElapsedPeriod epWrapping;
 				while (lineToWrap < lineToWrapEnd) {
@@ -1724,6 +1789,16 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 	paintAbandonedByStyling = false;
 
 	StyleAreaBounded(rcArea, false);
+	if (FoldLevelsNeeded()) {
+		pdoc->EnsureFoldedTo(std::min(PositionAfterArea(rcArea), pdoc->GetEndStyled()));
+	}
+	if (view.elasticTabstops) {
+		const Range changed = AlignElasticTabstops(surfaceWindow,
+			pcs->DocFromDisplay(topLine), pcs->DocFromDisplay(topLine + LinesOnScreen()));
+		if (changed.Valid()) {
+			CheckForChangeOutsidePaint(changed);
+		}
+	}
 
 	const PRectangle rcClient = GetClientRectangle();
 	//Platform::DebugPrintf("Client: (%3d,%3d) ... (%3d,%3d)   %d\n",
@@ -1854,6 +1929,7 @@ void Editor::ChangeSize() {
 		rcTextArea.left = static_cast<XYPOSITION>(vs.textStart);
 		rcTextArea.right -= vs.rightMarginWidth;
 		if (wrapWidth != rcTextArea.Width()) {
+			wrapGeneration++;
 			NeedWrapping();
 			Redraw();
 		}
@@ -2123,7 +2199,9 @@ void Editor::ClearDocumentStyle() {
 	pdoc->StartStyling(0, '\377');
 	pdoc->SetStyleFor(pdoc->Length(), 0);
 	pcs->ShowAll();
-	SetAnnotationHeights(0, pdoc->LinesTotal());
+	SetAnnotatedLineHeights();
+	if (Wrapping())
+		NeedWrapping();
 	pdoc->ClearLevels();
 }
 
@@ -2426,6 +2504,7 @@ bool Editor::NotifyMarginClick(Point pt, int modifiers) {
 			if (shift && ctrl) {
 				FoldAll(SC_FOLDACTION_TOGGLE);
 			} else {
+				pdoc->EnsureFoldedTo(pdoc->LineStart(lineClick + 1));
 				const int levelClick = pdoc->GetLevel(lineClick);
 				if (levelClick & SC_FOLDLEVELHEADERFLAG) {
 					if (shift) {
@@ -2542,6 +2621,7 @@ static inline Sci::Position MovePositionForDeletion(Sci::Position position, Sci:
 
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
 	ContainerNeedsUpdate(SC_UPDATE_CONTENT);
+	hoverLine = -1;
 	if (paintState == painting) {
 		CheckForChangeOutsidePaint(Range(mh.position, mh.position + mh.length));
 	}
@@ -2581,6 +2661,10 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		}
 		if (mh.modificationType & SC_MOD_CHANGESTYLE) {
 			view.llc.Invalidate(LineLayout::llCheckTextAndStyle);
+			if (view.elasticTabstops) {
+				view.InvalidateElasticTabstops(pdoc->SciLineFromPosition(mh.position),
+					pdoc->SciLineFromPosition(mh.position + mh.length), false);
+			}
 		}
 	} else {
 		// Move selection and brace highlights
@@ -2627,6 +2711,11 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			}
 			view.LinesAddedOrRemoved(lineOfPos, mh.linesAdded);
 		}
+		if (view.elasticTabstops && (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))) {
+			const Sci::Line lineOfPos = pdoc->SciLineFromPosition(mh.position);
+			view.InvalidateElasticTabstops(lineOfPos, lineOfPos + std::max(mh.linesAdded, static_cast<Sci::Line>(0)),
+				mh.linesAdded != 0);
+		}
 		if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
 			const Sci::Line lineDoc = pdoc->SciLineFromPosition(mh.position);
 			if (vs.annotationVisible) {
@@ -4146,6 +4235,16 @@ Sci::Position Editor::SearchInTarget(const char *text, Sci::Position length) {
 	}
 }
 
+Sci::Position Editor::SearchStyleInTarget(const char *styles, Sci::Position length) {
+	Sci::Position runEnd = targetEnd;
+	const Sci::Position pos = pdoc->FindStyleRun(targetStart, targetEnd, styles, length, &runEnd);
+	if (pos != -1) {
+		targetStart = pos;
+		targetEnd = runEnd;
+	}
+	return pos;
+}
+
 void Editor::GoToLine(Sci::Line lineNo) {
 	if (lineNo > pdoc->LinesTotal())
 		lineNo = pdoc->LinesTotal();
@@ -4666,12 +4765,58 @@ bool Editor::PositionIsHotspot(Sci::Position position) const {
 }
 
 bool Editor::PointIsHotspot(Point pt) {
+	if (!PointMayHover(pt, true))
+		return false;
 	const Sci::Position pos = PositionFromLocation(pt, true, true);
 	if (pos == INVALID_POSITION)
 		return false;
 	return PositionIsHotspot(pos);
 }
 
+// Find whether a line contains, or is followed by, a position with a dynamic indicator
+// or a hotspot.  May report a line that does not as long as it never misses one.
+void Editor::SummariseHoverLine(Sci::Line line) {
+	hoverLine = line;
+	const Sci::Position lineStart = pdoc->LineStart(line);
+	const Sci::Position lineEnd = pdoc->LineStart(line + 1);
+	hoverLineIndicator = false;
+	if (vs.indicatorsDynamic) {
+		for (const IDecoration *deco : pdoc->decorations->View()) {
+			if (vs.indicators[deco->Indicator()].IsDynamic()) {
+				if (deco->ValueAt(lineStart) || (deco->EndRun(lineStart) <= lineEnd)) {
+					hoverLineIndicator = true;
+					break;
+				}
+			}
+		}
+	}
+	std::string hotspotStyles;
+	for (size_t style = 0; style < vs.styles.size(); style++) {
+		if (vs.styles[style].hotspot)
+			hotspotStyles.push_back(static_cast<char>(style));
+	}
+	hoverLineHotspot = false;
+	if (!hotspotStyles.empty()) {
+		// Look for a run of any hotspot style in one pass over the styles of the line
+		Sci::Position runEnd = 0;
+		hoverLineHotspot = pdoc->FindStyleRun(lineStart, lineEnd + 1, hotspotStyles.c_str(),
+			hotspotStyles.length(), &runEnd) >= 0;
+	}
+}
+
+// Whether the point may be over a dynamic indicator or, if hotspot, over a hotspot.
+// Only looks at which line is under the point so does not lay out any text.
+bool Editor::PointMayHover(Point pt, bool hotspot) {
+	RefreshStyleData();
+	const PointDocument ptdoc = DocumentPointFromView(pt);
+	const Sci::Line lineDoc = pcs->DocFromDisplay(static_cast<Sci::Line>(floor(ptdoc.y / vs.lineHeight)));
+	if ((lineDoc < 0) || (lineDoc >= pdoc->LinesTotal()))
+		return false;
+	if (lineDoc != hoverLine)
+		SummariseHoverLine(lineDoc);
+	return hotspot ? hoverLineHotspot : hoverLineIndicator;
+}
+
 void Editor::SetHoverIndicatorPosition(Sci::Position position) {
 	const Sci::Position hoverIndicatorPosPrev = hoverIndicatorPos;
 	hoverIndicatorPos = INVALID_POSITION;
@@ -4692,7 +4837,7 @@ void Editor::SetHoverIndicatorPosition(Sci::Position position) {
 }
 
 void Editor::SetHoverIndicatorPoint(Point pt) {
-	if (!vs.indicatorsDynamic) {
+	if (!vs.indicatorsDynamic || !PointMayHover(pt, false)) {
 		SetHoverIndicatorPosition(INVALID_POSITION);
 	} else {
 		SetHoverIndicatorPosition(PositionFromLocation(pt, true, true));
@@ -4735,9 +4880,13 @@ void Editor::ButtonMoveWithModifiers(Point pt, unsigned int, int modifiers) {
 		DwellEnd(true);
 	}
 
-	SelectionPosition movePos = SPositionFromLocation(pt, false, false,
-		AllowVirtualSpace(virtualSpaceOptions, sel.IsRectangular()));
-	movePos = MovePositionOutsideChar(movePos, sel.MainCaret() - movePos.Position());
+	// Only dragging and selecting need the position so hovering does not lay out the line
+	SelectionPosition movePos;
+	if ((inDragDrop == ddInitial) || HaveMouseCapture()) {
+		movePos = SPositionFromLocation(pt, false, false,
+			AllowVirtualSpace(virtualSpaceOptions, sel.IsRectangular()));
+		movePos = MovePositionOutsideChar(movePos, sel.MainCaret() - movePos.Position());
+	}
 
 	if (inDragDrop == ddInitial) {
 		if (DragThreshold(ptMouseLast, pt)) {
@@ -4837,7 +4986,7 @@ void Editor::ButtonMoveWithModifiers(Point pt, unsigned int, int modifiers) {
 			}
 		}
 		// Display regular (drag) cursor over selection
-		if (PointInSelection(pt) && !SelectionEmpty()) {
+		if (!SelectionEmpty() && PointInSelection(pt)) {
 			DisplayCursor(Window::cursorArrow);
 		} else {
 			SetHoverIndicatorPoint(pt);
@@ -4953,6 +5102,8 @@ bool Editor::Idle() {
 		needWrap = wrapPending.NeedsWrap();
 	} else if (needIdleStyling) {
 		IdleStyling();
+	} else if (prefetch.Pending()) {
+		IdlePrefetch();
 	}
 
 	// Add more idle things to do here, but make sure idleDone is
@@ -4960,7 +5111,7 @@ bool Editor::Idle() {
 	// false will stop calling this idle function until SetIdle() is
 	// called again.
 
-	const bool idleDone = !needWrap && !needIdleStyling; // && thatDone && theOtherThingDone...
+	const bool idleDone = !needWrap && !needIdleStyling && !prefetch.Pending(); // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -5100,6 +5251,18 @@ void Editor::StyleAreaBounded(PRectangle rcArea, bool scrolling) {
 	StartIdleStyling(posAfterMax < posAfterArea);
 }
 
+// Fold levels are calculated on demand so only fold the painted area when
+// something drawn depends on the levels.
+bool Editor::FoldLevelsNeeded() const {
+	if (foldFlags || pcs->HiddenLines())
+		return true;
+	for (const MarginStyle &m : vs.ms) {
+		if ((m.width > 0) && (m.mask & SC_MASK_FOLDERS))
+			return true;
+	}
+	return false;
+}
+
 void Editor::IdleStyling() {
 	const Sci::Position posAfterArea = PositionAfterArea(GetClientRectangle());
 	const Sci::Position endGoal = (idleStyling >= SC_IDLESTYLING_AFTERVISIBLE) ?
@@ -5111,6 +5274,106 @@ void Editor::IdleStyling() {
 	}
 }
 
+// Track the direction and speed of scrolling and choose the lines to be laid out ahead of it.
+// Lines already prefetched for the other direction are abandoned.
+void Editor::PrefetchForScroll(Sci::Line linesMoved) {
+	if ((prefetch.pages <= 0) || (linesMoved == 0))
+		return;
+	const double timeNow = SecondsNow();
+	const double secondsSinceScroll = timeNow - prefetch.timeScrolled;
+	const int direction = (linesMoved > 0) ? 1 : -1;
+	const double linesPerSecond = std::abs(linesMoved) / std::max(secondsSinceScroll, 0.001);
+	if ((direction != prefetch.direction) || (secondsSinceScroll > secondsScrollPause)) {
+		prefetch.Cancel();
+		prefetch.linesPerSecond = linesPerSecond;
+	} else {
+		prefetch.linesPerSecond = (prefetch.linesPerSecond + linesPerSecond) / 2.0;
+	}
+	prefetch.direction = direction;
+	prefetch.timeScrolled = timeNow;
+
+	// Look ahead by about a second of scrolling at the current speed but at least a page
+	const Sci::Line linesPage = LinesOnScreen();
+	const Sci::Line linesAhead = Sci::clamp(static_cast<Sci::Line>(prefetch.linesPerSecond),
+		linesPage, linesPage * prefetch.pages);
+	view.llc.SetPrefetchLines(linesPage * prefetch.pages);
+	if (direction > 0) {
+		prefetch.next = topLine + linesPage;
+		prefetch.end = std::max(prefetch.next, std::min(prefetch.next + linesAhead, pcs->LinesDisplayed()));
+	} else {
+		prefetch.next = topLine - 1;
+		prefetch.end = std::max(prefetch.next - linesAhead, static_cast<Sci::Line>(-1));
+	}
+	if (prefetch.Pending()) {
+		SetIdle(true);
+	}
+}
+
+// Style and lay out the lines ahead of scrolling into the layout cache so they are ready
+// when scrolled into view. Each call is limited to a short time slice.
+// Lines not yet reached when scrolling pauses are abandoned.
+void Editor::IdlePrefetch() {
+	if ((SecondsNow() - prefetch.timeScrolled) > secondsScrollPause) {
+		prefetch.Cancel();
+		return;
+	}
+	const double secondsAllowed = 0.005;
+	ElapsedPeriod epPrefetch;
+	RefreshStyleData();
+	AutoSurface surface(this);
+	if (!surface) {
+		prefetch.Cancel();
+		return;
+	}
+	const Sci::Line linesDisplayed = pcs->LinesDisplayed();
+	const Sci::Line linesPage = LinesOnScreen() + 1;
+	while (prefetch.Pending() && (epPrefetch.Duration() < secondsAllowed)) {
+		if ((prefetch.next < 0) || (prefetch.next >= linesDisplayed)) {
+			// The document has shrunk since scrolling
+			prefetch.Cancel();
+			break;
+		}
+		// Style a page at a time as each styling call invalidates the cached layouts
+		const Sci::Line pageEnd = (prefetch.direction > 0) ?
+			std::min(prefetch.next + linesPage, prefetch.end) :
+			std::max(prefetch.next - linesPage, prefetch.end);
+		const Sci::Line lineDocFirst = pcs->DocFromDisplay(std::min(prefetch.next, pageEnd + 1));
+		const Sci::Line lineDocLast = pcs->DocFromDisplay(std::max(prefetch.next, pageEnd - 1));
+		pdoc->EnsureStyledTo(pdoc->LineStart(lineDocLast + 1));
+		if (view.elasticTabstops) {
+			const Range changed = AlignElasticTabstops(surface, lineDocFirst, lineDocLast);
+			if (changed.Valid()) {
+				InvalidateRange(changed.start, changed.end);
+			}
+		}
+		while (((prefetch.direction > 0) ? (prefetch.next < pageEnd) : (prefetch.next > pageEnd)) &&
+			(epPrefetch.Duration() < secondsAllowed)) {
+			const Sci::Line lineDoc = pcs->DocFromDisplay(prefetch.next);
+			AutoLineLayout ll(view.llc, view.RetrieveLineLayout(lineDoc, *this));
+			const int linesMeasuredBefore = view.linesMeasured;
+			view.LayoutLine(*this, lineDoc, surface, vs, ll, wrapWidth);
+			if (ll && (view.linesMeasured != linesMeasuredBefore)) {
+				ll->prefetched = true;
+			}
+			// Move past all the display lines of a wrapped line
+			prefetch.next = (prefetch.direction > 0) ?
+				pcs->DisplayLastFromDoc(lineDoc) + 1 : pcs->DisplayFromDoc(lineDoc) - 1;
+		}
+		if ((prefetch.direction > 0) ? (prefetch.next >= prefetch.end) : (prefetch.next <= prefetch.end)) {
+			prefetch.Cancel();
+		}
+	}
+}
+
+void Editor::SetLayoutPrefetch(int pages) {
+	prefetch.pages = std::max(pages, 0);
+	prefetch.direction = 0;
+	prefetch.Cancel();
+	view.llc.SetPrefetchLines(prefetch.pages * LinesOnScreen());
+	view.prefetchHits = 0;
+	view.prefetchMisses = 0;
+}
+
 void Editor::IdleWork() {
 	// Style the line after the modification as this allows modifications that change just the
 	// line of the modification to heal instead of propagating to the rest of the window.
@@ -5185,21 +5448,41 @@ void Editor::SetBraceHighlight(Sci::Position pos0, Sci::Position pos1, int match
 	}
 }
 
+bool Editor::SetAnnotationHeight(Sci::Line line) {
+	int linesWrapped = 1;
+	if (Wrapping()) {
+		AutoSurface surface(this);
+		AutoLineLayout ll(view.llc, view.RetrieveLineLayout(line, *this));
+		if (surface && ll) {
+			view.LayoutLine(*this, line, surface, vs, ll, wrapWidth);
+			linesWrapped = ll->lines;
+		}
+	}
+	return pcs->SetHeight(line, pdoc->AnnotationLines(line) + linesWrapped);
+}
+
 void Editor::SetAnnotationHeights(Sci::Line start, Sci::Line end) {
 	if (vs.annotationVisible) {
 		RefreshStyleData();
 		bool changedHeight = false;
 		for (Sci::Line line=start; line<end && line<pdoc->LinesTotal(); line++) {
-			int linesWrapped = 1;
-			if (Wrapping()) {
-				AutoSurface surface(this);
-				AutoLineLayout ll(view.llc, view.RetrieveLineLayout(line, *this));
-				if (surface && ll) {
-					view.LayoutLine(*this, line, surface, vs, ll, wrapWidth);
-					linesWrapped = ll->lines;
-				}
-			}
-			if (pcs->SetHeight(line, pdoc->AnnotationLines(line) + linesWrapped))
+			if (SetAnnotationHeight(line))
+				changedHeight = true;
+		}
+		if (changedHeight) {
+			Redraw();
+		}
+	}
+}
+
+// Set the heights of just the lines with annotations, for when the heights of the other
+// lines are already correct or are about to be found again by wrapping.
+void Editor::SetAnnotatedLineHeights() {
+	if (vs.annotationVisible) {
+		RefreshStyleData();
+		bool changedHeight = false;
+		for (Sci::Line line = pdoc->AnnotationNext(0); (line >= 0) && (line < pdoc->LinesTotal()); line = pdoc->AnnotationNext(line + 1)) {
+			if (SetAnnotationHeight(line))
 				changedHeight = true;
 		}
 		if (changedHeight) {
@@ -5208,9 +5491,55 @@ void Editor::SetAnnotationHeights(Sci::Line start, Sci::Line end) {
 	}
 }
 
+// Keep the view of the current document so it can be restored if the document is
+// displayed again.  If the document is then destroyed, its state is dropped.
+void Editor::SaveViewState() {
+	if (viewStates->Size() == 0)
+		return;
+	std::unique_ptr<DocumentViewState> state(new DocumentViewState(pdoc));
+	state->pcs = std::move(pcs);
+	state->llc.Swap(view.llc);
+	state->sel = sel;
+	const Sci::Line lineDocTop = state->pcs->DocFromDisplay(topLine);
+	state->posTopLine = pdoc->LineStart(lineDocTop);
+	state->subLineTop = topLine - state->pcs->DisplayFromDoc(lineDocTop);
+	state->xOffset = xOffset;
+	state->wrapPending = wrapPending;
+	state->wrapGeneration = wrapGeneration;
+	state->annotationVisible = vs.annotationVisible;
+	viewStates->Add(std::move(state));
+}
+
+// Restore the view of a document, only finding the heights of the lines changed while
+// it was not displayed unless the way lines are laid out has changed since.
+void Editor::RestoreViewState(DocumentViewState &state) {
+	view.llc.Swap(state.llc);
+	sel = state.sel;
+	xOffset = state.xOffset;
+	wrapPending.Reset();
+	if ((state.wrapGeneration != wrapGeneration) || (state.annotationVisible != vs.annotationVisible)) {
+		view.llc.Invalidate(LineLayout::llInvalid);
+		pcs->ResetHeights();
+		SetAnnotatedLineHeights();
+		NeedWrapping();
+	} else {
+		if (state.wrapPending.NeedsWrap())
+			NeedWrapping(state.wrapPending.start, state.wrapPending.end);
+		if (state.linesChanged.NeedsWrap()) {
+			SetAnnotationHeights(state.linesChanged.start, state.linesChanged.end);
+			NeedWrapping(state.linesChanged.start, state.linesChanged.end);
+		}
+	}
+	const Sci::Line lineDocTop = pdoc->SciLineFromPosition(state.posTopLine);
+	const Sci::Line subLineTop = std::min(state.subLineTop, static_cast<Sci::Line>(pcs->GetHeight(lineDocTop) - 1));
+	SetTopLine(Sci::clamp(pcs->DisplayFromDoc(lineDocTop) + std::max(subLineTop, static_cast<Sci::Line>(0)),
+		static_cast<Sci::Line>(0), MaxScrollPos()));
+}
+
 void Editor::SetDocPointer(Document *document) {
 	//Platform::DebugPrintf("** %x setdoc to %x\n", pdoc, document);
 	pdoc->RemoveWatcher(this, 0);
+	SaveViewState();
 	pdoc->Release();
 	if (!document) {
 		pdoc = new Document(SC_DOCUMENTOPTION_DEFAULT);
@@ -5218,7 +5547,13 @@ void Editor::SetDocPointer(Document *document) {
 		pdoc = document;
 	}
 	pdoc->AddRef();
-	pcs = ContractionStateCreate(pdoc->IsLarge());
+	std::unique_ptr<DocumentViewState> state = viewStates->Take(pdoc);
+	if (state) {
+		pcs = std::move(state->pcs);
+	} else {
+		pcs = ContractionStateCreate(pdoc->IsLarge());
+	}
+	hoverLine = -1;
 
 	// Ensure all positions within document
 	sel.Clear();
@@ -5232,12 +5567,16 @@ void Editor::SetDocPointer(Document *document) {
 
 	SetRepresentations();
 
-	// Reset the contraction state to fully shown.
-	pcs->Clear();
-	pcs->InsertLines(0, pdoc->LinesTotal() - 1);
-	SetAnnotationHeights(0, pdoc->LinesTotal());
-	view.llc.Deallocate();
-	NeedWrapping();
+	if (state) {
+		RestoreViewState(*state);
+	} else {
+		// Reset the contraction state to fully shown.
+		pcs->Clear();
+		pcs->InsertLines(0, pdoc->LinesTotal() - 1);
+		SetAnnotatedLineHeights();
+		view.llc.Deallocate();
+		NeedWrapping();
+	}
 
 	hotspot = Range(Sci::invalidPosition);
 	hoverIndicatorPos = Sci::invalidPosition;
@@ -5255,7 +5594,7 @@ void Editor::SetAnnotationVisible(int visible) {
 		vs.annotationVisible = visible;
 		if (changedFromOrToHidden) {
 			const int dir = vs.annotationVisible ? 1 : -1;
-			for (Sci::Line line=0; line<pdoc->LinesTotal(); line++) {
+			for (Sci::Line line = pdoc->AnnotationNext(0); (line >= 0) && (line < pdoc->LinesTotal()); line = pdoc->AnnotationNext(line + 1)) {
 				const int annotationLines = pdoc->AnnotationLines(line);
 				if (annotationLines > 0) {
 					pcs->SetHeight(line, pcs->GetHeight(line) + annotationLines * dir);
@@ -5296,6 +5635,7 @@ void Editor::SetFoldExpanded(Sci::Line lineDoc, bool expanded) {
 
 void Editor::FoldLine(Sci::Line line, int action) {
 	if (line >= 0) {
+		pdoc->EnsureFoldedTo(pdoc->LineStart(line + 1));
 		if (action == SC_FOLDACTION_TOGGLE) {
 			if ((pdoc->GetLevel(line) & SC_FOLDLEVELHEADERFLAG) == 0) {
 				line = pdoc->GetFoldParent(line);
@@ -5346,6 +5686,7 @@ void Editor::FoldExpand(Sci::Line line, int action, int level) {
 		// Nothing to do
 		return;
 	const Sci::Line lineMaxSubord = pdoc->GetLastChild(line, LevelNumber(level));
+	pdoc->EnsureFoldedTo(pdoc->LineStart(lineMaxSubord + 1));
 	line++;
 	pcs->SetVisible(line, lineMaxSubord, expanding);
 	while (line <= lineMaxSubord) {
@@ -5361,8 +5702,11 @@ void Editor::FoldExpand(Sci::Line line, int action, int level) {
 
 Sci::Line Editor::ContractedFoldNext(Sci::Line lineStart) const {
 	for (Sci::Line line = lineStart; line<pdoc->LinesTotal();) {
-		if (!pcs->GetExpanded(line) && (pdoc->GetLevel(line) & SC_FOLDLEVELHEADERFLAG))
-			return line;
+		if (!pcs->GetExpanded(line)) {
+			pdoc->EnsureFoldedTo(pdoc->LineStart(line + 1));
+			if (pdoc->GetLevel(line) & SC_FOLDLEVELHEADERFLAG)
+				return line;
+		}
 		line = pcs->ContractedNext(line+1);
 		if (line < 0)
 			return -1;
@@ -5385,6 +5729,7 @@ void Editor::EnsureLineVisible(Sci::Line lineDoc, bool enforcePolicy) {
 	}
 
 	if (!pcs->GetVisible(lineDoc)) {
+		pdoc->EnsureFoldedTo(pdoc->LineStart(lineDoc + 1));
 		// Back up to find a non-blank line
 		Sci::Line lookLine = lineDoc;
 		int lookLineLevel = pdoc->GetLevel(lookLine);
@@ -5431,7 +5776,7 @@ void Editor::EnsureLineVisible(Sci::Line lineDoc, bool enforcePolicy) {
 }
 
 void Editor::FoldAll(int action) {
-	pdoc->EnsureStyledTo(pdoc->Length());
+	pdoc->EnsureFoldedTo(pdoc->Length());
 	const Sci::Line maxLine = pdoc->LinesTotal();
 	bool expanding = action == SC_FOLDACTION_EXPAND;
 	if (action == SC_FOLDACTION_TOGGLE) {
@@ -5612,6 +5957,7 @@ bool Editor::ValidMargin(uptr_t wParam) const {
 
 void Editor::StyleSetMessage(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	vs.EnsureStyle(wParam);
+	const Style styleBefore(vs.styles[wParam]);
 	switch (iMessage) {
 	case SCI_STYLESETFORE:
 		vs.styles[wParam].fore = ColourDesired(static_cast<int>(lParam));
@@ -5662,7 +6008,10 @@ void Editor::StyleSetMessage(unsigned int iMessage, uptr_t wParam, sptr_t lParam
 		vs.styles[wParam].hotspot = lParam != 0;
 		break;
 	}
-	InvalidateStyleRedraw();
+	if (vs.styles[wParam].SameMetrics(styleBefore))
+		InvalidateStyleAppearance();
+	else
+		InvalidateStyleRedraw();
 }
 
 sptr_t Editor::StyleGetMessage(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
@@ -6014,6 +6363,18 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETSEARCHFLAGS:
 		return searchFlags;
 
+	case SCI_SEARCHSTYLEINTARGET:
+		PLATFORM_ASSERT(lParam);
+		return SearchStyleInTarget(CharPtrFromSPtr(lParam), static_cast<Sci::Position>(wParam));
+
+	case SCI_ALLOCATESTYLEINDEX:
+		pdoc->AllocateStyleIndex();
+		break;
+
+	case SCI_RELEASESTYLEINDEX:
+		pdoc->ReleaseStyleIndex();
+		break;
+
 	case SCI_GETTAG:
 		return GetTag(CharPtrFromSPtr(lParam), static_cast<int>(wParam));
 
@@ -6353,6 +6714,49 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->DeleteMarkFromHandle(static_cast<int>(wParam));
 		break;
 
+	case SCI_POSITIONANCHORADD:
+		return pdoc->AddPositionAnchor(static_cast<Sci::Position>(wParam), static_cast<int>(lParam));
+
+	case SCI_POSITIONANCHORDELETE:
+		pdoc->DeletePositionAnchor(static_cast<int>(wParam));
+		break;
+
+	case SCI_POSITIONANCHORDELETEAT:
+		pdoc->DeletePositionAnchorAt(static_cast<Sci::Position>(wParam));
+		break;
+
+	case SCI_POSITIONANCHORDELETEALL:
+		pdoc->DeleteAllPositionAnchors();
+		break;
+
+	case SCI_POSITIONANCHORPOSITION:
+		return pdoc->PositionAnchorPosition(static_cast<int>(wParam));
+
+	case SCI_POSITIONANCHORCOUNT:
+		return pdoc->PositionAnchorCount();
+
+	case SCI_POSITIONANCHORINDEXFROMPOSITION:
+		return pdoc->PositionAnchorIndexFromPosition(static_cast<Sci::Position>(wParam));
+
+	case SCI_POSITIONANCHORHANDLEAT:
+		return pdoc->PositionAnchorHandleAt(static_cast<Sci::Position>(wParam));
+
+	case SCI_POSITIONANCHORPOSITIONAT:
+		return pdoc->PositionAnchorPositionAt(static_cast<Sci::Position>(wParam));
+
+	case SCI_POSITIONANCHORGRAVITYAT:
+		return pdoc->PositionAnchorGravityAt(static_cast<Sci::Position>(wParam));
+
+	case SCI_POSITIONANCHORPOSITIONS:
+		PLATFORM_ASSERT(lParam || !wParam);
+		pdoc->PositionAnchorPositions(static_cast<Sci::Position *>(PtrFromSPtr(lParam)), static_cast<Sci::Position>(wParam));
+		break;
+
+	case SCI_POSITIONANCHORDELETEHANDLES:
+		PLATFORM_ASSERT(lParam || !wParam);
+		pdoc->DeletePositionAnchors(static_cast<const Sci::Position *>(PtrFromSPtr(lParam)), static_cast<Sci::Position>(wParam));
+		break;
+
 	case SCI_GETVIEWWS:
 		return vs.viewWhitespace;
 
@@ -6433,7 +6837,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		if (pdoc->SetLineEndTypesAllowed(static_cast<int>(wParam))) {
 			pcs->Clear();
 			pcs->InsertLines(0, pdoc->LinesTotal() - 1);
-			SetAnnotationHeights(0, pdoc->LinesTotal());
+			SetAnnotatedLineHeights();
 			InvalidateStyleRedraw();
 		}
 		break;
@@ -6522,6 +6926,15 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETNEXTTABSTOP:
 		return view.GetNextTabstop(static_cast<Sci::Line>(wParam), static_cast<int>(lParam));
 
+	case SCI_SETELASTICTABSTOPS:
+		if (view.SetElasticTabstops(wParam != 0)) {
+			InvalidateStyleRedraw();
+		}
+		break;
+
+	case SCI_GETELASTICTABSTOPS:
+		return view.elasticTabstops;
+
 	case SCI_SETINDENT:
 		pdoc->indentInChars = static_cast<int>(wParam);
 		if (pdoc->indentInChars != 0)
@@ -6648,6 +7061,19 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETLAYOUTCACHE:
 		return view.llc.GetLevel();
 
+	case SCI_SETLAYOUTPREFETCH:
+		SetLayoutPrefetch(static_cast<int>(wParam));
+		break;
+
+	case SCI_GETLAYOUTPREFETCH:
+		return prefetch.pages;
+
+	case SCI_GETLAYOUTPREFETCHHITS:
+		return view.prefetchHits;
+
+	case SCI_GETLAYOUTPREFETCHMISSES:
+		return view.prefetchMisses;
+
 	case SCI_SETPOSITIONCACHE:
 		view.posCache.SetSize(wParam);
 		break;
@@ -6772,7 +7198,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 			if (pdoc->SetDBCSCodePage(static_cast<int>(wParam))) {
 				pcs->Clear();
 				pcs->InsertLines(0, pdoc->LinesTotal() - 1);
-				SetAnnotationHeights(0, pdoc->LinesTotal());
+				SetAnnotatedLineHeights();
 				InvalidateStyleRedraw();
 				SetRepresentations();
 			}
@@ -7112,6 +7538,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		}
 
 	case SCI_GETFOLDLEVEL:
+		pdoc->EnsureFoldedTo(pdoc->LineStart(static_cast<Sci::Line>(wParam) + 1));
 		return pdoc->GetLevel(static_cast<Sci::Line>(wParam));
 
 	case SCI_GETLASTCHILD:
@@ -7177,6 +7604,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		break;
 
 	case SCI_FOLDCHILDREN:
+		pdoc->EnsureFoldedTo(pdoc->LineStart(static_cast<Sci::Line>(wParam) + 1));
 		FoldExpand(static_cast<Sci::Line>(wParam), static_cast<int>(lParam), pdoc->GetLevel(static_cast<int>(wParam)));
 		break;
 
@@ -7185,6 +7613,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		break;
 
 	case SCI_EXPANDCHILDREN:
+		pdoc->EnsureFoldedTo(pdoc->LineStart(static_cast<Sci::Line>(wParam) + 1));
 		FoldExpand(static_cast<Sci::Line>(wParam), SC_FOLDACTION_EXPAND, static_cast<int>(lParam));
 		break;
 
@@ -7617,6 +8046,13 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		SetDocPointer(static_cast<Document *>(PtrFromSPtr(lParam)));
 		return 0;
 
+	case SCI_SETVIEWSTATECACHESIZE:
+		viewStates->SetSize(wParam);
+		return 0;
+
+	case SCI_GETVIEWSTATECACHESIZE:
+		return static_cast<sptr_t>(viewStates->Size());
+
 	case SCI_CREATEDOCUMENT: {
 			Document *doc = new Document(static_cast<int>(lParam));
 			doc->AddRef();
@@ -7784,6 +8220,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 
 	case SCI_SETREPRESENTATION:
 		reprs.SetRepresentation(ConstCharPtrFromUPtr(wParam), ConstCharPtrFromSPtr(lParam));
+		view.ClearWrapSignatures();
 		break;
 
 	case SCI_GETREPRESENTATION: {
@@ -7797,6 +8234,7 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 
 	case SCI_CLEARREPRESENTATION:
 		reprs.ClearRepresentation(ConstCharPtrFromUPtr(wParam));
+		view.ClearWrapSignatures();
 		break;
 
 	case SCI_STARTRECORD:
@@ -7992,6 +8430,32 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->AddUndoAction(static_cast<Sci::Position>(wParam), lParam & UNDO_MAY_COALESCE);
 		break;
 
+	case SCI_GETEDITVERSION:
+		return pdoc->EditVersion();
+
+	case SCI_ALLOCATEEDITJOURNAL:
+		pdoc->AllocateEditJournal();
+		break;
+
+	case SCI_RELEASEEDITJOURNAL:
+		pdoc->ReleaseEditJournal();
+		break;
+
+	case SCI_EXPORTEDITS: {
+			std::string delta;
+			if (!pdoc->ExportEdits(static_cast<Sci::Position>(wParam), pdoc->EditVersion(), delta))
+				return 0;
+			return BytesResult(lParam, reinterpret_cast<const unsigned char *>(delta.c_str()), delta.length());
+		}
+
+	case SCI_IMPORTEDITS:
+		PLATFORM_ASSERT(lParam);
+		return pdoc->ImportEdits(CharPtrFromSPtr(lParam), static_cast<Sci::Position>(wParam));
+
+	case SCI_DISCARDEDITS:
+		pdoc->DiscardEdits(static_cast<Sci::Position>(wParam));
+		break;
+
 	case SCI_SETMOUSESELECTIONRECTANGULARSWITCH:
 		mouseSelectionRectangularSwitch = wParam != 0;
 		break;
@@ -8226,6 +8690,30 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_COUNTCODEUNITS:
 		return pdoc->CountUTF16(static_cast<Sci::Position>(wParam), lParam);
 
+	case SCI_ALLOCATETEXTSTATISTICS:
+		pdoc->AllocateStatistics();
+		break;
+
+	case SCI_RELEASETEXTSTATISTICS:
+		pdoc->ReleaseStatistics();
+		break;
+
+	case SCI_COUNTWORDS:
+		return pdoc->CountWords(static_cast<Sci::Position>(wParam), lParam);
+
+	case SCI_COUNTNONBLANKLINES:
+		return pdoc->CountNonBlankLines(static_cast<Sci::Position>(wParam), lParam);
+
+	case SCI_POSITIONSFROMCODEUNITS:
+		PLATFORM_ASSERT(lParam || !wParam);
+		pdoc->PositionsFromUTF16(static_cast<Sci::Position *>(PtrFromSPtr(lParam)), static_cast<Sci::Position>(wParam));
+		break;
+
+	case SCI_CODEUNITSFROMPOSITIONS:
+		PLATFORM_ASSERT(lParam || !wParam);
+		pdoc->UTF16FromPositions(static_cast<Sci::Position *>(PtrFromSPtr(lParam)), static_cast<Sci::Position>(wParam));
+		break;
+
 	default:
 		return DefWndProc(iMessage, wParam, lParam);
 	}
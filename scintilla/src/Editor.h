@@ -10,6 +10,9 @@
 
 namespace Scintilla {
 
+class DocumentViewState;
+class ViewStateCache;
+
 /**
  */
 class Timer {
@@ -143,6 +146,30 @@ struct WrapPending {
 	}
 };
 
+struct ScrollPrefetch {
+	// The display lines ahead of scrolling to style and lay out during idle time
+	int pages;	// How far ahead to prefetch in pages, 0 when not prefetching
+	int direction;	// 1 when scrolling down, -1 when scrolling up, 0 before scrolling
+	double linesPerSecond;	// Smoothed speed of recent scrolling
+	double timeScrolled;	// When the last scroll happened
+	Sci::Line next;	// Next display line to lay out
+	Sci::Line end;	// Display line to stop at, reached by moving in direction from next
+	ScrollPrefetch() {
+		pages = 0;
+		direction = 0;
+		linesPerSecond = 0.0;
+		timeScrolled = 0.0;
+		next = 0;
+		end = 0;
+	}
+	void Cancel() {
+		next = end;
+	}
+	bool Pending() const {
+		return (pages > 0) && (next != end);
+	}
+};
+
 /**
  */
 class Editor : public EditModel, public DocWatcher {
@@ -251,6 +278,19 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	// Wrapping support
 	WrapPending wrapPending;
 	ActionDuration durationWrapOneLine;
+	// Incremented when the wrapping of every line must be found again.
+	int wrapGeneration;
+
+	// The views of documents that have been replaced by SetDocPointer
+	std::unique_ptr<ViewStateCache> viewStates;
+
+	// Whether the line last hovered over may contain a dynamic indicator or a hotspot
+	// so that moving the mouse over other text does not need to find a position.
+	Sci::Line hoverLine;
+	bool hoverLineIndicator;
+	bool hoverLineHotspot;
+
+	ScrollPrefetch prefetch;
 
 	bool convertPastes;
 
@@ -266,6 +306,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	void InvalidateStyleData();
 	void InvalidateStyleRedraw();
+	void InvalidateStyleAppearance();
 	void RefreshStyleData();
 	void SetRepresentations();
 	void DropGraphics(bool freeObjects);
@@ -371,6 +412,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool Wrapping() const;
 	void NeedWrapping(Sci::Line docLineStart=0, Sci::Line docLineEnd=WrapPending::lineLarge);
 	bool WrapOneLine(Surface *surface, Sci::Line lineToWrap);
+	Range AlignElasticTabstops(Surface *surface, Sci::Line lineFirst, Sci::Line lineLast);
 	enum class WrapScope {wsAll, wsVisible, wsIdle};
 	bool WrapLines(WrapScope ws);
 	void LinesJoin();
@@ -478,6 +520,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void SearchAnchor();
 	Sci::Position SearchText(unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 	Sci::Position SearchInTarget(const char *text, Sci::Position length);
+	Sci::Position SearchStyleInTarget(const char *styles, Sci::Position length);
 	void GoToLine(Sci::Line lineNo);
 
 	virtual void CopyToClipboard(const SelectionText &selectedText) = 0;
@@ -522,7 +565,11 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Position PositionAfterMaxStyling(Sci::Position posMax, bool scrolling) const;
 	void StartIdleStyling(bool truncatedLastStyling);
 	void StyleAreaBounded(PRectangle rcArea, bool scrolling);
+	bool FoldLevelsNeeded() const;
 	void IdleStyling();
+	void PrefetchForScroll(Sci::Line linesMoved);
+	void IdlePrefetch();
+	void SetLayoutPrefetch(int pages);
 	virtual void IdleWork();
 	virtual void QueueIdleWork(WorkNeeded::workItems items, Sci::Position upTo=0);
 
@@ -531,7 +578,11 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void CheckForChangeOutsidePaint(Range r);
 	void SetBraceHighlight(Sci::Position pos0, Sci::Position pos1, int matchStyle);
 
+	bool SetAnnotationHeight(Sci::Line line);
 	void SetAnnotationHeights(Sci::Line start, Sci::Line end);
+	void SetAnnotatedLineHeights();
+	void SaveViewState();
+	void RestoreViewState(DocumentViewState &state);
 	virtual void SetDocPointer(Document *document);
 
 	void SetAnnotationVisible(int visible);
@@ -551,6 +602,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	bool PositionIsHotspot(Sci::Position position) const;
 	bool PointIsHotspot(Point pt);
+	void SummariseHoverLine(Sci::Line line);
+	bool PointMayHover(Point pt, bool hotspot);
 	void SetHotSpotRange(const Point *pt);
 	Range GetHotSpotRange() const override;
 	void SetHoverIndicatorPosition(Sci::Position position);
@@ -21,6 +21,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "SparseVector.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
 
@@ -317,44 +318,49 @@ void LineAnnotation::Init() {
 	ClearAll();
 }
 
+void LineAnnotation::EnsureLength(Sci::Line lines) {
+	if (annotations.Length() < lines) {
+		annotations.InsertSpace(annotations.Length(), lines - annotations.Length());
+	}
+}
+
 void LineAnnotation::InsertLine(Sci::Line line) {
 	if (annotations.Length()) {
-		annotations.EnsureLength(line);
-		annotations.Insert(line, std::unique_ptr<char []>());
+		EnsureLength(line);
+		annotations.InsertSpace(line, 1);
 	}
 }
 
 void LineAnnotation::RemoveLine(Sci::Line line) {
 	if (annotations.Length() && (line > 0) && (line <= annotations.Length())) {
-		annotations[line-1].reset();
-		annotations.Delete(line-1);
+		annotations.DeletePosition(line-1);
 	}
 }
 
 bool LineAnnotation::MultipleStyles(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line].get())->style == IndividualStyles;
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line))
+		return reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get())->style == IndividualStyles;
 	else
 		return false;
 }
 
 int LineAnnotation::Style(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line].get())->style;
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line))
+		return reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get())->style;
 	else
 		return 0;
 }
 
 const char *LineAnnotation::Text(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return annotations[line].get()+sizeof(AnnotationHeader);
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line))
+		return annotations.ValueAt(line).get()+sizeof(AnnotationHeader);
 	else
 		return nullptr;
 }
 
 const unsigned char *LineAnnotation::Styles(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line] && MultipleStyles(line))
-		return reinterpret_cast<unsigned char *>(annotations[line].get() + sizeof(AnnotationHeader) + Length(line));
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line) && MultipleStyles(line))
+		return reinterpret_cast<unsigned char *>(annotations.ValueAt(line).get() + sizeof(AnnotationHeader) + Length(line));
 	else
 		return nullptr;
 }
@@ -367,19 +373,20 @@ static char *AllocateAnnotation(int length, int style) {
 
 void LineAnnotation::SetText(Sci::Line line, const char *text) {
 	if (text && (line >= 0)) {
-		annotations.EnsureLength(line+1);
+		EnsureLength(line+1);
 		const int style = Style(line);
-		annotations[line].reset(AllocateAnnotation(static_cast<int>(strlen(text)), style));
-		char *pa = annotations[line].get();
+		std::unique_ptr<char []> annotation(AllocateAnnotation(static_cast<int>(strlen(text)), style));
+		char *pa = annotation.get();
 		assert(pa);
 		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(pa);
 		pah->style = static_cast<short>(style);
 		pah->length = static_cast<int>(strlen(text));
 		pah->lines = static_cast<short>(NumberLines(text));
 		memcpy(pa+sizeof(AnnotationHeader), text, pah->length);
+		annotations.SetValueAt(line, std::move(annotation));
 	} else {
-		if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line]) {
-			annotations[line].reset();
+		if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line)) {
+			annotations.SetValueAt(line, std::unique_ptr<char []>());
 		}
 	}
 }
@@ -389,49 +396,63 @@ void LineAnnotation::ClearAll() {
 }
 
 void LineAnnotation::SetStyle(Sci::Line line, int style) {
-	annotations.EnsureLength(line+1);
-	if (!annotations[line]) {
-		annotations[line].reset(AllocateAnnotation(0, style));
+	EnsureLength(line+1);
+	if (!annotations.ValueAt(line)) {
+		annotations.SetValueAt(line, std::unique_ptr<char []>(AllocateAnnotation(0, style)));
 	}
-	reinterpret_cast<AnnotationHeader *>(annotations[line].get())->style = static_cast<short>(style);
+	reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get())->style = static_cast<short>(style);
 }
 
 void LineAnnotation::SetStyles(Sci::Line line, const unsigned char *styles) {
 	if (line >= 0) {
-		annotations.EnsureLength(line+1);
-		if (!annotations[line]) {
-			annotations[line].reset(AllocateAnnotation(0, IndividualStyles));
+		EnsureLength(line+1);
+		if (!annotations.ValueAt(line)) {
+			annotations.SetValueAt(line, std::unique_ptr<char []>(AllocateAnnotation(0, IndividualStyles)));
 		} else {
-			const AnnotationHeader *pahSource = reinterpret_cast<AnnotationHeader *>(annotations[line].get());
+			const AnnotationHeader *pahSource = reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get());
 			if (pahSource->style != IndividualStyles) {
 				char *allocation = AllocateAnnotation(pahSource->length, IndividualStyles);
 				AnnotationHeader *pahAlloc = reinterpret_cast<AnnotationHeader *>(allocation);
 				pahAlloc->length = pahSource->length;
 				pahAlloc->lines = pahSource->lines;
-				memcpy(allocation + sizeof(AnnotationHeader), annotations[line].get() + sizeof(AnnotationHeader), pahSource->length);
-				annotations[line].reset(allocation);
+				memcpy(allocation + sizeof(AnnotationHeader), annotations.ValueAt(line).get() + sizeof(AnnotationHeader), pahSource->length);
+				annotations.SetValueAt(line, std::unique_ptr<char []>(allocation));
 			}
 		}
-		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations[line].get());
+		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get());
 		pah->style = IndividualStyles;
-		memcpy(annotations[line].get() + sizeof(AnnotationHeader) + pah->length, styles, pah->length);
+		memcpy(annotations.ValueAt(line).get() + sizeof(AnnotationHeader) + pah->length, styles, pah->length);
 	}
 }
 
 int LineAnnotation::Length(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line].get())->length;
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line))
+		return reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get())->length;
 	else
 		return 0;
 }
 
 int LineAnnotation::Lines(Sci::Line line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line].get())->lines;
+	if ((line >= 0) && (line < annotations.Length()) && annotations.ValueAt(line))
+		return reinterpret_cast<AnnotationHeader *>(annotations.ValueAt(line).get())->lines;
 	else
 		return 0;
 }
 
+// The first line at or after lineStart with an annotation, or -1 if there is none.
+// Only looks at the lines with annotations so is fast when annotations are sparse.
+Sci::Line LineAnnotation::Next(Sci::Line lineStart) const {
+	lineStart = std::max(lineStart, static_cast<Sci::Line>(0));
+	if (lineStart < annotations.Length()) {
+		for (Sci::Position element = annotations.ElementFromPosition(lineStart); element < annotations.Elements(); element++) {
+			const Sci::Line line = annotations.PositionOfElement(static_cast<int>(element));
+			if ((line >= lineStart) && annotations.ValueAt(line))
+				return line;
+		}
+	}
+	return -1;
+}
+
 LineTabstops::~LineTabstops() {
 	tabstops.DeleteAll();
 }
@@ -484,6 +505,27 @@ bool LineTabstops::AddTabstop(Sci::Line line, int x) {
 	return false;
 }
 
+bool LineTabstops::SetTabstops(Sci::Line line, const int *stops, size_t count) {
+	if ((count == 0) && ((line >= tabstops.Length()) || !tabstops[line]))
+		return false;
+	tabstops.EnsureLength(line + 1);
+	if (!tabstops[line]) {
+		tabstops[line].reset(new TabstopList());
+	}
+	TabstopList *tl = tabstops[line].get();
+	if ((tl->size() == count) && std::equal(tl->begin(), tl->end(), stops))
+		return false;
+	tl->assign(stops, stops + count);
+	return true;
+}
+
+const TabstopList *LineTabstops::Tabstops(Sci::Line line) const {
+	if (line < tabstops.Length()) {
+		return tabstops[line].get();
+	}
+	return nullptr;
+}
+
 int LineTabstops::GetNextTabstop(Sci::Line line, int x) const {
 	if (line < tabstops.Length()) {
 		TabstopList *tl = tabstops[line].get();
@@ -497,3 +539,180 @@ int LineTabstops::GetNextTabstop(Sci::Line line, int x) const {
 	}
 	return 0;
 }
+
+LineCellWidths::~LineCellWidths() {
+	cells.DeleteAll();
+}
+
+void LineCellWidths::Init() {
+	cells.DeleteAll();
+	removedAtStart.clear();
+}
+
+void LineCellWidths::InsertLine(Sci::Line line) {
+	if (cells.Length()) {
+		cells.EnsureLength(line);
+		Cells inserted;
+		inserted.added = true;
+		cells.Insert(line, std::move(inserted));
+	}
+}
+
+// The widths the line had when aligned, along with those of any lines removed below it,
+// are kept with the line above. A line added since aligning did not count so is dropped.
+void LineCellWidths::RemoveLine(Sci::Line line) {
+	if (cells.Length() > line) {
+		Cells &cellsRemoved = cells[line];
+		std::vector<TabstopList> &removed = (line > 0) ? cells[line - 1].removed : removedAtStart;
+		if (!cellsRemoved.added)
+			removed.push_back(std::move(cellsRemoved.widths));
+		for (TabstopList &widths : cellsRemoved.removed)
+			removed.push_back(std::move(widths));
+		cells.Delete(line);
+	}
+}
+
+bool LineCellWidths::Measured(Sci::Line line) const {
+	return cells.ValueAt(line).measured;
+}
+
+// Added since its block was last aligned.
+bool LineCellWidths::Added(Sci::Line line) const {
+	return cells.ValueAt(line).added;
+}
+
+// The widths last measured, which remain after the line changes until it is measured again.
+const TabstopList &LineCellWidths::Widths(Sci::Line line) const {
+	return cells.ValueAt(line).widths;
+}
+
+void LineCellWidths::SetWidths(Sci::Line line, TabstopList &&widths) {
+	cells.EnsureLength(line + 1);
+	cells[line].widths = std::move(widths);
+	cells[line].measured = true;
+}
+
+// Lines were removed between this line and the next, or before the first line for -1.
+bool LineCellWidths::HasRemoved(Sci::Line line) const {
+	return (line < 0) ? !removedAtStart.empty() : !cells.ValueAt(line).removed.empty();
+}
+
+void LineCellWidths::TakeRemoved(Sci::Line line, std::vector<TabstopList> &widths) {
+	if (HasRemoved(line)) {
+		std::vector<TabstopList> &removed = (line < 0) ? removedAtStart : cells[line].removed;
+		for (TabstopList &widthsRemoved : removed)
+			widths.push_back(std::move(widthsRemoved));
+		removed.clear();
+	}
+}
+
+bool LineCellWidths::Aligned(Sci::Line line) const {
+	return cells.ValueAt(line).aligned;
+}
+
+void LineCellWidths::SetAligned(Sci::Line lineFirst, Sci::Line lineLast) {
+	cells.EnsureLength(lineLast + 1);
+	for (Sci::Line line = lineFirst; line <= lineLast; line++) {
+		cells[line].aligned = true;
+		cells[line].added = false;
+	}
+}
+
+void LineCellWidths::SetUnaligned(Sci::Line line) {
+	if (line < cells.Length()) {
+		cells[line].aligned = false;
+	}
+}
+
+// Mark a line and the blocks of lines with cells either side of it as needing to be aligned again.
+void LineCellWidths::Unalign(Sci::Line line) {
+	const Sci::Line lines = cells.Length();
+	SetUnaligned(line);
+	for (Sci::Line lineUp = std::min(line, lines) - 1; (lineUp >= 0) && !cells[lineUp].widths.empty(); lineUp--) {
+		cells[lineUp].aligned = false;
+	}
+	for (Sci::Line lineDown = line + 1; (lineDown < lines) && !cells[lineDown].widths.empty(); lineDown++) {
+		cells[lineDown].aligned = false;
+	}
+}
+
+// Whether the run of cells reaching column continues from line in direction, -1 for up or 1
+// for down, to a cell of width as the lines were when aligned. Added lines are passed over
+// and the search gives up at removed lines as it is not known where they were.
+bool LineCellWidths::RunHasWidth(Sci::Line line, int direction, size_t column, int width) const {
+	while (true) {
+		if (HasRemoved((direction < 0) ? line - 1 : line))
+			return false;
+		line += direction;
+		if ((line < 0) || (line >= cells.Length()))
+			return false;
+		const Cells &cellsLine = cells[line];
+		// Lines being aligned have lost the widths they had
+		if (!cellsLine.aligned && cellsLine.measured)
+			return false;
+		if (!cellsLine.added) {
+			if (cellsLine.widths.size() <= column)
+				return false;
+			if (cellsLine.widths[column] == width)
+				return true;
+		}
+	}
+}
+
+// Text or styles changed within lines. The alignment is kept until the lines are measured
+// as the block only has to be aligned again when the widest cell of a column changes.
+void LineCellWidths::Remeasure(Sci::Line lineFirst, Sci::Line lineLast) {
+	lineLast = std::min(lineLast, cells.Length() - 1);
+	for (Sci::Line line = lineFirst; line <= lineLast; line++) {
+		cells[line].measured = false;
+	}
+}
+
+// Lines were added or removed. The changed lines are aligned again by fitting them between
+// the lines either side, whose blocks are only aligned again when that changes the widest
+// cell of a column.
+void LineCellWidths::Invalidate(Sci::Line lineFirst, Sci::Line lineLast) {
+	Remeasure(lineFirst, lineLast);
+	const Sci::Line lines = cells.Length();
+	for (Sci::Line line = std::max(lineFirst, static_cast<Sci::Line>(0)); (line <= lineLast) && (line < lines); line++) {
+		cells[line].aligned = false;
+	}
+}
+
+LineWrapSignatures::~LineWrapSignatures() {
+	signatures.DeleteAll();
+}
+
+void LineWrapSignatures::Init() {
+	signatures.DeleteAll();
+}
+
+void LineWrapSignatures::InsertLine(Sci::Line line) {
+	if (signatures.Length() > line) {
+		signatures.Insert(line, Signature());
+	}
+}
+
+void LineWrapSignatures::RemoveLine(Sci::Line line) {
+	if (signatures.Length() > line) {
+		signatures.Delete(line);
+	}
+}
+
+// The number of lines the line wrapped into when it last had the same signature or 0.
+int LineWrapSignatures::Lines(Sci::Line line, unsigned int hash) const {
+	const Signature &signature = signatures.ValueAt(line);
+	return (signature.hash == hash) ? signature.lines : 0;
+}
+
+void LineWrapSignatures::SetLines(Sci::Line line, unsigned int hash, int lines) {
+	signatures.EnsureLength(line + 1);
+	signatures[line].hash = hash;
+	signatures[line].lines = lines;
+}
+
+void LineWrapSignatures::Forget(Sci::Line line) {
+	if (signatures.Length() > line) {
+		signatures[line].lines = 0;
+	}
+}
@@ -111,7 +111,9 @@ public:
 };
 
 class LineAnnotation : public PerLine {
-	SplitVector<std::unique_ptr<char []>> annotations;
+	// Most lines do not have annotations so only those that do are stored.
+	SparseVector<std::unique_ptr<char []>> annotations;
+	void EnsureLength(Sci::Line lines);
 public:
 	LineAnnotation() {
 	}
@@ -135,6 +137,7 @@ public:
 	void SetStyles(Sci::Line line, const unsigned char *styles);
 	int Length(Sci::Line line) const;
 	int Lines(Sci::Line line) const;
+	Sci::Line Next(Sci::Line lineStart) const;
 };
 
 typedef std::vector<int> TabstopList;
@@ -156,9 +159,85 @@ public:
 
 	bool ClearTabstops(Sci::Line line);
 	bool AddTabstop(Sci::Line line, int x);
+	bool SetTabstops(Sci::Line line, const int *stops, size_t count);
+	const TabstopList *Tabstops(Sci::Line line) const;
 	int GetNextTabstop(Sci::Line line, int x) const;
 };
 
+/**
+ * Widths of the cells ended by tabs on each line, measured for elastic tabstops.
+ * A line is aligned once its tabstops have been set from the widths of its block.
+ * Until a changed line is aligned again it keeps the widths it had when its block was
+ * aligned, and the widths of lines removed since then are kept with the line above them,
+ * so that aligning can tell whether the widest cell of a column has gone.
+ */
+class LineCellWidths : public PerLine {
+	struct Cells {
+		TabstopList widths;
+		std::vector<TabstopList> removed;
+		bool measured = false;
+		bool aligned = false;
+		bool added = false;
+	};
+	SplitVector<Cells> cells;
+	std::vector<TabstopList> removedAtStart;
+public:
+	LineCellWidths() {
+	}
+	// Deleted so LineCellWidths objects can not be copied.
+	LineCellWidths(const LineCellWidths &) = delete;
+	LineCellWidths(LineCellWidths &&) = delete;
+	void operator=(const LineCellWidths &) = delete;
+	void operator=(LineCellWidths &&) = delete;
+	~LineCellWidths() override;
+	void Init() override;
+	void InsertLine(Sci::Line line) override;
+	void RemoveLine(Sci::Line line) override;
+
+	bool Measured(Sci::Line line) const;
+	bool Added(Sci::Line line) const;
+	const TabstopList &Widths(Sci::Line line) const;
+	void SetWidths(Sci::Line line, TabstopList &&widths);
+	bool HasRemoved(Sci::Line line) const;
+	void TakeRemoved(Sci::Line line, std::vector<TabstopList> &widths);
+	bool Aligned(Sci::Line line) const;
+	void SetAligned(Sci::Line lineFirst, Sci::Line lineLast);
+	void SetUnaligned(Sci::Line line);
+	void Unalign(Sci::Line line);
+	bool RunHasWidth(Sci::Line line, int direction, size_t column, int width) const;
+	void Remeasure(Sci::Line lineFirst, Sci::Line lineLast);
+	void Invalidate(Sci::Line lineFirst, Sci::Line lineLast);
+};
+
+/**
+ * A signature of the text and style metrics of each wrapped line with the number of lines
+ * it was wrapped into, so that a line rewrapped after being restyled in colour only does
+ * not have to be laid out again.
+ */
+class LineWrapSignatures : public PerLine {
+	struct Signature {
+		unsigned int hash = 0;
+		int lines = 0;
+	};
+	SplitVector<Signature> signatures;
+public:
+	LineWrapSignatures() {
+	}
+	// Deleted so LineWrapSignatures objects can not be copied.
+	LineWrapSignatures(const LineWrapSignatures &) = delete;
+	LineWrapSignatures(LineWrapSignatures &&) = delete;
+	void operator=(const LineWrapSignatures &) = delete;
+	void operator=(LineWrapSignatures &&) = delete;
+	~LineWrapSignatures() override;
+	void Init() override;
+	void InsertLine(Sci::Line line) override;
+	void RemoveLine(Sci::Line line) override;
+
+	int Lines(Sci::Line line, unsigned int hash) const;
+	void SetLines(Sci::Line line, unsigned int hash, int lines);
+	void Forget(Sci::Line line);
+};
+
 }
 
 #endif
@@ -0,0 +1,195 @@
+// Scintilla source code edit control
+/** @file PositionAnchors.cxx
+ ** Positions that move with edits to the text.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "PositionAnchors.h"
+
+using namespace Scintilla;
+
+PositionAnchors::PositionAnchors() : starts(64), handleCurrent(0), handleIndexesValid(false) {
+	handles.SetGrowSize(64);
+	gravities.SetGrowSize(64);
+}
+
+PositionAnchors::~PositionAnchors() {
+}
+
+// Index of the first anchor after position.
+Sci::Position PositionAnchors::IndexAfter(Sci::Position position) const noexcept {
+	// PartitionFromPosition finds the last start at or before position and
+	// start 0 is always 0 so this is the number of anchors at or before position.
+	// When position is past the end it is limited to the last anchor.
+	if (position < 0)
+		return 0;
+	return starts.PartitionFromPosition(position);
+}
+
+// Restore the order of the anchors at a position after some have been moved there.
+void PositionAnchors::OrderRun(Sci::Position position) {
+	const Sci::Position first = IndexFromPosition(position);
+	const Sci::Position last = IndexAfter(position);
+	if (last - first < 2)
+		return;
+	std::vector<std::pair<char, int>> run;
+	for (Sci::Position index = first; index < last; index++) {
+		run.push_back(std::make_pair(gravities.ValueAt(index), handles.ValueAt(index)));
+	}
+	std::stable_partition(run.begin(), run.end(), [](const std::pair<char, int> &anchor) noexcept {
+		return anchor.first == SC_ANCHORGRAVITY_BEFORE;
+	});
+	for (Sci::Position index = first; index < last; index++) {
+		gravities.SetValueAt(index, run[index - first].first);
+		handles.SetValueAt(index, run[index - first].second);
+	}
+	handleIndexesValid = false;
+}
+
+// Find the index of every handle, sorted by handle so each can be found by a binary search.
+void PositionAnchors::IndexHandles() const {
+	const Sci::Position count = Count();
+	handleIndexes.clear();
+	handleIndexes.reserve(count);
+	for (Sci::Position index = 0; index < count; index++) {
+		handleIndexes.push_back(std::make_pair(handles.ValueAt(index), index));
+	}
+	std::sort(handleIndexes.begin(), handleIndexes.end());
+	handleIndexesValid = true;
+}
+
+Sci::Position PositionAnchors::Count() const noexcept {
+	return handles.Length();
+}
+
+int PositionAnchors::Add(Sci::Position position, int gravity) {
+	const Sci::Position end = starts.PositionFromPartition(starts.Partitions());
+	position = Sci::clamp(position, static_cast<Sci::Position>(0), end);
+	if (gravity != SC_ANCHORGRAVITY_AFTER)
+		gravity = SC_ANCHORGRAVITY_BEFORE;
+	const Sci::Position index = (gravity == SC_ANCHORGRAVITY_BEFORE) ?
+		IndexFromPosition(position) : IndexAfter(position);
+	handleCurrent++;
+	starts.InsertPartition(index + 1, position);
+	handles.Insert(index, handleCurrent);
+	gravities.Insert(index, static_cast<char>(gravity));
+	handleIndexesValid = false;
+	return handleCurrent;
+}
+
+bool PositionAnchors::Delete(int handle) {
+	const Sci::Position index = IndexFromHandle(handle);
+	if (index < 0)
+		return false;
+	DeleteAt(index);
+	return true;
+}
+
+void PositionAnchors::DeleteAt(Sci::Position index) {
+	if ((index < 0) || (index >= Count()))
+		return;
+	starts.RemovePartition(index + 1);
+	handles.Delete(index);
+	gravities.Delete(index);
+	handleIndexesValid = false;
+}
+
+void PositionAnchors::DeleteAll() {
+	const Sci::Position end = starts.PositionFromPartition(starts.Partitions());
+	starts.DeleteAll();
+	starts.InsertText(0, end);
+	handles.DeleteAll();
+	gravities.DeleteAll();
+	handleIndexesValid = false;
+}
+
+// Delete the anchors with a set of handles, starting with the last so the indexes of the
+// others stay the same.
+void PositionAnchors::DeleteHandles(const Sci::Position *handlesToDelete, Sci::Position count) {
+	std::vector<Sci::Position> indexes;
+	for (Sci::Position i = 0; i < count; i++) {
+		const Sci::Position index = IndexFromHandle(static_cast<int>(handlesToDelete[i]));
+		if (index >= 0)
+			indexes.push_back(index);
+	}
+	std::sort(indexes.begin(), indexes.end());
+	indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+	for (std::vector<Sci::Position>::const_reverse_iterator it = indexes.rbegin(); it != indexes.rend(); ++it) {
+		DeleteAt(*it);
+	}
+}
+
+Sci::Position PositionAnchors::IndexFromHandle(int handle) const {
+	if (!handleIndexesValid)
+		IndexHandles();
+	const std::vector<std::pair<int, Sci::Position>>::const_iterator it = std::lower_bound(
+		handleIndexes.begin(), handleIndexes.end(), std::make_pair(handle, static_cast<Sci::Position>(0)));
+	if ((it == handleIndexes.end()) || (it->first != handle))
+		return -1;
+	return it->second;
+}
+
+// Replace each of a number of handles with the position of its anchor or -1.
+void PositionAnchors::PositionsFromHandles(Sci::Position *values, Sci::Position count) const {
+	for (Sci::Position i = 0; i < count; i++) {
+		values[i] = PositionAt(IndexFromHandle(static_cast<int>(values[i])));
+	}
+}
+
+// Index of the first anchor at or after position.
+Sci::Position PositionAnchors::IndexFromPosition(Sci::Position position) const noexcept {
+	return IndexAfter(position - 1);
+}
+
+int PositionAnchors::HandleAt(Sci::Position index) const noexcept {
+	return handles.ValueAt(index);
+}
+
+Sci::Position PositionAnchors::PositionAt(Sci::Position index) const noexcept {
+	if ((index < 0) || (index >= Count()))
+		return -1;
+	return starts.PositionFromPartition(index + 1);
+}
+
+int PositionAnchors::GravityAt(Sci::Position index) const noexcept {
+	return gravities.ValueAt(index);
+}
+
+void PositionAnchors::InsertSpace(Sci::Position position, Sci::Position insertLength) {
+	// Anchors at position that stay before the inserted text come first so
+	// the anchors to move start with the first that goes after it.
+	Sci::Position index = IndexFromPosition(position);
+	const Sci::Position last = IndexAfter(position);
+	while ((index < last) && (gravities.ValueAt(index) == SC_ANCHORGRAVITY_BEFORE))
+		index++;
+	starts.InsertText(index, insertLength);
+}
+
+void PositionAnchors::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
+	// Anchors inside the deleted text collapse to its start.
+	const Sci::Position first = IndexAfter(position);
+	const Sci::Position last = IndexAfter(position + deleteLength);
+	for (Sci::Position index = first; index < last; index++) {
+		starts.RemovePartition(index + 1);
+		starts.InsertPartition(index + 1, position);
+	}
+	starts.InsertText(last, -deleteLength);
+	if (first < last)
+		OrderRun(position);
+}
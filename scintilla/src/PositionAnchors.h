@@ -0,0 +1,61 @@
+// Scintilla source code edit control
+/** @file PositionAnchors.h
+ ** Positions that move with edits to the text.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef POSITIONANCHORS_H
+#define POSITIONANCHORS_H
+
+namespace Scintilla {
+
+/// A set of positions identified by handles that are kept in position order.
+/// Anchor i is the start of partition i+1 of a Partitioning and the start of the
+/// last partition is the length of the document, so that an edit moves all the
+/// anchors after it by adjusting the step of the Partitioning.
+/// Anchors at the same position are kept with SC_ANCHORGRAVITY_BEFORE anchors first
+/// so that text inserted there only needs to move the anchors after a single index.
+/// Edits do not change the order of anchors so the index of each handle is only found
+/// again after anchors are added, deleted or reordered.
+class PositionAnchors {
+	Partitioning<Sci::Position> starts;
+	SplitVector<int> handles;
+	SplitVector<char> gravities;
+	int handleCurrent;
+	mutable std::vector<std::pair<int, Sci::Position>> handleIndexes;
+	mutable bool handleIndexesValid;
+
+	Sci::Position IndexAfter(Sci::Position position) const noexcept;
+	void OrderRun(Sci::Position position);
+	void IndexHandles() const;
+public:
+	PositionAnchors();
+	// Deleted so PositionAnchors objects can not be copied.
+	PositionAnchors(const PositionAnchors &) = delete;
+	PositionAnchors(PositionAnchors &&) = delete;
+	void operator=(const PositionAnchors &) = delete;
+	void operator=(PositionAnchors &&) = delete;
+	~PositionAnchors();
+
+	Sci::Position Count() const noexcept;
+	int Add(Sci::Position position, int gravity);
+	bool Delete(int handle);
+	void DeleteAt(Sci::Position index);
+	void DeleteAll();
+	void DeleteHandles(const Sci::Position *handlesToDelete, Sci::Position count);
+
+	Sci::Position IndexFromHandle(int handle) const;
+	void PositionsFromHandles(Sci::Position *values, Sci::Position count) const;
+	Sci::Position IndexFromPosition(Sci::Position position) const noexcept;
+	int HandleAt(Sci::Position index) const noexcept;
+	Sci::Position PositionAt(Sci::Position index) const noexcept;
+	int GravityAt(Sci::Position index) const noexcept;
+
+	void InsertSpace(Sci::Position position, Sci::Position insertLength);
+	void DeleteRange(Sci::Position position, Sci::Position deleteLength);
+};
+
+}
+
+#endif
@@ -57,6 +57,7 @@ LineLayout::LineLayout(int maxLineLength_) :
 	xHighlightGuide(0),
 	highlightColumn(false),
 	containsCaret(false),
+	prefetched(false),
 	edgeColumn(0),
 	bracePreviousStyles{},
 	hotspot(0,0),
@@ -245,7 +246,7 @@ int LineLayout::EndLineStyle() const {
 
 LineLayoutCache::LineLayoutCache() :
 	level(0),
-	allInvalidated(false), styleClock(-1), useCount(0) {
+	allInvalidated(false), styleClock(-1), useCount(0), linesPrefetched(0), generation(0) {
 	Allocate(0);
 }
 
@@ -262,10 +263,11 @@ void LineLayoutCache::Allocate(size_t length_) {
 void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc) {
 	PLATFORM_ASSERT(useCount == 0);
 	size_t lengthForLevel = 0;
-	if (level == llcCaret) {
+	if ((level == llcCaret) && (linesPrefetched == 0)) {
 		lengthForLevel = 1;
-	} else if (level == llcPage) {
-		lengthForLevel = linesOnScreen + 1;
+	} else if ((level == llcCaret) || (level == llcPage)) {
+		// Lines laid out ahead of scrolling are kept along with the page
+		lengthForLevel = linesOnScreen + 1 + linesPrefetched;
 	} else if (level == llcDocument) {
 		lengthForLevel = linesInDoc;
 	}
@@ -286,9 +288,22 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 void LineLayoutCache::Deallocate() {
 	PLATFORM_ASSERT(useCount == 0);
 	cache.clear();
+	generation++;
+}
+
+// Exchange the layouts with another cache so that the layouts of a document can be kept
+// while it is not displayed.  The level and prefetching belong to the view so are not exchanged.
+void LineLayoutCache::Swap(LineLayoutCache &other) noexcept {
+	PLATFORM_ASSERT((useCount == 0) && (other.useCount == 0));
+	cache.swap(other.cache);
+	std::swap(allInvalidated, other.allInvalidated);
+	std::swap(styleClock, other.styleClock);
+	generation++;
+	other.generation++;
 }
 
 void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
+	generation++;
 	if (!cache.empty() && !allInvalidated) {
 		for (const std::unique_ptr<LineLayout> &ll : cache) {
 			if (ll) {
@@ -301,6 +316,10 @@ void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
 	}
 }
 
+void LineLayoutCache::SetPrefetchLines(Sci::Line lines) {
+	linesPrefetched = std::max(lines, static_cast<Sci::Line>(0));
+}
+
 void LineLayoutCache::SetLevel(int level_) {
 	allInvalidated = false;
 	if ((level_ != -1) && (level != level_)) {
@@ -319,9 +338,9 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 	allInvalidated = false;
 	Sci::Position pos = -1;
 	LineLayout *ret = nullptr;
-	if (level == llcCaret) {
+	if ((level == llcCaret) && (linesPrefetched == 0)) {
 		pos = 0;
-	} else if (level == llcPage) {
+	} else if ((level == llcCaret) || (level == llcPage)) {
 		if (lineNumber == lineCaret) {
 			pos = 0;
 		} else if (cache.size() > 1) {
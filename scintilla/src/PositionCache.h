@@ -64,6 +64,8 @@ public:
 	int xHighlightGuide;
 	bool highlightColumn;
 	bool containsCaret;
+	/// Laid out ahead of scrolling and not yet drawn
+	bool prefetched;
 	int edgeColumn;
 	std::unique_ptr<char[]> chars;
 	std::unique_ptr<unsigned char[]> styles;
@@ -111,6 +113,9 @@ class LineLayoutCache {
 	bool allInvalidated;
 	int styleClock;
 	int useCount;
+	Sci::Line linesPrefetched;
+	// Incremented whenever layouts may be discarded or invalidated.
+	int generation;
 	void Allocate(size_t length_);
 	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc);
 public:
@@ -122,6 +127,7 @@ public:
 	void operator=(LineLayoutCache &&) = delete;
 	virtual ~LineLayoutCache();
 	void Deallocate();
+	void Swap(LineLayoutCache &other) noexcept;
 	enum {
 		llcNone=SC_CACHE_NONE,
 		llcCaret=SC_CACHE_CARET,
@@ -131,6 +137,9 @@ public:
 	void Invalidate(LineLayout::validLevel validity_);
 	void SetLevel(int level_);
 	int GetLevel() const { return level; }
+	void SetPrefetchLines(Sci::Line lines);
+	Sci::Line GetPrefetchLines() const { return linesPrefetched; }
+	int Generation() const noexcept { return generation; }
 	LineLayout *Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
 		Sci::Line linesOnScreen, Sci::Line linesInDoc);
 	void Dispose(LineLayout *ll);
@@ -176,7 +176,7 @@ void SelectionRange::MinimizeVirtualSpace() {
 	}
 }
 
-Selection::Selection() : mainRange(0), moveExtends(false), tentativeMain(false), selType(selStream) {
+Selection::Selection() : mainRange(0), moveExtends(false), tentativeMain(false), indexValid(false), selType(selStream) {
 	AddSelection(SelectionRange(SelectionPosition(0)));
 }
 
@@ -234,6 +234,7 @@ void Selection::SetMain(size_t r) {
 }
 
 SelectionRange &Selection::Range(size_t r) {
+	InvalidateIndex();
 	return ranges[r];
 }
 
@@ -242,6 +243,7 @@ const SelectionRange &Selection::Range(size_t r) const {
 }
 
 SelectionRange &Selection::RangeMain() {
+	InvalidateIndex();
 	return ranges[mainRange];
 }
 
@@ -293,6 +295,7 @@ Sci::Position Selection::Length() const {
 }
 
 void Selection::MovePositions(bool insertion, Sci::Position startChange, Sci::Position length) {
+	InvalidateIndex();
 	for (SelectionRange &range : ranges) {
 		range.MoveForInsertDelete(insertion, startChange, length);
 	}
@@ -302,6 +305,7 @@ void Selection::MovePositions(bool insertion, Sci::Position startChange, Sci::Po
 }
 
 void Selection::TrimSelection(SelectionRange range) {
+	InvalidateIndex();
 	for (size_t i=0; i<ranges.size();) {
 		if ((i != mainRange) && (ranges[i].Trim(range))) {
 			// Trimmed to empty so remove
@@ -318,6 +322,7 @@ void Selection::TrimSelection(SelectionRange range) {
 }
 
 void Selection::TrimOtherSelections(size_t r, SelectionRange range) {
+	InvalidateIndex();
 	for (size_t i = 0; i<ranges.size(); ++i) {
 		if (i != r) {
 			ranges[i].Trim(range);
@@ -326,23 +331,27 @@ void Selection::TrimOtherSelections(size_t r, SelectionRange range) {
 }
 
 void Selection::SetSelection(SelectionRange range) {
+	InvalidateIndex();
 	ranges.clear();
 	ranges.push_back(range);
 	mainRange = ranges.size() - 1;
 }
 
 void Selection::AddSelection(SelectionRange range) {
+	InvalidateIndex();
 	TrimSelection(range);
 	ranges.push_back(range);
 	mainRange = ranges.size() - 1;
 }
 
 void Selection::AddSelectionWithoutTrim(SelectionRange range) {
+	InvalidateIndex();
 	ranges.push_back(range);
 	mainRange = ranges.size() - 1;
 }
 
 void Selection::DropSelection(size_t r) {
+	InvalidateIndex();
 	if ((ranges.size() > 1) && (r < ranges.size())) {
 		size_t mainNew = mainRange;
 		if (mainNew >= r) {
@@ -362,6 +371,7 @@ void Selection::DropAdditionalRanges() {
 }
 
 void Selection::TentativeSelection(SelectionRange range) {
+	InvalidateIndex();
 	if (!tentativeMain) {
 		rangesSaved = ranges;
 	}
@@ -376,34 +386,100 @@ void Selection::CommitTentative() {
 	tentativeMain = false;
 }
 
-int Selection::CharacterInSelection(Sci::Position posCharacter) const {
-	for (size_t i=0; i<ranges.size(); i++) {
-		if (ranges[i].ContainsCharacter(posCharacter))
-			return i == mainRange ? 1 : 2;
+namespace {
+
+// With fewer ranges than this, examining each is as quick as using the index.
+constexpr size_t rangesIndexed = 32;
+
+}
+
+void Selection::BuildIndex() const {
+	rangesByStart.resize(ranges.size());
+	for (size_t r = 0; r < ranges.size(); r++) {
+		rangesByStart[r] = r;
+	}
+	std::stable_sort(rangesByStart.begin(), rangesByStart.end(), [this](size_t a, size_t b) {
+		return ranges[a].Start().Position() < ranges[b].Start().Position();
+	});
+	endsReached.resize(ranges.size());
+	Sci::Position endReached = 0;
+	for (size_t i = 0; i < rangesByStart.size(); i++) {
+		endReached = std::max(endReached, ranges[rangesByStart[i]].End().Position());
+		endsReached[i] = endReached;
+	}
+	indexValid = true;
+}
+
+// Call visit for each range with positions from start to end inclusive.
+// Ranges are visited in order of their start when indexed.
+template <typename Visit>
+void Selection::ForRangesTouching(Sci::Position start, Sci::Position end, Visit visit) const {
+	if (ranges.size() < rangesIndexed) {
+		for (size_t r = 0; r < ranges.size(); r++) {
+			if ((ranges[r].Start().Position() <= end) && (ranges[r].End().Position() >= start))
+				visit(r);
+		}
+		return;
 	}
+	if (!indexValid)
+		BuildIndex();
+	// Ranges before the first prefix reaching start all end before it
+	const size_t first = std::lower_bound(endsReached.begin(), endsReached.end(), start) - endsReached.begin();
+	for (size_t i = first; i < rangesByStart.size(); i++) {
+		const SelectionRange &range = ranges[rangesByStart[i]];
+		if (range.Start().Position() > end)
+			break;
+		if (range.End().Position() >= start)
+			visit(rangesByStart[i]);
+	}
+}
+
+// Find the ranges with positions from start to end inclusive, in order.
+void Selection::RangesTouching(Sci::Position start, Sci::Position end, std::vector<size_t> &found) const {
+	found.clear();
+	ForRangesTouching(start, end, [&found](size_t r) {
+		found.push_back(r);
+	});
+	std::sort(found.begin(), found.end());
+}
+
+int Selection::CharacterInSelection(Sci::Position posCharacter) const {
+	// The earliest range containing the character decides as ranges may overlap
+	size_t rangeFirst = ranges.size();
+	ForRangesTouching(posCharacter, posCharacter, [&](size_t r) {
+		if ((r < rangeFirst) && ranges[r].ContainsCharacter(posCharacter))
+			rangeFirst = r;
+	});
+	if (rangeFirst < ranges.size())
+		return rangeFirst == mainRange ? 1 : 2;
 	return 0;
 }
 
 int Selection::InSelectionForEOL(Sci::Position pos) const {
-	for (size_t i=0; i<ranges.size(); i++) {
-		if (!ranges[i].Empty() && (pos > ranges[i].Start().Position()) && (pos <= ranges[i].End().Position()))
-			return i == mainRange ? 1 : 2;
-	}
+	size_t rangeFirst = ranges.size();
+	ForRangesTouching(pos, pos, [&](size_t r) {
+		if ((r < rangeFirst) && !ranges[r].Empty() && (pos > ranges[r].Start().Position()) && (pos <= ranges[r].End().Position()))
+			rangeFirst = r;
+	});
+	if (rangeFirst < ranges.size())
+		return rangeFirst == mainRange ? 1 : 2;
 	return 0;
 }
 
 Sci::Position Selection::VirtualSpaceFor(Sci::Position pos) const {
 	Sci::Position virtualSpace = 0;
-	for (const SelectionRange &range : ranges) {
+	ForRangesTouching(pos, pos, [&](size_t r) {
+		const SelectionRange &range = ranges[r];
 		if ((range.caret.Position() == pos) && (virtualSpace < range.caret.VirtualSpace()))
 			virtualSpace = range.caret.VirtualSpace();
 		if ((range.anchor.Position() == pos) && (virtualSpace < range.anchor.VirtualSpace()))
 			virtualSpace = range.anchor.VirtualSpace();
-	}
+	});
 	return virtualSpace;
 }
 
 void Selection::Clear() {
+	InvalidateIndex();
 	ranges.clear();
 	ranges.emplace_back();
 	mainRange = ranges.size() - 1;
@@ -414,6 +490,7 @@ void Selection::Clear() {
 }
 
 void Selection::RemoveDuplicates() {
+	InvalidateIndex();
 	for (size_t i=0; i<ranges.size()-1; i++) {
 		if (ranges[i].Empty()) {
 			size_t j=i+1;
@@ -137,6 +137,18 @@ class Selection {
 	size_t mainRange;
 	bool moveExtends;
 	bool tentativeMain;
+	// Ranges ordered by start with the furthest end reached by each prefix so that drawing can
+	// find the ranges touching a line without examining every range. Built when first needed
+	// and discarded by modifications, which all go through non-const methods.
+	mutable std::vector<size_t> rangesByStart;
+	mutable std::vector<Sci::Position> endsReached;
+	mutable bool indexValid;
+	void InvalidateIndex() {
+		indexValid = false;
+	}
+	void BuildIndex() const;
+	template <typename Visit>
+	void ForRangesTouching(Sci::Position start, Sci::Position end, Visit visit) const;
 public:
 	enum selTypes { noSel, selStream, selRectangle, selLines, selThin };
 	selTypes selType;
@@ -175,6 +187,7 @@ public:
 	void DropAdditionalRanges();
 	void TentativeSelection(SelectionRange range);
 	void CommitTentative();
+	void RangesTouching(Sci::Position start, Sci::Position end, std::vector<size_t> &found) const;
 	int CharacterInSelection(Sci::Position posCharacter) const;
 	int InSelectionForEOL(Sci::Position pos) const;
 	Sci::Position VirtualSpaceFor(Sci::Position pos) const;
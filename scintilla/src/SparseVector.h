@@ -49,6 +49,9 @@ public:
 	Sci::Position PositionOfElement(int element) const {
 		return starts->PositionFromPartition(element);
 	}
+	Sci::Position ElementFromPosition(Sci::Position position) const {
+		return starts->PartitionFromPosition(position);
+	}
 	const T& ValueAt(Sci::Position position) const {
 		assert(position < Length());
 		const Sci::Position partition = starts->PartitionFromPosition(position);
@@ -134,6 +137,14 @@ public:
 		}
 		starts->InsertText(partition, -1);
 	}
+	void DeleteAll() {
+		for (Sci::Position part = 0; part < values->Length(); part++) {
+			ClearValue(part);
+		}
+		starts = std::unique_ptr<Partitioning<Sci::Position>>(new Partitioning<Sci::Position>(8));
+		values = std::unique_ptr<SplitVector<T>>(new SplitVector<T>());
+		values->InsertEmpty(0, 2);
+	}
 	void Check() const {
 		if (Length() < 0) {
 			throw std::runtime_error("SparseVector: Length can not be negative.");
@@ -166,3 +166,15 @@ void Style::Copy(Font &font_, const FontMeasurements &fm_) {
 	font.MakeAlias(font_);
 	(FontMeasurements &)(*this) = fm_;
 }
+
+// Text is measured and laid out the same in both styles which may differ in colours and decorations.
+// The extra font flag is not compared as it is the same for every style once refreshed.
+bool Style::SameMetrics(const Style &other) const {
+	return fontName == other.fontName &&
+		weight == other.weight &&
+		italic == other.italic &&
+		size == other.size &&
+		characterSet == other.characterSet &&
+		caseForce == other.caseForce &&
+		visible == other.visible;
+}
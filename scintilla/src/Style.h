@@ -85,6 +85,7 @@ public:
 	void ClearTo(const Style &source);
 	void Copy(Font &font_, const FontMeasurements &fm_);
 	bool IsProtected() const { return !(changeable && visible);}
+	bool SameMetrics(const Style &other) const;
 };
 
 }
@@ -0,0 +1,273 @@
+// Scintilla source code edit control
+/** @file StyleIndex.cxx
+ ** Finds runs of styles without examining the style of every byte.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+#include <bitset>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "StyleIndex.h"
+
+using namespace Scintilla;
+
+namespace {
+
+// Blocks are split into pieces of this length when they become twice as long.
+constexpr Sci::Position blockSize = 4096;
+
+}
+
+StyleIndex::StyleIndex() : starts(256), leaves(1), treeValid(false) {
+	blockStyles.resize(1);
+	blockChanged.resize(1);
+}
+
+StyleIndex::~StyleIndex() {
+}
+
+void StyleIndex::MarkChanged(Sci::Position block) {
+	if (!blockChanged[block]) {
+		blockChanged[block] = 1;
+		if (treeValid)
+			changedBlocks.push_back(block);
+	}
+}
+
+// Split a block that has grown too long into pieces of blockSize.
+void StyleIndex::Split(Sci::Position block) {
+	const Sci::Position start = starts.PositionFromPartition(block);
+	const Sci::Position length = starts.PositionFromPartition(block + 1) - start;
+	if (length <= 2 * blockSize)
+		return;
+	const Sci::Position pieces = (length + blockSize - 1) / blockSize;
+	for (Sci::Position piece = 1; piece < pieces; piece++)
+		starts.InsertPartition(block + piece, start + piece * blockSize);
+	blockStyles.insert(blockStyles.begin() + block + 1, pieces - 1, StyleSet());
+	blockChanged.insert(blockChanged.begin() + block + 1, pieces - 1, 1);
+	blockChanged[block] = 1;
+	treeValid = false;
+}
+
+// Remove a block that has become empty unless it is the only block.
+void StyleIndex::RemoveEmpty(Sci::Position block) {
+	if ((starts.Partitions() <= 1) ||
+		(starts.PositionFromPartition(block) != starts.PositionFromPartition(block + 1)))
+		return;
+	// The first block always starts at 0 so the block after it is merged into it.
+	starts.RemovePartition((block > 0) ? block : 1);
+	blockStyles.erase(blockStyles.begin() + block);
+	blockChanged.erase(blockChanged.begin() + block);
+	treeValid = false;
+}
+
+void StyleIndex::FindStyles(const Document *pdoc, Sci::Position block) {
+	StyleSet styles;
+	unsigned char buffer[blockSize];
+	Sci::Position position = starts.PositionFromPartition(block);
+	const Sci::Position end = starts.PositionFromPartition(block + 1);
+	while (position < end) {
+		const Sci::Position length = std::min(blockSize, end - position);
+		pdoc->GetStyleRange(buffer, position, length);
+		for (Sci::Position i = 0; i < length; i++)
+			styles.set(buffer[i]);
+		position += length;
+	}
+	blockStyles[block] = styles;
+	blockChanged[block] = 0;
+}
+
+// Find the styles of the blocks that have changed and update the tree.
+// After blocks have been split or removed, the whole tree is built again.
+void StyleIndex::Refresh(const Document *pdoc) {
+	if (!treeValid) {
+		const Sci::Position blocks = starts.Partitions();
+		for (Sci::Position block = 0; block < blocks; block++) {
+			if (blockChanged[block])
+				FindStyles(pdoc, block);
+		}
+		leaves = 1;
+		while (leaves < blocks)
+			leaves *= 2;
+		tree.assign(2 * leaves, StyleSet());
+		std::copy(blockStyles.begin(), blockStyles.end(), tree.begin() + leaves);
+		for (Sci::Position node = leaves - 1; node > 0; node--)
+			tree[node] = tree[2 * node] | tree[2 * node + 1];
+		treeValid = true;
+	} else {
+		for (const Sci::Position block : changedBlocks) {
+			FindStyles(pdoc, block);
+			Sci::Position node = leaves + block;
+			tree[node] = blockStyles[block];
+			for (node /= 2; node > 0; node /= 2)
+				tree[node] = tree[2 * node] | tree[2 * node + 1];
+		}
+	}
+	changedBlocks.clear();
+}
+
+// The first block at or after block that uses any of styles or -1.
+Sci::Position StyleIndex::NextBlock(Sci::Position block, const StyleSet &styles) const noexcept {
+	Sci::Position node = leaves + block;
+	if ((tree[node] & styles).any())
+		return block;
+	// Go up until there is a matching subtree to the right then down to its first block.
+	while ((node % 2 == 1) || !(tree[node + 1] & styles).any()) {
+		node /= 2;
+		if (node <= 1)
+			return -1;
+	}
+	node++;
+	while (node < leaves)
+		node = (tree[2 * node] & styles).any() ? 2 * node : 2 * node + 1;
+	return node - leaves;
+}
+
+// The end of the run of style that contains position, limited to end.
+// Blocks that only use the style are skipped without looking at their bytes.
+Sci::Position StyleIndex::RunEnd(const Document *pdoc, Sci::Position position, Sci::Position end, int style) const {
+	StyleSet only;
+	only.set(style);
+	unsigned char buffer[blockSize];
+	while (position < end) {
+		const Sci::Position block = starts.PartitionFromPosition(position);
+		const Sci::Position blockEnd = std::min(starts.PositionFromPartition(block + 1), end);
+		if (!blockChanged[block] && (blockStyles[block] == only)) {
+			position = blockEnd;
+			continue;
+		}
+		while (position < blockEnd) {
+			const Sci::Position length = std::min(blockSize, blockEnd - position);
+			pdoc->GetStyleRange(buffer, position, length);
+			for (Sci::Position i = 0; i < length; i++) {
+				if (buffer[i] != style)
+					return position + i;
+			}
+			position += length;
+		}
+	}
+	return end;
+}
+
+void StyleIndex::Rebuild(Sci::Position length) {
+	starts.DeleteAll();
+	starts.InsertText(0, length);
+	blockStyles.assign(1, StyleSet());
+	blockChanged.assign(1, 1);
+	changedBlocks.clear();
+	treeValid = false;
+	Split(0);
+}
+
+void StyleIndex::InsertSpace(Sci::Position position, Sci::Position insertLength) {
+	const Sci::Position block = starts.PartitionFromPosition(position);
+	starts.InsertText(block, insertLength);
+	MarkChanged(block);
+	Split(block);
+}
+
+void StyleIndex::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
+	const Sci::Position first = starts.PartitionFromPosition(position);
+	const Sci::Position last = starts.PartitionFromPosition(position + deleteLength - 1);
+	if (last > first) {
+		// Merge the blocks containing the deleted text into the first
+		for (Sci::Position block = last; block > first; block--)
+			starts.RemovePartition(block);
+		blockStyles.erase(blockStyles.begin() + first + 1, blockStyles.begin() + last + 1);
+		blockChanged.erase(blockChanged.begin() + first + 1, blockChanged.begin() + last + 1);
+		treeValid = false;
+	}
+	starts.InsertText(first, -deleteLength);
+	MarkChanged(first);
+	Split(first);
+	RemoveEmpty(first);
+}
+
+void StyleIndex::Restyled(Sci::Position position, Sci::Position length) {
+	const Sci::Position first = starts.PartitionFromPosition(position);
+	const Sci::Position last = starts.PartitionFromPosition(position + length - 1);
+	for (Sci::Position block = first; block <= last; block++)
+		MarkChanged(block);
+}
+
+// Find the first run of any of styles that ends after start and starts before end,
+// returning its start and setting runEnd to its end, both limited to the range.
+Sci::Position StyleIndex::Find(const Document *pdoc, Sci::Position start, Sci::Position end, const StyleSet &styles,
+	Sci::Position *runEnd) {
+	Refresh(pdoc);
+	unsigned char buffer[blockSize];
+	Sci::Position position = start;
+	while (position < end) {
+		const Sci::Position block = NextBlock(starts.PartitionFromPosition(position), styles);
+		if (block < 0)
+			return -1;
+		position = std::max(position, starts.PositionFromPartition(block));
+		const Sci::Position blockEnd = std::min(starts.PositionFromPartition(block + 1), end);
+		while (position < blockEnd) {
+			const Sci::Position length = std::min(blockSize, blockEnd - position);
+			pdoc->GetStyleRange(buffer, position, length);
+			for (Sci::Position i = 0; i < length; i++) {
+				if (styles[buffer[i]]) {
+					*runEnd = RunEnd(pdoc, position + i, end, buffer[i]);
+					return position + i;
+				}
+			}
+			position += length;
+		}
+	}
+	return -1;
+}
+
+// Find a run of styles by examining each byte, for when no index is being maintained.
+Sci::Position StyleIndex::FindByScanning(const Document *pdoc, Sci::Position start, Sci::Position end,
+	const StyleSet &styles, Sci::Position *runEnd) {
+	unsigned char buffer[blockSize];
+	Sci::Position found = -1;
+	int style = 0;
+	Sci::Position position = start;
+	while (position < end) {
+		const Sci::Position length = std::min(blockSize, end - position);
+		pdoc->GetStyleRange(buffer, position, length);
+		for (Sci::Position i = 0; i < length; i++) {
+			if (found < 0) {
+				if (styles[buffer[i]]) {
+					found = position + i;
+					style = buffer[i];
+				}
+			} else if (buffer[i] != style) {
+				*runEnd = position + i;
+				return found;
+			}
+		}
+		position += length;
+	}
+	if (found >= 0)
+		*runEnd = end;
+	return found;
+}
@@ -0,0 +1,65 @@
+// Scintilla source code edit control
+/** @file StyleIndex.h
+ ** Finds runs of styles without examining the style of every byte.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef STYLEINDEX_H
+#define STYLEINDEX_H
+
+namespace Scintilla {
+
+class Document;
+
+/// The text of a document is divided into blocks of a few kilobytes, the starts of
+/// which are held in a Partitioning so that they move with edits.  For each block the
+/// set of styles used in it is kept, along with a tree that combines the sets of
+/// neighbouring blocks so that the next block using any of a set of styles is found
+/// in O(log n).
+/// Changes to the text or styles only mark the blocks involved and the sets of those
+/// blocks are found again when the index is next searched, as lexers often style the
+/// same text repeatedly.
+class StyleIndex {
+public:
+	typedef std::bitset<256> StyleSet;
+private:
+	Partitioning<Sci::Position> starts;
+	std::vector<StyleSet> blockStyles;
+	std::vector<char> blockChanged;
+	std::vector<Sci::Position> changedBlocks;
+	// tree[1] is the root and the set of block b is at tree[leaves + b].
+	std::vector<StyleSet> tree;
+	Sci::Position leaves;
+	bool treeValid;
+
+	void MarkChanged(Sci::Position block);
+	void Split(Sci::Position block);
+	void RemoveEmpty(Sci::Position block);
+	void FindStyles(const Document *pdoc, Sci::Position block);
+	void Refresh(const Document *pdoc);
+	Sci::Position NextBlock(Sci::Position block, const StyleSet &styles) const noexcept;
+	Sci::Position RunEnd(const Document *pdoc, Sci::Position position, Sci::Position end, int style) const;
+public:
+	StyleIndex();
+	// Deleted so StyleIndex objects can not be copied.
+	StyleIndex(const StyleIndex &) = delete;
+	StyleIndex(StyleIndex &&) = delete;
+	void operator=(const StyleIndex &) = delete;
+	void operator=(StyleIndex &&) = delete;
+	~StyleIndex();
+
+	void Rebuild(Sci::Position length);
+	void InsertSpace(Sci::Position position, Sci::Position insertLength);
+	void DeleteRange(Sci::Position position, Sci::Position deleteLength);
+	void Restyled(Sci::Position position, Sci::Position length);
+	Sci::Position Find(const Document *pdoc, Sci::Position start, Sci::Position end, const StyleSet &styles,
+		Sci::Position *runEnd);
+
+	static Sci::Position FindByScanning(const Document *pdoc, Sci::Position start, Sci::Position end,
+		const StyleSet &styles, Sci::Position *runEnd);
+};
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Scintilla source code edit control
+/** @file ViewStateCache.cxx
+ ** Keeps the view of documents that are not displayed so that it can be restored.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <forward_list>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+
+#include "Platform.h"
+
+#include "ILoader.h"
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "CharacterCategory.h"
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "KeyMap.h"
+#include "Indicator.h"
+#include "LineMarker.h"
+#include "Style.h"
+#include "ViewStyle.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "UniConversion.h"
+#include "Selection.h"
+#include "PositionCache.h"
+#include "EditModel.h"
+#include "MarginView.h"
+#include "EditView.h"
+#include "Editor.h"
+#include "ViewStateCache.h"
+
+using namespace Scintilla;
+
+DocumentViewState::DocumentViewState(Document *pdoc_) :
+	pdoc(pdoc_), posTopLine(0), subLineTop(0), xOffset(0), wrapGeneration(0), annotationVisible(0) {
+	pdoc->AddWatcher(this, nullptr);
+}
+
+DocumentViewState::~DocumentViewState() {
+	if (pdoc)
+		pdoc->RemoveWatcher(this, nullptr);
+}
+
+// Show every line and expand every fold header.  The line heights are kept.
+void DocumentViewState::ShowAll() {
+	pcs->SetVisible(0, pcs->LinesInDoc() - 1, true);
+	for (Sci::Line line = pcs->ContractedNext(0); line >= 0; line = pcs->ContractedNext(line + 1))
+		pcs->SetExpanded(line, true);
+}
+
+// Follow the changes made to the text as Editor::NotifyModified does.
+// Where the editor would show folded lines, either itself or by asking its container,
+// all the lines are shown as the container can not be asked while detached.
+void DocumentViewState::NotifyModified(Document *doc, DocModification mh, void *) {
+	if ((mh.modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE)) && pcs->HiddenLines()) {
+		// The same lines as Editor::NotifyModified finds for NeedShown.
+		const Sci::Line lineOfPos = doc->SciLineFromPosition(mh.position);
+		Sci::Line lineLast = lineOfPos;
+		if (mh.modificationType & SC_MOD_BEFOREINSERT) {
+			if (doc->ContainsLineEnd(mh.text, mh.length) && (mh.position != doc->LineStart(lineOfPos)))
+				lineLast = lineOfPos + 1;
+		} else {
+			lineLast = doc->SciLineFromPosition(mh.position + mh.length);
+			for (Sci::Line line = lineOfPos + 1; line <= lineLast; line++)
+				lineLast = std::max(lineLast, doc->GetLastChild(line, -1, -1));
+		}
+		for (Sci::Line line = lineOfPos; line <= lineLast; line++) {
+			if (!pcs->GetVisible(line)) {
+				ShowAll();
+				break;
+			}
+		}
+	}
+	if (mh.modificationType & SC_MOD_CHANGEFOLD) {
+		// Editor::FoldChanged only shows lines and expands headers, and only when a header
+		// is added or removed or the level drops.
+		const bool headerChanged = ((mh.foldLevelNow ^ mh.foldLevelPrev) & SC_FOLDLEVELHEADERFLAG) != 0;
+		const bool levelDropped = LevelNumber(mh.foldLevelPrev) > LevelNumber(mh.foldLevelNow);
+		if ((headerChanged || levelDropped) && (pcs->HiddenLines() || !pcs->GetExpanded(mh.line)))
+			ShowAll();
+	}
+	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
+		const bool insertion = (mh.modificationType & SC_MOD_INSERTTEXT) != 0;
+		sel.MovePositions(insertion, mh.position, mh.length);
+		const Sci::Line lineDoc = doc->SciLineFromPosition(mh.position);
+		if (mh.linesAdded != 0) {
+			Sci::Line lineOfPos = lineDoc;
+			if (mh.position > doc->LineStart(lineOfPos))
+				lineOfPos++;	// Affecting subsequent lines
+			if (mh.linesAdded > 0) {
+				pcs->InsertLines(lineOfPos, mh.linesAdded);
+			} else {
+				pcs->DeleteLines(lineOfPos, -mh.linesAdded);
+			}
+		}
+		// Keep the same text at the top of the view
+		if (mh.position < posTopLine) {
+			if (insertion)
+				posTopLine += mh.length;
+			else
+				posTopLine = std::max(mh.position, posTopLine - mh.length);
+		}
+		llc.Invalidate(LineLayout::llCheckTextAndStyle);
+		linesChanged.AddRange(lineDoc, lineDoc + std::max(static_cast<Sci::Line>(0), mh.linesAdded) + 2);
+	}
+	if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
+		const Sci::Line lineDoc = doc->SciLineFromPosition(mh.position);
+		linesChanged.AddRange(lineDoc, lineDoc + 1);
+	}
+}
+
+// Called while the document is being destroyed so just forget it and leave the cache
+// to remove this state.
+void DocumentViewState::NotifyDeleted(Document *, void *) {
+	pdoc = nullptr;
+}
+
+ViewStateCache::ViewStateCache() : size(0) {
+}
+
+ViewStateCache::~ViewStateCache() {
+}
+
+void ViewStateCache::RemoveDeleted() {
+	states.erase(std::remove_if(states.begin(), states.end(),
+		[](const std::unique_ptr<DocumentViewState> &state) { return state->pdoc == nullptr; }),
+		states.end());
+}
+
+void ViewStateCache::SetSize(size_t size_) {
+	size = size_;
+	RemoveDeleted();
+	if (states.size() > size)
+		states.erase(states.begin(), states.begin() + (states.size() - size));
+}
+
+// Keep the state, dropping the least recently detached if the cache is full.
+void ViewStateCache::Add(std::unique_ptr<DocumentViewState> state) {
+	RemoveDeleted();
+	if (size == 0)
+		return;
+	if (states.size() >= size)
+		states.erase(states.begin());
+	states.push_back(std::move(state));
+}
+
+// Remove and return the state of a document or null if it was not kept.
+std::unique_ptr<DocumentViewState> ViewStateCache::Take(const Document *pdoc) {
+	RemoveDeleted();
+	for (std::vector<std::unique_ptr<DocumentViewState>>::iterator it = states.begin(); it != states.end(); ++it) {
+		if ((*it)->pdoc == pdoc) {
+			std::unique_ptr<DocumentViewState> state = std::move(*it);
+			states.erase(it);
+			return state;
+		}
+	}
+	return std::unique_ptr<DocumentViewState>();
+}
@@ -0,0 +1,81 @@
+// Scintilla source code edit control
+/** @file ViewStateCache.h
+ ** Keeps the view of documents that are not displayed so that it can be restored.
+ **/
+// Copyright 1998-2007 by Neil Hodgson <neilh@scintilla.org>
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef VIEWSTATECACHE_H
+#define VIEWSTATECACHE_H
+
+namespace Scintilla {
+
+/// The state of an editor's view of a document, taken when the document is replaced
+/// so that displaying the document again does not have to show every line and find
+/// the height of every wrapped line.
+/// While detached, the state watches the document and follows changes to its text in
+/// the same way as the editor would, noting the lines whose heights must be found again.
+/// Edits and fold changes that would make the editor show folded lines show all lines.
+class DocumentViewState : public DocWatcher {
+public:
+	Document *pdoc;
+	std::unique_ptr<IContractionState> pcs;
+	LineLayoutCache llc;
+	Selection sel;
+	// The top line is kept as the start of its document line and a sub line so that
+	// it can be found again after the heights of lines change.
+	Sci::Position posTopLine;
+	Sci::Line subLineTop;
+	int xOffset;
+	// Wrapping that had not been done when the state was taken.
+	WrapPending wrapPending;
+	// Lines changed while detached.
+	WrapPending linesChanged;
+	// The line heights are only valid if the editor has not changed how it lays out lines.
+	int wrapGeneration;
+	int annotationVisible;
+
+	explicit DocumentViewState(Document *pdoc_);
+	// Deleted so DocumentViewState objects can not be copied.
+	DocumentViewState(const DocumentViewState &) = delete;
+	DocumentViewState(DocumentViewState &&) = delete;
+	void operator=(const DocumentViewState &) = delete;
+	void operator=(DocumentViewState &&) = delete;
+	~DocumentViewState() override;
+
+	void ShowAll();
+
+	void NotifyModifyAttempt(Document *, void *) override {}
+	void NotifySavePoint(Document *, void *, bool) override {}
+	void NotifyModified(Document *doc, DocModification mh, void *) override;
+	void NotifyDeleted(Document *doc, void *) override;
+	void NotifyStyleNeeded(Document *, void *, Sci::Position) override {}
+	void NotifyLexerChanged(Document *, void *) override {}
+	void NotifyErrorOccurred(Document *, void *, int) override {}
+};
+
+/// The states of the documents most recently detached from an editor, limited to a
+/// small number so that the memory used by line layouts remains bounded.
+class ViewStateCache {
+	// Least recently detached first.
+	std::vector<std::unique_ptr<DocumentViewState>> states;
+	size_t size;
+	void RemoveDeleted();
+public:
+	ViewStateCache();
+	// Deleted so ViewStateCache objects can not be copied.
+	ViewStateCache(const ViewStateCache &) = delete;
+	ViewStateCache(ViewStateCache &&) = delete;
+	void operator=(const ViewStateCache &) = delete;
+	void operator=(ViewStateCache &&) = delete;
+	~ViewStateCache();
+
+	size_t Size() const noexcept { return size; }
+	void SetSize(size_t size_);
+	void Add(std::unique_ptr<DocumentViewState> state);
+	std::unique_ptr<DocumentViewState> Take(const Document *pdoc);
+};
+
+}
+
+#endif
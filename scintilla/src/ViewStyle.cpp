@@ -359,6 +359,14 @@ void ViewStyle::Refresh(Surface &surface, int tabInChars) {
 	someStylesForceCase = std::any_of(styles.cbegin(), styles.cend(),
 		[](const Style &style) { return style.caseForce != Style::caseMixed; });
 
+	metricClasses.resize(styles.size());
+	for (size_t styleIndex = 0; styleIndex < styles.size(); styleIndex++) {
+		size_t same = 0;
+		while (!styles[same].SameMetrics(styles[styleIndex]))
+			same++;
+		metricClasses[styleIndex] = static_cast<int>(same);
+	}
+
 	aveCharWidth = styles[STYLE_DEFAULT].aveCharWidth;
 	spaceWidth = styles[STYLE_DEFAULT].spaceWidth;
 	tabWidth = spaceWidth * tabInChars;
@@ -442,6 +450,14 @@ bool ViewStyle::ValidStyle(size_t styleIndex) const {
 	return styleIndex < styles.size();
 }
 
+// Styles with the same metric class can be exchanged without measuring text again.
+// Before the styles are refreshed each style is only in its own class.
+int ViewStyle::MetricClass(int styleIndex) const noexcept {
+	if (static_cast<size_t>(styleIndex) < metricClasses.size())
+		return metricClasses[styleIndex];
+	return styleIndex;
+}
+
 void ViewStyle::CalcLargestMarkerHeight() {
 	largestMarkerHeight = 0;
 	for (const LineMarker &marker : markers) {
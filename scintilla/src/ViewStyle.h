@@ -95,6 +95,8 @@ class ViewStyle {
 	FontMap fonts;
 public:
 	std::vector<Style> styles;
+	/// For each style, the first style that measures text the same
+	std::vector<int> metricClasses;
 	int nextExtendedStyle;
 	std::vector<LineMarker> markers;
 	int largestMarkerHeight;
@@ -196,6 +198,7 @@ public:
 	int ExternalMarginWidth() const;
 	int MarginFromLocation(Point pt) const;
 	bool ValidStyle(size_t styleIndex) const;
+	int MetricClass(int styleIndex) const noexcept;
 	void CalcLargestMarkerHeight();
 	int GetFrameWidth() const;
 	bool IsLineFrameOpaque(bool caretActive, bool lineContainsCaret) const;
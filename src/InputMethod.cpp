@@ -8,6 +8,7 @@
 
 #include <qglobal.h>
 
+#include <QByteArray>
 #include <QColor>
 #include <QFont>
 #include <QInputMethodEvent>
@@ -15,10 +16,10 @@
 #include <QTextCharFormat>
 #include <QTextFormat>
 #include <QVariant>
-#include <QVarLengthArray>
 
 #include "Qsci/qsciscintillabase.h"
 #include "ScintillaQt.h"
+#include "CharacterCategory.h"
 
 
 #define INDIC_INPUTMETHOD 24
@@ -44,6 +45,65 @@ static bool IsHangul(const QChar qchar)
                 HangulJamoExtendedA || HangulJamoExtendedB;
 }
 
+// Return true if a grapheme would be split at a position of a UTF-8 document,
+// ie. the character at the position is a combining mark, a variation selector
+// or an emoji modifier or the character before it is a zero width joiner.
+static bool SplitsGrapheme(Scintilla::Document *doc, Sci::Position pos)
+{
+    if (doc->dbcsCodePage != SC_CP_UTF8 || pos <= 0 || pos >= doc->Length())
+        return false;
+
+    if (doc->CharacterBefore(pos).character == 0x200d)
+        return true;
+
+    int ch = doc->CharacterAfter(pos).character;
+
+    switch (Scintilla::CategoriseCharacter(ch)) {
+        case Scintilla::ccMn:
+        case Scintilla::ccMc:
+        case Scintilla::ccMe:
+            return true;
+
+        default:
+            return (ch >= 0x1f3fb && ch <= 0x1f3ff);
+    }
+}
+
+// Return the start of the paragraph containing a position as
+// Document::ParaUp() does but without looking before a limit.
+static Sci::Position BoundedParaUp(Scintilla::Document *doc, Sci::Position pos,
+        Sci::Position limit)
+{
+    Sci::Line line = doc->SciLineFromPosition(pos) - 1;
+
+    while (line >= 0 && doc->LineEnd(line) >= limit && doc->IsWhiteLine(line))
+        line--;
+
+    while (line >= 0 && doc->LineEnd(line) >= limit && !doc->IsWhiteLine(line))
+        line--;
+
+    return std::max(doc->LineStart(line + 1), limit);
+}
+
+// Return the end of the paragraph containing a position as Document::ParaDown()
+// does but without looking after a limit.
+static Sci::Position BoundedParaDown(Scintilla::Document *doc,
+        Sci::Position pos, Sci::Position limit)
+{
+    Sci::Line line = doc->SciLineFromPosition(pos);
+    const Sci::Line lines = doc->LinesTotal();
+
+    while (line < lines && doc->LineStart(line) <= limit && !doc->IsWhiteLine(line))
+        line++;
+
+    while (line < lines && doc->LineStart(line) <= limit && doc->IsWhiteLine(line))
+        line++;
+
+    Sci::Position end = (line < lines) ? doc->LineStart(line) : doc->LineEnd(line - 1);
+
+    return std::min(end, limit);
+}
+
 static void MoveImeCarets(QsciScintillaQt *sqt, int offset)
 {
     // Move carets relatively by bytes
@@ -213,6 +273,64 @@ void QsciScintillaBase::inputMethodEvent(QInputMethodEvent *event)
     sci->ShowCaretAtCurrentPosition();
 }
 
+// Set the maximum length of the text either side of the caret given to input
+// methods.
+void QsciScintillaBase::setInputMethodContextLength(int length)
+{
+    imContextLength = length;
+    imContextDoc = 0;
+}
+
+
+// Find the text around the caret given to input methods unless the document
+// and selection have not changed since it was last found.  Input methods query
+// it whenever the caret moves so it is limited in length.
+void QsciScintillaBase::updateInputMethodContext() const
+{
+    Scintilla::Document *doc = sci->pdoc;
+    int pos = sci->sel.MainCaret();
+    int anchor = sci->sel.MainAnchor();
+
+    if (imContextDoc == doc && imContextVersion == doc->EditVersion() &&
+            imContextPos == pos && imContextAnchor == anchor)
+        return;
+
+    Sci::Position start = BoundedParaUp(doc, pos,
+            std::max<Sci::Position>(pos - imContextLength, 0));
+    Sci::Position end = BoundedParaDown(doc, pos,
+            std::min<Sci::Position>(static_cast<Sci::Position>(pos) + imContextLength,
+                    doc->Length()));
+
+    // Don't split a character, a line end or a combining sequence.
+    start = doc->MovePositionOutsideChar(start, 1);
+
+    while (start < pos && SplitsGrapheme(doc, start))
+        start = doc->NextPosition(start, 1);
+
+    end = doc->MovePositionOutsideChar(end, -1);
+
+    while (end > pos && SplitsGrapheme(doc, end))
+        end = doc->NextPosition(end, -1);
+
+    QByteArray bytes(end - start, '\0');
+    doc->GetCharRange(bytes.data(), start, end - start);
+
+    imContextText = bytesAsText(bytes.constData());
+
+    int limited = qBound<int>(start, anchor, end);
+
+    imContextCursor = qMin<int>(doc->CountUTF16(start, pos),
+            imContextText.length());
+    imContextAnchorOffset = qMin<int>(doc->CountUTF16(start, limited),
+            imContextText.length());
+
+    imContextDoc = doc;
+    imContextVersion = doc->EditVersion();
+    imContextPos = pos;
+    imContextAnchor = anchor;
+}
+
+
 QVariant QsciScintillaBase::inputMethodQuery(Qt::InputMethodQuery query) const
 {
     int pos = SendScintilla(SCI_GETCURRENTPOS);
@@ -243,37 +361,36 @@ QVariant QsciScintillaBase::inputMethodQuery(Qt::InputMethodQuery query) const
         }
 
         case Qt::ImCursorPosition:
-        {
-            int paraStart = sci->pdoc->ParaUp(pos);
-            return pos - paraStart;
-        }
+            updateInputMethodContext();
+            return imContextCursor;
 
-        case Qt::ImSurroundingText:
-        {
-            int paraStart = sci->pdoc->ParaUp(pos);
-            int paraEnd = sci->pdoc->ParaDown(pos);
-            QVarLengthArray<char,1024> buffer(paraEnd - paraStart + 1);
+        case Qt::ImAnchorPosition:
+            updateInputMethodContext();
+            return imContextAnchorOffset;
 
-            Sci_CharacterRange charRange;
-            charRange.cpMin = paraStart;
-            charRange.cpMax = paraEnd;
+        case Qt::ImSurroundingText:
+            updateInputMethodContext();
+            return imContextText;
 
-            Sci_TextRange textRange;
-            textRange.chrg = charRange;
-            textRange.lpstrText = buffer.data();
+        case Qt::ImCurrentSelection:
+        {
+            updateInputMethodContext();
 
-            SendScintilla(SCI_GETTEXTRANGE, 0, (sptr_t)&textRange);
+            int from = qMin(imContextCursor, imContextAnchorOffset);
+            int to = qMax(imContextCursor, imContextAnchorOffset);
 
-            return bytesAsText(buffer.constData());
+            return imContextText.mid(from, to - from);
         }
 
-        case Qt::ImCurrentSelection:
-        {
-            QVarLengthArray<char,1024> buffer(SendScintilla(SCI_GETSELTEXT));
-            SendScintilla(SCI_GETSELTEXT, 0, (sptr_t)buffer.data());
+#if QT_VERSION >= 0x050300
+        case Qt::ImTextBeforeCursor:
+            updateInputMethodContext();
+            return imContextText.left(imContextCursor);
 
-            return bytesAsText(buffer.constData());
-        }
+        case Qt::ImTextAfterCursor:
+            updateInputMethodContext();
+            return imContextText.mid(imContextCursor);
+#endif
 
         default:
             return QVariant();
@@ -62,6 +62,19 @@ public:
     virtual void updateAutoCompletionList(const QStringList &context,
             QStringList &list) = 0;
 
+    //! Update the list \a list with no more than \a limit API entries derived
+    //! from \a context, as for updateAutoCompletionList().  The entries are
+    //! appended in sorted order and without duplicates so that they can be
+    //! given to the auto-completion list without sorting them again.  If \a
+    //! limit is less than or equal to 0 then there is no limit.  The default
+    //! implementation calls updateAutoCompletionList() and then sorts and
+    //! truncates the new entries.  A sub-class can re-implement it to avoid
+    //! creating entries beyond the limit.
+    //!
+    //! \sa updateAutoCompletionList()
+    virtual void updateSortedAutoCompletionList(const QStringList &context,
+            QStringList &list, int limit);
+
     //! This is called when the user selects the entry \a selection from the
     //! auto-completion list.  A sub-class can use this as a hint to provide
     //! more specific API entries in future calls to
@@ -0,0 +1,90 @@
+// This defines the interface to the QsciAbstractDocumentProvider class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCIABSTRACTDOCUMENTPROVIDER_H
+#define QSCIABSTRACTDOCUMENTPROVIDER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QObject>
+
+#include <Qsci/qsciglobal.h>
+
+
+//! \brief The QsciAbstractDocumentProvider class represents the interface to
+//! a source of text that is too large, or too slow, to be loaded into a
+//! document all at once.  A sub-class will provide the actual implementation
+//! of the interface.
+//!
+//! The text is fetched a range of lines at a time by a QsciPagedDocument as
+//! the lines are scrolled into view.  Lines are fetched in a separate thread
+//! so that the implementation may block, for example while waiting for a
+//! database query or a network request to complete.
+//!
+//! \sa QsciPagedDocument
+class QSCINTILLA_EXPORT QsciAbstractDocumentProvider : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Constructs a QsciAbstractDocumentProvider instance with parent \a
+    //! parent.
+    QsciAbstractDocumentProvider(QObject *parent = 0);
+
+    //! Destroy the QsciAbstractDocumentProvider instance.
+    virtual ~QsciAbstractDocumentProvider();
+
+    //! Returns an estimate of the number of lines of text.  It is used to
+    //! size the document before any text has been fetched and does not need
+    //! to be exact.  The document grows or shrinks as the real end of the
+    //! text is found.  It is called in the main thread.
+    virtual int estimatedLineCount() = 0;
+
+    //! Returns up to \a count lines of text starting at line \a line, where
+    //! the first line is line 0.  Each line should include its end-of-line
+    //! characters.  Fewer than \a count lines should only be returned if the
+    //! end of the text is reached.  It is called in a separate thread, but
+    //! only one call is made at a time.  An implementation that may take a
+    //! long time should call isCancelled() regularly and return early if it
+    //! returns true.
+    //!
+    //! \sa isCancelled()
+    virtual QByteArray fetchLines(int line, int count) = 0;
+
+    //! Returns true if the text being fetched by fetchLines() is no longer
+    //! wanted, either because the document has been reloaded or because the
+    //! QsciPagedDocument is being destroyed.  Anything returned by
+    //! fetchLines() after this is ignored.  It may be called from any thread.
+    //!
+    //! \sa fetchLines()
+    bool isCancelled() const;
+
+private:
+    friend class QsciPagedDocumentWorker;
+
+    QAtomicInt cancelled;
+
+    void setCancelled(bool cancel);
+
+    QsciAbstractDocumentProvider(const QsciAbstractDocumentProvider &);
+    QsciAbstractDocumentProvider &operator=(const QsciAbstractDocumentProvider &);
+};
+
+#endif
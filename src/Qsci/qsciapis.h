@@ -24,6 +24,7 @@
 #include <QList>
 #include <QObject>
 #include <QPair>
+#include <QSet>
 #include <QStringList>
 
 #include <Qsci/qsciabstractapis.h>
@@ -138,6 +139,10 @@ public:
     virtual void updateAutoCompletionList(const QStringList &context,
             QStringList &list);
 
+    //! \reimp
+    virtual void updateSortedAutoCompletionList(const QStringList &context,
+            QStringList &list, int limit);
+
     //! \reimp
     virtual void autoCompletionSelected(const QString &sel);
 
@@ -198,11 +203,12 @@ private:
     bool originStartsWith(const QString &path, const QString &wsep);
     const WordIndexList *wordIndexOf(const QString &word) const;
     void lastCompleteWord(const QString &word, QStringList &with_context,
-            bool &unambig);
-    void lastPartialWord(const QString &word, QStringList &with_context,
-            bool &unambig);
+            QSet<QString> &with_context_set, bool &unambig);
+    bool lastPartialWord(const QString &word, QStringList &with_context,
+            QSet<QString> &with_context_set, bool &unambig, int limit);
     void addAPIEntries(const WordIndexList &wl, bool complete,
-            QStringList &with_context, bool &unambig);
+            QStringList &with_context, QSet<QString> &with_context_set,
+            bool &unambig);
     QString prepName(const QString &filename, bool mkpath = false) const;
     void deleteWorker();
 
@@ -24,8 +24,9 @@
 #include <Qsci/qsciglobal.h>
 
 
-class QsciScintillaBase;
 class QsciDocumentP;
+class QsciEditQueue;
+class QsciScintillaBase;
 
 
 //! \brief The QsciDocument class represents a document to be edited.
@@ -44,6 +45,36 @@ public:
     QsciDocument(const QsciDocument &);
     QsciDocument &operator=(const QsciDocument &);
 
+    //! Returns a digest of the text of the document.  The digest depends only
+    //! on the text and is kept up to date as the document is edited so that,
+    //! once it has first been calculated, it is quick to get even for very
+    //! large documents.  It may be used to check if the text matches a copy
+    //! saved elsewhere, to detect identical documents or as a key for cached
+    //! data.
+    //!
+    //! \sa firstDifference()
+    quint64 digest() const;
+
+    //! Returns a digest of the text from position \a start up to, but not
+    //! including, position \a end.
+    quint64 digest(int start, int end) const;
+
+    //! Returns the position of the first character where the text of the
+    //! document differs from that of \a other.  -1 is returned if the text
+    //! of the two documents is the same.
+    //!
+    //! \sa digest()
+    int firstDifference(const QsciDocument &other) const;
+
+    //! Returns the queue of edits to the document that may be submitted from
+    //! other threads.  It is created the first time this is called, which
+    //! must be from the GUI thread.  The queue is owned by the document and
+    //! must not be used once all QsciDocument instances that refer to the
+    //! document have been destroyed.
+    //!
+    //! \sa QsciEditQueue
+    QsciEditQueue *editQueue() const;
+
 private:
     friend class QsciScintilla;
 
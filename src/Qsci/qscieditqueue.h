@@ -0,0 +1,177 @@
+// This defines the interface to the QsciEditQueue class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCIEDITQUEUE_H
+#define QSCIEDITQUEUE_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+
+#include <Qsci/qsciglobal.h>
+
+
+class QEvent;
+class QsciDocument;
+class QsciEditQueueBatch;
+class QsciEditQueueWatcher;
+
+
+//! \brief The QsciEditQueue class is a queue of edits to a document that may
+//! be computed in other threads.
+//!
+//! Tools such as formatters compute edits in a worker thread against the
+//! text of a particular version of the document.  Batches of edits may be
+//! submitted from any thread without locking.  The queue is drained by the
+//! GUI thread once per pass of the event loop and all the batches drained
+//! are applied as a single undo action.  Only the text changed by each batch
+//! is reported as modified.  A batch computed against an older version of the
+//! document is moved to allow for the edits made since, or is rejected if any
+//! of those edits overlap it.
+//!
+//! The queue of a document is obtained with QsciDocument::editQueue().
+//!
+//! \sa QsciDocument
+class QSCINTILLA_EXPORT QsciEditQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! \brief An edit replaces the text from position \a start up to, but
+    //! not including, position \a end with \a text.
+    //!
+    //! Positions are byte positions, as used by the Scintilla messages, in
+    //! the version of the document the edit was computed against.  \a text
+    //! is in the encoding of the document.
+    struct Edit
+    {
+        //! The position of the start of the text to replace.
+        int start;
+
+        //! The position of the end of the text to replace.
+        int end;
+
+        //! The replacement text.
+        QByteArray text;
+    };
+
+    //! Destroys the queue.  Any batches not yet applied are discarded.
+    virtual ~QsciEditQueue();
+
+    //! Returns the version of the document.  The version changes with every
+    //! modification of the text.  It may be called from any thread but, to
+    //! be consistent with the text, it should be read in the GUI thread at
+    //! the same time as the text that edits are computed against.
+    //!
+    //! \sa submit()
+    int version() const;
+
+    //! Submits the batch of \a edits computed against the version \a version
+    //! of the document and returns an identifier for the batch.  The edits
+    //! must not overlap.  It may be called from any thread.
+    //!
+    //! \sa batchApplied(), batchRejected(), version()
+    int submit(int version, const QList<Edit> &edits);
+
+    //! Applies any batches that have been submitted without waiting for the
+    //! event loop.  It must be called from the GUI thread.
+    void flush();
+
+    //! Sets the number of modifications of the document that are remembered
+    //! to \a changes.  A batch computed against a version older than this is
+    //! rejected.  The default is 1024.
+    //!
+    //! \sa historySize()
+    void setHistorySize(int changes);
+
+    //! Returns the number of modifications of the document that are
+    //! remembered.
+    //!
+    //! \sa setHistorySize()
+    int historySize() const;
+
+    //! Returns the time in microseconds between the submission of the last
+    //! batch that was applied and its application.
+    //!
+    //! \sa maximumLatency()
+    qint64 lastLatency() const;
+
+    //! Returns the longest time in microseconds between the submission of a
+    //! batch and its application.
+    //!
+    //! \sa lastLatency(), resetLatency()
+    qint64 maximumLatency() const;
+
+    //! Resets the latencies returned by lastLatency() and maximumLatency().
+    void resetLatency();
+
+signals:
+    //! This signal is emitted when the batch with the identifier \a id has
+    //! been applied to the document.
+    void batchApplied(int id);
+
+    //! This signal is emitted when the batch with the identifier \a id has
+    //! been rejected.  This happens if it was computed against a version of
+    //! the document that is no longer remembered or that was modified where
+    //! the batch would make its edits, or if its edits are invalid.
+    void batchRejected(int id);
+
+protected:
+    //! \reimp
+    virtual bool event(QEvent *e);
+
+private:
+    friend class QsciDocument;
+    friend class QsciEditQueueWatcher;
+
+    // A modification of the document.
+    struct Change
+    {
+        int position;
+        int deleted;
+        int inserted;
+    };
+
+    QsciEditQueue();
+
+    void setDocument(void *doc);
+    void changed(int position, int deleted, int inserted);
+    void drain();
+    bool rebase(QsciEditQueueBatch *batch) const;
+
+    void *doc;
+    QsciEditQueueWatcher *watcher;
+    bool applying;
+    QAtomicPointer<QsciEditQueueBatch> submitted;
+    QAtomicInt next_id;
+    QAtomicInt current_version;
+    QAtomicInt drain_posted;
+    QList<Change> history;
+    int history_size;
+    qint64 last_latency;
+    qint64 max_latency;
+
+    QsciEditQueue(const QsciEditQueue &);
+    QsciEditQueue &operator=(const QsciEditQueue &);
+};
+
+#endif
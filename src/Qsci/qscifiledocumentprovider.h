@@ -0,0 +1,82 @@
+// This defines the interface to the QsciFileDocumentProvider class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCIFILEDOCUMENTPROVIDER_H
+#define QSCIFILEDOCUMENTPROVIDER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <Qsci/qsciabstractdocumentprovider.h>
+#include <Qsci/qsciglobal.h>
+
+
+//! \brief The QsciFileDocumentProvider class is a document provider that
+//! reads the text of a local file a range of lines at a time.
+//!
+//! Only the parts of the file that are displayed are read, although finding
+//! a line for the first time requires the file to be scanned up to that line.
+//! It is mainly intended as a stand-in for remote or database backed providers
+//! while testing.
+//!
+//! \sa QsciPagedDocument
+class QSCINTILLA_EXPORT QsciFileDocumentProvider : public QsciAbstractDocumentProvider
+{
+    Q_OBJECT
+
+public:
+    //! Constructs a QsciFileDocumentProvider instance that reads the file
+    //! named \a filename and with parent \a parent.
+    QsciFileDocumentProvider(const QString &filename, QObject *parent = 0);
+
+    //! Destroy the QsciFileDocumentProvider instance.
+    virtual ~QsciFileDocumentProvider();
+
+    //! Returns the name of the file that is read.
+    QString fileName() const;
+
+    //! \reimp  The estimate is based on the number of lines in the first
+    //! part of the file and is exact for small files.
+    virtual int estimatedLineCount();
+
+    //! \reimp  Scanning the file for a line that has not been found before
+    //! stops if the fetch is cancelled.
+    virtual QByteArray fetchLines(int line, int count);
+
+private:
+    QFile file;
+    QMutex mutex;
+
+    // The offset of every LinesPerCheckpoint'th line found so far.
+    QVector<qint64> checkpoints;
+    qint64 scan_offset;
+    int scan_line;
+    bool scan_complete;
+
+    bool scanForward();
+
+    QsciFileDocumentProvider(const QsciFileDocumentProvider &);
+    QsciFileDocumentProvider &operator=(const QsciFileDocumentProvider &);
+};
+
+#endif
@@ -0,0 +1,188 @@
+// This defines the interface to the QsciPagedDocument class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCIPAGEDDOCUMENT_H
+#define QSCIPAGEDDOCUMENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+#include <Qsci/qsciglobal.h>
+
+
+class QsciAbstractDocumentProvider;
+class QsciPagedDocumentWorker;
+class QsciScintilla;
+
+
+//! \brief The QsciPagedDocument class displays text, supplied on demand by a
+//! provider, that is too large, or too slow, to be loaded all at once.
+//!
+//! The document of the editor is divided into pages of consecutive lines.  A
+//! page is fetched from the provider, in a separate thread, when it is
+//! scrolled into view.  Until its text arrives a page is shown as empty
+//! placeholder lines.  Pages that have been fetched are kept in a cache and
+//! the least recently displayed ones are returned to placeholders when the
+//! cache is full.  The number of lines in the document is first set from the
+//! provider's estimate and is corrected as the end of the text is found.
+//!
+//! Lexers, folding, searching and wrapping all work with the text of the
+//! pages that have been fetched.
+//!
+//! The document is read-only by default.  If it is made editable then a page
+//! that is edited is kept in the editor's document and is never fetched again
+//! or discarded from the cache.  Edits cannot be undone.
+//!
+//! \sa QsciAbstractDocumentProvider
+class QSCINTILLA_EXPORT QsciPagedDocument : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Construct a QsciPagedDocument that displays the text supplied by \a
+    //! provider in a new document of \a parent.  \a provider must not be
+    //! destroyed before the QsciPagedDocument.
+    QsciPagedDocument(QsciAbstractDocumentProvider *provider,
+            QsciScintilla *parent);
+
+    //! Destroy the QsciPagedDocument instance.  Any fetch being made by the
+    //! provider is cancelled and waited for.
+    //!
+    //! \sa QsciAbstractDocumentProvider::isCancelled()
+    virtual ~QsciPagedDocument();
+
+    //! Returns the provider of the text.
+    QsciAbstractDocumentProvider *provider() const;
+
+    //! Sets the number of lines in a page to \a lines.  The document is
+    //! reloaded.  The default is 256.
+    //!
+    //! \sa pageSize(), reload()
+    void setPageSize(int lines);
+
+    //! Returns the number of lines in a page.
+    //!
+    //! \sa setPageSize()
+    int pageSize() const;
+
+    //! Sets the maximum number of pages that are kept once fetched to \a
+    //! pages.  Pages that have been edited and pages being displayed are not
+    //! counted.  The default is 64.
+    //!
+    //! \sa cacheSize()
+    void setCacheSize(int pages);
+
+    //! Returns the maximum number of pages that are kept once fetched.
+    //!
+    //! \sa setCacheSize()
+    int cacheSize() const;
+
+    //! If \a editable is true then the document may be edited.  The default
+    //! is false.
+    //!
+    //! \sa isEditable()
+    void setEditable(bool editable);
+
+    //! Returns true if the document may be edited.
+    //!
+    //! \sa setEditable()
+    bool isEditable() const;
+
+    //! Returns the current number of pages.
+    int pageCount() const;
+
+    //! Returns true if the text of page \a page has been fetched and not yet
+    //! discarded.
+    bool isPageLoaded(int page) const;
+
+    //! Returns true if page \a page has been edited.
+    bool isPageEdited(int page) const;
+
+    //! \internal Reimplemented to receive the pages fetched by the worker
+    //! thread.
+    virtual bool event(QEvent *e);
+
+public slots:
+    //! Discard all fetched and edited pages and size the document from a new
+    //! estimate of the number of lines from the provider.
+    void reload();
+
+signals:
+    //! This signal is emitted when the text of page \a page has been fetched
+    //! and displayed.
+    //!
+    //! \sa pageEvicted()
+    void pageLoaded(int page);
+
+    //! This signal is emitted when the text of page \a page has been discarded
+    //! from the cache.
+    //!
+    //! \sa pageLoaded()
+    void pageEvicted(int page);
+
+private slots:
+    void handleUpdateUI(int updated);
+    void handleModified(int pos, int mtype, const char *text, int len,
+            int added, int line, int foldNow, int foldPrev, int token,
+            int annotationLinesAdded);
+
+private:
+    enum PageState {
+        PagePlaceholder,
+        PageLoaded,
+        PageEdited
+    };
+
+    QsciAbstractDocumentProvider *prov;
+    QsciScintilla *qsci;
+    QsciPagedDocumentWorker *worker;
+    int page_size;
+    int cache_size;
+    bool editable;
+    bool complete;
+    bool replacing;
+    int generation;
+    int nr_edited;
+    int first_shown;
+    int last_shown;
+    QVector<int> page_lines;
+    QVector<int> page_starts;
+    QVector<PageState> page_states;
+    QList<int> lru;
+    int saved_first_visible;
+    int saved_caret_line, saved_caret_index;
+    int saved_anchor_line, saved_anchor_index;
+
+    int pageAt(int line) const;
+    void updatePageStarts();
+    void requestShownPages();
+    void loadPage(int page, QByteArray text);
+    void evictPages();
+    void beginReplace();
+    void replaceLines(int line, int nr_lines, const QByteArray &text);
+    void endReplace();
+
+    QsciPagedDocument(const QsciPagedDocument &);
+    QsciPagedDocument &operator=(const QsciPagedDocument &);
+};
+
+#endif
@@ -79,6 +79,16 @@ public:
         AiClosing = 0x04
     };
 
+    //! This enum defines what happens to a position anchor when text is
+    //! inserted at its position.
+    enum AnchorGravity {
+        //! The anchor stays before the inserted text.
+        AnchorBefore = QsciScintillaBase::SC_ANCHORGRAVITY_BEFORE,
+
+        //! The anchor moves after the inserted text.
+        AnchorAfter = QsciScintillaBase::SC_ANCHORGRAVITY_AFTER,
+    };
+
     //! This enum defines the different annotation display styles.
     enum AnnotationDisplay {
         //! Annotations are not displayed.
@@ -597,6 +607,12 @@ public:
     //! \sa setAutoCompletionSource()
     AutoCompletionSource autoCompletionSource() const {return acSource;}
 
+    //! Returns the maximum number of entries displayed in the auto-completion
+    //! list.
+    //!
+    //! \sa setAutoCompletionLimit()
+    int autoCompletionLimit() const {return acLimit;}
+
     //! Returns the current threshold for the automatic display of the
     //! auto-completion list as the user types.
     //!
@@ -704,6 +720,13 @@ public:
     //! The menu's ownership is transferred to the caller.
     QMenu *createStandardContextMenu();
 
+    //! Discards the recorded edits made before version \a version.  This
+    //! should be done once the edits have been exported to every copy of the
+    //! document to limit the memory used.
+    //!
+    //! \sa exportEdits(), setEditJournalEnabled()
+    void discardEdits(int version);
+
     //! Returns the attached document.
     //!
     //! \sa setDocument()
@@ -732,6 +755,22 @@ public:
     //! \sa setEdgeMode()
     EdgeMode edgeMode() const;
 
+    //! Returns true if the edits made to the document are being recorded.
+    //!
+    //! \sa setEditJournalEnabled()
+    bool editJournalEnabled() const {return edit_journal;}
+
+    //! Returns the version of the document which is the number of insertions
+    //! and deletions that have been made to it.
+    //!
+    //! \sa exportEdits()
+    int editVersion() const;
+
+    //! Returns true if elastic tabstops are enabled.
+    //!
+    //! \sa setElasticTabstops()
+    bool elasticTabstops() const;
+
     //! Set the default font.  This has no effect if a language lexer has been
     //! set.
     void setFont(const QFont &f);
@@ -746,6 +785,16 @@ public:
     //! \sa setEolVisibility()
     bool eolVisibility() const;
 
+    //! Returns the edits made to the document since version \a fromVersion as
+    //! a compact binary delta that can be applied to a copy of the document
+    //! at that version with importEdits().  This is much smaller than the
+    //! text of the document or the notifications of each change.  If
+    //! \a compress is true then the delta is also compressed.  An empty
+    //! array is returned if the edits have not been recorded.
+    //!
+    //! \sa editVersion(), importEdits(), setEditJournalEnabled()
+    QByteArray exportEdits(int fromVersion, bool compress = false) const;
+
     //! Returns the extra space added to the height of a line above the
     //! baseline of the text.
     //!
@@ -842,6 +891,18 @@ public:
     //! \sa cancelFind(), findFirst(), findFirstInSelection(), replace()
     virtual bool findNext();
 
+    //! Find the first run of text between the positions \a from and \a to
+    //! that has any of the styles in \a styles, where a run is text that all
+    //! has the same style.  If \a to is -1 then the search is to the end of
+    //! the document.  Any unstyled text in the range is styled first.  If a
+    //! run is found then \a *start and \a *end are set to the part of it
+    //! between \a from and \a to and true is returned.  The search is much
+    //! quicker for large documents if the style index is enabled.
+    //!
+    //! \sa setStyleIndexEnabled(), styleRuns()
+    bool findStyleRun(const QList<int> &styles, int *start, int *end,
+            int from = 0, int to = -1);
+
     //! Find a brace and it's match.  \a brace is updated with the position of
     //! the brace and will be -1 if there is none.  \a is updated with the
     //! position of the matching brace and will be -1 if there is none.
@@ -876,11 +937,43 @@ public:
     void getSelection(int *lineFrom, int *indexFrom, int *lineTo,
             int *indexTo) const;
 
+    //! Sets \a *characters, \a *words, \a *lines and \a *nonBlankLines to
+    //! the number of characters, words, lines and lines containing something
+    //! other than whitespace in the selected text.  When there are multiple
+    //! selections the counts are the totals of the selections that are not
+    //! empty.
+    //!
+    //! \sa getTextStatistics()
+    void getSelectionStatistics(int *characters, int *words, int *lines,
+            int *nonBlankLines) const;
+
+    //! Sets \a *characters, \a *words, \a *lines and \a *nonBlankLines to
+    //! the number of characters, words, lines and lines containing something
+    //! other than whitespace in the text from position \a start up to
+    //! position \a end.  If \a end is -1 then the text up to the end of the
+    //! document is counted.  A word is a sequence of word characters.  The
+    //! number of lines is the number of lines that contain part of the text.
+    //!
+    //! Unless text statistics are enabled the counts are found by examining
+    //! all of the text.
+    //!
+    //! \sa getSelectionStatistics(), setTextStatisticsEnabled()
+    void getTextStatistics(int *characters, int *words, int *lines,
+            int *nonBlankLines, int start = 0, int end = -1) const;
+
     //! Returns true if some text is selected.
     //!
     //! \sa selectedText()
     bool hasSelectedText() const {return selText;}
 
+    //! Applies the edits in \a delta, which was returned by exportEdits(), to
+    //! the document as a single change that can be undone.  false is returned
+    //! without changing the document if the delta is invalid or the document
+    //! is not the same length as the one it was exported from.
+    //!
+    //! \sa exportEdits()
+    bool importEdits(const QByteArray &delta);
+
     //! Returns the number of characters that line \a line is indented by.
     //!
     //! \sa setIndentation()
@@ -963,6 +1056,12 @@ public:
     //! \sa wordCharacters()
     bool isWordCharacter(char ch) const;
 
+    //! Returns the number of pages of lines that are laid out ahead of
+    //! scrolling.
+    //!
+    //! \sa setLayoutPrefetch()
+    int layoutPrefetch() const;
+
     //! Returns the line which is at \a point pixel coordinates or -1 if there
     //! is no line at that point.
     int lineAt(const QPoint &point) const;
@@ -1121,6 +1220,53 @@ public:
     //! \sa markerFindNext()
     int markerFindPrevious(int linenr, unsigned mask) const;
 
+    //! Add a position anchor at the position \a pos and return its handle.
+    //! A position anchor moves with edits to the text so that it stays in
+    //! the same place relative to the text around it.  \a gravity decides
+    //! whether text inserted at the anchor goes after it or before it.  An
+    //! anchor inside deleted text moves to the start of the deletion.
+    //! Anchors belong to the document and so are shared by all editors that
+    //! display it.
+    //!
+    //! \sa addPositionAnchors(), positionAnchorPosition(),
+    //! deletePositionAnchors()
+    int addPositionAnchor(int pos, AnchorGravity gravity = AnchorBefore);
+
+    //! Add a position anchor at each of the positions in \a positions and
+    //! return their handles in the same order.
+    //!
+    //! \sa addPositionAnchor()
+    QList<int> addPositionAnchors(const QList<int> &positions,
+            AnchorGravity gravity = AnchorBefore);
+
+    //! Return the current position of the position anchor with the handle
+    //! \a handle or -1 if there is no such anchor.
+    //!
+    //! \sa positionAnchorPositions()
+    int positionAnchorPosition(int handle) const;
+
+    //! Return the current positions of the position anchors with the handles
+    //! in \a handles in the same order.  The position of a handle that is
+    //! not an anchor is -1.  This is quicker than calling
+    //! positionAnchorPosition() for each handle.
+    //!
+    //! \sa positionAnchorPosition()
+    QList<int> positionAnchorPositions(const QList<int> &handles) const;
+
+    //! Return the handles, in position order, of the position anchors at or
+    //! after the position \a start and before the position \a end.
+    QList<int> positionAnchorsInRange(int start, int end) const;
+
+    //! Delete the position anchors with the handles in \a handles.
+    //!
+    //! \sa addPositionAnchor(), deleteAllPositionAnchors()
+    void deletePositionAnchors(const QList<int> &handles);
+
+    //! Delete all position anchors.
+    //!
+    //! \sa deletePositionAnchors()
+    void deleteAllPositionAnchors();
+
     //! Returns true if text entered by the user will overwrite existing text.
     //!
     //! \sa setOverwriteMode()
@@ -1140,6 +1286,25 @@ public:
     //! \sa lineIndexFromPosition()
     int positionFromLineIndex(int line, int index) const;
 
+    //! Returns the positions corresponding to a list of lines and UTF-16 code
+    //! unit indexes from the start of those lines.  \a line_indexes contains
+    //! each line number followed by its index.  An index past the end of its
+    //! line corresponds to the end of the line.  This is the form of position
+    //! used by the Language Server Protocol.
+    //!
+    //! \sa positionsFromUtf16Offsets(), utf16LineIndexesFromPositions()
+    QList<int> positionsFromUtf16LineIndexes(const QList<int> &line_indexes);
+
+    //! Returns the positions corresponding to a list of UTF-16 code unit
+    //! offsets from the start of the text.  All of the offsets are converted
+    //! in a single pass over the text which is much faster than converting
+    //! each separately.  The first time that offsets or positions of UTF-8
+    //! text are converted an index of the UTF-16 offsets of each line is
+    //! created and then maintained as the text changes.
+    //!
+    //! \sa positionsFromUtf16LineIndexes(), utf16OffsetsFromPositions()
+    QList<int> positionsFromUtf16Offsets(const QList<int> &offsets);
+
     //! Reads the current document from the \a io device and returns true if
     //! there was no error.
     //!
@@ -1301,6 +1466,22 @@ public:
     //! \sa edgeMode()
     void setEdgeMode(EdgeMode mode);
 
+    //! If \a enabled is true then the insertions and deletions made to the
+    //! document are recorded so that they can be exported with exportEdits().
+    //! The default is false.
+    //!
+    //! \sa editJournalEnabled(), exportEdits()
+    void setEditJournalEnabled(bool enabled);
+
+    //! If \a elastic is true then elastic tabstops are enabled.  The tabs on
+    //! consecutive lines that contain tabs are then positioned so that the
+    //! text between them lines up in columns, each as wide as its widest
+    //! cell.  Any tabstops set explicitly are discarded.  The default is
+    //! false.
+    //!
+    //! \sa elasticTabstops()
+    void setElasticTabstops(bool elastic);
+
     //! Set the number of the first visible line to \a linenr.
     //!
     //! \sa firstVisibleLine()
@@ -1333,6 +1514,14 @@ public:
     //! At the moment only the alpha value of the colour has any affect.
     void setIndicatorOutlineColor(const QColor &col, int indicatorNumber = -1);
 
+    //! Set the number of pages of lines that are styled and laid out, while
+    //! idle, ahead of the direction of scrolling to \a pages.  This makes
+    //! scrolling through large documents smoother.  If \a pages is 0 then
+    //! prefetching is disabled.  The default is 0.
+    //!
+    //! \sa layoutPrefetch()
+    void setLayoutPrefetch(int pages);
+
     //! Sets the background color of margin \a margin to \a col.
     //!
     //! \sa marginBackgroundColor()
@@ -1426,12 +1615,33 @@ public:
     //! \sa setScrollWidth(), scrollWidthTracking()
     void setScrollWidthTracking(bool enabled);
 
+    //! If the style index is enabled then the styles used in each part of the
+    //! document are recorded as the text is styled so that findStyleRun() and
+    //! styleRuns() can skip the parts that don't use the styles being
+    //! searched for.  This is intended for large documents where only the
+    //! text with certain styles, such as comments, is of interest.  The style
+    //! index is enabled if \a enabled is true.  The default is false.
+    //!
+    //! \sa styleIndexEnabled(), findStyleRun()
+    void setStyleIndexEnabled(bool enabled);
+
     //! Sets the mode used to draw tab characters when whitespace is visible to
     //! \a mode.  The default is to use an arrow.
     //!
     //! \sa tabDrawMode()
     void setTabDrawMode(TabDrawMode mode);
 
+    //! If text statistics are enabled then counts of the text are updated as
+    //! the document changes so that getTextStatistics() and
+    //! getSelectionStatistics() take a time that hardly depends on the amount
+    //! of text being counted.  This is intended for status bars that show
+    //! statistics after every change to large documents.  It uses a small
+    //! amount of memory and slightly slows down changes to the text.  Text
+    //! statistics are enabled if \a enabled is true.  The default is false.
+    //!
+    //! \sa textStatisticsEnabled(), getTextStatistics()
+    void setTextStatisticsEnabled(bool enabled);
+
     //! Set the background colour used to display unmatched braces to \a col.
     //! It is ignored if an indicator is being used.  The default is white.
     //!
@@ -1455,6 +1665,17 @@ public:
     //! \sa setUnmatchedBraceIndicator()
     void resetUnmatchedBraceIndicator();
 
+    //! Sets the number of documents replaced by setDocument() whose folding,
+    //! line wrapping, selection and scroll position are kept to \a size.
+    //! Setting one of these documents again restores its view without
+    //! unfolding or wrapping every line, so switching between large
+    //! documents is immediate.  Only the lines changed while a document was
+    //! not displayed are wrapped again.  The default is 0 so that no views are
+    //! kept.
+    //!
+    //! \sa viewStateCacheSize(), setDocument()
+    void setViewStateCacheSize(int size);
+
     //! Set the visual flags displayed when a line is wrapped.  \a endFlag
     //! determines if and where the flag at the end of a line is displayed.
     //! \a startFlag determines if and where the flag at the start of a line is
@@ -1549,6 +1770,21 @@ public:
     //! The standard command set is returned.
     QsciCommandSet *standardCommands() const {return stdCmds;}
 
+    //! Returns true if the style index is enabled.
+    //!
+    //! \sa setStyleIndexEnabled()
+    bool styleIndexEnabled() const {return style_index;}
+
+    //! Returns the start and end positions of all of the runs of text between
+    //! the positions \a start and \a end that have any of the styles in
+    //! \a styles.  The list contains the start of each run followed by its
+    //! end.  If \a end is -1 then the runs up to the end of the document are
+    //! returned.
+    //!
+    //! \sa findStyleRun()
+    QList<int> styleRuns(const QList<int> &styles, int start = 0,
+            int end = -1);
+
     //! Returns the mode used to draw tab characters when whitespace is
     //! visible.
     //!
@@ -1566,6 +1802,11 @@ public:
     //! \sa setTabWidth()
     int tabWidth() const;
 
+    //! Returns true if text statistics are enabled.
+    //!
+    //! \sa setTextStatisticsEnabled()
+    bool textStatisticsEnabled() const {return text_statistics;}
+
     //! Returns the text of the current document.
     //!
     //! \sa setText()
@@ -1594,6 +1835,26 @@ public:
     //! \sa setWhitespaceSize()
     int whitespaceSize() const;
 
+    //! Returns a list of the lines and UTF-16 code unit indexes from the start
+    //! of those lines corresponding to a list of positions.  The list contains
+    //! each line number followed by its index.
+    //!
+    //! \sa positionsFromUtf16LineIndexes(), utf16OffsetsFromPositions()
+    QList<int> utf16LineIndexesFromPositions(const QList<int> &positions);
+
+    //! Returns the UTF-16 code unit offsets from the start of the text
+    //! corresponding to a list of positions.  All of the positions are
+    //! converted in a single pass over the text.
+    //!
+    //! \sa positionsFromUtf16Offsets(), utf16LineIndexesFromPositions()
+    QList<int> utf16OffsetsFromPositions(const QList<int> &positions);
+
+    //! Returns the number of documents whose view is kept when they are
+    //! replaced by setDocument().
+    //!
+    //! \sa setViewStateCacheSize()
+    int viewStateCacheSize() const;
+
     //! Returns the visibility of whitespace.
     //!
     //! \sa setWhitespaceVisibility()
@@ -1778,6 +2039,16 @@ public slots:
     //! \sa autoCompletionSource()
     virtual void setAutoCompletionSource(AutoCompletionSource source);
 
+    //! Sets the maximum number of entries displayed in the auto-completion
+    //! list to \a limit.  The entries that come first in the sorted list are
+    //! kept.  If entries have been left out then the list is created again
+    //! each time the user types or deletes a character while it is displayed.
+    //! If the limit is less than or equal to 0 then all entries are displayed.
+    //! The default is 0.
+    //!
+    //! \sa autoCompletionLimit()
+    virtual void setAutoCompletionLimit(int limit);
+
     //! Sets the threshold for the automatic display of the auto-completion
     //! list as the user types to \a thresh.  The threshold is the number of
     //! characters that the user must type before the list is displayed.  If
@@ -2164,6 +2435,7 @@ protected:
     virtual void wheelEvent(QWheelEvent *e);
 
 private slots:
+    void handleAutoCompletionCharDeleted();
     void handleCallTipClick(int dir);
     void handleCharAdded(int charadded);
     void handleIndicatorClick(int pos, int modifiers);
@@ -2214,6 +2486,7 @@ private:
     int indentWidth() const;
     bool doFind();
     int simpleFind();
+    QList<int> convertUtf16(int msg, const QList<int> &values);
     void foldClick(int lineClick, int bstate);
     void foldChanged(int line, int levelNow, int levelPrev);
     void foldExpand(int &line, bool doExpand, bool force = false,
@@ -2279,6 +2552,9 @@ private:
     BraceMatch braceMode;
     AutoCompletionSource acSource;
     int acThresh;
+    int acLimit;
+    bool acTruncated;
+    AutoCompletionSource acTruncatedSource;
     QStringList wseps;
     const char *wchars;
     CallTipsPosition call_tips_position;
@@ -2295,6 +2571,10 @@ private:
     QColor nl_paper_colour;
     QByteArray explicit_fillups;
     bool fillups_enabled;
+    bool text_statistics;
+    bool style_index;
+    bool utf16_index;
+    bool edit_journal;
 
     // The following allow QsciListBoxQt to distinguish between an
     // auto-completion list and a user list, and to return the full selection
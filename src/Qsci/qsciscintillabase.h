@@ -41,6 +41,7 @@ class QUrl;
 QT_END_NAMESPACE
 
 class QsciScintillaQt;
+class QsciSessionRecorder;
 
 
 //! \brief The QsciScintillaBase class implements the Scintilla editor widget
@@ -146,6 +147,83 @@ public:
         //! \sa SCI_MARKERADD
         SCI_MARKERDELETEHANDLE = 2018,
 
+        //! This message adds a position anchor that moves with edits to the
+        //! text and returns its handle.
+        //! \a wParam is the position of the anchor.
+        //! \a lParam is the gravity of the anchor, either
+        //! SC_ANCHORGRAVITY_BEFORE or SC_ANCHORGRAVITY_AFTER.
+        //!
+        //! \sa SCI_POSITIONANCHORDELETE, SCI_POSITIONANCHORPOSITION
+        SCI_POSITIONANCHORADD = 2725,
+
+        //! This message deletes a position anchor.
+        //! \a wParam is the handle of the anchor.
+        //!
+        //! \sa SCI_POSITIONANCHORADD
+        SCI_POSITIONANCHORDELETE = 2726,
+
+        //! This message deletes the position anchor at an index in position
+        //! order.
+        //! \a wParam is the index of the anchor.
+        //!
+        //! \sa SCI_POSITIONANCHORINDEXFROMPOSITION
+        SCI_POSITIONANCHORDELETEAT = 2727,
+
+        //! This message deletes all position anchors.
+        //!
+        //! \sa SCI_POSITIONANCHORADD
+        SCI_POSITIONANCHORDELETEALL = 2728,
+
+        //! This message returns the position of a position anchor or -1 if
+        //! there is no such anchor.
+        //! \a wParam is the handle of the anchor.
+        //!
+        //! \sa SCI_POSITIONANCHORADD
+        SCI_POSITIONANCHORPOSITION = 2729,
+
+        //! This message returns the number of position anchors.
+        SCI_POSITIONANCHORCOUNT = 2730,
+
+        //! This message returns the index in position order of the first
+        //! position anchor at or after a position.
+        //! \a wParam is the position.
+        //!
+        //! \sa SCI_POSITIONANCHORHANDLEAT, SCI_POSITIONANCHORPOSITIONAT
+        SCI_POSITIONANCHORINDEXFROMPOSITION = 2731,
+
+        //! This message returns the handle of the position anchor at an index
+        //! in position order.
+        //! \a wParam is the index of the anchor.
+        SCI_POSITIONANCHORHANDLEAT = 2732,
+
+        //! This message returns the position of the position anchor at an
+        //! index in position order.
+        //! \a wParam is the index of the anchor.
+        SCI_POSITIONANCHORPOSITIONAT = 2733,
+
+        //! This message returns the gravity of the position anchor at an index
+        //! in position order.
+        //! \a wParam is the index of the anchor.
+        SCI_POSITIONANCHORGRAVITYAT = 2734,
+
+        //! This message replaces each of an array of position anchor handles
+        //! with the position of its anchor, or -1 if there is no such anchor.
+        //! \a wParam is the number of handles.
+        //! \a lParam is the address of the array of handles.  Each is the size
+        //! of a pointer.
+        //!
+        //! \sa SCI_POSITIONANCHORPOSITION
+        SCI_POSITIONANCHORPOSITIONS = 2752,
+
+        //! This message deletes the position anchors with an array of
+        //! handles.
+        //! \a wParam is the number of handles.
+        //! \a lParam is the address of the array of handles.  Each is the size
+        //! of a pointer.
+        //!
+        //! \sa SCI_POSITIONANCHORDELETE
+        SCI_POSITIONANCHORDELETEHANDLES = 2753,
+
         //!
         SCI_GETUNDOCOLLECTION = 2019,
 
@@ -821,6 +899,30 @@ public:
         //!
         SCI_GETSEARCHFLAGS = 2199,
 
+        //! This message searches the target for the first run of text that
+        //! has any of a set of styles.  If a run is found the target is set to
+        //! the part of the run inside the target and the start of the run is
+        //! returned, otherwise -1 is returned.
+        //! \a wParam is the number of styles.
+        //! \a lParam is the address of an array of styles, one per byte.
+        //!
+        //! \sa SCI_ALLOCATESTYLEINDEX, SCI_SEARCHINTARGET
+        SCI_SEARCHSTYLEINTARGET = 2739,
+
+        //! This message requests that the styles used in each part of the
+        //! document be indexed so that SCI_SEARCHSTYLEINTARGET does not need to
+        //! examine the style of every byte.  Each use must be matched by a
+        //! SCI_RELEASESTYLEINDEX message.
+        //!
+        //! \sa SCI_RELEASESTYLEINDEX
+        SCI_ALLOCATESTYLEINDEX = 2740,
+
+        //! This message releases a use of the style index.  It is removed when
+        //! it is no longer used.
+        //!
+        //! \sa SCI_ALLOCATESTYLEINDEX
+        SCI_RELEASESTYLEINDEX = 2741,
+
         //!
         SCI_CALLTIPSHOW = 2200,
 
@@ -974,6 +1076,18 @@ public:
         //!
         SCI_GETLAYOUTCACHE = 2273,
 
+        //!
+        SCI_SETLAYOUTPREFETCH = 2721,
+
+        //!
+        SCI_GETLAYOUTPREFETCH = 2722,
+
+        //!
+        SCI_GETLAYOUTPREFETCHHITS = 2723,
+
+        //!
+        SCI_GETLAYOUTPREFETCHMISSES = 2724,
+
         //!
         SCI_SETSCROLLWIDTH = 2274,
 
@@ -1215,6 +1329,20 @@ public:
         //!
         SCI_SETDOCPOINTER = 2358,
 
+        //! This message sets the number of documents replaced by
+        //! SCI_SETDOCPOINTER whose folding, line heights, laid out lines,
+        //! selection and scroll position are kept so that their view can be
+        //! restored quickly.  The default is 0.
+        //! \a wParam is the number of documents.
+        //!
+        //! \sa SCI_GETVIEWSTATECACHESIZE
+        SCI_SETVIEWSTATECACHESIZE = 2750,
+
+        //! This message returns the number of documents whose view is kept.
+        //!
+        //! \sa SCI_SETVIEWSTATECACHESIZE
+        SCI_GETVIEWSTATECACHESIZE = 2751,
+
         //!
         SCI_SETMODEVENTMASK = 2359,
 
@@ -1479,6 +1607,12 @@ public:
         //!
         SCI_ALLOCATE = 2446,
 
+        //!
+        SCI_TARGETASUTF8 = 2447,
+
+        //!
+        SCI_ENCODEDFROMUTF8 = 2449,
+
         //!
         SCI_HOMEWRAP = 2349,
 
@@ -1799,6 +1933,51 @@ public:
         //!
         SCI_ADDUNDOACTION = 2560,
 
+        //! This message requests that the insertions and deletions made to
+        //! the document be recorded so that they can be exported with
+        //! SCI_EXPORTEDITS.  Each use must be matched by a
+        //! SCI_RELEASEEDITJOURNAL message.
+        //!
+        //! \sa SCI_RELEASEEDITJOURNAL, SCI_GETEDITVERSION
+        SCI_ALLOCATEEDITJOURNAL = 2744,
+
+        //! This message releases a use of the edit journal.  It is removed
+        //! when it is no longer used.
+        //!
+        //! \sa SCI_ALLOCATEEDITJOURNAL
+        SCI_RELEASEEDITJOURNAL = 2745,
+
+        //! This message returns the version of the document, which is the
+        //! number of insertions and deletions made to it.
+        //!
+        //! \sa SCI_EXPORTEDITS
+        SCI_GETEDITVERSION = 2746,
+
+        //! This message copies the edits made since a version as a binary
+        //! delta and returns its length, or 0 if the edits have not been
+        //! recorded.
+        //! \a wParam is the version.
+        //! \a lParam is the address of a buffer for the delta, or 0 to just
+        //! return its length.
+        //!
+        //! \sa SCI_IMPORTEDITS, SCI_DISCARDEDITS
+        SCI_EXPORTEDITS = 2747,
+
+        //! This message applies a delta made by SCI_EXPORTEDITS as a single
+        //! undoable change and returns true, or false if the delta could not
+        //! be applied.
+        //! \a wParam is the length of the delta.
+        //! \a lParam is the address of the delta.
+        //!
+        //! \sa SCI_EXPORTEDITS
+        SCI_IMPORTEDITS = 2748,
+
+        //! This message discards the recorded edits made before a version.
+        //! \a wParam is the version.
+        //!
+        //! \sa SCI_EXPORTEDITS
+        SCI_DISCARDEDITS = 2749,
+
         //!
         SCI_CHARPOSITIONFROMPOINT = 2561,
 
@@ -2162,6 +2341,12 @@ public:
         //!
         SCI_GETNEXTTABSTOP = 2677,
 
+        //!
+        SCI_SETELASTICTABSTOPS = 2719,
+
+        //!
+        SCI_GETELASTICTABSTOPS = 2720,
+
         //!
         SCI_GETIMEINTERACTION = 2678,
 
@@ -2357,6 +2542,59 @@ public:
         //!
         SCI_COUNTCODEUNITS = 2715,
 
+        //! This message requests that counts of the text be kept up to date
+        //! with each change so that counting characters, code units, words
+        //! and non-blank lines takes a time that does not depend on the length
+        //! of the text being counted.  Each use must be matched by a
+        //! SCI_RELEASETEXTSTATISTICS message.
+        //!
+        //! \sa SCI_RELEASETEXTSTATISTICS
+        SCI_ALLOCATETEXTSTATISTICS = 2735,
+
+        //! This message releases a use of the text statistics.  They are
+        //! removed when they are no longer used.
+        //!
+        //! \sa SCI_ALLOCATETEXTSTATISTICS
+        SCI_RELEASETEXTSTATISTICS = 2736,
+
+        //! This message returns the number of words in a range of text.  A word
+        //! is a run of word characters.
+        //! \a wParam is the start of the range.
+        //! \a lParam is the end of the range.
+        //!
+        //! \sa SCI_COUNTNONBLANKLINES, SCI_SETWORDCHARS
+        SCI_COUNTWORDS = 2737,
+
+        //! This message returns the number of lines in a range of text that
+        //! contain characters other than whitespace.
+        //! \a wParam is the start of the range.
+        //! \a lParam is the end of the range.
+        //!
+        //! \sa SCI_COUNTWORDS
+        SCI_COUNTNONBLANKLINES = 2738,
+
+        //! This message converts an array of UTF-16 code unit offsets from the
+        //! start of the document to positions, replacing each offset with its
+        //! position.  The values are converted in a single pass which is
+        //! faster still if the SC_LINECHARACTERINDEX_UTF16 line index has been
+        //! allocated.
+        //! \a wParam is the number of values.
+        //! \a lParam is the address of the array of values.  Each is the size
+        //! of a pointer.
+        //!
+        //! \sa SCI_CODEUNITSFROMPOSITIONS, SCI_ALLOCATELINECHARACTERINDEX
+        SCI_POSITIONSFROMCODEUNITS = 2742,
+
+        //! This message converts an array of positions to UTF-16 code unit
+        //! offsets from the start of the document, replacing each position
+        //! with its offset.
+        //! \a wParam is the number of values.
+        //! \a lParam is the address of the array of values.  Each is the size
+        //! of a pointer.
+        //!
+        //! \sa SCI_POSITIONSFROMCODEUNITS
+        SCI_CODEUNITSFROMPOSITIONS = 2743,
+
         //!
         SCI_POSITIONRELATIVECODEUNITS = 2716,
 
@@ -2408,6 +2646,12 @@ public:
         SC_CARETSTICKY_WHITESPACE = 2
     };
 
+    enum
+    {
+        SC_ANCHORGRAVITY_BEFORE = 0,
+        SC_ANCHORGRAVITY_AFTER = 1
+    };
+
     enum
     {
         SC_DOCUMENTOPTION_DEFAULT = 0x0000,
@@ -3487,6 +3731,22 @@ public:
     //! QAbstractScrollArea::setHorizontalScrollBar().
     void replaceVerticalScrollBar(QScrollBar *scrollBar);
 
+    //! Sets the maximum number of bytes of text before and after the caret
+    //! that is given to an input method as the text surrounding the cursor
+    //! to \a length.  The text is also limited to the paragraph containing
+    //! the caret and never splits a character or a combining sequence.  The
+    //! current selection reported to an input method is limited to the same
+    //! text.  The default is 1024.
+    //!
+    //! \sa inputMethodContextLength()
+    void setInputMethodContextLength(int length);
+
+    //! Returns the maximum number of bytes of text before and after the caret
+    //! that is given to an input method.
+    //!
+    //! \sa setInputMethodContextLength()
+    int inputMethodContextLength() const {return imContextLength;}
+
     //! Send the Scintilla message \a msg with the optional parameters \a
     //! wParam and \a lParam.
     long SendScintilla(unsigned int msg, unsigned long wParam = 0,
@@ -3787,6 +4047,12 @@ protected:
     //! \sa canInsertFromMimeData(), fromMimeData()
     virtual QMimeData *toMimeData(const QByteArray &text, bool rectangular) const;
 
+    //! \reimp
+    virtual bool event(QEvent *e);
+
+    //! \reimp
+    virtual bool viewportEvent(QEvent *e);
+
     //! \reimp
     virtual void changeEvent(QEvent *e);
 
@@ -3867,6 +4133,9 @@ private:
     // This is needed to allow QsciScintillaQt to emit this class's signals.
     friend class QsciScintillaQt;
 
+    // This is needed to allow QsciSessionRecorder to attach itself.
+    friend class QsciSessionRecorder;
+
     QsciScintillaQt *sci;
     QPoint triple_click_at;
     QTimer triple_click;
@@ -3874,6 +4143,20 @@ private:
     int preeditNrBytes;
     QString preeditString;
     bool clickCausedFocus;
+    QsciSessionRecorder *recorder;
+    int imContextLength;
+
+    // The text around the caret last given to an input method and the state
+    // of the document it was taken from.
+    mutable void *imContextDoc;
+    mutable long imContextVersion;
+    mutable int imContextPos;
+    mutable int imContextAnchor;
+    mutable QString imContextText;
+    mutable int imContextCursor;
+    mutable int imContextAnchorOffset;
+
+    void updateInputMethodContext() const;
 
     void connectHorizontalScrollBar();
     void connectVerticalScrollBar();
@@ -0,0 +1,159 @@
+// This defines the interface to the QsciSessionRecorder class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCISESSIONRECORDER_H
+#define QSCISESSIONRECORDER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <Qsci/qsciglobal.h>
+
+
+class QDataStream;
+class QEvent;
+class QsciScintillaBase;
+
+
+//! \brief The QsciSessionRecorder class records an editing session so that
+//! it can be replayed later with QsciSessionReplayer.
+//!
+//! When recording starts the state of the editor is captured as the messages
+//! needed to recreate it: the text, the lexer and its properties, keywords
+//! and styles, the view settings and the selection.  From then on every
+//! message sent with QsciScintillaBase::SendScintilla() and every key, mouse,
+//! wheel, input method, focus and resize event received by the editor is
+//! recorded with the time at which it happened.  Messages sent and events
+//! handled as a consequence of another message, event or notification are
+//! not recorded because replaying the original reproduces them.
+//!
+//! Messages whose arguments cannot be written to a file (such as document
+//! pointers and images) are counted but not recorded.  When recording stops
+//! the session is compressed and written to the file given to start().
+//!
+//! \sa QsciSessionReplayer
+class QSCINTILLA_EXPORT QsciSessionRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Construct a recorder for the editor \a editor.  The recorder becomes
+    //! a child of the editor.
+    QsciSessionRecorder(QsciScintillaBase *editor);
+
+    //! Destroys the recorder.  Any recording in progress is stopped.
+    virtual ~QsciSessionRecorder();
+
+    //! Returns the editor that the recorder is attached to.
+    QsciScintillaBase *editor() const;
+
+    //! Start recording to the file \a filename.  false is returned if a
+    //! recording is already in progress or if another recorder is recording
+    //! the editor.
+    //!
+    //! \sa stop()
+    bool start(const QString &filename);
+
+    //! Stop recording and write the session to the file.  false is returned
+    //! if no recording was in progress or if the file could not be written.
+    //!
+    //! \sa start()
+    bool stop();
+
+    //! Returns true if a recording is in progress.
+    bool isRecording() const;
+
+    //! Returns the number of messages and events recorded so far, not
+    //! including those that describe the initial state of the editor.
+    int recordCount() const;
+
+    //! Returns the number of messages that could not be recorded.
+    int skippedCount() const;
+
+private:
+    friend class QsciScintillaBase;
+    friend class QsciScintillaQt;
+    friend class QsciSessionReplayer;
+
+    // The types of the records in a session.
+    enum RecordType {
+        Message = 1,
+        StringMessage,
+        StringsMessage,
+        ResultMessage,
+        StringResultMessage,
+        RangeMessage,
+        Key,
+        Mouse,
+        Wheel,
+        InputMethod,
+        Focus,
+        Resize,
+        Scroll,
+        StateCaptured
+    };
+
+    // The file format.
+    enum {
+        Magic = 0x51534353,
+        Version = 1
+    };
+
+    QPointer<QsciScintillaBase> ed;
+    QString file_name;
+    QByteArray records;
+    QDataStream *out;
+    QElapsedTimer clock;
+    int depth;
+    int nr_records;
+    int nr_skipped;
+
+    void enter() {++depth;}
+    void leave() {if (depth > 0) --depth;}
+
+    void recordMessage(unsigned int msg, unsigned long wParam, long lParam);
+    void recordMessage(unsigned int msg, unsigned long wParam,
+            const void *lParam);
+    void recordMessage(unsigned int msg, uintptr_t wParam,
+            const char *lParam);
+    void recordMessage(unsigned int msg, const char *wParam,
+            const char *lParam);
+    void recordMessage(unsigned int msg, long cpMin, long cpMax);
+    void recordSkipped();
+    void recordEvent(QEvent *e, bool viewport);
+    void recordScroll(Qt::Orientation orientation, int value);
+
+    bool recording() const;
+    void beginRecord(RecordType type);
+    void captureState();
+    void captureSetting(int get_msg, int set_msg, int index = -1);
+    void captureStyles();
+
+    static bool isResultMessage(unsigned int msg);
+    static bool isStringResultMessage(unsigned int msg);
+
+    QsciSessionRecorder(const QsciSessionRecorder &);
+    QsciSessionRecorder &operator=(const QsciSessionRecorder &);
+};
+
+#endif
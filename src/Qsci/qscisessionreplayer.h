@@ -0,0 +1,114 @@
+// This defines the interface to the QsciSessionReplayer class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#ifndef QSCISESSIONREPLAYER_H
+#define QSCISESSIONREPLAYER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+
+#include <Qsci/qsciglobal.h>
+
+
+class QDataStream;
+class QsciScintillaBase;
+
+
+//! \brief The QsciSessionReplayer class replays a session recorded by
+//! QsciSessionRecorder and measures how long each step takes.
+//!
+//! The editor is first returned to the state it was in when the session was
+//! recorded.  Each recorded message is then sent and each recorded event is
+//! delivered to the editor in turn.  After each one any pending repaint of
+//! the editor is done immediately, and the time taken by both is the latency
+//! of the step.  Pending timers and posted events are processed between
+//! steps but are not included in the latency.
+//!
+//! The replayer does not need a visible display and is normally used with
+//! Qt's \c offscreen platform plugin.  The \c replay tool included with
+//! QScintilla does this and prints the report returned by report().
+//!
+//! \sa QsciSessionRecorder
+class QSCINTILLA_EXPORT QsciSessionReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Construct a replayer for the editor \a editor.  The replayer becomes
+    //! a child of the editor.
+    QsciSessionReplayer(QsciScintillaBase *editor);
+
+    //! Destroys the replayer.
+    virtual ~QsciSessionReplayer();
+
+    //! Returns the editor that the session is replayed in.
+    QsciScintillaBase *editor() const;
+
+    //! Load the session in the file \a filename.  false is returned if the
+    //! file could not be read or is not a recorded session.
+    bool load(const QString &filename);
+
+    //! Replay the session that was loaded.  If \a real_time is true then
+    //! each step is delayed until the same time after the start as when it
+    //! was recorded.  Otherwise the steps are replayed as quickly as
+    //! possible.  false is returned if no session is loaded or if the
+    //! session is corrupt.
+    bool replay(bool real_time = false);
+
+    //! Returns the number of steps replayed, not including those that
+    //! restored the initial state of the editor.
+    int stepCount() const;
+
+    //! Returns a description of the step \a step.
+    QString stepDescription(int step) const;
+
+    //! Returns the time, in microseconds after the start of the session,
+    //! that the step \a step was recorded.
+    qint64 stepTime(int step) const;
+
+    //! Returns the latency, in microseconds, of the step \a step.
+    qint64 stepLatency(int step) const;
+
+    //! Returns a report of the latencies of the steps of each kind and of
+    //! the slowest steps.
+    QString report() const;
+
+private:
+    QPointer<QsciScintillaBase> ed;
+    QByteArray records;
+    QList<int> step_types;
+    QList<qint64> step_times;
+    QList<qint64> step_latencies;
+    QStringList step_descriptions;
+
+    bool replayRecord(QDataStream &in, int type, QString &desc);
+    void flushUpdates();
+
+    static QString typeName(int type);
+
+    QsciSessionReplayer(const QsciSessionReplayer &);
+    QsciSessionReplayer &operator=(const QsciSessionReplayer &);
+};
+
+#endif
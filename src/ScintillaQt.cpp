@@ -30,6 +30,7 @@
 #include <qstring.h>
 
 #include "Qsci/qsciscintillabase.h"
+#include "Qsci/qscisessionrecorder.h"
 #include "ScintillaQt.h"
 #if !defined(QT_NO_ACCESSIBILITY)
 #include "SciAccessibility.h"
@@ -300,7 +301,15 @@ void QsciScintillaQt::ReconfigureScrollBars()
 // Notify interested parties of any change in the document.
 void QsciScintillaQt::NotifyChange()
 {
+    QsciSessionRecorder *rec = qsb->recorder;
+
+    if (rec)
+        rec->enter();
+
     emit qsb->SCEN_CHANGE();
+
+    if (rec)
+        rec->leave();
 }
 
 
@@ -308,6 +317,13 @@ void QsciScintillaQt::NotifyChange()
 // between Scintilla notifications and Qt signals.
 void QsciScintillaQt::NotifyParent(SCNotification scn)
 {
+    // Anything done in response to a notification is a consequence of
+    // something that a session recorder has already recorded.
+    QsciSessionRecorder *rec = qsb->recorder;
+
+    if (rec)
+        rec->enter();
+
     switch (scn.nmhdr.code)
     {
     case SCN_CALLTIPCLICK:
@@ -477,6 +493,9 @@ void QsciScintillaQt::NotifyParent(SCNotification scn)
     default:
         qWarning("Unknown notification: %u", scn.nmhdr.code);
     }
+
+    if (rec)
+        rec->leave();
 }
 
 
@@ -44,6 +44,25 @@ QsciLexer *QsciAbstractAPIs::lexer() const
 }
 
 
+// Add a sorted and limited number of auto-completion words to an existing
+// list.
+void QsciAbstractAPIs::updateSortedAutoCompletionList(
+        const QStringList &context, QStringList &list, int limit)
+{
+    QStringList entries;
+
+    updateAutoCompletionList(context, entries);
+
+    entries.sort();
+    entries.removeDuplicates();
+
+    if (limit > 0 && entries.count() > limit)
+        entries.erase(entries.begin() + limit, entries.end());
+
+    list += entries;
+}
+
+
 // Called when the user has made a selection from the auto-completion list.
 void QsciAbstractAPIs::autoCompletionSelected(const QString &selection)
 {
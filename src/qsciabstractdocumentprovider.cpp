@@ -0,0 +1,48 @@
+// This module implements the QsciAbstractDocumentProvider class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qsciabstractdocumentprovider.h"
+
+
+// The ctor.
+QsciAbstractDocumentProvider::QsciAbstractDocumentProvider(QObject *parent)
+    : QObject(parent), cancelled(0)
+{
+}
+
+
+// The dtor.
+QsciAbstractDocumentProvider::~QsciAbstractDocumentProvider()
+{
+}
+
+
+// Return true if the current fetch is no longer wanted.
+bool QsciAbstractDocumentProvider::isCancelled() const
+{
+    return cancelled.loadAcquire() != 0;
+}
+
+
+// Set whether the current fetch is no longer wanted.
+void QsciAbstractDocumentProvider::setCancelled(bool cancel)
+{
+    cancelled.storeRelease(cancel ? 1 : 0);
+}
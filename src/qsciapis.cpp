@@ -423,15 +423,31 @@ bool QsciAPIs::originStartsWith(const QString &path, const QString &wsep)
 // Add auto-completion words to an existing list.
 void QsciAPIs::updateAutoCompletionList(const QStringList &context,
         QStringList &list)
+{
+    updateSortedAutoCompletionList(context, list, 0);
+}
+
+
+// Add a sorted and limited number of auto-completion words to an existing
+// list.
+void QsciAPIs::updateSortedAutoCompletionList(const QStringList &context,
+        QStringList &list, int limit)
 {
     QString path;
     QStringList new_context = positionOrigin(context, path);
+    QStringList words;
 
     if (origin_len > 0)
     {
         const QString wsep = lexer()->autoCompletionWordSeparators().first();
         QStringList::const_iterator it = origin;
 
+        // Use a set to check for duplicates as the list may be long.
+        QSet<QString> list_set;
+
+        for (int i = 0; i < list.count(); ++i)
+            list_set.insert(list[i]);
+
         unambiguous_context = path;
 
         while (it != prep->raw_apis.end())
@@ -451,8 +467,11 @@ void QsciAPIs::updateAutoCompletionList(const QStringList &context,
                 // Append the space, we know the origin is unambiguous.
                 w.append(' ');
 
-                if (!list.contains(w))
-                    list << w;
+                if (!list_set.contains(w))
+                {
+                    list_set.insert(w);
+                    words << w;
+                }
             }
 
             ++it;
@@ -464,13 +483,25 @@ void QsciAPIs::updateAutoCompletionList(const QStringList &context,
         // mark the unambiguous context as unknown.
         unambiguous_context = QString();
 
-        bool unambig = true;
+        bool unambig = true, limited = false;
         QStringList with_context;
+        QSet<QString> with_context_set;
 
         if (new_context.last().isEmpty())
-            lastCompleteWord(new_context[new_context.count() - 2], with_context, unambig);
+            lastCompleteWord(new_context[new_context.count() - 2],
+                    with_context, with_context_set, unambig);
         else
-            lastPartialWord(new_context.last(), with_context, unambig);
+            limited = lastPartialWord(new_context.last(), with_context,
+                    with_context_set, unambig, limit);
+
+        // The entries that weren't added may have had a different context.
+        if (limited && unambig)
+        {
+            unambiguous_context.truncate(0);
+            unambig = false;
+        }
+
+        words.reserve(with_context.count());
 
         for (int i = 0; i < with_context.count(); ++i)
         {
@@ -493,9 +524,18 @@ void QsciAPIs::updateAutoCompletionList(const QStringList &context,
                 }
             }
 
-            list << noc;
+            words << noc;
         }
     }
+
+    // Only the words we have added need sorting.  The limit is applied to the
+    // sorted words.
+    words.sort();
+
+    if (limit > 0 && words.count() > limit)
+        words.erase(words.begin() + limit, words.end());
+
+    list += words;
 }
 
 
@@ -527,21 +567,33 @@ const QsciAPIs::WordIndexList *QsciAPIs::wordIndexOf(const QString &word) const
 
 
 // Add auto-completion words based on the last complete word entered.
-void QsciAPIs::lastCompleteWord(const QString &word, QStringList &with_context, bool &unambig)
+void QsciAPIs::lastCompleteWord(const QString &word,
+        QStringList &with_context, QSet<QString> &with_context_set,
+        bool &unambig)
 {
     // Get the possible API entries if any.
     const WordIndexList *wl = wordIndexOf(word);
 
     if (wl)
-        addAPIEntries(*wl, true, with_context, unambig);
+        addAPIEntries(*wl, true, with_context, with_context_set, unambig);
 }
 
 
-// Add auto-completion words based on the last partial word entered.
-void QsciAPIs::lastPartialWord(const QString &word, QStringList &with_context, bool &unambig)
+// Add auto-completion words based on the last partial word entered.  Return
+// true if the limit stopped any from being added.
+bool QsciAPIs::lastPartialWord(const QString &word,
+        QStringList &with_context, QSet<QString> &with_context_set,
+        bool &unambig, int limit)
 {
     if (lexer()->caseSensitive())
     {
+        // The words are visited in sorted order and each entry is its word
+        // followed by a space or by an image identifier.  Therefore the
+        // entries of a word sort after those of all earlier words, unless it
+        // extends an earlier word that has an entry with an image.  Once the
+        // limit is reached we can stop at the first word where neither is the
+        // case without changing which entries come first.
+        QStringList image_words;
         QMap<QString, WordIndexList>::const_iterator it = prep->wdict.lowerBound(word);
 
         while (it != prep->wdict.end())
@@ -549,13 +601,42 @@ void QsciAPIs::lastPartialWord(const QString &word, QStringList &with_context, b
             if (!it.key().startsWith(word))
                 break;
 
-            addAPIEntries(it.value(), false, with_context, unambig);
+            if (limit > 0 && with_context.count() >= limit)
+            {
+                bool extends_image = false;
+
+                for (int i = 0; i < image_words.count(); ++i)
+                    if (it.key().startsWith(image_words[i]))
+                    {
+                        extends_image = true;
+                        break;
+                    }
+
+                if (!extends_image)
+                    return true;
+            }
+
+            int first = with_context.count();
+
+            addAPIEntries(it.value(), false, with_context, with_context_set,
+                    unambig);
+
+            QString with_image = it.key() + '?';
+
+            for (int i = first; i < with_context.count(); ++i)
+                if (with_context[i].startsWith(with_image))
+                {
+                    image_words.append(it.key());
+                    break;
+                }
 
             ++it;
         }
     }
     else
     {
+        // The dictionary is in case insensitive order which isn't the order
+        // of the list, so all the words are needed before it can be limited.
         QMap<QString, QString>::const_iterator it = prep->cdict.lowerBound(word);
 
         while (it != prep->cdict.end())
@@ -563,11 +644,14 @@ void QsciAPIs::lastPartialWord(const QString &word, QStringList &with_context, b
             if (!it.key().startsWith(word))
                 break;
 
-            addAPIEntries(prep->wdict[it.value()], false, with_context, unambig);
+            addAPIEntries(prep->wdict[it.value()], false, with_context,
+                    with_context_set, unambig);
 
             ++it;
         }
     }
+
+    return false;
 }
 
 
@@ -612,7 +696,8 @@ void QsciAPIs::autoCompletionSelected(const QString &selection)
 // in the APIs) and depending on whether the word was complete (when it's
 // actually the next word in the API entry that is of interest) or not.
 void QsciAPIs::addAPIEntries(const WordIndexList &wl, bool complete,
-        QStringList &with_context, bool &unambig)
+        QStringList &with_context, QSet<QString> &with_context_set,
+        bool &unambig)
 {
     QStringList wseps = lexer()->autoCompletionWordSeparators();
 
@@ -672,8 +757,11 @@ void QsciAPIs::addAPIEntries(const WordIndexList &wl, bool complete,
             }
         }
 
-        if (!with_context.contains(api_word))
+        if (!with_context_set.contains(api_word))
+        {
+            with_context_set.insert(api_word);
             with_context.append(api_word);
+        }
     }
 }
 
@@ -19,20 +19,45 @@
 
 
 #include "Qsci/qscidocument.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Qsci/qscieditqueue.h"
 #include "Qsci/qsciscintillabase.h"
 
+#include "ILexer.h"
+#include "ILoader.h"
+#include "Platform.h"
+#include "Scintilla.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "Position.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "RunStyles.h"
+#include "CaseFolder.h"
+#include "Decoration.h"
+#include "Document.h"
+
 
 // This internal class encapsulates the underlying document and is shared by
 // QsciDocument instances.
 class QsciDocumentP
 {
 public:
-    QsciDocumentP() : doc(0), nr_displays(0), nr_attaches(1), modified(false) {}
+    QsciDocumentP() : doc(0), nr_displays(0), nr_attaches(1), modified(false),
+            edit_queue(0) {}
+    ~QsciDocumentP() {delete edit_queue;}
 
     void *doc;              // The Scintilla document.
     int nr_displays;        // The number of displays.
     int nr_attaches;        // The number of attaches.
     bool modified;          // Set if not at a save point.
+    QsciEditQueue *edit_queue;  // The queue of edits, created when needed.
 };
 
 
@@ -134,6 +159,9 @@ void QsciDocument::display(QsciScintillaBase *qsb, const QsciDocument *from)
 
     pdoc->doc = ndoc;
     ++pdoc->nr_displays;
+
+    if (pdoc->edit_queue)
+        pdoc->edit_queue->setDocument(ndoc);
 }
 
 
@@ -149,3 +177,62 @@ void QsciDocument::setModified(bool m)
 {
     pdoc->modified = m;
 }
+
+
+// Return the digest of the text of the document.
+quint64 QsciDocument::digest() const
+{
+    Scintilla::Document *doc = static_cast<Scintilla::Document *>(pdoc->doc);
+
+    if (!doc)
+        return 0;
+
+    return doc->HashRange(0, doc->Length());
+}
+
+
+// Return the digest of a range of the text of the document.
+quint64 QsciDocument::digest(int start, int end) const
+{
+    Scintilla::Document *doc = static_cast<Scintilla::Document *>(pdoc->doc);
+
+    if (!doc)
+        return 0;
+
+    return doc->HashRange(start, end);
+}
+
+
+// Return the position of the first difference from another document.
+int QsciDocument::firstDifference(const QsciDocument &other) const
+{
+    Scintilla::Document *doc = static_cast<Scintilla::Document *>(pdoc->doc);
+    Scintilla::Document *other_doc = static_cast<Scintilla::Document *>(
+            other.pdoc->doc);
+
+    // A document that has never been displayed has no text.
+    if (!doc || !other_doc)
+    {
+        int length = (doc ? doc->Length() : (other_doc ? other_doc->Length() : 0));
+
+        return (length == 0 ? -1 : 0);
+    }
+
+    if (doc == other_doc)
+        return -1;
+
+    return doc->FirstDifference(*other_doc);
+}
+
+
+// Return the queue of edits, creating it if necessary.
+QsciEditQueue *QsciDocument::editQueue() const
+{
+    if (!pdoc->edit_queue)
+    {
+        pdoc->edit_queue = new QsciEditQueue;
+        pdoc->edit_queue->setDocument(pdoc->doc);
+    }
+
+    return pdoc->edit_queue;
+}
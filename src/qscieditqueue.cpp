@@ -0,0 +1,458 @@
+// This module implements the QsciEditQueue class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qscieditqueue.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+
+#include "ILexer.h"
+#include "ILoader.h"
+#include "Platform.h"
+#include "Scintilla.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "Position.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "RunStyles.h"
+#include "CaseFolder.h"
+#include "Decoration.h"
+#include "EditJournal.h"
+#include "Document.h"
+
+
+// The event type that asks for the queue to be drained.
+static const QEvent::Type DrainEvent = static_cast<QEvent::Type>(
+        QEvent::registerEventType());
+
+
+// This internal class is a submitted batch of edits.  Batches are held in a
+// singly linked list with the most recently submitted first.
+class QsciEditQueueBatch
+{
+public:
+    QsciEditQueueBatch *next;
+    int id;
+    int version;
+    QList<QsciEditQueue::Edit> edits;
+    QElapsedTimer timer;
+};
+
+
+// This internal class watches the document for modifications so that the
+// version can be updated and older batches moved to allow for them.
+class QsciEditQueueWatcher : public Scintilla::DocWatcher
+{
+public:
+    QsciEditQueueWatcher(QsciEditQueue *queue_) : queue(queue_) {}
+
+    virtual void NotifyModifyAttempt(Scintilla::Document *, void *) {}
+    virtual void NotifySavePoint(Scintilla::Document *, void *, bool) {}
+    virtual void NotifyDeleted(Scintilla::Document *, void *) {}
+    virtual void NotifyStyleNeeded(Scintilla::Document *, void *,
+            Sci::Position) {}
+    virtual void NotifyLexerChanged(Scintilla::Document *, void *) {}
+    virtual void NotifyErrorOccurred(Scintilla::Document *, void *, int) {}
+
+    virtual void NotifyModified(Scintilla::Document *,
+            Scintilla::DocModification mh, void *)
+    {
+        if (mh.modificationType & SC_MOD_INSERTTEXT)
+            queue->changed(mh.position, 0, mh.length);
+        else if (mh.modificationType & SC_MOD_DELETETEXT)
+            queue->changed(mh.position, mh.length, 0);
+    }
+
+private:
+    QsciEditQueue *queue;
+};
+
+
+// The ctor.
+QsciEditQueue::QsciEditQueue()
+    : doc(0), watcher(0), applying(false), submitted(0), next_id(0),
+      current_version(0),
+      drain_posted(0), history_size(1024), last_latency(0), max_latency(0)
+{
+}
+
+
+// The dtor.
+QsciEditQueue::~QsciEditQueue()
+{
+    setDocument(0);
+
+    QsciEditQueueBatch *batch = submitted.fetchAndStoreAcquire(0);
+
+    while (batch)
+    {
+        QsciEditQueueBatch *next = batch->next;
+        delete batch;
+        batch = next;
+    }
+}
+
+
+// Set the document that edits are applied to.
+void QsciEditQueue::setDocument(void *new_doc)
+{
+    if (new_doc == doc)
+        return;
+
+    if (doc)
+    {
+        Scintilla::Document *sci_doc = static_cast<Scintilla::Document *>(doc);
+
+        sci_doc->RemoveWatcher(watcher, 0);
+        sci_doc->Release();
+
+        delete watcher;
+        watcher = 0;
+    }
+
+    doc = new_doc;
+    history.clear();
+
+    if (doc)
+    {
+        Scintilla::Document *sci_doc = static_cast<Scintilla::Document *>(doc);
+
+        // Keep the document alive for as long as it is being watched.
+        sci_doc->AddRef();
+
+        watcher = new QsciEditQueueWatcher(this);
+        sci_doc->AddWatcher(watcher, 0);
+    }
+}
+
+
+// Return the version of the document.
+int QsciEditQueue::version() const
+{
+    return current_version.loadAcquire();
+}
+
+
+// Submit a batch of edits.
+int QsciEditQueue::submit(int version, const QList<Edit> &edits)
+{
+    QsciEditQueueBatch *batch = new QsciEditQueueBatch;
+
+    batch->id = next_id.fetchAndAddRelaxed(1);
+    batch->version = version;
+    batch->edits = edits;
+    batch->timer.start();
+
+    // Push the batch onto the front of the list.  The GUI thread takes the
+    // whole list at once so there is no ABA problem.
+    QsciEditQueueBatch *head;
+
+    do
+    {
+        head = submitted.loadAcquire();
+        batch->next = head;
+    }
+    while (!submitted.testAndSetRelease(head, batch));
+
+    // Only ask for the queue to be drained if it hasn't already been asked.
+    if (drain_posted.testAndSetOrdered(0, 1))
+        QCoreApplication::postEvent(this, new QEvent(DrainEvent));
+
+    return batch->id;
+}
+
+
+// Apply any submitted batches now.
+void QsciEditQueue::flush()
+{
+    drain();
+}
+
+
+// Set the number of modifications that are remembered.
+void QsciEditQueue::setHistorySize(int changes)
+{
+    history_size = qMax(changes, 0);
+
+    while (history.size() > history_size)
+        history.removeFirst();
+}
+
+
+// Return the number of modifications that are remembered.
+int QsciEditQueue::historySize() const
+{
+    return history_size;
+}
+
+
+// Return the latency of the last batch applied.
+qint64 QsciEditQueue::lastLatency() const
+{
+    return last_latency;
+}
+
+
+// Return the longest latency of a batch applied.
+qint64 QsciEditQueue::maximumLatency() const
+{
+    return max_latency;
+}
+
+
+// Reset the latencies.
+void QsciEditQueue::resetLatency()
+{
+    last_latency = 0;
+    max_latency = 0;
+}
+
+
+// Handle the event asking for the queue to be drained.
+bool QsciEditQueue::event(QEvent *e)
+{
+    if (e->type() == DrainEvent)
+    {
+        drain();
+        return true;
+    }
+
+    return QObject::event(e);
+}
+
+
+// Remember a modification of the document.
+void QsciEditQueue::changed(int position, int deleted, int inserted)
+{
+    // The edits of a batch being applied are remembered individually when it
+    // has been applied.
+    if (applying)
+        return;
+
+    Change change;
+
+    change.position = position;
+    change.deleted = deleted;
+    change.inserted = inserted;
+
+    history.append(change);
+
+    while (history.size() > history_size)
+        history.removeFirst();
+
+    current_version.storeRelease(current_version.loadAcquire() + 1);
+}
+
+
+// Apply all the submitted batches.
+void QsciEditQueue::drain()
+{
+    // Allow another drain to be asked for before taking the batches so that
+    // none submitted after we take them are missed.
+    drain_posted.storeRelease(0);
+
+    QsciEditQueueBatch *batch = submitted.fetchAndStoreAcquire(0);
+
+    if (!batch)
+        return;
+
+    // Reverse the list so that batches are applied in the order they were
+    // submitted.
+    QsciEditQueueBatch *first = 0;
+
+    while (batch)
+    {
+        QsciEditQueueBatch *next = batch->next;
+        batch->next = first;
+        first = batch;
+        batch = next;
+    }
+
+    Scintilla::Document *sci_doc = static_cast<Scintilla::Document *>(doc);
+    bool read_only = (!sci_doc || sci_doc->IsReadOnly());
+    QList<int> applied, rejected;
+
+    if (!read_only)
+        sci_doc->BeginUndoAction();
+
+    for (batch = first; batch; batch = batch->next)
+    {
+        if (read_only || !rebase(batch))
+        {
+            rejected.append(batch->id);
+            continue;
+        }
+
+        // The edits are sorted and don't overlap so apply them from the end
+        // so that the positions of those still to be applied don't change.
+        // The document reports edits that touch as one modification so they
+        // are remembered separately once the batch has been applied.
+        // Otherwise an older batch that edits between them would be
+        // rejected.
+        Scintilla::EditDelta delta;
+
+        for (int i = batch->edits.size() - 1; i >= 0; --i)
+        {
+            const Edit &edit = batch->edits.at(i);
+
+            if (edit.end > edit.start)
+            {
+                Scintilla::EditDelta::Edit removal = {false, edit.start,
+                        edit.end - edit.start, 0};
+
+                delta.edits.push_back(removal);
+            }
+
+            if (!edit.text.isEmpty())
+            {
+                Scintilla::EditDelta::Edit insertion = {true, edit.start,
+                        edit.text.size(), edit.text.constData()};
+
+                delta.edits.push_back(insertion);
+            }
+        }
+
+        applying = true;
+        bool ok = sci_doc->ApplyEdits(delta);
+        applying = false;
+
+        if (!ok)
+        {
+            rejected.append(batch->id);
+            continue;
+        }
+
+        // Remember each edit as a replacement in the order they appear in the
+        // document so that text inserted where two edits meet stays between
+        // them.
+        int offset = 0;
+
+        for (int i = 0; i < batch->edits.size(); ++i)
+        {
+            const Edit &edit = batch->edits.at(i);
+            int deleted = edit.end - edit.start;
+            int inserted = edit.text.size();
+
+            if (deleted == 0 && inserted == 0)
+                continue;
+
+            changed(edit.start + offset, deleted, inserted);
+            offset += inserted - deleted;
+        }
+
+        last_latency = batch->timer.nsecsElapsed() / 1000;
+
+        if (max_latency < last_latency)
+            max_latency = last_latency;
+
+        applied.append(batch->id);
+    }
+
+    if (!read_only)
+        sci_doc->EndUndoAction();
+
+    while (first)
+    {
+        batch = first->next;
+        delete first;
+        first = batch;
+    }
+
+    // Only tell anybody once the document is consistent.
+    for (int i = 0; i < applied.size(); ++i)
+        emit batchApplied(applied.at(i));
+
+    for (int i = 0; i < rejected.size(); ++i)
+        emit batchRejected(rejected.at(i));
+}
+
+
+// Return true if an edit starts before another.
+static bool editBefore(const QsciEditQueue::Edit &a,
+        const QsciEditQueue::Edit &b)
+{
+    return a.start < b.start;
+}
+
+
+// Sort the edits of a batch and move them to allow for the modifications of
+// the document since the version they were computed against.  Returns false
+// if the batch should be rejected.
+bool QsciEditQueue::rebase(QsciEditQueueBatch *batch) const
+{
+    int nr_changes = version() - batch->version;
+
+    if (nr_changes < 0 || nr_changes > history.size())
+        return false;
+
+    QList<Edit> &edits = batch->edits;
+
+    std::stable_sort(edits.begin(), edits.end(), editBefore);
+
+    for (int i = 0; i < edits.size(); ++i)
+    {
+        const Edit &edit = edits.at(i);
+
+        if (edit.start < 0 || edit.end < edit.start)
+            return false;
+
+        if (i > 0 && edits.at(i - 1).end > edit.start)
+            return false;
+    }
+
+    for (int c = history.size() - nr_changes; c < history.size(); ++c)
+    {
+        const Change &change = history.at(c);
+        int delta = change.inserted - change.deleted;
+
+        for (int i = 0; i < edits.size(); ++i)
+        {
+            Edit &edit = edits[i];
+
+            // An insertion at the same position as the change stays before
+            // it.
+            if (edit.end <= change.position)
+                continue;
+
+            if (edit.start >= change.position + change.deleted)
+            {
+                edit.start += delta;
+                edit.end += delta;
+                continue;
+            }
+
+            // The change modified text the edit was computed against.
+            return false;
+        }
+    }
+
+    int length = static_cast<Scintilla::Document *>(doc)->Length();
+
+    return edits.isEmpty() || edits.last().end <= length;
+}
@@ -0,0 +1,154 @@
+// This module implements the QsciFileDocumentProvider class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qscifiledocumentprovider.h"
+
+#include <QMutexLocker>
+
+
+// The number of lines between the offsets that are remembered.
+static const int LinesPerCheckpoint = 1024;
+
+// The number of bytes read at a time when scanning or sampling the file.
+static const int ScanBlockSize = 0x10000;
+
+
+// The ctor.
+QsciFileDocumentProvider::QsciFileDocumentProvider(const QString &filename,
+        QObject *parent)
+    : QsciAbstractDocumentProvider(parent), file(filename), scan_offset(0),
+      scan_line(0), scan_complete(false)
+{
+    checkpoints.append(0);
+}
+
+
+// The dtor.
+QsciFileDocumentProvider::~QsciFileDocumentProvider()
+{
+}
+
+
+// Return the name of the file.
+QString QsciFileDocumentProvider::fileName() const
+{
+    return file.fileName();
+}
+
+
+// Return an estimate of the number of lines in the file.
+int QsciFileDocumentProvider::estimatedLineCount()
+{
+    QMutexLocker locker(&mutex);
+
+    if (!file.isOpen() && !file.open(QIODevice::ReadOnly))
+        return 0;
+
+    qint64 size = file.size();
+
+    if (size == 0 || !file.seek(0))
+        return 0;
+
+    QByteArray sample = file.read(ScanBlockSize);
+    int nr_lines = sample.count('\n');
+
+    // Small files are read completely so the count is exact.
+    if (sample.size() >= size)
+        return sample.endsWith('\n') ? nr_lines : nr_lines + 1;
+
+    if (nr_lines == 0)
+        return 1;
+
+    return static_cast<int>(qMin(size * nr_lines / sample.size(),
+                static_cast<qint64>(0x7fffffff)));
+}
+
+
+// Return up to a number of lines starting at a particular line.
+QByteArray QsciFileDocumentProvider::fetchLines(int line, int count)
+{
+    QMutexLocker locker(&mutex);
+
+    if (line < 0 || count <= 0)
+        return QByteArray();
+
+    if (!file.isOpen() && !file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    // Make sure the offset of the nearest line at or before the one wanted is
+    // known.
+    int checkpoint = line / LinesPerCheckpoint;
+
+    while (checkpoint >= checkpoints.size())
+        if (isCancelled() || !scanForward())
+            return QByteArray();
+
+    if (!file.seek(checkpoints[checkpoint]))
+        return QByteArray();
+
+    for (int skip = line - checkpoint * LinesPerCheckpoint; skip > 0; --skip)
+        if (file.readLine().isEmpty())
+            return QByteArray();
+
+    QByteArray text;
+
+    while (count-- > 0 && !isCancelled())
+    {
+        QByteArray text_line = file.readLine();
+
+        if (text_line.isEmpty())
+            break;
+
+        text.append(text_line);
+    }
+
+    return text;
+}
+
+
+// Scan the next block of the file for line starts.  Return false if the end
+// of the file has already been reached.
+bool QsciFileDocumentProvider::scanForward()
+{
+    if (scan_complete || !file.seek(scan_offset))
+        return false;
+
+    QByteArray block = file.read(ScanBlockSize);
+
+    if (block.isEmpty())
+    {
+        scan_complete = true;
+        return false;
+    }
+
+    for (int i = 0; i < block.size(); ++i)
+    {
+        if (block.at(i) == '\n')
+        {
+            // Don't remember a line that starts at the very end of the file.
+            if (++scan_line % LinesPerCheckpoint == 0 && scan_offset + i + 1 < file.size())
+                checkpoints.append(scan_offset + i + 1);
+        }
+    }
+
+    scan_offset += block.size();
+
+    return true;
+}
@@ -98,10 +98,13 @@ HEADERS = \
     ./Qsci/qsciscintilla.h \
     ./Qsci/qsciscintillabase.h \
     ./Qsci/qsciabstractapis.h \
+    ./Qsci/qsciabstractdocumentprovider.h \
     ./Qsci/qsciapis.h \
     ./Qsci/qscicommand.h \
     ./Qsci/qscicommandset.h \
     ./Qsci/qscidocument.h \
+    ./Qsci/qscieditqueue.h \
+    ./Qsci/qscifiledocumentprovider.h \
     ./Qsci/qscilexer.h \
     ./Qsci/qscilexeravs.h \
     ./Qsci/qscilexerbash.h \
@@ -144,6 +147,9 @@ HEADERS = \
     ./Qsci/qscilexerxml.h \
     ./Qsci/qscilexeryaml.h \
     ./Qsci/qscimacro.h \
+    ./Qsci/qscipageddocument.h \
+    ./Qsci/qscisessionrecorder.h \
+    ./Qsci/qscisessionreplayer.h \
     ./Qsci/qscistyle.h \
     ./Qsci/qscistyledtext.h \
     ListBoxQt.h \
@@ -184,6 +190,8 @@ HEADERS = \
     ../scintilla/src/DBCS.h \
     ../scintilla/src/Decoration.h \
     ../scintilla/src/Document.h \
+    ../scintilla/src/DocumentStatistics.h \
+    ../scintilla/src/EditJournal.h \
     ../scintilla/src/EditModel.h \
     ../scintilla/src/Editor.h \
     ../scintilla/src/EditView.h \
@@ -198,6 +206,7 @@ HEADERS = \
     ../scintilla/src/Partitioning.h \
     ../scintilla/src/PerLine.h \
     ../scintilla/src/Position.h \
+    ../scintilla/src/PositionAnchors.h \
     ../scintilla/src/PositionCache.h \
     ../scintilla/src/RESearch.h \
     ../scintilla/src/RunStyles.h \
@@ -206,8 +215,10 @@ HEADERS = \
     ../scintilla/src/SparseVector.h \
     ../scintilla/src/SplitVector.h \
     ../scintilla/src/Style.h \
+    ../scintilla/src/StyleIndex.h \
     ../scintilla/src/UniConversion.h \
     ../scintilla/src/UniqueString.h \
+    ../scintilla/src/ViewStateCache.h \
     ../scintilla/src/ViewStyle.h \
     ../scintilla/src/XPM.h
 
@@ -217,10 +228,13 @@ SOURCES = \
     qsciscintilla.cpp \
     qsciscintillabase.cpp \
     qsciabstractapis.cpp \
+    qsciabstractdocumentprovider.cpp \
     qsciapis.cpp \
     qscicommand.cpp \
     qscicommandset.cpp \
     qscidocument.cpp \
+    qscieditqueue.cpp \
+    qscifiledocumentprovider.cpp \
     qscilexer.cpp \
     qscilexeravs.cpp \
     qscilexerbash.cpp \
@@ -263,6 +277,9 @@ SOURCES = \
     qscilexerxml.cpp \
     qscilexeryaml.cpp \
     qscimacro.cpp \
+    qscipageddocument.cpp \
+    qscisessionrecorder.cpp \
+    qscisessionreplayer.cpp \
     qscistyle.cpp \
     qscistyledtext.cpp \
     InputMethod.cpp \
@@ -402,6 +419,8 @@ SOURCES = \
     ../scintilla/src/DBCS.cpp \
     ../scintilla/src/Decoration.cpp \
     ../scintilla/src/Document.cpp \
+    ../scintilla/src/DocumentStatistics.cpp \
+    ../scintilla/src/EditJournal.cpp \
     ../scintilla/src/EditModel.cpp \
     ../scintilla/src/Editor.cpp \
     ../scintilla/src/EditView.cpp \
@@ -411,13 +430,16 @@ SOURCES = \
     ../scintilla/src/LineMarker.cpp \
     ../scintilla/src/MarginView.cpp \
     ../scintilla/src/PerLine.cpp \
+    ../scintilla/src/PositionAnchors.cpp \
     ../scintilla/src/PositionCache.cpp \
     ../scintilla/src/RESearch.cpp \
     ../scintilla/src/RunStyles.cpp \
     ../scintilla/src/ScintillaBase.cpp \
     ../scintilla/src/Selection.cpp \
     ../scintilla/src/Style.cpp \
+    ../scintilla/src/StyleIndex.cpp \
     ../scintilla/src/UniConversion.cpp \
+    ../scintilla/src/ViewStateCache.cpp \
     ../scintilla/src/ViewStyle.cpp \
     ../scintilla/src/XPM.cpp
 
@@ -0,0 +1,667 @@
+// This module implements the QsciPagedDocument class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qscipageddocument.h"
+
+#include <algorithm>
+
+#include <QApplication>
+#include <QEvent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "Qsci/qsciabstractdocumentprovider.h"
+#include "Qsci/qscidocument.h"
+#include "Qsci/qsciscintilla.h"
+
+
+// The event type that carries a page fetched by the worker thread.
+static const QEvent::Type PageFetched = static_cast<QEvent::Type>(
+        QEvent::registerEventType());
+
+// The number of placeholder lines inserted at a time when reloading.
+static const int PlaceholderChunkSize = 0x10000;
+
+
+// This class is the event that carries a page fetched by the worker thread.
+class QsciPageFetchedEvent : public QEvent
+{
+public:
+    QsciPageFetchedEvent(int generation_, int page_, const QByteArray &text_)
+        : QEvent(PageFetched), generation(generation_), page(page_),
+          text(text_)
+    {
+    }
+
+    int generation;
+    int page;
+    QByteArray text;
+};
+
+
+// This class is the worker thread that fetches pages from the provider.
+class QsciPagedDocumentWorker : public QThread
+{
+public:
+    // A page to be fetched.
+    struct Fetch
+    {
+        int page;
+        int line;
+        int count;
+    };
+
+    QsciPagedDocumentWorker(QsciPagedDocument *paged,
+            QsciAbstractDocumentProvider *provider);
+    virtual ~QsciPagedDocumentWorker();
+
+    void request(int generation, const QList<Fetch> &fetches);
+
+    virtual void run();
+
+private:
+    QsciPagedDocument *proxy;
+    QsciAbstractDocumentProvider *prov;
+    QMutex mutex;
+    QWaitCondition requested;
+    QList<Fetch> queue;
+    int queue_generation;
+    int current_page;
+    int current_generation;
+    bool abort;
+};
+
+
+// The worker thread ctor.
+QsciPagedDocumentWorker::QsciPagedDocumentWorker(QsciPagedDocument *paged,
+        QsciAbstractDocumentProvider *provider)
+    : proxy(paged), prov(provider), queue_generation(0), current_page(-1),
+      current_generation(0), abort(false)
+{
+}
+
+
+// The worker thread dtor.
+QsciPagedDocumentWorker::~QsciPagedDocumentWorker()
+{
+    // Tell the thread to stop and the provider to abandon any fetch.
+    mutex.lock();
+    abort = true;
+    prov->setCancelled(true);
+    requested.wakeAll();
+    mutex.unlock();
+
+    wait();
+}
+
+
+// Replace any outstanding requests with a new list of pages to fetch.
+void QsciPagedDocumentWorker::request(int generation,
+        const QList<Fetch> &fetches)
+{
+    QMutexLocker locker(&mutex);
+
+    queue.clear();
+    queue_generation = generation;
+
+    // A page being fetched for an earlier generation is no longer wanted.
+    if (current_page >= 0 && generation != current_generation)
+        prov->setCancelled(true);
+
+    for (int i = 0; i < fetches.size(); ++i)
+    {
+        const Fetch &fetch = fetches.at(i);
+
+        // Don't fetch a page that is already being fetched.
+        if (fetch.page != current_page || generation != current_generation)
+            queue.append(fetch);
+    }
+
+    if (!queue.isEmpty())
+        requested.wakeOne();
+}
+
+
+// The worker thread entry point.
+void QsciPagedDocumentWorker::run()
+{
+    mutex.lock();
+
+    while (!abort)
+    {
+        if (queue.isEmpty())
+        {
+            requested.wait(&mutex);
+            continue;
+        }
+
+        Fetch fetch = queue.takeFirst();
+        current_page = fetch.page;
+        current_generation = queue_generation;
+        prov->setCancelled(false);
+        mutex.unlock();
+
+        // The provider may block so don't hold the lock while it does.
+        QByteArray text = prov->fetchLines(fetch.line, fetch.count);
+
+        mutex.lock();
+
+        if (!prov->isCancelled())
+            QApplication::postEvent(proxy,
+                    new QsciPageFetchedEvent(current_generation, fetch.page,
+                            text));
+
+        current_page = -1;
+    }
+
+    mutex.unlock();
+}
+
+
+// The ctor.
+QsciPagedDocument::QsciPagedDocument(QsciAbstractDocumentProvider *provider,
+        QsciScintilla *parent)
+    : QObject(parent), prov(provider), qsci(parent), worker(0),
+      page_size(256), cache_size(64), editable(false), complete(false),
+      replacing(false), generation(0), nr_edited(0), first_shown(0),
+      last_shown(-1), saved_first_visible(0), saved_caret_line(0),
+      saved_caret_index(0), saved_anchor_line(0), saved_anchor_index(0)
+{
+    worker = new QsciPagedDocumentWorker(this, prov);
+    worker->start();
+
+    qsci->setDocument(QsciDocument());
+
+    connect(qsci, SIGNAL(SCN_UPDATEUI(int)), SLOT(handleUpdateUI(int)));
+    connect(qsci,
+            SIGNAL(SCN_MODIFIED(int,int,const char *,int,int,int,int,int,int,int)),
+            SLOT(handleModified(int,int,const char *,int,int,int,int,int,int,int)));
+
+    reload();
+}
+
+
+// The dtor.
+QsciPagedDocument::~QsciPagedDocument()
+{
+    delete worker;
+}
+
+
+// Return the provider.
+QsciAbstractDocumentProvider *QsciPagedDocument::provider() const
+{
+    return prov;
+}
+
+
+// Set the number of lines in a page.
+void QsciPagedDocument::setPageSize(int lines)
+{
+    if (lines > 0 && lines != page_size)
+    {
+        page_size = lines;
+        reload();
+    }
+}
+
+
+// Return the number of lines in a page.
+int QsciPagedDocument::pageSize() const
+{
+    return page_size;
+}
+
+
+// Set the maximum number of fetched pages to keep.
+void QsciPagedDocument::setCacheSize(int pages)
+{
+    cache_size = qMax(pages, 0);
+
+    beginReplace();
+    evictPages();
+    endReplace();
+}
+
+
+// Return the maximum number of fetched pages to keep.
+int QsciPagedDocument::cacheSize() const
+{
+    return cache_size;
+}
+
+
+// Set whether the document may be edited.
+void QsciPagedDocument::setEditable(bool editable_)
+{
+    editable = editable_;
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETREADONLY, !editable);
+}
+
+
+// Return true if the document may be edited.
+bool QsciPagedDocument::isEditable() const
+{
+    return editable;
+}
+
+
+// Return the number of pages.
+int QsciPagedDocument::pageCount() const
+{
+    return page_states.size();
+}
+
+
+// Return true if a page has been fetched.
+bool QsciPagedDocument::isPageLoaded(int page) const
+{
+    if (page < 0 || page >= page_states.size())
+        return false;
+
+    return page_states[page] == PageLoaded;
+}
+
+
+// Return true if a page has been edited.
+bool QsciPagedDocument::isPageEdited(int page) const
+{
+    if (page < 0 || page >= page_states.size())
+        return false;
+
+    return page_states[page] == PageEdited;
+}
+
+
+// Discard all pages and start again with placeholders.
+void QsciPagedDocument::reload()
+{
+    // Pages being fetched are for the old pages and will be ignored.
+    ++generation;
+    worker->request(generation, QList<QsciPagedDocumentWorker::Fetch>());
+
+    int nr_lines = qMax(prov->estimatedLineCount(), 1);
+    int nr_pages = (nr_lines + page_size - 1) / page_size;
+
+    page_lines.fill(page_size, nr_pages);
+    page_lines.last() = nr_lines - (nr_pages - 1) * page_size;
+    page_states.fill(PagePlaceholder, nr_pages);
+    updatePageStarts();
+
+    lru.clear();
+    complete = false;
+    nr_edited = 0;
+
+    // Each line of a page, including the last, is terminated so that the
+    // text of a page can be replaced without affecting its neighbours.  The
+    // lines are appended in chunks so that a large estimate doesn't need a
+    // buffer of the same size.
+    QByteArray placeholders(qMin(nr_lines, PlaceholderChunkSize), '\n');
+
+    replacing = true;
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETREADONLY, 0);
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETUNDOCOLLECTION, 0);
+    qsci->SendScintilla(QsciScintillaBase::SCI_CLEARALL);
+
+    for (int remaining = nr_lines; remaining > 0; remaining -= placeholders.size())
+    {
+        int chunk = qMin(remaining, placeholders.size());
+
+        qsci->SendScintilla(QsciScintillaBase::SCI_APPENDTEXT, chunk,
+                placeholders.constData());
+    }
+
+    qsci->SendScintilla(QsciScintillaBase::SCI_EMPTYUNDOBUFFER);
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETSAVEPOINT);
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETREADONLY, !editable);
+    replacing = false;
+
+    requestShownPages();
+}
+
+
+// Handle the event carrying a fetched page.
+bool QsciPagedDocument::event(QEvent *e)
+{
+    if (e->type() == PageFetched)
+    {
+        QsciPageFetchedEvent *pfe = static_cast<QsciPageFetchedEvent *>(e);
+
+        if (pfe->generation == generation)
+            loadPage(pfe->page, pfe->text);
+
+        return true;
+    }
+
+    return QObject::event(e);
+}
+
+
+// Fetch any pages that have been scrolled into view.
+void QsciPagedDocument::handleUpdateUI(int updated)
+{
+    if (updated & (QsciScintillaBase::SC_UPDATE_V_SCROLL|QsciScintillaBase::SC_UPDATE_CONTENT))
+        requestShownPages();
+}
+
+
+// Keep track of the pages that have been edited.
+void QsciPagedDocument::handleModified(int pos, int mtype, const char *text,
+        int len, int added, int line, int foldNow, int foldPrev, int token,
+        int annotationLinesAdded)
+{
+    Q_UNUSED(text);
+    Q_UNUSED(len);
+    Q_UNUSED(line);
+    Q_UNUSED(foldNow);
+    Q_UNUSED(foldPrev);
+    Q_UNUSED(token);
+    Q_UNUSED(annotationLinesAdded);
+
+    if (replacing || page_states.isEmpty())
+        return;
+
+    if ((mtype & (QsciScintillaBase::SC_MOD_INSERTTEXT|QsciScintillaBase::SC_MOD_DELETETEXT)) == 0)
+        return;
+
+    int first_line = qsci->SendScintilla(QsciScintillaBase::SCI_LINEFROMPOSITION,
+            pos);
+    int first = pageAt(first_line);
+
+    // A deletion of lines may have spanned several pages.  The first of them
+    // gets the remaining lines and the others become empty.
+    int last = (added < 0) ? pageAt(first_line - added) : first;
+
+    for (int page = first; page <= last; ++page)
+    {
+        if (page_states[page] == PageLoaded)
+            lru.removeOne(page);
+
+        if (page_states[page] != PageEdited)
+        {
+            page_states[page] = PageEdited;
+            ++nr_edited;
+        }
+
+        if (page != first)
+        {
+            page_lines[first] += page_lines[page];
+            page_lines[page] = 0;
+        }
+    }
+
+    page_lines[first] += added;
+    updatePageStarts();
+}
+
+
+// Return the page containing a line.
+int QsciPagedDocument::pageAt(int line) const
+{
+    QVector<int>::const_iterator it = std::upper_bound(
+            page_starts.constBegin(), page_starts.constEnd(), line);
+
+    return qBound(0, static_cast<int>(it - page_starts.constBegin()) - 1,
+            page_starts.size() - 1);
+}
+
+
+// Recalculate the first line of each page.
+void QsciPagedDocument::updatePageStarts()
+{
+    page_starts.resize(page_lines.size());
+
+    int line = 0;
+
+    for (int page = 0; page < page_lines.size(); ++page)
+    {
+        page_starts[page] = line;
+        line += page_lines[page];
+    }
+}
+
+
+// Ask the worker thread for the pages being shown that are placeholders.
+void QsciPagedDocument::requestShownPages()
+{
+    if (page_states.isEmpty())
+        return;
+
+    long first_visible = qsci->SendScintilla(
+            QsciScintillaBase::SCI_GETFIRSTVISIBLELINE);
+    long last_visible = first_visible + qsci->SendScintilla(
+            QsciScintillaBase::SCI_LINESONSCREEN);
+    int first = pageAt(qsci->SendScintilla(
+            QsciScintillaBase::SCI_DOCLINEFROMVISIBLE, first_visible));
+    int last = pageAt(qsci->SendScintilla(
+            QsciScintillaBase::SCI_DOCLINEFROMVISIBLE, last_visible));
+
+    // Include a page either side so that short scrolls don't show
+    // placeholders.
+    first_shown = qMax(first - 1, 0);
+    last_shown = qMin(last + 1, page_states.size() - 1);
+
+    // The visible pages are fetched first.
+    QList<int> pages;
+
+    for (int page = first; page <= last; ++page)
+        pages.append(page);
+
+    if (first_shown < first)
+        pages.append(first_shown);
+
+    if (last_shown > last)
+        pages.append(last_shown);
+
+    QList<QsciPagedDocumentWorker::Fetch> fetches;
+
+    for (int i = 0; i < pages.size(); ++i)
+    {
+        int page = pages.at(i);
+
+        if (page_states[page] == PagePlaceholder)
+        {
+            QsciPagedDocumentWorker::Fetch fetch;
+
+            // Only the last page can have fewer lines than the page size in
+            // the provider's text so the first line of a page is fixed.
+            fetch.page = page;
+            fetch.line = page * page_size;
+            fetch.count = page_size;
+
+            fetches.append(fetch);
+        }
+        else if (page_states[page] == PageLoaded)
+        {
+            // Keep the most recently shown pages at the end.
+            lru.removeOne(page);
+            lru.append(page);
+        }
+    }
+
+    worker->request(generation, fetches);
+}
+
+
+// Replace the placeholders of a page with its fetched text.
+void QsciPagedDocument::loadPage(int page, QByteArray text)
+{
+    if (page >= page_states.size() || page_states[page] != PagePlaceholder)
+        return;
+
+    if (!text.isEmpty() && !text.endsWith('\n'))
+        text.append('\n');
+
+    int nr_lines = text.count('\n');
+
+    beginReplace();
+
+    if (nr_lines < page_size)
+    {
+        // This is the end of the text so remove the pages after it, apart
+        // from any that have been edited.
+        complete = true;
+
+        while (page_states.size() - 1 > page && page_states.last() != PageEdited)
+        {
+            int last = page_states.size() - 1;
+
+            replaceLines(page_starts[last], page_lines[last], QByteArray());
+
+            if (page_states[last] == PageLoaded)
+                lru.removeOne(last);
+
+            page_lines.removeLast();
+            page_starts.removeLast();
+            page_states.removeLast();
+        }
+    }
+    else if (page == page_states.size() - 1 && !complete)
+    {
+        // The text may continue past the estimate so add another page.
+        replaceLines(page_starts[page] + page_lines[page], 0,
+                QByteArray(page_size, '\n'));
+
+        page_lines.append(page_size);
+        page_states.append(PagePlaceholder);
+    }
+
+    replaceLines(page_starts[page], page_lines[page], text);
+    page_lines[page] = nr_lines;
+    updatePageStarts();
+
+    page_states[page] = PageLoaded;
+    lru.append(page);
+    evictPages();
+
+    endReplace();
+
+    emit pageLoaded(page);
+}
+
+
+// Return the least recently shown pages to placeholders until the cache is
+// no longer over full.
+void QsciPagedDocument::evictPages()
+{
+    while (lru.size() > cache_size)
+    {
+        int victim = -1;
+
+        for (int i = 0; i < lru.size(); ++i)
+        {
+            int page = lru.at(i);
+
+            if (page < first_shown || page > last_shown)
+            {
+                victim = i;
+                break;
+            }
+        }
+
+        if (victim < 0)
+            break;
+
+        int page = lru.takeAt(victim);
+
+        replaceLines(page_starts[page], page_lines[page],
+                QByteArray(page_lines[page], '\n'));
+        page_states[page] = PagePlaceholder;
+
+        emit pageEvicted(page);
+    }
+}
+
+
+// Prepare for the text of pages to be replaced.
+void QsciPagedDocument::beginReplace()
+{
+    replacing = true;
+
+    saved_first_visible = qsci->SendScintilla(
+            QsciScintillaBase::SCI_GETFIRSTVISIBLELINE);
+
+    // Positions are saved as lines and indexes as the text of a page
+    // usually changes length but not its number of lines.
+    long caret = qsci->SendScintilla(QsciScintillaBase::SCI_GETCURRENTPOS);
+    saved_caret_line = qsci->SendScintilla(
+            QsciScintillaBase::SCI_LINEFROMPOSITION, caret);
+    saved_caret_index = caret - qsci->SendScintilla(
+            QsciScintillaBase::SCI_POSITIONFROMLINE, saved_caret_line);
+
+    long anchor = qsci->SendScintilla(QsciScintillaBase::SCI_GETANCHOR);
+    saved_anchor_line = qsci->SendScintilla(
+            QsciScintillaBase::SCI_LINEFROMPOSITION, anchor);
+    saved_anchor_index = anchor - qsci->SendScintilla(
+            QsciScintillaBase::SCI_POSITIONFROMLINE, saved_anchor_line);
+
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETREADONLY, 0);
+}
+
+
+// Replace the text of a number of lines.
+void QsciPagedDocument::replaceLines(int line, int nr_lines,
+        const QByteArray &text)
+{
+    long start = qsci->SendScintilla(QsciScintillaBase::SCI_POSITIONFROMLINE,
+            line);
+    long end = qsci->SendScintilla(QsciScintillaBase::SCI_POSITIONFROMLINE,
+            line + nr_lines);
+
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETTARGETRANGE, start, end);
+    qsci->SendScintilla(QsciScintillaBase::SCI_REPLACETARGET, text.size(),
+            text.constData());
+}
+
+
+// Restore the state of the editor after the text of pages has been replaced.
+void QsciPagedDocument::endReplace()
+{
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETREADONLY, !editable);
+
+    int last_line = qsci->SendScintilla(QsciScintillaBase::SCI_GETLINECOUNT)
+            - 1;
+    int line = qMin(saved_anchor_line, last_line);
+    long anchor = qMin(
+            qsci->SendScintilla(QsciScintillaBase::SCI_POSITIONFROMLINE,
+                    line) + saved_anchor_index,
+            qsci->SendScintilla(QsciScintillaBase::SCI_GETLINEENDPOSITION,
+                    line));
+
+    line = qMin(saved_caret_line, last_line);
+    long caret = qMin(
+            qsci->SendScintilla(QsciScintillaBase::SCI_POSITIONFROMLINE,
+                    line) + saved_caret_index,
+            qsci->SendScintilla(QsciScintillaBase::SCI_GETLINEENDPOSITION,
+                    line));
+
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETANCHOR, anchor);
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETCURRENTPOS, caret);
+    qsci->SendScintilla(QsciScintillaBase::SCI_SETFIRSTVISIBLELINE,
+            saved_first_visible);
+
+    // The text has only changed if the user has edited it.
+    if (nr_edited == 0)
+        qsci->SendScintilla(QsciScintillaBase::SCI_SETSAVEPOINT);
+
+    replacing = false;
+}
@@ -34,6 +34,8 @@
 #include <QKeySequence>
 #include <QMenu>
 #include <QPoint>
+#include <QSet>
+#include <QVector>
 
 #include "Qsci/qsciabstractapis.h"
 #include "Qsci/qscicommandset.h"
@@ -67,9 +69,12 @@ QsciScintilla::QsciScintilla(QWidget *parent)
       allocatedMarkers(0), allocatedIndicators(7), oldPos(-1), selText(false),
       fold(NoFoldStyle), foldmargin(2), autoInd(false),
       braceMode(NoBraceMatch), acSource(AcsNone), acThresh(-1),
+      acLimit(0), acTruncated(false), acTruncatedSource(AcsNone),
       wchars(defaultWordChars), call_tips_position(CallTipsBelowText),
       call_tips_style(CallTipsNoContext), maxCallTips(-1),
-      use_single(AcusNever), explicit_fillups(""), fillups_enabled(false)
+      use_single(AcusNever), explicit_fillups(""), fillups_enabled(false),
+      text_statistics(false), style_index(false), utf16_index(false),
+      edit_journal(false)
 {
     connect(this,SIGNAL(SCN_MODIFYATTEMPTRO()),
              SIGNAL(modificationAttempted()));
@@ -80,6 +85,8 @@ QsciScintilla::QsciScintilla(QWidget *parent)
              SLOT(handleCallTipClick(int)));
     connect(this,SIGNAL(SCN_CHARADDED(int)),
              SLOT(handleCharAdded(int)));
+    connect(this,SIGNAL(SCN_AUTOCCHARDELETED()),
+             SLOT(handleAutoCompletionCharDeleted()));
     connect(this,SIGNAL(SCN_INDICATORCLICK(int,int)),
              SLOT(handleIndicatorClick(int,int)));
     connect(this,SIGNAL(SCN_INDICATORRELEASE(int,int)),
@@ -149,6 +156,15 @@ QsciScintilla::~QsciScintilla()
     // Detach any current lexer.
     detachLexer();
 
+    // The document may be shared with another editor.
+    setTextStatisticsEnabled(false);
+    setStyleIndexEnabled(false);
+    setEditJournalEnabled(false);
+
+    if (utf16_index)
+        SendScintilla(SCI_RELEASELINECHARACTERINDEX,
+                SC_LINECHARACTERINDEX_UTF16);
+
     doc.undisplay(this);
     delete stdCmds;
 }
@@ -246,6 +262,16 @@ void QsciScintilla::handleCharAdded(int ch)
     if (pos != SendScintilla(SCI_GETSELECTIONEND) || pos == 0)
         return;
 
+    // If the auto-completion list was limited then it may be missing entries
+    // that match what has now been typed so create it again.
+    if (isListActive() && acTruncated && isWordCharacter(ch))
+    {
+        cancelList();
+        startAutoCompletion(acTruncatedSource, false, false);
+
+        return;
+    }
+
     // If auto-completion is already active then see if this character is a
     // start character.  If it is then create a new list which will be a subset
     // of the current one.  The case where it isn't a start character seems to
@@ -282,6 +308,18 @@ void QsciScintilla::handleCharAdded(int ch)
 }
 
 
+// Handle the deletion of a character while the auto-completion list is active.
+void QsciScintilla::handleAutoCompletionCharDeleted()
+{
+    // A limited list may be missing entries that match what is left.
+    if (isListActive() && acTruncated)
+    {
+        cancelList();
+        startAutoCompletion(acTruncatedSource, false, false);
+    }
+}
+
+
 // See if a call tip is active.
 bool QsciScintilla::isCallTipActive() const
 {
@@ -668,6 +706,8 @@ bool QsciScintilla::isStartChar(char ch) const
 void QsciScintilla::startAutoCompletion(AutoCompletionSource acs,
         bool checkThresh, bool choose_single)
 {
+    acTruncated = false;
+
     int start, ignore;
     QStringList context = apiContext(SendScintilla(SCI_GETCURRENTPOS), start,
             ignore);
@@ -683,15 +723,16 @@ void QsciScintilla::startAutoCompletion(AutoCompletionSource acs,
     if (checkThresh && last_len < acThresh)
         return;
 
-    // Generate the string representing the valid words to select from.
-    QStringList wlist;
+    // Get the sorted words from the APIs and from the document separately so
+    // that they can be merged without sorting them all again.
+    QStringList wlist, dlist;
 
     if ((acs == AcsAll || acs == AcsAPIs) && !lex.isNull())
     {
         QsciAbstractAPIs *apis = lex->apis();
 
         if (apis)
-            apis->updateAutoCompletionList(context, wlist);
+            apis->updateSortedAutoCompletionList(context, wlist, acLimit);
     }
 
     if (acs == AcsAll || acs == AcsDocument)
@@ -711,6 +752,12 @@ void QsciScintilla::startAutoCompletion(AutoCompletionSource acs,
 
         SendScintilla(SCI_GETTEXTRANGE, start, caret, orig_context);
 
+        // Use a set to check for words already present as there may be many.
+        QSet<QString> wset;
+
+        for (int i = 0; i < wlist.count(); ++i)
+            wset.insert(wlist[i]);
+
         for (;;)
         {
             int fstart;
@@ -754,30 +801,61 @@ void QsciScintilla::startAutoCompletion(AutoCompletionSource acs,
                     QString api_w = w;
                     api_w.append(' ');
 
-                    keep = !wlist.contains(api_w);
+                    keep = !wset.contains(api_w);
                 }
                 else
                 {
                     keep = true;
                 }
 
-                if (keep && !wlist.contains(w))
-                    wlist.append(w);
+                if (keep && !wset.contains(w))
+                {
+                    wset.insert(w);
+                    dlist.append(w);
+                }
             }
         }
 
         delete []orig_context;
+
+        dlist.sort();
     }
 
-    if (wlist.isEmpty())
+    if (wlist.isEmpty() && dlist.isEmpty())
         return;
 
-    wlist.sort();
+    // Merge the two lists, up to the limit, directly into the separated
+    // string that Scintilla expects.
+    ScintillaBytes wlist_s;
+    int wi = 0, di = 0, nr = 0;
+
+    while ((wi < wlist.count() || di < dlist.count()) &&
+            (acLimit <= 0 || nr < acLimit))
+    {
+        const QString *w;
+
+        if (di >= dlist.count() || (wi < wlist.count() && wlist[wi] < dlist[di]))
+            w = &wlist[wi++];
+        else
+            w = &dlist[di++];
+
+        if (nr++ > 0)
+            wlist_s += acSeparator;
+
+        wlist_s += textAsBytes(*w);
+    }
+
+    // Remember if the list may be missing entries so that it can be created
+    // again as the user types.
+    if (acLimit > 0 && (wi < wlist.count() || di < dlist.count() ||
+                wlist.count() >= acLimit))
+    {
+        acTruncated = true;
+        acTruncatedSource = acs;
+    }
 
     SendScintilla(SCI_AUTOCSETCHOOSESINGLE, choose_single);
     SendScintilla(SCI_AUTOCSETSEPARATOR, acSeparator);
-
-    ScintillaBytes wlist_s = textAsBytes(wlist.join(QChar(acSeparator)));
     SendScintilla(SCI_AUTOCSHOW, last_len, ScintillaBytesConstData(wlist_s));
 }
 
@@ -1145,6 +1223,77 @@ void QsciScintilla::setEdgeMode(EdgeMode mode)
 }
 
 
+// Enable or disable the recording of edits.
+void QsciScintilla::setEditJournalEnabled(bool enabled)
+{
+    if (edit_journal == enabled)
+        return;
+
+    SendScintilla(enabled ? SCI_ALLOCATEEDITJOURNAL : SCI_RELEASEEDITJOURNAL);
+    edit_journal = enabled;
+}
+
+
+// Return the version of the document.
+int QsciScintilla::editVersion() const
+{
+    return SendScintilla(SCI_GETEDITVERSION);
+}
+
+
+// Return the edits made since a version as a delta.
+QByteArray QsciScintilla::exportEdits(int fromVersion, bool compress) const
+{
+    long len = SendScintilla(SCI_EXPORTEDITS, fromVersion);
+
+    if (len <= 0)
+        return QByteArray();
+
+    QByteArray delta(len, '\0');
+
+    SendScintilla(SCI_EXPORTEDITS, fromVersion, delta.data());
+
+    if (compress)
+        delta = qCompress(delta);
+
+    return delta;
+}
+
+
+// Apply a delta returned by exportEdits().
+bool QsciScintilla::importEdits(const QByteArray &delta)
+{
+    // An uncompressed delta starts with a fixed signature.
+    QByteArray edits = delta.startsWith("SCED") ? delta : qUncompress(delta);
+
+    if (edits.isEmpty())
+        return false;
+
+    return SendScintilla(SCI_IMPORTEDITS, edits.size(), edits.constData());
+}
+
+
+// Discard the recorded edits made before a version.
+void QsciScintilla::discardEdits(int version)
+{
+    SendScintilla(SCI_DISCARDEDITS, version);
+}
+
+
+// Return the use of elastic tabstops.
+bool QsciScintilla::elasticTabstops() const
+{
+    return SendScintilla(SCI_GETELASTICTABSTOPS);
+}
+
+
+// Set the use of elastic tabstops.
+void QsciScintilla::setElasticTabstops(bool elastic)
+{
+    SendScintilla(SCI_SETELASTICTABSTOPS, elastic);
+}
+
+
 // Return the end-of-line visibility.
 bool QsciScintilla::eolVisibility() const
 {
@@ -1243,6 +1392,29 @@ void QsciScintilla::setTabDrawMode(TabDrawMode mode)
 }
 
 
+// Enable or disable the style index.
+void QsciScintilla::setStyleIndexEnabled(bool enabled)
+{
+    if (style_index == enabled)
+        return;
+
+    SendScintilla(enabled ? SCI_ALLOCATESTYLEINDEX : SCI_RELEASESTYLEINDEX);
+    style_index = enabled;
+}
+
+
+// Enable or disable the maintenance of text statistics.
+void QsciScintilla::setTextStatisticsEnabled(bool enabled)
+{
+    if (text_statistics == enabled)
+        return;
+
+    SendScintilla(
+            enabled ? SCI_ALLOCATETEXTSTATISTICS : SCI_RELEASETEXTSTATISTICS);
+    text_statistics = enabled;
+}
+
+
 // Return the line wrap mode.
 QsciScintilla::WrapMode QsciScintilla::wrapMode() const
 {
@@ -1811,6 +1983,69 @@ bool QsciScintilla::findNext()
 }
 
 
+// Find the first run of text with one of a set of styles.
+bool QsciScintilla::findStyleRun(const QList<int> &styles, int *start,
+        int *end, int from, int to)
+{
+    if (to < 0)
+        to = SendScintilla(SCI_GETTEXTLENGTH);
+
+    // Style any text in the range that hasn't been styled yet from the start
+    // of its line.
+    long end_styled = SendScintilla(SCI_GETENDSTYLED);
+
+    if (end_styled < to)
+        SendScintilla(SCI_COLOURISE,
+                SendScintilla(SCI_POSITIONFROMLINE,
+                        SendScintilla(SCI_LINEFROMPOSITION, end_styled)),
+                to);
+
+    QByteArray style_bytes;
+
+    for (int i = 0; i < styles.size(); ++i)
+        style_bytes.append(static_cast<char>(styles.at(i)));
+
+    // Preserve the target.
+    long targ_start = SendScintilla(SCI_GETTARGETSTART);
+    long targ_end = SendScintilla(SCI_GETTARGETEND);
+
+    SendScintilla(SCI_SETTARGETRANGE, from, to);
+
+    bool found = (SendScintilla(SCI_SEARCHSTYLEINTARGET, style_bytes.size(),
+            style_bytes.constData()) >= 0);
+
+    if (found)
+    {
+        *start = SendScintilla(SCI_GETTARGETSTART);
+        *end = SendScintilla(SCI_GETTARGETEND);
+    }
+
+    SendScintilla(SCI_SETTARGETRANGE, targ_start, targ_end);
+
+    return found;
+}
+
+
+// Return the runs of text with one of a set of styles.
+QList<int> QsciScintilla::styleRuns(const QList<int> &styles, int start,
+        int end)
+{
+    QList<int> runs;
+    int run_start, run_end;
+
+    if (end < 0)
+        end = SendScintilla(SCI_GETTEXTLENGTH);
+
+    while (findStyleRun(styles, &run_start, &run_end, start, end))
+    {
+        runs << run_start << run_end;
+        start = run_end;
+    }
+
+    return runs;
+}
+
+
 // Do the hard work of the find methods.
 bool QsciScintilla::doFind()
 {
@@ -2025,6 +2260,53 @@ void QsciScintilla::getSelection(int *lineFrom, int *indexFrom, int *lineTo,
 }
 
 
+// Get the statistics of the selected text.
+void QsciScintilla::getSelectionStatistics(int *characters, int *words,
+        int *lines, int *nonBlankLines) const
+{
+    *characters = *words = *lines = *nonBlankLines = 0;
+
+    int nr_selections = SendScintilla(SCI_GETSELECTIONS);
+
+    for (int i = 0; i < nr_selections; ++i)
+    {
+        int start = SendScintilla(SCI_GETSELECTIONNSTART, i);
+        int end = SendScintilla(SCI_GETSELECTIONNEND, i);
+
+        if (start == end)
+            continue;
+
+        int sel_characters, sel_words, sel_lines, sel_non_blank_lines;
+
+        getTextStatistics(&sel_characters, &sel_words, &sel_lines,
+                &sel_non_blank_lines, start, end);
+
+        *characters += sel_characters;
+        *words += sel_words;
+        *lines += sel_lines;
+        *nonBlankLines += sel_non_blank_lines;
+    }
+}
+
+
+// Get the statistics of some text.
+void QsciScintilla::getTextStatistics(int *characters, int *words, int *lines,
+        int *nonBlankLines, int start, int end) const
+{
+    if (end < 0)
+        end = SendScintilla(SCI_GETTEXTLENGTH);
+
+    if (start > end)
+        start = end;
+
+    *characters = SendScintilla(SCI_COUNTCHARACTERS, start, end);
+    *words = SendScintilla(SCI_COUNTWORDS, start, end);
+    *lines = SendScintilla(SCI_LINEFROMPOSITION, end) -
+            SendScintilla(SCI_LINEFROMPOSITION, start) + 1;
+    *nonBlankLines = SendScintilla(SCI_COUNTNONBLANKLINES, start, end);
+}
+
+
 // Sets the current selection.
 void QsciScintilla::setSelection(int lineFrom, int indexFrom, int lineTo,
         int indexTo)
@@ -2663,6 +2945,20 @@ void QsciScintilla::setMarginBackgroundColor(int margin, const QColor &col)
 }
 
 
+// Return the number of pages laid out ahead of scrolling.
+int QsciScintilla::layoutPrefetch() const
+{
+    return SendScintilla(SCI_GETLAYOUTPREFETCH);
+}
+
+
+// Set the number of pages laid out ahead of scrolling.
+void QsciScintilla::setLayoutPrefetch(int pages)
+{
+    SendScintilla(SCI_SETLAYOUTPREFETCH, pages);
+}
+
+
 // Return the margin options.
 int QsciScintilla::marginOptions() const
 {
@@ -3160,6 +3456,95 @@ int QsciScintilla::markerFindPrevious(int linenr, unsigned mask) const
 }
 
 
+// Add a position anchor.
+int QsciScintilla::addPositionAnchor(int pos, AnchorGravity gravity)
+{
+    return SendScintilla(SCI_POSITIONANCHORADD, pos, static_cast<long>(gravity));
+}
+
+
+// Add a number of position anchors.
+QList<int> QsciScintilla::addPositionAnchors(const QList<int> &positions,
+        AnchorGravity gravity)
+{
+    QList<int> handles;
+
+    handles.reserve(positions.size());
+
+    for (int i = 0; i < positions.size(); ++i)
+        handles.append(addPositionAnchor(positions.at(i), gravity));
+
+    return handles;
+}
+
+
+// Return the position of a position anchor.
+int QsciScintilla::positionAnchorPosition(int handle) const
+{
+    return SendScintilla(SCI_POSITIONANCHORPOSITION, handle);
+}
+
+
+// Return the positions of a number of position anchors.
+QList<int> QsciScintilla::positionAnchorPositions(const QList<int> &handles)
+        const
+{
+    QVector<qintptr> buffer(handles.size());
+
+    for (int i = 0; i < handles.size(); ++i)
+        buffer[i] = handles.at(i);
+
+    if (!buffer.isEmpty())
+        SendScintilla(SCI_POSITIONANCHORPOSITIONS, buffer.size(),
+                buffer.data());
+
+    QList<int> positions;
+
+    positions.reserve(buffer.size());
+
+    for (int i = 0; i < buffer.size(); ++i)
+        positions.append(buffer.at(i));
+
+    return positions;
+}
+
+
+// Return the position anchors in a range of text.
+QList<int> QsciScintilla::positionAnchorsInRange(int start, int end) const
+{
+    QList<int> handles;
+
+    int first = SendScintilla(SCI_POSITIONANCHORINDEXFROMPOSITION, start);
+    int last = SendScintilla(SCI_POSITIONANCHORINDEXFROMPOSITION, end);
+
+    for (int index = first; index < last; ++index)
+        handles.append(SendScintilla(SCI_POSITIONANCHORHANDLEAT, index));
+
+    return handles;
+}
+
+
+// Delete a number of position anchors.
+void QsciScintilla::deletePositionAnchors(const QList<int> &handles)
+{
+    QVector<qintptr> buffer(handles.size());
+
+    for (int i = 0; i < handles.size(); ++i)
+        buffer[i] = handles.at(i);
+
+    if (!buffer.isEmpty())
+        SendScintilla(SCI_POSITIONANCHORDELETEHANDLES, buffer.size(),
+                buffer.data());
+}
+
+
+// Delete all position anchors.
+void QsciScintilla::deleteAllPositionAnchors()
+{
+    SendScintilla(SCI_POSITIONANCHORDELETEALL);
+}
+
+
 // Set the marker background colour.
 void QsciScintilla::setMarkerBackgroundColor(const QColor &col, int markerNumber)
 {
@@ -3357,6 +3742,20 @@ void QsciScintilla::resetUnmatchedBraceIndicator()
 }
 
 
+// Set the number of documents whose view is kept.
+void QsciScintilla::setViewStateCacheSize(int size)
+{
+    SendScintilla(SCI_SETVIEWSTATECACHESIZE, size);
+}
+
+
+// Return the number of documents whose view is kept.
+int QsciScintilla::viewStateCacheSize() const
+{
+    return SendScintilla(SCI_GETVIEWSTATECACHESIZE);
+}
+
+
 // Detach any lexer.
 void QsciScintilla::detachLexer()
 {
@@ -3752,6 +4151,111 @@ int QsciScintilla::positionFromLineIndex(int line, int index) const
 }
 
 
+// Convert a list of UTF-16 offsets to positions.
+QList<int> QsciScintilla::positionsFromUtf16Offsets(const QList<int> &offsets)
+{
+    return convertUtf16(SCI_POSITIONSFROMCODEUNITS, offsets);
+}
+
+
+// Convert a list of positions to UTF-16 offsets.
+QList<int> QsciScintilla::utf16OffsetsFromPositions(
+        const QList<int> &positions)
+{
+    return convertUtf16(SCI_CODEUNITSFROMPOSITIONS, positions);
+}
+
+
+// Convert a list of lines and UTF-16 indexes to positions.
+QList<int> QsciScintilla::positionsFromUtf16LineIndexes(
+        const QList<int> &line_indexes)
+{
+    QList<int> lines, line_starts;
+
+    for (int i = 0; i + 1 < line_indexes.size(); i += 2)
+    {
+        int line = line_indexes.at(i);
+
+        lines.append(line);
+        line_starts.append(SendScintilla(SCI_POSITIONFROMLINE, line));
+    }
+
+    // Convert the starts of the lines in one go.
+    QList<int> offsets = utf16OffsetsFromPositions(line_starts);
+
+    for (int i = 0; i < offsets.size(); ++i)
+        offsets[i] += qMax(line_indexes.at(i * 2 + 1), 0);
+
+    QList<int> positions = positionsFromUtf16Offsets(offsets);
+
+    // Don't go past the end of the line.
+    for (int i = 0; i < positions.size(); ++i)
+    {
+        int line_end = SendScintilla(SCI_GETLINEENDPOSITION, lines.at(i));
+
+        if (positions.at(i) > line_end)
+            positions[i] = line_end;
+    }
+
+    return positions;
+}
+
+
+// Convert a list of positions to lines and UTF-16 indexes.
+QList<int> QsciScintilla::utf16LineIndexesFromPositions(
+        const QList<int> &positions)
+{
+    // Convert the positions and the starts of their lines in one go.
+    QList<int> lines, values = positions;
+
+    for (int i = 0; i < positions.size(); ++i)
+    {
+        int line = SendScintilla(SCI_LINEFROMPOSITION, positions.at(i));
+
+        lines.append(line);
+        values.append(SendScintilla(SCI_POSITIONFROMLINE, line));
+    }
+
+    QList<int> offsets = utf16OffsetsFromPositions(values);
+    QList<int> line_indexes;
+
+    for (int i = 0; i < positions.size(); ++i)
+        line_indexes << lines.at(i)
+                << offsets.at(i) - offsets.at(positions.size() + i);
+
+    return line_indexes;
+}
+
+
+// Convert a list of values with SCI_POSITIONSFROMCODEUNITS or
+// SCI_CODEUNITSFROMPOSITIONS.
+QList<int> QsciScintilla::convertUtf16(int msg, const QList<int> &values)
+{
+    // Scintilla only indexes UTF-8 text and the conversion works without it.
+    if (!utf16_index && SendScintilla(SCI_GETCODEPAGE) == SC_CP_UTF8)
+    {
+        SendScintilla(SCI_ALLOCATELINECHARACTERINDEX,
+                SC_LINECHARACTERINDEX_UTF16);
+        utf16_index = true;
+    }
+
+    QVector<qintptr> buffer(values.size());
+
+    for (int i = 0; i < values.size(); ++i)
+        buffer[i] = values.at(i);
+
+    if (!buffer.isEmpty())
+        SendScintilla(msg, buffer.size(), buffer.data());
+
+    QList<int> converted;
+
+    for (int i = 0; i < buffer.size(); ++i)
+        converted.append(buffer.at(i));
+
+    return converted;
+}
+
+
 // Return a line number and an index within the line from a position.
 void QsciScintilla::lineIndexFromPosition(int position, int *line, int *index) const
 {
@@ -3786,6 +4290,13 @@ void QsciScintilla::setAutoCompletionSource(AutoCompletionSource source)
 }
 
 
+// Set the maximum number of entries in the auto-completion list.
+void QsciScintilla::setAutoCompletionLimit(int limit)
+{
+    acLimit = limit;
+}
+
+
 // Set the threshold for automatic auto-completion.
 void QsciScintilla::setAutoCompletionThreshold(int thresh)
 {
@@ -3982,9 +4493,36 @@ void QsciScintilla::setDocument(const QsciDocument &document)
 {
     if (doc.pdoc != document.pdoc)
     {
+        // Text statistics and the style index belong to the document.
+        if (text_statistics)
+            SendScintilla(SCI_RELEASETEXTSTATISTICS);
+
+        if (style_index)
+            SendScintilla(SCI_RELEASESTYLEINDEX);
+
+        if (utf16_index)
+            SendScintilla(SCI_RELEASELINECHARACTERINDEX,
+                    SC_LINECHARACTERINDEX_UTF16);
+
+        if (edit_journal)
+            SendScintilla(SCI_RELEASEEDITJOURNAL);
+
         doc.undisplay(this);
         doc.attach(document);
         doc.display(this,&document);
+
+        if (text_statistics)
+            SendScintilla(SCI_ALLOCATETEXTSTATISTICS);
+
+        if (style_index)
+            SendScintilla(SCI_ALLOCATESTYLEINDEX);
+
+        if (utf16_index)
+            SendScintilla(SCI_ALLOCATELINECHARACTERINDEX,
+                    SC_LINECHARACTERINDEX_UTF16);
+
+        if (edit_journal)
+            SendScintilla(SCI_ALLOCATEEDITJOURNAL);
     }
 }
 
@@ -4056,6 +4594,8 @@ void QsciScintilla::showUserList(int id, const QStringList &list)
     if (id <= 0)
         return;
 
+    acTruncated = false;
+
     SendScintilla(SCI_AUTOCSETSEPARATOR, userSeparator);
 
     ScintillaBytes s = textAsBytes(list.join(QChar(userSeparator)));
@@ -37,6 +37,8 @@
 #include <QScrollBar>
 #include <QStyle>
 
+#include "Qsci/qscisessionrecorder.h"
+
 #include "SciAccessibility.h"
 #include "ScintillaQt.h"
 
@@ -87,7 +89,8 @@ extern void initialiseRectangularPasteboardMime();
 // The ctor.
 QsciScintillaBase::QsciScintillaBase(QWidget *parent)
     : QAbstractScrollArea(parent), preeditPos(-1), preeditNrBytes(0),
-            clickCausedFocus(false)
+            clickCausedFocus(false), recorder(0), imContextLength(1024),
+            imContextDoc(0)
 {
 #if !defined(QT_NO_ACCESSIBILITY)
     QsciAccessibleScintillaBase::initialise();
@@ -132,6 +135,10 @@ QsciScintillaBase::QsciScintillaBase(QWidget *parent)
 // The dtor.
 QsciScintillaBase::~QsciScintillaBase()
 {
+    // Finish any recording while the editor is still intact.
+    if (recorder)
+        recorder->stop();
+
     // The QsciScintillaQt object isn't a child so delete it explicitly.
     delete sci;
 
@@ -160,7 +167,18 @@ void QsciScintillaBase::setScrollBars()
 long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
         long lParam) const
 {
-    return sci->WndProc(msg, wParam, lParam);
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return sci->WndProc(msg, wParam, lParam);
+
+    rec->recordMessage(msg, wParam, lParam);
+
+    rec->enter();
+    long res = sci->WndProc(msg, wParam, lParam);
+    rec->leave();
+
+    return res;
 }
 
 
@@ -168,7 +186,18 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
 long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
         void *lParam) const
 {
-    return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+
+    rec->recordMessage(msg, wParam, static_cast<const void *>(lParam));
+
+    rec->enter();
+    long res = sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+    rec->leave();
+
+    return res;
 }
 
 
@@ -176,7 +205,18 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
 long QsciScintillaBase::SendScintilla(unsigned int msg, uintptr_t wParam,
         const char *lParam) const
 {
-    return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+
+    rec->recordMessage(msg, wParam, lParam);
+
+    rec->enter();
+    long res = sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(lParam));
+    rec->leave();
+
+    return res;
 }
 
 
@@ -184,8 +224,7 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, uintptr_t wParam,
 long QsciScintillaBase::SendScintilla(unsigned int msg,
         const char *lParam) const
 {
-    return sci->WndProc(msg, static_cast<uptr_t>(0),
-            reinterpret_cast<sptr_t>(lParam));
+    return SendScintilla(msg, static_cast<uintptr_t>(0), lParam);
 }
 
 
@@ -193,24 +232,34 @@ long QsciScintillaBase::SendScintilla(unsigned int msg,
 long QsciScintillaBase::SendScintilla(unsigned int msg, const char *wParam,
         const char *lParam) const
 {
-    return sci->WndProc(msg, reinterpret_cast<uptr_t>(wParam),
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return sci->WndProc(msg, reinterpret_cast<uptr_t>(wParam),
+                reinterpret_cast<sptr_t>(lParam));
+
+    rec->recordMessage(msg, wParam, lParam);
+
+    rec->enter();
+    long res = sci->WndProc(msg, reinterpret_cast<uptr_t>(wParam),
             reinterpret_cast<sptr_t>(lParam));
+    rec->leave();
+
+    return res;
 }
 
 
 // Overloaded message send.
 long QsciScintillaBase::SendScintilla(unsigned int msg, long wParam) const
 {
-    return sci->WndProc(msg, static_cast<uptr_t>(wParam),
-            static_cast<sptr_t>(0));
+    return SendScintilla(msg, static_cast<unsigned long>(wParam), 0L);
 }
 
 
 // Overloaded message send.
 long QsciScintillaBase::SendScintilla(unsigned int msg, int wParam) const
 {
-    return sci->WndProc(msg, static_cast<uptr_t>(wParam),
-            static_cast<sptr_t>(0));
+    return SendScintilla(msg, static_cast<unsigned long>(wParam), 0L);
 }
 
 
@@ -224,8 +273,20 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, long cpMin, long cpMax,
     tr.chrg.cpMax = cpMax;
     tr.lpstrText = lpstrText;
 
-    return sci->WndProc(msg, static_cast<uptr_t>(0),
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return sci->WndProc(msg, static_cast<uptr_t>(0),
+                reinterpret_cast<sptr_t>(&tr));
+
+    rec->recordMessage(msg, cpMin, cpMax);
+
+    rec->enter();
+    long res = sci->WndProc(msg, static_cast<uptr_t>(0),
             reinterpret_cast<sptr_t>(&tr));
+    rec->leave();
+
+    return res;
 }
 
 
@@ -233,18 +294,18 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, long cpMin, long cpMax,
 long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
         const QColor &col) const
 {
-    sptr_t lParam = (col.blue() << 16) | (col.green() << 8) | col.red();
+    long lParam = (col.blue() << 16) | (col.green() << 8) | col.red();
 
-    return sci->WndProc(msg, wParam, lParam);
+    return SendScintilla(msg, wParam, lParam);
 }
 
 
 // Overloaded message send.
 long QsciScintillaBase::SendScintilla(unsigned int msg, const QColor &col) const
 {
-    uptr_t wParam = (col.blue() << 16) | (col.green() << 8) | col.red();
+    unsigned long wParam = (col.blue() << 16) | (col.green() << 8) | col.red();
 
-    return sci->WndProc(msg, wParam, static_cast<sptr_t>(0));
+    return SendScintilla(msg, wParam, 0L);
 }
 
 
@@ -264,6 +325,9 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
     rf.chrg.cpMin = cpMin;
     rf.chrg.cpMax = cpMax;
 
+    if (recorder)
+        recorder->recordSkipped();
+
     return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(&rf));
 }
 
@@ -272,6 +336,9 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
 long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
         const QPixmap &lParam) const
 {
+    if (recorder)
+        recorder->recordSkipped();
+
     return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(&lParam));
 }
 
@@ -280,6 +347,9 @@ long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
 long QsciScintillaBase::SendScintilla(unsigned int msg, unsigned long wParam,
         const QImage &lParam) const
 {
+    if (recorder)
+        recorder->recordSkipped();
+
     return sci->WndProc(msg, wParam, reinterpret_cast<sptr_t>(&lParam));
 }
 
@@ -293,6 +363,42 @@ void *QsciScintillaBase::SendScintillaPtrResult(unsigned int msg) const
 }
 
 
+// Re-implemented so that the events handled by the editor can be recorded.
+bool QsciScintillaBase::event(QEvent *e)
+{
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return QAbstractScrollArea::event(e);
+
+    rec->recordEvent(e, false);
+
+    rec->enter();
+    bool res = QAbstractScrollArea::event(e);
+    rec->leave();
+
+    return res;
+}
+
+
+// Re-implemented so that the events handled by the viewport can be recorded.
+bool QsciScintillaBase::viewportEvent(QEvent *e)
+{
+    QsciSessionRecorder *rec = recorder;
+
+    if (!rec)
+        return QAbstractScrollArea::viewportEvent(e);
+
+    rec->recordEvent(e, true);
+
+    rec->enter();
+    bool res = QAbstractScrollArea::viewportEvent(e);
+    rec->leave();
+
+    return res;
+}
+
+
 // Re-implemented to handle font changes
 void QsciScintillaBase::changeEvent(QEvent *e)
 {
@@ -654,6 +760,9 @@ void QsciScintillaBase::scrollContentsBy(int, int)
 // Handle the vertical scrollbar.
 void QsciScintillaBase::handleVSb(int value)
 {
+    if (recorder)
+        recorder->recordScroll(Qt::Vertical, value);
+
     sci->ScrollTo(value);
 }
 
@@ -661,6 +770,9 @@ void QsciScintillaBase::handleVSb(int value)
 // Handle the horizontal scrollbar.
 void QsciScintillaBase::handleHSb(int value)
 {
+    if (recorder)
+        recorder->recordScroll(Qt::Horizontal, value);
+
     sci->HorizontalScrollTo(value);
 }
 
@@ -0,0 +1,826 @@
+// This module implements the QsciSessionRecorder class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qscisessionrecorder.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QFocusEvent>
+#include <QInputMethodEvent>
+#include <QKeyEvent>
+#include <QList>
+#include <QMouseEvent>
+#include <QResizeEvent>
+#include <QWheelEvent>
+
+#include "Qsci/qscilexer.h"
+#include "Qsci/qsciscintilla.h"
+
+
+// This must match the value in qsciscintilla.cpp.
+#define KEYWORDSET_MAX  8
+
+
+// The settings that are captured when recording starts, as pairs of the
+// message that gets a setting and the message that sets it.  The order is
+// the order in which they are restored.
+static const int settings[][2] = {
+    {QsciScintillaBase::SCI_GETTABWIDTH, QsciScintillaBase::SCI_SETTABWIDTH},
+    {QsciScintillaBase::SCI_GETUSETABS, QsciScintillaBase::SCI_SETUSETABS},
+    {QsciScintillaBase::SCI_GETINDENT, QsciScintillaBase::SCI_SETINDENT},
+    {QsciScintillaBase::SCI_GETTABINDENTS, QsciScintillaBase::SCI_SETTABINDENTS},
+    {QsciScintillaBase::SCI_GETBACKSPACEUNINDENTS, QsciScintillaBase::SCI_SETBACKSPACEUNINDENTS},
+    {QsciScintillaBase::SCI_GETELASTICTABSTOPS, QsciScintillaBase::SCI_SETELASTICTABSTOPS},
+    {QsciScintillaBase::SCI_GETWRAPMODE, QsciScintillaBase::SCI_SETWRAPMODE},
+    {QsciScintillaBase::SCI_GETWRAPVISUALFLAGS, QsciScintillaBase::SCI_SETWRAPVISUALFLAGS},
+    {QsciScintillaBase::SCI_GETWRAPVISUALFLAGSLOCATION, QsciScintillaBase::SCI_SETWRAPVISUALFLAGSLOCATION},
+    {QsciScintillaBase::SCI_GETWRAPSTARTINDENT, QsciScintillaBase::SCI_SETWRAPSTARTINDENT},
+    {QsciScintillaBase::SCI_GETWRAPINDENTMODE, QsciScintillaBase::SCI_SETWRAPINDENTMODE},
+    {QsciScintillaBase::SCI_GETVIEWWS, QsciScintillaBase::SCI_SETVIEWWS},
+    {QsciScintillaBase::SCI_GETWHITESPACESIZE, QsciScintillaBase::SCI_SETWHITESPACESIZE},
+    {QsciScintillaBase::SCI_GETVIEWEOL, QsciScintillaBase::SCI_SETVIEWEOL},
+    {QsciScintillaBase::SCI_GETINDENTATIONGUIDES, QsciScintillaBase::SCI_SETINDENTATIONGUIDES},
+    {QsciScintillaBase::SCI_GETEDGEMODE, QsciScintillaBase::SCI_SETEDGEMODE},
+    {QsciScintillaBase::SCI_GETEDGECOLUMN, QsciScintillaBase::SCI_SETEDGECOLUMN},
+    {QsciScintillaBase::SCI_GETEDGECOLOUR, QsciScintillaBase::SCI_SETEDGECOLOUR},
+    {QsciScintillaBase::SCI_GETCARETLINEVISIBLE, QsciScintillaBase::SCI_SETCARETLINEVISIBLE},
+    {QsciScintillaBase::SCI_GETCARETLINEBACK, QsciScintillaBase::SCI_SETCARETLINEBACK},
+    {QsciScintillaBase::SCI_GETCARETSTYLE, QsciScintillaBase::SCI_SETCARETSTYLE},
+    {QsciScintillaBase::SCI_GETCARETWIDTH, QsciScintillaBase::SCI_SETCARETWIDTH},
+    {QsciScintillaBase::SCI_GETCARETFORE, QsciScintillaBase::SCI_SETCARETFORE},
+    {QsciScintillaBase::SCI_GETSCROLLWIDTH, QsciScintillaBase::SCI_SETSCROLLWIDTH},
+    {QsciScintillaBase::SCI_GETSCROLLWIDTHTRACKING, QsciScintillaBase::SCI_SETSCROLLWIDTHTRACKING},
+    {QsciScintillaBase::SCI_GETENDATLASTLINE, QsciScintillaBase::SCI_SETENDATLASTLINE},
+    {QsciScintillaBase::SCI_GETHSCROLLBAR, QsciScintillaBase::SCI_SETHSCROLLBAR},
+    {QsciScintillaBase::SCI_GETVSCROLLBAR, QsciScintillaBase::SCI_SETVSCROLLBAR},
+    {QsciScintillaBase::SCI_GETMULTIPLESELECTION, QsciScintillaBase::SCI_SETMULTIPLESELECTION},
+    {QsciScintillaBase::SCI_GETADDITIONALSELECTIONTYPING, QsciScintillaBase::SCI_SETADDITIONALSELECTIONTYPING},
+    {QsciScintillaBase::SCI_GETMULTIPASTE, QsciScintillaBase::SCI_SETMULTIPASTE},
+    {QsciScintillaBase::SCI_GETVIRTUALSPACEOPTIONS, QsciScintillaBase::SCI_SETVIRTUALSPACEOPTIONS},
+    {QsciScintillaBase::SCI_GETLAYOUTCACHE, QsciScintillaBase::SCI_SETLAYOUTCACHE},
+    {QsciScintillaBase::SCI_GETPOSITIONCACHE, QsciScintillaBase::SCI_SETPOSITIONCACHE},
+    {QsciScintillaBase::SCI_GETLAYOUTPREFETCH, QsciScintillaBase::SCI_SETLAYOUTPREFETCH},
+    {QsciScintillaBase::SCI_GETPHASESDRAW, QsciScintillaBase::SCI_SETPHASESDRAW},
+    {QsciScintillaBase::SCI_GETBUFFEREDDRAW, QsciScintillaBase::SCI_SETBUFFEREDDRAW},
+    {QsciScintillaBase::SCI_GETIDLESTYLING, QsciScintillaBase::SCI_SETIDLESTYLING},
+    {QsciScintillaBase::SCI_GETCONTROLCHARSYMBOL, QsciScintillaBase::SCI_SETCONTROLCHARSYMBOL},
+    {QsciScintillaBase::SCI_GETMARGINLEFT, QsciScintillaBase::SCI_SETMARGINLEFT},
+    {QsciScintillaBase::SCI_GETMARGINRIGHT, QsciScintillaBase::SCI_SETMARGINRIGHT},
+    {QsciScintillaBase::SCI_GETEXTRAASCENT, QsciScintillaBase::SCI_SETEXTRAASCENT},
+    {QsciScintillaBase::SCI_GETEXTRADESCENT, QsciScintillaBase::SCI_SETEXTRADESCENT},
+    {QsciScintillaBase::SCI_GETAUTOMATICFOLD, QsciScintillaBase::SCI_SETAUTOMATICFOLD},
+    {QsciScintillaBase::SCI_ANNOTATIONGETVISIBLE, QsciScintillaBase::SCI_ANNOTATIONSETVISIBLE},
+    {QsciScintillaBase::SCI_GETMODEVENTMASK, QsciScintillaBase::SCI_SETMODEVENTMASK},
+    {QsciScintillaBase::SCI_GETMOUSEDWELLTIME, QsciScintillaBase::SCI_SETMOUSEDWELLTIME},
+    {QsciScintillaBase::SCI_GETCOMMANDEVENTS, QsciScintillaBase::SCI_SETCOMMANDEVENTS},
+    {QsciScintillaBase::SCI_GETZOOM, QsciScintillaBase::SCI_SETZOOM},
+    {QsciScintillaBase::SCI_GETSELECTIONMODE, QsciScintillaBase::SCI_SETSELECTIONMODE},
+    {QsciScintillaBase::SCI_GETREADONLY, QsciScintillaBase::SCI_SETREADONLY}
+};
+
+// The settings of each margin.
+static const int marginSettings[][2] = {
+    {QsciScintillaBase::SCI_GETMARGINTYPEN, QsciScintillaBase::SCI_SETMARGINTYPEN},
+    {QsciScintillaBase::SCI_GETMARGINWIDTHN, QsciScintillaBase::SCI_SETMARGINWIDTHN},
+    {QsciScintillaBase::SCI_GETMARGINMASKN, QsciScintillaBase::SCI_SETMARGINMASKN},
+    {QsciScintillaBase::SCI_GETMARGINSENSITIVEN, QsciScintillaBase::SCI_SETMARGINSENSITIVEN},
+    {QsciScintillaBase::SCI_GETMARGINCURSORN, QsciScintillaBase::SCI_SETMARGINCURSORN},
+    {QsciScintillaBase::SCI_GETMARGINBACKN, QsciScintillaBase::SCI_SETMARGINBACKN}
+};
+
+// The attributes of each style, apart from the font name.
+static const int styleSettings[][2] = {
+    {QsciScintillaBase::SCI_STYLEGETFORE, QsciScintillaBase::SCI_STYLESETFORE},
+    {QsciScintillaBase::SCI_STYLEGETBACK, QsciScintillaBase::SCI_STYLESETBACK},
+    {QsciScintillaBase::SCI_STYLEGETSIZEFRACTIONAL, QsciScintillaBase::SCI_STYLESETSIZEFRACTIONAL},
+    {QsciScintillaBase::SCI_STYLEGETWEIGHT, QsciScintillaBase::SCI_STYLESETWEIGHT},
+    {QsciScintillaBase::SCI_STYLEGETITALIC, QsciScintillaBase::SCI_STYLESETITALIC},
+    {QsciScintillaBase::SCI_STYLEGETUNDERLINE, QsciScintillaBase::SCI_STYLESETUNDERLINE},
+    {QsciScintillaBase::SCI_STYLEGETEOLFILLED, QsciScintillaBase::SCI_STYLESETEOLFILLED},
+    {QsciScintillaBase::SCI_STYLEGETCASE, QsciScintillaBase::SCI_STYLESETCASE},
+    {QsciScintillaBase::SCI_STYLEGETVISIBLE, QsciScintillaBase::SCI_STYLESETVISIBLE},
+    {QsciScintillaBase::SCI_STYLEGETCHANGEABLE, QsciScintillaBase::SCI_STYLESETCHANGEABLE},
+    {QsciScintillaBase::SCI_STYLEGETHOTSPOT, QsciScintillaBase::SCI_STYLESETHOTSPOT},
+    {QsciScintillaBase::SCI_STYLEGETCHARACTERSET, QsciScintillaBase::SCI_STYLESETCHARACTERSET}
+};
+
+// The messages that return a string, or other bytes, in a buffer passed as
+// lParam.  These are recorded without their (output) buffer and the buffer is
+// sized by asking for the length of the result when replayed.
+static const unsigned int resultMessages[] = {
+    QsciScintillaBase::SCI_GETCURLINE,
+    QsciScintillaBase::SCI_GETLINE,
+    QsciScintillaBase::SCI_GETSELTEXT,
+    QsciScintillaBase::SCI_GETTEXT,
+    QsciScintillaBase::SCI_TARGETASUTF8,
+    QsciScintillaBase::SCI_STYLEGETFONT,
+    QsciScintillaBase::SCI_MARGINGETTEXT,
+    QsciScintillaBase::SCI_MARGINGETSTYLES,
+    QsciScintillaBase::SCI_ANNOTATIONGETTEXT,
+    QsciScintillaBase::SCI_ANNOTATIONGETSTYLES,
+    QsciScintillaBase::SCI_AUTOCGETCURRENTTEXT,
+    QsciScintillaBase::SCI_GETTAG,
+    QsciScintillaBase::SCI_GETWORDCHARS,
+    QsciScintillaBase::SCI_GETWHITESPACECHARS,
+    QsciScintillaBase::SCI_GETPUNCTUATIONCHARS,
+    QsciScintillaBase::SCI_GETTARGETTEXT,
+    QsciScintillaBase::SCI_GETLEXERLANGUAGE,
+    QsciScintillaBase::SCI_PROPERTYNAMES,
+    QsciScintillaBase::SCI_DESCRIBEKEYWORDSETS,
+    QsciScintillaBase::SCI_GETSUBSTYLEBASES,
+    QsciScintillaBase::SCI_NAMEOFSTYLE,
+    QsciScintillaBase::SCI_TAGSOFSTYLE,
+    QsciScintillaBase::SCI_DESCRIPTIONOFSTYLE,
+    QsciScintillaBase::SCI_EXPORTEDITS
+};
+
+// The messages that take a string as wParam and return a string in a buffer
+// passed as lParam.
+static const unsigned int stringResultMessages[] = {
+    QsciScintillaBase::SCI_ENCODEDFROMUTF8,
+    QsciScintillaBase::SCI_GETREPRESENTATION,
+    QsciScintillaBase::SCI_GETPROPERTY,
+    QsciScintillaBase::SCI_GETPROPERTYEXPANDED,
+    QsciScintillaBase::SCI_DESCRIBEPROPERTY
+};
+
+
+// Return the string result of a message.
+static QByteArray stringResult(QsciScintillaBase *ed, unsigned int msg,
+        uintptr_t wParam)
+{
+    long need = ed->SendScintilla(msg, wParam,
+            static_cast<const char *>(0));
+
+    QByteArray result(need + 1, '\0');
+    ed->SendScintilla(msg, wParam, result.data());
+    result.truncate(qstrlen(result.constData()));
+
+    return result;
+}
+
+
+// Return the string result of a message that takes a string argument.
+static QByteArray keyedStringResult(QsciScintillaBase *ed, unsigned int msg,
+        const char *wParam)
+{
+    long need = ed->SendScintilla(msg, wParam,
+            static_cast<const char *>(0));
+
+    QByteArray result(need + 1, '\0');
+    ed->SendScintilla(msg, wParam, result.data());
+    result.truncate(qstrlen(result.constData()));
+
+    return result;
+}
+
+
+// The ctor.
+QsciSessionRecorder::QsciSessionRecorder(QsciScintillaBase *editor)
+    : QObject(editor), ed(editor), out(0), depth(0), nr_records(0),
+            nr_skipped(0)
+{
+}
+
+
+// The dtor.
+QsciSessionRecorder::~QsciSessionRecorder()
+{
+    stop();
+}
+
+
+// Return the editor.
+QsciScintillaBase *QsciSessionRecorder::editor() const
+{
+    return ed;
+}
+
+
+// Start recording.
+bool QsciSessionRecorder::start(const QString &filename)
+{
+    if (out || !ed || ed->recorder)
+        return false;
+
+    file_name = filename;
+    records.clear();
+    nr_records = 0;
+    nr_skipped = 0;
+    depth = 0;
+
+    QBuffer *buf = new QBuffer(&records);
+    buf->open(QIODevice::WriteOnly);
+
+    out = new QDataStream(buf);
+    out->setVersion(QDataStream::Qt_5_0);
+
+    // The state is captured before the recorder is attached so that the
+    // messages used to query it are not themselves recorded.
+    clock.invalidate();
+    captureState();
+    beginRecord(StateCaptured);
+    clock.start();
+
+    ed->recorder = this;
+
+    return true;
+}
+
+
+// Stop recording and write the file.
+bool QsciSessionRecorder::stop()
+{
+    if (!out)
+        return false;
+
+    if (ed && ed->recorder == this)
+        ed->recorder = 0;
+
+    QIODevice *buf = out->device();
+    delete out;
+    out = 0;
+    delete buf;
+
+    QFile f(file_name);
+
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream fs(&f);
+    fs.setVersion(QDataStream::Qt_5_0);
+    fs << static_cast<quint32>(Magic) << static_cast<quint16>(Version)
+            << qCompress(records);
+
+    records.clear();
+
+    return fs.status() == QDataStream::Ok;
+}
+
+
+// Return true if a recording is in progress.
+bool QsciSessionRecorder::isRecording() const
+{
+    return out != 0;
+}
+
+
+// Return the number of records.
+int QsciSessionRecorder::recordCount() const
+{
+    return nr_records;
+}
+
+
+// Return the number of messages that couldn't be recorded.
+int QsciSessionRecorder::skippedCount() const
+{
+    return nr_skipped;
+}
+
+
+// Return true if the current message or event should be recorded.
+bool QsciSessionRecorder::recording() const
+{
+    return out && depth == 0;
+}
+
+
+// Write the start of a record.
+void QsciSessionRecorder::beginRecord(RecordType type)
+{
+    qint64 when = 0;
+
+    if (clock.isValid())
+    {
+        when = clock.nsecsElapsed() / 1000;
+        ++nr_records;
+    }
+
+    *out << static_cast<quint8>(type) << when;
+}
+
+
+// Record a message with scalar arguments.
+void QsciSessionRecorder::recordMessage(unsigned int msg,
+        unsigned long wParam, long lParam)
+{
+    if (!recording())
+        return;
+
+    beginRecord(Message);
+    *out << static_cast<quint32>(msg) << static_cast<quint64>(wParam)
+            << static_cast<qint64>(lParam);
+}
+
+
+// Record a message with a pointer argument.  Only a null pointer can be
+// recorded.
+void QsciSessionRecorder::recordMessage(unsigned int msg,
+        unsigned long wParam, const void *lParam)
+{
+    if (!recording())
+        return;
+
+    if (lParam)
+        recordSkipped();
+    else
+        recordMessage(msg, wParam, 0L);
+}
+
+
+// Record a message with a string argument.
+void QsciSessionRecorder::recordMessage(unsigned int msg, uintptr_t wParam,
+        const char *lParam)
+{
+    if (!recording())
+        return;
+
+    if (!lParam)
+    {
+        recordMessage(msg, static_cast<unsigned long>(wParam), 0L);
+        return;
+    }
+
+    if (isResultMessage(msg))
+    {
+        beginRecord(ResultMessage);
+        *out << static_cast<quint32>(msg) << static_cast<quint64>(wParam);
+        return;
+    }
+
+    int len;
+
+    switch (msg)
+    {
+    case QsciScintillaBase::SCI_ADDTEXT:
+    case QsciScintillaBase::SCI_ADDSTYLEDTEXT:
+    case QsciScintillaBase::SCI_APPENDTEXT:
+    case QsciScintillaBase::SCI_REPLACETARGET:
+    case QsciScintillaBase::SCI_REPLACETARGETRE:
+    case QsciScintillaBase::SCI_SEARCHINTARGET:
+    case QsciScintillaBase::SCI_CHANGEINSERTION:
+    case QsciScintillaBase::SCI_SETSTYLINGEX:
+    case QsciScintillaBase::SCI_COPYTEXT:
+    case QsciScintillaBase::SCI_SEARCHSTYLEINTARGET:
+    case QsciScintillaBase::SCI_IMPORTEDITS:
+        // These take the length of the string as wParam.
+        if (static_cast<intptr_t>(wParam) < 0)
+            len = qstrlen(lParam);
+        else
+            len = wParam;
+
+        break;
+
+    case QsciScintillaBase::SCI_MARGINSETSTYLES:
+    case QsciScintillaBase::SCI_ANNOTATIONSETSTYLES:
+        // These take a style for each character of the existing text.
+        enter();
+        len = ed->SendScintilla(
+                msg == QsciScintillaBase::SCI_MARGINSETSTYLES ?
+                        QsciScintillaBase::SCI_MARGINGETTEXT :
+                        QsciScintillaBase::SCI_ANNOTATIONGETTEXT,
+                wParam, static_cast<const char *>(0));
+        leave();
+        break;
+
+    case QsciScintillaBase::SCI_MARKERDEFINERGBAIMAGE:
+    case QsciScintillaBase::SCI_REGISTERRGBAIMAGE:
+        // The size of the image isn't known here.
+        recordSkipped();
+        return;
+
+    default:
+        len = qstrlen(lParam);
+    }
+
+    beginRecord(StringMessage);
+    *out << static_cast<quint32>(msg) << static_cast<quint64>(wParam)
+            << QByteArray(lParam, len);
+}
+
+
+// Record a message with two string arguments.
+void QsciSessionRecorder::recordMessage(unsigned int msg, const char *wParam,
+        const char *lParam)
+{
+    if (!recording())
+        return;
+
+    if (isStringResultMessage(msg))
+    {
+        beginRecord(StringResultMessage);
+        *out << static_cast<quint32>(msg) << QByteArray(wParam);
+        return;
+    }
+
+    beginRecord(StringsMessage);
+    *out << static_cast<quint32>(msg) << QByteArray(wParam)
+            << QByteArray(lParam);
+}
+
+
+// Record a message that returns a range of text.
+void QsciSessionRecorder::recordMessage(unsigned int msg, long cpMin,
+        long cpMax)
+{
+    if (!recording())
+        return;
+
+    beginRecord(RangeMessage);
+    *out << static_cast<quint32>(msg) << static_cast<qint64>(cpMin)
+            << static_cast<qint64>(cpMax);
+}
+
+
+// Count a message that can't be recorded.
+void QsciSessionRecorder::recordSkipped()
+{
+    if (recording())
+        ++nr_skipped;
+}
+
+
+// Record an event received by the editor or its viewport.
+void QsciSessionRecorder::recordEvent(QEvent *e, bool viewport)
+{
+    if (!recording())
+        return;
+
+    switch (e->type())
+    {
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+        if (!viewport)
+        {
+            QKeyEvent *ke = static_cast<QKeyEvent *>(e);
+
+            beginRecord(Key);
+            *out << static_cast<quint16>(ke->type())
+                    << static_cast<qint32>(ke->key())
+                    << static_cast<quint32>(ke->modifiers()) << ke->text()
+                    << ke->isAutoRepeat() << static_cast<quint16>(ke->count());
+        }
+
+        break;
+
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+        if (viewport)
+        {
+            QMouseEvent *me = static_cast<QMouseEvent *>(e);
+
+            beginRecord(Mouse);
+            *out << static_cast<quint16>(me->type()) << me->pos()
+                    << static_cast<quint32>(me->button())
+                    << static_cast<quint32>(me->buttons())
+                    << static_cast<quint32>(me->modifiers());
+        }
+
+        break;
+
+    case QEvent::Wheel:
+        if (viewport)
+        {
+            QWheelEvent *we = static_cast<QWheelEvent *>(e);
+#if QT_VERSION >= 0x050e00
+            QPointF pos = we->position();
+#else
+            QPointF pos = we->posF();
+#endif
+
+            beginRecord(Wheel);
+            *out << pos << we->pixelDelta() << we->angleDelta()
+                    << static_cast<quint32>(we->buttons())
+                    << static_cast<quint32>(we->modifiers())
+                    << static_cast<quint8>(we->phase()) << we->inverted();
+        }
+
+        break;
+
+    case QEvent::InputMethod:
+        if (!viewport)
+        {
+            QInputMethodEvent *ime = static_cast<QInputMethodEvent *>(e);
+            const QList<QInputMethodEvent::Attribute> &attrs = ime->attributes();
+
+            beginRecord(InputMethod);
+            *out << ime->preeditString() << ime->commitString()
+                    << static_cast<qint32>(ime->replacementStart())
+                    << static_cast<qint32>(ime->replacementLength())
+                    << static_cast<quint32>(attrs.size());
+
+            for (int i = 0; i < attrs.size(); ++i)
+            {
+                const QInputMethodEvent::Attribute &a = attrs.at(i);
+
+                *out << static_cast<qint32>(a.type)
+                        << static_cast<qint32>(a.start)
+                        << static_cast<qint32>(a.length) << a.value;
+            }
+        }
+
+        break;
+
+    case QEvent::FocusIn:
+    case QEvent::FocusOut:
+        if (!viewport)
+        {
+            QFocusEvent *fe = static_cast<QFocusEvent *>(e);
+
+            beginRecord(Focus);
+            *out << static_cast<quint16>(fe->type())
+                    << static_cast<quint16>(fe->reason());
+        }
+
+        break;
+
+    case QEvent::Resize:
+        if (!viewport)
+        {
+            beginRecord(Resize);
+            *out << static_cast<QResizeEvent *>(e)->size();
+        }
+
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+// Record a change to the value of a scroll bar.
+void QsciSessionRecorder::recordScroll(Qt::Orientation orientation, int value)
+{
+    if (!recording())
+        return;
+
+    beginRecord(Scroll);
+    *out << static_cast<quint8>(orientation) << static_cast<qint32>(value);
+}
+
+
+// Record the messages that recreate the current state of the editor.
+void QsciSessionRecorder::captureState()
+{
+    beginRecord(Resize);
+    *out << ed->size();
+
+    // How the text is interpreted.
+    captureSetting(QsciScintillaBase::SCI_GETCODEPAGE,
+            QsciScintillaBase::SCI_SETCODEPAGE);
+    captureSetting(QsciScintillaBase::SCI_GETEOLMODE,
+            QsciScintillaBase::SCI_SETEOLMODE);
+
+    // The text.  This is added rather than set so that any nuls are included.
+    long len = ed->SendScintilla(QsciScintillaBase::SCI_GETLENGTH);
+    QByteArray text(len + 1, '\0');
+    ed->SendScintilla(QsciScintillaBase::SCI_GETTEXT, len + 1, text.data());
+    text.truncate(len);
+
+    beginRecord(Message);
+    *out << static_cast<quint32>(QsciScintillaBase::SCI_SETREADONLY)
+            << static_cast<quint64>(0) << static_cast<qint64>(0);
+    beginRecord(Message);
+    *out << static_cast<quint32>(QsciScintillaBase::SCI_CLEARALL)
+            << static_cast<quint64>(0) << static_cast<qint64>(0);
+    beginRecord(StringMessage);
+    *out << static_cast<quint32>(QsciScintillaBase::SCI_ADDTEXT)
+            << static_cast<quint64>(len) << text;
+    beginRecord(Message);
+    *out << static_cast<quint32>(QsciScintillaBase::SCI_EMPTYUNDOBUFFER)
+            << static_cast<quint64>(0) << static_cast<qint64>(0);
+
+    if (!ed->SendScintilla(QsciScintillaBase::SCI_GETMODIFY))
+    {
+        beginRecord(Message);
+        *out << static_cast<quint32>(QsciScintillaBase::SCI_SETSAVEPOINT)
+                << static_cast<quint64>(0) << static_cast<qint64>(0);
+    }
+
+    // The lexer, its properties and keywords.
+    bool container = (ed->SendScintilla(QsciScintillaBase::SCI_GETLEXER) ==
+            QsciScintillaBase::SCLEX_CONTAINER);
+
+    if (container)
+    {
+        beginRecord(Message);
+        *out << static_cast<quint32>(QsciScintillaBase::SCI_SETLEXER)
+                << static_cast<quint64>(QsciScintillaBase::SCLEX_CONTAINER)
+                << static_cast<qint64>(0);
+    }
+    else
+    {
+        beginRecord(StringMessage);
+        *out << static_cast<quint32>(QsciScintillaBase::SCI_SETLEXERLANGUAGE)
+                << static_cast<quint64>(0)
+                << stringResult(ed, QsciScintillaBase::SCI_GETLEXERLANGUAGE,
+                        0);
+
+        QList<QByteArray> names = stringResult(ed,
+                QsciScintillaBase::SCI_PROPERTYNAMES, 0).split('\n');
+
+        for (int i = 0; i < names.size(); ++i)
+        {
+            const QByteArray &name = names.at(i);
+
+            if (name.isEmpty())
+                continue;
+
+            beginRecord(StringsMessage);
+            *out << static_cast<quint32>(QsciScintillaBase::SCI_SETPROPERTY)
+                    << name
+                    << keyedStringResult(ed,
+                            QsciScintillaBase::SCI_GETPROPERTY,
+                            name.constData());
+        }
+
+        QsciScintilla *qsci = qobject_cast<QsciScintilla *>(ed);
+        QsciLexer *lex = (qsci ? qsci->lexer() : 0);
+
+        if (lex)
+        {
+            for (int k = 0; k <= KEYWORDSET_MAX; ++k)
+            {
+                const char *kw = lex->keywords(k + 1);
+
+                if (kw)
+                {
+                    beginRecord(StringMessage);
+                    *out << static_cast<quint32>(
+                                    QsciScintillaBase::SCI_SETKEYWORDS)
+                            << static_cast<quint64>(k) << QByteArray(kw);
+                }
+            }
+        }
+    }
+
+    captureStyles();
+
+    // A container lexer has nothing to restyle the text with.
+    if (container && len > 0)
+    {
+        QByteArray cells(len * 2 + 2, '\0');
+        ed->SendScintilla(QsciScintillaBase::SCI_GETSTYLEDTEXT, 0, len,
+                cells.data());
+
+        QByteArray styles(len, '\0');
+
+        for (long i = 0; i < len; ++i)
+            styles[static_cast<int>(i)] = cells.at(static_cast<int>(i * 2 + 1));
+
+        beginRecord(Message);
+        *out << static_cast<quint32>(QsciScintillaBase::SCI_STARTSTYLING)
+                << static_cast<quint64>(0) << static_cast<qint64>(0);
+        beginRecord(StringMessage);
+        *out << static_cast<quint32>(QsciScintillaBase::SCI_SETSTYLINGEX)
+                << static_cast<quint64>(len) << styles;
+    }
+
+    // The margins.
+    captureSetting(QsciScintillaBase::SCI_GETMARGINS,
+            QsciScintillaBase::SCI_SETMARGINS);
+
+    int nr_margins = ed->SendScintilla(QsciScintillaBase::SCI_GETMARGINS);
+
+    for (int m = 0; m < nr_margins; ++m)
+        for (size_t i = 0; i < sizeof (marginSettings) / sizeof (marginSettings[0]); ++i)
+            captureSetting(marginSettings[i][0], marginSettings[i][1], m);
+
+    // The view settings.
+    for (size_t i = 0; i < sizeof (settings) / sizeof (settings[0]); ++i)
+        captureSetting(settings[i][0], settings[i][1]);
+
+    // The selection and scroll position.
+    beginRecord(Message);
+    *out << static_cast<quint32>(QsciScintillaBase::SCI_SETSEL)
+            << static_cast<quint64>(ed->SendScintilla(
+                    QsciScintillaBase::SCI_GETANCHOR))
+            << static_cast<qint64>(ed->SendScintilla(
+                    QsciScintillaBase::SCI_GETCURRENTPOS));
+
+    captureSetting(QsciScintillaBase::SCI_GETFIRSTVISIBLELINE,
+            QsciScintillaBase::SCI_SETFIRSTVISIBLELINE);
+    captureSetting(QsciScintillaBase::SCI_GETXOFFSET,
+            QsciScintillaBase::SCI_SETXOFFSET);
+}
+
+
+// Record the message that restores a setting.  If index is not negative then
+// it identifies the instance (e.g. a margin) of the setting.
+void QsciSessionRecorder::captureSetting(int get_msg, int set_msg, int index)
+{
+    long value = ed->SendScintilla(get_msg,
+            static_cast<unsigned long>(index < 0 ? 0 : index));
+
+    beginRecord(Message);
+
+    if (index >= 0)
+        *out << static_cast<quint32>(set_msg) << static_cast<quint64>(index)
+                << static_cast<qint64>(value);
+    else
+        *out << static_cast<quint32>(set_msg) << static_cast<quint64>(value)
+                << static_cast<qint64>(0);
+}
+
+
+// Record the messages that restore the styles.  The default style is
+// restored and copied to all the others.  Only those styles that are
+// different to it are then restored.
+void QsciSessionRecorder::captureStyles()
+{
+    const int nr_attrs = sizeof (styleSettings) / sizeof (styleSettings[0]);
+    long defaults[nr_attrs];
+    QByteArray default_font = stringResult(ed,
+            QsciScintillaBase::SCI_STYLEGETFONT,
+            QsciScintillaBase::STYLE_DEFAULT);
+
+    for (int a = 0; a < nr_attrs; ++a)
+        defaults[a] = ed->SendScintilla(styleSettings[a][0],
+                static_cast<unsigned long>(QsciScintillaBase::STYLE_DEFAULT));
+
+    for (int style = -1; style <= QsciScintillaBase::STYLE_MAX; ++style)
+    {
+        // The default style is restored first.
+        bool is_default = (style < 0);
+        unsigned long s = (is_default ? QsciScintillaBase::STYLE_DEFAULT : style);
+
+        if (!is_default && s == QsciScintillaBase::STYLE_DEFAULT)
+            continue;
+
+        QByteArray font = (is_default ? default_font :
+                stringResult(ed, QsciScintillaBase::SCI_STYLEGETFONT, s));
+
+        if (is_default || font != default_font)
+        {
+            beginRecord(StringMessage);
+            *out << static_cast<quint32>(QsciScintillaBase::SCI_STYLESETFONT)
+                    << static_cast<quint64>(s) << font;
+        }
+
+        for (int a = 0; a < nr_attrs; ++a)
+        {
+            long value = (is_default ? defaults[a] :
+                    ed->SendScintilla(styleSettings[a][0], s));
+
+            if (is_default || value != defaults[a])
+            {
+                beginRecord(Message);
+                *out << static_cast<quint32>(styleSettings[a][1])
+                        << static_cast<quint64>(s)
+                        << static_cast<qint64>(value);
+            }
+        }
+
+        if (is_default)
+        {
+            beginRecord(Message);
+            *out << static_cast<quint32>(QsciScintillaBase::SCI_STYLECLEARALL)
+                    << static_cast<quint64>(0) << static_cast<qint64>(0);
+        }
+    }
+}
+
+
+// Return true if a message returns a string in an lParam buffer.
+bool QsciSessionRecorder::isResultMessage(unsigned int msg)
+{
+    for (size_t i = 0; i < sizeof (resultMessages) / sizeof (resultMessages[0]); ++i)
+        if (resultMessages[i] == msg)
+            return true;
+
+    return false;
+}
+
+
+// Return true if a message takes a string as wParam and returns a string in
+// an lParam buffer.
+bool QsciSessionRecorder::isStringResultMessage(unsigned int msg)
+{
+    for (size_t i = 0; i < sizeof (stringResultMessages) / sizeof (stringResultMessages[0]); ++i)
+        if (stringResultMessages[i] == msg)
+            return true;
+
+    return false;
+}
@@ -0,0 +1,636 @@
+// This module implements the QsciSessionReplayer class.
+//
+// Copyright (c) 2022 Riverbank Computing Limited <info@riverbankcomputing.com>
+// 
+// This file is part of QScintilla.
+// 
+// This file may be used under the terms of the GNU General Public License
+// version 3.0 as published by the Free Software Foundation and appearing in
+// the file LICENSE included in the packaging of this file.  Please review the
+// following information to ensure the GNU General Public License version 3.0
+// requirements will be met: http://www.gnu.org/copyleft/gpl.html.
+// 
+// If you do not wish to use this file under the terms of the GPL version 3.0
+// then you may purchase a commercial license.  For more information contact
+// info@riverbankcomputing.com.
+// 
+// This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+// WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+
+#include "Qsci/qscisessionreplayer.h"
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFocusEvent>
+#include <QInputMethodEvent>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPair>
+#include <QScrollBar>
+#include <QSize>
+#include <QThread>
+#include <QVariant>
+#include <QWheelEvent>
+
+#include "Qsci/qsciscintillabase.h"
+#include "Qsci/qscisessionrecorder.h"
+
+
+// The number of slowest steps included in a report.
+static const int nrSlowestSteps = 10;
+
+
+// Return the value at a percentile of a sorted list of latencies.
+static qint64 percentile(const QList<qint64> &sorted, int pc)
+{
+    return sorted.at((sorted.size() - 1) * pc / 100);
+}
+
+
+// Return true if one step is slower than another.
+static bool slowerStep(const QPair<qint64, int> &a, const QPair<qint64, int> &b)
+{
+    return a.first > b.first;
+}
+
+
+// The ctor.
+QsciSessionReplayer::QsciSessionReplayer(QsciScintillaBase *editor)
+    : QObject(editor), ed(editor)
+{
+}
+
+
+// The dtor.
+QsciSessionReplayer::~QsciSessionReplayer()
+{
+}
+
+
+// Return the editor.
+QsciScintillaBase *QsciSessionReplayer::editor() const
+{
+    return ed;
+}
+
+
+// Load a session from a file.
+bool QsciSessionReplayer::load(const QString &filename)
+{
+    records.clear();
+
+    QFile f(filename);
+
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    quint16 version;
+    QByteArray compressed;
+
+    in >> magic >> version;
+
+    if (in.status() != QDataStream::Ok || magic != QsciSessionRecorder::Magic
+            || version != QsciSessionRecorder::Version)
+        return false;
+
+    in >> compressed;
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    records = qUncompress(compressed);
+
+    return !records.isEmpty();
+}
+
+
+// Replay the session.
+bool QsciSessionReplayer::replay(bool real_time)
+{
+    step_types.clear();
+    step_times.clear();
+    step_latencies.clear();
+    step_descriptions.clear();
+
+    if (!ed || records.isEmpty())
+        return false;
+
+    QDataStream in(records);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    bool restoring = true;
+    QElapsedTimer clock, timer;
+
+    while (!in.atEnd())
+    {
+        quint8 type;
+        qint64 when;
+
+        in >> type >> when;
+
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        if (type == QsciSessionRecorder::StateCaptured)
+        {
+            // Make sure the initial state is fully displayed before starting.
+            flushUpdates();
+            QCoreApplication::processEvents();
+
+            restoring = false;
+            clock.start();
+
+            continue;
+        }
+
+        if (real_time && !restoring)
+        {
+            qint64 remaining;
+
+            while ((remaining = when - clock.nsecsElapsed() / 1000) > 0)
+            {
+                QCoreApplication::processEvents();
+                QThread::usleep(qMin(remaining, qint64(1000)));
+            }
+        }
+
+        QString desc;
+
+        timer.start();
+
+        if (!replayRecord(in, type, desc))
+            return false;
+
+        flushUpdates();
+
+        qint64 latency = timer.nsecsElapsed() / 1000;
+
+        if (!restoring)
+        {
+            step_types.append(type);
+            step_times.append(when);
+            step_latencies.append(latency);
+            step_descriptions.append(desc);
+        }
+
+        // Allow timers and posted events to be handled as they would have
+        // been between the recorded steps.
+        QCoreApplication::processEvents();
+    }
+
+    return true;
+}
+
+
+// Replay a single record.
+bool QsciSessionReplayer::replayRecord(QDataStream &in, int type,
+        QString &desc)
+{
+    switch (type)
+    {
+    case QsciSessionRecorder::Message:
+        {
+            quint32 msg;
+            quint64 wParam;
+            qint64 lParam;
+
+            in >> msg >> wParam >> lParam;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            ed->SendScintilla(msg, static_cast<unsigned long>(wParam),
+                    static_cast<long>(lParam));
+
+            desc = QString("message %1 (%2, %3)").arg(msg).arg(wParam).arg(lParam);
+            break;
+        }
+
+    case QsciSessionRecorder::StringMessage:
+        {
+            quint32 msg;
+            quint64 wParam;
+            QByteArray lParam;
+
+            in >> msg >> wParam >> lParam;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            ed->SendScintilla(msg, static_cast<uintptr_t>(wParam),
+                    lParam.constData());
+
+            desc = QString("message %1 (%2, %3 bytes)").arg(msg).arg(wParam).arg(lParam.size());
+            break;
+        }
+
+    case QsciSessionRecorder::StringsMessage:
+        {
+            quint32 msg;
+            QByteArray wParam, lParam;
+
+            in >> msg >> wParam >> lParam;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            ed->SendScintilla(msg,
+                    (wParam.isNull() ? 0 : wParam.constData()),
+                    (lParam.isNull() ? 0 : lParam.constData()));
+
+            desc = QString("message %1 (\"%2\", %3 bytes)").arg(msg)
+                    .arg(QString::fromLatin1(wParam)).arg(lParam.size());
+            break;
+        }
+
+    case QsciSessionRecorder::ResultMessage:
+        {
+            quint32 msg;
+            quint64 wParam;
+
+            in >> msg >> wParam;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            // Ask for the size of the result.  Some messages limit the
+            // result to the size of the buffer given by wParam.
+            long size = ed->SendScintilla(msg, static_cast<uintptr_t>(wParam),
+                    static_cast<const char *>(0));
+
+            if ((msg == QsciScintillaBase::SCI_GETTEXT
+                        || msg == QsciScintillaBase::SCI_GETCURLINE)
+                    && static_cast<long>(wParam) > size)
+                size = wParam;
+
+            QByteArray buf(size + 1, '\0');
+            ed->SendScintilla(msg, static_cast<uintptr_t>(wParam),
+                    buf.data());
+
+            desc = QString("message %1 (%2, buffer)").arg(msg).arg(wParam);
+            break;
+        }
+
+    case QsciSessionRecorder::StringResultMessage:
+        {
+            quint32 msg;
+            QByteArray wParam;
+
+            in >> msg >> wParam;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            long size = ed->SendScintilla(msg, wParam.constData(),
+                    static_cast<const char *>(0));
+
+            QByteArray buf(size + 1, '\0');
+            ed->SendScintilla(msg, wParam.constData(), buf.data());
+
+            desc = QString("message %1 (\"%2\", buffer)").arg(msg).arg(QString::fromLatin1(wParam));
+            break;
+        }
+
+    case QsciSessionRecorder::RangeMessage:
+        {
+            quint32 msg;
+            qint64 cpMin, cpMax;
+
+            in >> msg >> cpMin >> cpMax;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            // Allow for styled text which has two bytes per character.
+            long end = (cpMax < 0 ? ed->SendScintilla(QsciScintillaBase::SCI_GETLENGTH) : cpMax);
+            long size = qMax(end - static_cast<long>(cpMin), 0L);
+
+            QByteArray buf(size * 2 + 2, '\0');
+            ed->SendScintilla(msg, static_cast<long>(cpMin),
+                    static_cast<long>(cpMax), buf.data());
+
+            desc = QString("message %1 (%2-%3)").arg(msg).arg(cpMin).arg(cpMax);
+            break;
+        }
+
+    case QsciSessionRecorder::Key:
+        {
+            quint16 ktype;
+            qint32 key;
+            quint32 modifiers;
+            QString text;
+            bool autorep;
+            quint16 count;
+
+            in >> ktype >> key >> modifiers >> text >> autorep >> count;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            QKeyEvent ke(static_cast<QEvent::Type>(ktype), key,
+                    Qt::KeyboardModifiers(modifiers), text, autorep, count);
+            QCoreApplication::sendEvent(ed, &ke);
+
+            desc = QString("key %1 0x%2")
+                    .arg(ktype == QEvent::KeyPress ? "press" : "release")
+                    .arg(key, 0, 16);
+            break;
+        }
+
+    case QsciSessionRecorder::Mouse:
+        {
+            quint16 mtype;
+            QPoint pos;
+            quint32 button, buttons, modifiers;
+
+            in >> mtype >> pos >> button >> buttons >> modifiers;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            QWidget *vp = ed->viewport();
+            QMouseEvent me(static_cast<QEvent::Type>(mtype), QPointF(pos),
+                    QPointF(vp->mapToGlobal(pos)),
+                    static_cast<Qt::MouseButton>(button),
+                    Qt::MouseButtons(buttons),
+                    Qt::KeyboardModifiers(modifiers));
+            QCoreApplication::sendEvent(vp, &me);
+
+            desc = QString("mouse %1 at %2,%3").arg(mtype).arg(pos.x()).arg(pos.y());
+            break;
+        }
+
+    case QsciSessionRecorder::Wheel:
+        {
+            QPointF pos;
+            QPoint pixel_delta, angle_delta;
+            quint32 buttons, modifiers;
+            quint8 phase;
+            bool inverted;
+
+            in >> pos >> pixel_delta >> angle_delta >> buttons >> modifiers
+                    >> phase >> inverted;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            QWidget *vp = ed->viewport();
+#if QT_VERSION >= 0x050c00
+            QWheelEvent we(pos, vp->mapToGlobal(pos.toPoint()), pixel_delta,
+                    angle_delta, Qt::MouseButtons(buttons),
+                    Qt::KeyboardModifiers(modifiers),
+                    static_cast<Qt::ScrollPhase>(phase), inverted);
+#else
+            bool vertical = (angle_delta.y() != 0);
+            QWheelEvent we(pos, vp->mapToGlobal(pos.toPoint()), pixel_delta,
+                    angle_delta, vertical ? angle_delta.y() : angle_delta.x(),
+                    vertical ? Qt::Vertical : Qt::Horizontal,
+                    Qt::MouseButtons(buttons),
+                    Qt::KeyboardModifiers(modifiers),
+                    static_cast<Qt::ScrollPhase>(phase),
+                    Qt::MouseEventNotSynthesized, inverted);
+#endif
+            QCoreApplication::sendEvent(vp, &we);
+
+            desc = QString("wheel %1,%2").arg(angle_delta.x()).arg(angle_delta.y());
+            break;
+        }
+
+    case QsciSessionRecorder::InputMethod:
+        {
+            QString preedit, commit;
+            qint32 start, length;
+            quint32 nr_attrs;
+            QList<QInputMethodEvent::Attribute> attrs;
+
+            in >> preedit >> commit >> start >> length >> nr_attrs;
+
+            for (quint32 i = 0; i < nr_attrs && in.status() == QDataStream::Ok; ++i)
+            {
+                qint32 atype, astart, alength;
+                QVariant value;
+
+                in >> atype >> astart >> alength >> value;
+
+                attrs.append(QInputMethodEvent::Attribute(
+                        static_cast<QInputMethodEvent::AttributeType>(atype),
+                        astart, alength, value));
+            }
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            QInputMethodEvent ime(preedit, attrs);
+            ime.setCommitString(commit, start, length);
+            QCoreApplication::sendEvent(ed, &ime);
+
+            desc = QString("input method \"%1\" \"%2\"").arg(preedit).arg(commit);
+            break;
+        }
+
+    case QsciSessionRecorder::Focus:
+        {
+            quint16 ftype, reason;
+
+            in >> ftype >> reason;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            QFocusEvent fe(static_cast<QEvent::Type>(ftype),
+                    static_cast<Qt::FocusReason>(reason));
+            QCoreApplication::sendEvent(ed, &fe);
+
+            desc = QString("focus %1").arg(ftype == QEvent::FocusIn ? "in" : "out");
+            break;
+        }
+
+    case QsciSessionRecorder::Resize:
+        {
+            QSize size;
+
+            in >> size;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            ed->resize(size);
+
+            desc = QString("resize %1x%2").arg(size.width()).arg(size.height());
+            break;
+        }
+
+    case QsciSessionRecorder::Scroll:
+        {
+            quint8 orientation;
+            qint32 value;
+
+            in >> orientation >> value;
+
+            if (in.status() != QDataStream::Ok)
+                return false;
+
+            if (orientation == Qt::Vertical)
+                ed->verticalScrollBar()->setValue(value);
+            else
+                ed->horizontalScrollBar()->setValue(value);
+
+            desc = QString("scroll %1 to %2")
+                    .arg(orientation == Qt::Vertical ? "vertically" : "horizontally")
+                    .arg(value);
+            break;
+        }
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+
+// Do any pending repaints of the editor now.
+void QsciSessionReplayer::flushUpdates()
+{
+    QCoreApplication::sendPostedEvents(ed->window(), QEvent::UpdateRequest);
+}
+
+
+// Return the number of steps replayed.
+int QsciSessionReplayer::stepCount() const
+{
+    return step_latencies.size();
+}
+
+
+// Return the description of a step.
+QString QsciSessionReplayer::stepDescription(int step) const
+{
+    return step_descriptions.at(step);
+}
+
+
+// Return the time a step was recorded.
+qint64 QsciSessionReplayer::stepTime(int step) const
+{
+    return step_times.at(step);
+}
+
+
+// Return the latency of a step.
+qint64 QsciSessionReplayer::stepLatency(int step) const
+{
+    return step_latencies.at(step);
+}
+
+
+// Return a report of the latencies.
+QString QsciSessionReplayer::report() const
+{
+    QString rep = QString("%1 %2 %3 %4 %5 %6\n").arg("step", -14)
+            .arg("count", 8).arg("mean us", 10).arg("p50 us", 10)
+            .arg("p95 us", 10).arg("max us", 10);
+
+    // Summarise each kind of step in the order they are defined.
+    QStringList kinds;
+
+    for (int type = QsciSessionRecorder::Message; type < QsciSessionRecorder::StateCaptured; ++type)
+        if (!kinds.contains(typeName(type)))
+            kinds.append(typeName(type));
+
+    for (int k = 0; k < kinds.size(); ++k)
+    {
+        QList<qint64> latencies;
+        qint64 total = 0;
+
+        for (int i = 0; i < step_types.size(); ++i)
+            if (typeName(step_types.at(i)) == kinds.at(k))
+            {
+                latencies.append(step_latencies.at(i));
+                total += step_latencies.at(i);
+            }
+
+        if (latencies.isEmpty())
+            continue;
+
+        std::sort(latencies.begin(), latencies.end());
+
+        rep += QString("%1 %2 %3 %4 %5 %6\n").arg(kinds.at(k), -14)
+                .arg(latencies.size(), 8).arg(total / latencies.size(), 10)
+                .arg(percentile(latencies, 50), 10)
+                .arg(percentile(latencies, 95), 10)
+                .arg(latencies.last(), 10);
+    }
+
+    // List the slowest steps.
+    QList<QPair<qint64, int> > slowest;
+
+    for (int i = 0; i < step_latencies.size(); ++i)
+        slowest.append(qMakePair(step_latencies.at(i), i));
+
+    std::stable_sort(slowest.begin(), slowest.end(), slowerStep);
+
+    if (!slowest.isEmpty())
+        rep += "\nslowest steps:\n";
+
+    for (int i = 0; i < slowest.size() && i < nrSlowestSteps; ++i)
+    {
+        int step = slowest.at(i).second;
+
+        rep += QString("%1 us at %2 s: %3\n").arg(slowest.at(i).first, 10)
+                .arg(step_times.at(step) / 1e6, 0, 'f', 3)
+                .arg(step_descriptions.at(step));
+    }
+
+    return rep;
+}
+
+
+// Return the name of a type of step.
+QString QsciSessionReplayer::typeName(int type)
+{
+    switch (type)
+    {
+    case QsciSessionRecorder::Message:
+    case QsciSessionRecorder::StringMessage:
+    case QsciSessionRecorder::StringsMessage:
+        return "message";
+
+    case QsciSessionRecorder::ResultMessage:
+    case QsciSessionRecorder::StringResultMessage:
+    case QsciSessionRecorder::RangeMessage:
+        return "query";
+
+    case QsciSessionRecorder::Key:
+        return "key";
+
+    case QsciSessionRecorder::Mouse:
+        return "mouse";
+
+    case QsciSessionRecorder::Wheel:
+        return "wheel";
+
+    case QsciSessionRecorder::InputMethod:
+        return "input method";
+
+    case QsciSessionRecorder::Focus:
+        return "focus";
+
+    case QsciSessionRecorder::Resize:
+        return "resize";
+
+    case QsciSessionRecorder::Scroll:
+        return "scroll";
+    }
+
+    return QString();
+}